@@ -135,6 +135,8 @@ void LXActorLight::DefineProperties()
 	DefineProperty("TargetDistance", &_fTargetDistance);
 	auto pPropSpotAngle = DefinePropertyFloat("SpotAngle", GetAutomaticPropertyID(), &_fSpotAngle);
 	pPropSpotAngle->SetMinMax(1.f, 179.f);
+
+	DefinePropertyFloat("Range", GetAutomaticPropertyID(), &_fRange);
 }
 
 void LXActorLight::OnPropertyChanged(LXProperty* Property)
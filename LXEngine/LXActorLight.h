@@ -70,6 +70,9 @@ private:
 
 	// Spot
 	GetSetDef(float, _fSpotAngle, SpotAngle, 35.f);
+
+	// Spot and Omni: influence distance, bounds the light for the clustered lighting
+	GetSetDef(float, _fRange, Range, 1000.f);
 	
 	float _fTargetDistance = 1.f; 
 
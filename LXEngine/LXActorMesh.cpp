@@ -69,6 +69,9 @@ void LXActorMesh::DefineProperties( )
 	//CastShadows
 	DefinePropertyBool(L"CastShadows", GetAutomaticPropertyID(), &_bCastShadows);
 
+	//Occluder
+	DefinePropertyBool(L"Occluder", GetAutomaticPropertyID(), &_bOccluder);
+
 	//Asset
 	auto PropAssetMesh = DefineProperty(L"AssetMesh", (LXAsset**)&_AssetMesh);
 	PropAssetMesh->SetLambdaOnChange([this](LXPropertyAssetPtr* Property)
@@ -116,6 +119,15 @@ void LXActorMesh::UpdateAssetMeshCallbacks()
 			_bValidWorldPrimitives = false;
 			InvalidateRenderState();
 		});
+
+		// Asynchronous load completed
+		_AssetMesh->RegisterCB(this, L"Loaded", [this](LXSmartObject* SmartObject)
+		{
+			UpdateMesh();
+			InvalidateBounds(true);
+			_bValidWorldPrimitives = false;
+			InvalidateRenderState();
+		});
 	}
 }
 
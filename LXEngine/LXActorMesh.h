@@ -73,6 +73,7 @@ public:
 	void							SetMesh(LXMesh* Mesh);
 	LXMesh*							GetMesh() { return Mesh; }
 	void							SetAssetMesh(LXAssetMesh* AssetMesh);
+	LXAssetMesh*					GetAssetMesh() const { return _AssetMesh; }
 
 private:
 
@@ -93,6 +94,7 @@ protected:
 	GetSetDef(int, _nLayer, Layer, 0);
 	GetSetDef(bool, _showOutlines, ShowOutlines, false);
 	GetSetDef(bool, _bCastShadows, CastShadows, true);
+	GetSetDef(bool, _bOccluder, Occluder, false);	// Rasterized by the software occlusion culling: large or low-poly meshes
 
 private:
 
@@ -8,10 +8,12 @@
 
 #include "stdafx.h"
 #include "LXAsset.h"
+#include "LXAssetManager.h"
 #include "LXCore.h"
 #include "LXProject.h"
 #include "LXSettings.h"
 #include "LXLogger.h"
+#include "LXThreadManager.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
 LXAsset::LXAsset()
@@ -55,9 +57,18 @@ bool LXAsset::Save()
 	LXSmartObject::Save(saveContext);
 	fclose(pFile);
 	_bNeedSave = false;
+
+	if (LXProject* Project = GetCore().GetProject())
+		Project->GetAssetManager().OnAssetSaved(this);
+
 	return true;
 }
 
+void LXAsset::MarkUsed()
+{
+	LastUsedFrame = GetCore().Frame;
+}
+
 LXString LXAsset::GetRelativeFilename() const
 {
 	if (Owner == EResourceOwner::LXResourceOwner_Engine)
@@ -78,7 +89,14 @@ LXString LXAsset::GetRelativeFilename() const
 const ListProperties& LXAsset::GetProperties() const
 {
 	const ListProperties& listProperties =  __super::GetProperties();
-	if (State == EResourceState::LXResourceState_Unloaded)
+	const_cast<LXAsset*>(this)->MarkUsed();
+	if (State == EResourceState::LXResourceState_Loading)
+	{
+		// Completed by the Main thread otherwise
+		if (IsMainThread())
+			GetCore().GetProject()->GetAssetManager().FinishLoading(const_cast<LXAsset*>(this));
+	}
+	else if (State == EResourceState::LXResourceState_Unloaded)
 	{
 		(const_cast<LXAsset*>(this))->Load();
 	}
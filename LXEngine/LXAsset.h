@@ -10,6 +10,7 @@
 
 #include "LXSmartObject.h"
 #include "LXFilepath.h"
+#include <atomic>
 
 enum class EResourceOwner
 {
@@ -26,6 +27,7 @@ public:
 	{
 		LXResourceState_NotAFile,
 		LXResourceState_Unloaded,
+		LXResourceState_Loading,	// Requested to the LXAssetLoader
 		LXResourceState_Loaded
 	};
 	
@@ -33,6 +35,19 @@ public:
 	virtual ~LXAsset();
 
 	virtual bool Load() = 0;
+
+	// Asynchronous loading, first step, on a loader thread: reads and prepares the data used by Load.
+	// Must not touch the other engine objects.
+	virtual bool LoadData() { return true; }
+
+	// Memory budget (LXAssetManager): the CPU data that can be read again from the files.
+	// ReleaseData frees it and sets the asset Unloaded, Load reads it again.
+	virtual uint64 GetMemorySize() const { return 0; }
+	virtual bool ReleaseData() { return false; }
+
+	// The CPU data is used this frame, by any thread
+	void MarkUsed();
+
 	virtual bool Save();
 
 	bool CanBeSaved();
@@ -53,6 +68,12 @@ public:
 
 	EResourceState State = EResourceState::LXResourceState_Unloaded;
 	EResourceOwner Owner = EResourceOwner::LXResourceOwner_Engine;
+	std::atomic<__int64> LastUsedFrame{ 0 };
+
+protected:
+
+	// Loaded once, then Unloaded by ReleaseData
+	bool _DataReleased = false;
 
 };
 
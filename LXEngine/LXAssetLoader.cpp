@@ -0,0 +1,302 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXAssetLoader.h"
+#include "LXAsset.h"
+#include "LXLogger.h"
+#include "LXPerformance.h"
+#include "LXThreadManager.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+LXAssetLoader::LXAssetLoader(uint ThreadCount)
+{
+	for (uint i = 0; i < ThreadCount; i++)
+	{
+		_Threads.push_back(std::thread(&LXAssetLoader::LoaderMain, this));
+	}
+}
+
+LXAssetLoader::~LXAssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		_Exit = true;
+	}
+	_Queued.notify_all();
+
+	// The started loads are finished
+	for (std::thread& Thread : _Threads)
+	{
+		Thread.join();
+	}
+
+	for (auto& It : _Loads)
+	{
+		if (It.first->State == LXAsset::EResourceState::LXResourceState_Loading)
+			It.first->State = LXAsset::EResourceState::LXResourceState_Unloaded;
+	}
+}
+
+void LXAssetLoader::LoaderMain()
+{
+	auto HasQueuedLoads = [this]()
+	{
+		for (const std::deque<shared_ptr<TLoad>>& Queue : _Queues)
+		{
+			if (!Queue.empty())
+				return true;
+		}
+		return false;
+	};
+
+	std::unique_lock<std::mutex> Lock(_Mutex);
+
+	while (true)
+	{
+		_Queued.wait(Lock, [this, &HasQueuedLoads]() { return _Exit || HasQueuedLoads(); });
+
+		if (_Exit)
+			return;
+
+		// Highest priority first
+		shared_ptr<TLoad> Load;
+
+		for (int Priority = 0; Priority < (int)EAssetPriority::Count && !Load; Priority++)
+		{
+			std::deque<shared_ptr<TLoad>>& Queue = _Queues[Priority];
+			while (!Queue.empty() && !Load)
+			{
+				shared_ptr<TLoad> Front = move(Queue.front());
+				Queue.pop_front();
+
+				if (Front->Status == ELoadStatus::Queued && (int)Front->Priority == Priority)
+					Load = move(Front);
+			}
+		}
+
+		if (!Load)
+			continue;
+
+		Load->Status = ELoadStatus::Loading;
+		Lock.unlock();
+
+		const bool Result = Load->Asset->LoadData();
+
+		Lock.lock();
+		Load->Result = Result;
+		Load->Status = ELoadStatus::Ready;
+		_Ready.notify_all();
+	}
+}
+
+LXAssetRequestPtr LXAssetLoader::Request(LXAsset* Asset, EAssetPriority Priority, std::function<void(LXAsset*)> OnLoaded)
+{
+	CHK(IsMainThread());
+	LXAssetRequestPtr Request = make_shared<LXAssetRequest>(Asset, Priority, OnLoaded);
+	shared_ptr<TLoad>& Load = _Loads[Asset];
+
+	if (Load)
+	{
+		Load->Requests.push_back(Request);
+		UpdatePriority(Load);
+		return Request;
+	}
+
+	Load = make_shared<TLoad>();
+	Load->Asset = Asset;
+	Load->Priority = Priority;
+	Load->Requests.push_back(Request);
+
+	if (Asset->State == LXAsset::EResourceState::LXResourceState_Loaded)
+	{
+		// Called back at the next sync point
+		Load->Status = ELoadStatus::Ready;
+		Load->Result = true;
+	}
+	else
+	{
+		Asset->State = LXAsset::EResourceState::LXResourceState_Loading;
+		Queue(Load);
+	}
+
+	return Request;
+}
+
+void LXAssetLoader::SetPriority(const LXAssetRequestPtr& Request, EAssetPriority Priority)
+{
+	CHK(IsMainThread());
+	Request->_Priority = Priority;
+
+	auto It = _Loads.find(Request->_Asset);
+	if (It != _Loads.end() && !Request->_Done && !Request->_Canceled)
+		UpdatePriority(It->second);
+}
+
+void LXAssetLoader::Cancel(const LXAssetRequestPtr& Request)
+{
+	CHK(IsMainThread());
+	if (Request->_Done || Request->_Canceled)
+		return;
+
+	Request->_Canceled = true;
+
+	auto It = _Loads.find(Request->_Asset);
+	if (It == _Loads.end())
+		return;
+
+	shared_ptr<TLoad> Load = It->second;
+	Load->Requests.erase(std::remove(Load->Requests.begin(), Load->Requests.end(), Request), Load->Requests.end());
+
+	if (!Load->Requests.empty())
+	{
+		UpdatePriority(Load);
+		return;
+	}
+
+	// Started loads are completed anyway
+	bool Canceled = false;
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		if (Load->Status == ELoadStatus::Queued)
+		{
+			Load->Status = ELoadStatus::Canceled;
+			Canceled = true;
+		}
+	}
+
+	if (Canceled)
+	{
+		Load->Asset->State = LXAsset::EResourceState::LXResourceState_Unloaded;
+		_Loads.erase(It);
+	}
+}
+
+void LXAssetLoader::Finish(LXAsset* Asset)
+{
+	CHK(IsMainThread());
+	auto It = _Loads.find(Asset);
+	if (It == _Loads.end())
+		return;
+
+	shared_ptr<TLoad> Load = It->second;
+
+	{
+		std::unique_lock<std::mutex> Lock(_Mutex);
+
+		if (Load->Status == ELoadStatus::Queued)
+		{
+			Load->Status = ELoadStatus::Loading;
+			Lock.unlock();
+
+			const bool Result = Asset->LoadData();
+
+			Lock.lock();
+			Load->Result = Result;
+			Load->Status = ELoadStatus::Ready;
+		}
+		else
+		{
+			_Ready.wait(Lock, [&Load]() { return Load->Status == ELoadStatus::Ready; });
+		}
+	}
+
+	_Loads.erase(Asset);
+	Complete(*Load);
+}
+
+void LXAssetLoader::Synchronize(double Budget)
+{
+	CHK(IsMainThread());
+	vector<shared_ptr<TLoad>> ReadyLoads;
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		for (auto& It : _Loads)
+		{
+			if (It.second->Status == ELoadStatus::Ready)
+				ReadyLoads.push_back(It.second);
+		}
+	}
+
+	std::stable_sort(ReadyLoads.begin(), ReadyLoads.end(), [](const shared_ptr<TLoad>& a, const shared_ptr<TLoad>& b)
+	{
+		return a->Priority < b->Priority;
+	});
+
+	LXPerformance Perf;
+
+	for (size_t i = 0; i < ReadyLoads.size(); i++)
+	{
+		if (i > 0 && Perf.GetTime() > Budget)
+			break;
+
+		_Loads.erase(ReadyLoads[i]->Asset);
+		Complete(*ReadyLoads[i]);
+	}
+}
+
+void LXAssetLoader::Queue(const shared_ptr<TLoad>& Load)
+{
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		_Queues[(int)Load->Priority].push_back(Load);
+	}
+	_Queued.notify_one();
+}
+
+void LXAssetLoader::UpdatePriority(const shared_ptr<TLoad>& Load)
+{
+	EAssetPriority Priority = EAssetPriority::Background;
+	for (const LXAssetRequestPtr& Request : Load->Requests)
+		Priority = std::min(Priority, Request->_Priority);
+
+	bool Queued = false;
+	{
+		std::lock_guard<std::mutex> Lock(_Mutex);
+		if (Load->Priority == Priority)
+			return;
+
+		// The previous entry is skipped when popped
+		Load->Priority = Priority;
+		if (Load->Status == ELoadStatus::Queued)
+		{
+			_Queues[(int)Priority].push_back(Load);
+			Queued = true;
+		}
+	}
+
+	if (Queued)
+		_Queued.notify_one();
+}
+
+void LXAssetLoader::Complete(TLoad& Load)
+{
+	LXAsset* Asset = Load.Asset;
+
+	if (Asset->State != LXAsset::EResourceState::LXResourceState_Loaded)
+	{
+		Asset->State = LXAsset::EResourceState::LXResourceState_Unloaded;
+
+		if (Load.Result)
+			Asset->Load();
+
+		if (Asset->State == LXAsset::EResourceState::LXResourceState_Loaded)
+			LogI(AssetManager, L"Loaded %s", Asset->GetFilepath().GetBuffer());
+		else
+			LogE(AssetManager, L"Failed to load %s", Asset->GetFilepath().GetBuffer());
+	}
+
+	const bool Loaded = Asset->State == LXAsset::EResourceState::LXResourceState_Loaded;
+
+	for (const LXAssetRequestPtr& Request : Load.Requests)
+	{
+		Request->_Done = true;
+		if (Request->_OnLoaded)
+			Request->_OnLoaded(Loaded ? Asset : nullptr);
+	}
+}
@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class LXAsset;
+
+enum class EAssetPriority
+{
+	Visible,
+	Nearby,
+	Background,
+	Count
+};
+
+//
+// Asynchronous load of an asset, returned to the requester.
+// Several requests can share the load of an asset: it runs at the highest of their priorities.
+//
+
+class LXCORE_API LXAssetRequest
+{
+	friend class LXAssetLoader;
+
+public:
+
+	LXAssetRequest(LXAsset* Asset, EAssetPriority Priority, std::function<void(LXAsset*)> OnLoaded) :_Asset(Asset), _Priority(Priority), _OnLoaded(OnLoaded) {}
+
+	LXAsset* GetAsset() const { return _Asset; }
+	EAssetPriority GetPriority() const { return _Priority; }
+
+	// Main thread
+	bool IsDone() const { return _Done; }
+	bool IsCanceled() const { return _Canceled; }
+
+private:
+
+	LXAsset* _Asset;
+	EAssetPriority _Priority;
+	std::function<void(LXAsset*)> _OnLoaded;	// Asset or nullptr if it failed
+	bool _Done = false;
+	bool _Canceled = false;
+};
+
+typedef shared_ptr<LXAssetRequest> LXAssetRequestPtr;
+
+//
+// Loader threads of the LXAssetManager.
+// The loads are done in two steps: LXAsset::LoadData on a loader thread, by priority, then LXAsset::Load
+// on the Main thread, at the sync point (Synchronize) where the requesters are called back.
+// The requests are made, prioritized, canceled and finished on the Main thread only: _Loads is not locked.
+//
+
+class LXAssetLoader
+{
+
+public:
+
+	LXAssetLoader(uint ThreadCount);
+	~LXAssetLoader();
+
+	LXAssetRequestPtr Request(LXAsset* Asset, EAssetPriority Priority, std::function<void(LXAsset*)> OnLoaded);
+	void SetPriority(const LXAssetRequestPtr& Request, EAssetPriority Priority);
+
+	// The requester is not called back. The load is abandoned when no other request needs it and it is not started.
+	void Cancel(const LXAssetRequestPtr& Request);
+
+	// Completes the load of the Asset now, on the calling thread
+	void Finish(LXAsset* Asset);
+
+	// Completes the ready loads, by priority, for at most Budget ms (one at least)
+	void Synchronize(double Budget);
+
+	uint GetPendingCount() const { return (uint)_Loads.size(); }
+
+private:
+
+	enum class ELoadStatus
+	{
+		Queued,
+		Loading,
+		Ready,		// LoadData done
+		Canceled
+	};
+
+	struct TLoad
+	{
+		LXAsset* Asset = nullptr;
+		EAssetPriority Priority = EAssetPriority::Background;
+		ELoadStatus Status = ELoadStatus::Queued;
+		bool Result = false;
+		vector<LXAssetRequestPtr> Requests;
+	};
+
+	void LoaderMain();
+	void Queue(const shared_ptr<TLoad>& Load);
+	void UpdatePriority(const shared_ptr<TLoad>& Load);
+	void Complete(TLoad& Load);
+
+private:
+
+	// Main thread
+	map<LXAsset*, shared_ptr<TLoad>> _Loads;
+
+	// The queues keep the loads canceled or moved to another priority: they are skipped when popped
+	std::mutex _Mutex;
+	std::condition_variable _Queued;
+	std::condition_variable _Ready;
+	std::deque<shared_ptr<TLoad>> _Queues[(int)EAssetPriority::Count];
+	bool _Exit = false;
+
+	vector<std::thread> _Threads;
+};
@@ -20,13 +20,61 @@
 #include "LXDirectory.h"
 #include "LXImporter.h"
 #include "LXAssetMesh.h"
+#include "LXAssetRegistry.h"
 #include "LXMesh.h"
+#include "LXPerformance.h"
 #include "LXConsoleManager.h"
 #include "LXGraphTemplate.h"
+#include "LXStatManager.h"
+#include "LXGeometryContainer.h"
+#include "LXThreadManager.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
 #define LX_DEFAULT_MATERIAL L"Materials/M_Default.smat"
 
+namespace
+{
+	// Memory budgets, in MB of CPU data, 0 for no budget
+	LXConsoleCommandT<int> CSet_MeshMemoryBudget(L"Engine.ini", L"AssetManager", L"MeshMemoryBudget", L"1024");
+	LXConsoleCommandT<int> CSet_TextureMemoryBudget(L"Engine.ini", L"AssetManager", L"TextureMemoryBudget", L"1024");
+	
+	// Frames without use before the data of an asset can be released. Longer than the upload of the asset
+	// by the RenderThread, its actors being synchronized at the frame of their last use.
+	LXConsoleCommandT<int> CSet_AssetEvictionDelay(L"Engine.ini", L"AssetManager", L"EvictionDelay", L"600");
+
+	// Frames between the budget updates
+	const __int64 MemoryBudgetPeriod = 30;
+
+	const wchar_t* AssetTypeNames[] = { L"Other", L"Material", L"Texture", L"Mesh", L"Shader", L"Animation", L"RawTexture" };
+
+	EAssetType GetAssetType(const LXAsset* Asset)
+	{
+		if (dynamic_cast<const LXAssetMesh*>(Asset))
+			return EAssetType::Mesh;
+		else if (dynamic_cast<const LXTexture*>(Asset))
+			return EAssetType::Texture;
+		else if (dynamic_cast<const LXMaterial*>(Asset))
+			return EAssetType::Material;
+		else if (dynamic_cast<const LXShader*>(Asset))
+			return EAssetType::Shader;
+		else if (dynamic_cast<const LXAnimation*>(Asset))
+			return EAssetType::Animation;
+		else
+			return EAssetType::Unknown;
+	}
+
+	uint64 GetMemoryBudget(EAssetType Type)
+	{
+		int Budget = 0;
+		if (Type == EAssetType::Mesh)
+			Budget = CSet_MeshMemoryBudget.GetValue();
+		else if (Type == EAssetType::Texture)
+			Budget = CSet_TextureMemoryBudget.GetValue();
+
+		return Budget > 0 ? (uint64)Budget * 1024 * 1024 : 0;
+	}
+};
+
 //------------------------------------------------------------------------------------------------------
 // Console commands
 //------------------------------------------------------------------------------------------------------
@@ -83,12 +131,52 @@ LXConsoleCommand1S CCCreateNewAnimation(L"CreateNewAnimation", [](const LXString
 	}
 });
 
+// CPU data of the loaded assets by class, at the last budget update
+LXConsoleCommandNoArg CCAssetMemory(L"AssetMemory", []()
+{
+	LXProject* Project = GetCore().GetProject();
+	if (!Project)
+	{
+		LogW(Core, L"No project");
+		return;
+	}
+
+	const LXAssetManager& AssetManager = Project->GetAssetManager();
+	for (int Type = 0; Type < (int)EAssetType::Count; Type++)
+	{
+		const uint64 Size = AssetManager.GetMemorySize((EAssetType)Type);
+		const uint64 Budget = GetMemoryBudget((EAssetType)Type);
+		if (Size > 0 || Budget > 0)
+			LogI(AssetManager, L"%s: %u assets, %.1f MB, budget %.0f MB", AssetTypeNames[Type], AssetManager.GetResidentCount((EAssetType)Type), Size / (1024. * 1024.), Budget / (1024. * 1024.));
+	}
+});
+
+// Rewrites the legacy geometry files of the folder (project assets by default) as geometry containers.
+// ConvertGeometries [Folder] [Compress]: with Compress 1, the containers are compressed.
+LXConsoleCommand2S CCConvertGeometries(L"ConvertGeometries", [](const LXString& inFolder, const LXString& inCompress)
+{
+	LXFilepath Folder = inFolder;
+	if (Folder.IsEmpty())
+	{
+		LXProject* Project = GetCore().GetProject();
+		Folder = Project ? Project->GetAssetFolder() : GetSettings().GetDataFolder();
+	}
+
+	uint ConvertedCount = LXGeometryContainer::ConvertFolder(Folder, _wtoi(inCompress) != 0);
+	LogI(Core, L"%u geometry file(s) converted in %s", ConvertedCount, Folder.GetBuffer());
+});
+
 //------------------------------------------------------------------------------------------------------
 
 const bool ForceLowercase = false;
 
+// Asynchronous loading
+const uint LoaderThreadCount = 2;		// Mostly waiting for the disk, the decoding is done by the LXThreadManager
+const double SynchronizeBudget = 4.;	// ms of Load per sync point
+
 LXAssetManager::LXAssetManager(LXProject* Project) :_pDocument(Project)
 {
+	_AssetLoader = make_unique<LXAssetLoader>(LoaderThreadCount);
 	_graphMaterialTemplate = make_unique<LXGraphTemplate>();
 	VRF(_graphMaterialTemplate->LoadWithMSXML(GetSettings().GetCoreFolder() + L"/GraphMaterialTempale.xml"));
 				
@@ -109,6 +197,13 @@ LXAssetManager::LXAssetManager(LXProject* Project) :_pDocument(Project)
 
 LXAssetManager::~LXAssetManager()
 {
+	// The loader threads can use the assets
+	_AssetLoader.reset();
+
+	// Assets saved since the launch
+	for (auto& It : _AssetRegistries)
+		It.second->Save();
+
 	for (auto It : _MapAssets)
 		delete It.second;
 }
@@ -129,7 +224,17 @@ LXAsset* LXAssetManager::GetAsset(const LXString& Name) const
 	if (It != _MapAssets.end())
 	{
 		LXAsset* Resource = It->second;
-		if (Resource->State == LXAsset::EResourceState::LXResourceState_Unloaded)
+		Resource->MarkUsed();
+
+		if (Resource->State == LXAsset::EResourceState::LXResourceState_Loading)
+		{
+			// The asynchronous loads belong to the Main thread, which completes it and calls back the users
+			if (!IsMainThread())
+				return Resource;
+
+			FinishLoading(Resource);
+		}
+		else if (Resource->State == LXAsset::EResourceState::LXResourceState_Unloaded)
 		{
 			Resource->Load();
 			LogI(AssetManager, L"Loaded %s", Resource->GetFilepath().GetBuffer());
@@ -151,6 +256,155 @@ LXAsset* LXAssetManager::GetAsset(const LXString& Name) const
 	}
 }
 
+LXAssetRequestPtr LXAssetManager::LoadAssetAsync(LXAsset* Asset, EAssetPriority Priority, std::function<void(LXAsset*)> OnLoaded)
+{
+	CHK(Asset);
+	return _AssetLoader->Request(Asset, Priority, OnLoaded);
+}
+
+void LXAssetManager::SetPriority(const LXAssetRequestPtr& Request, EAssetPriority Priority)
+{
+	_AssetLoader->SetPriority(Request, Priority);
+}
+
+void LXAssetManager::Cancel(const LXAssetRequestPtr& Request)
+{
+	_AssetLoader->Cancel(Request);
+}
+
+LXAsset* LXAssetManager::GetAssetAsync(const LXString& Name, EAssetPriority Priority)
+{
+	// The LoadingThread loads the assets of the project it builds, as before the asynchronous loading
+	if (!IsMainThread())
+		return GetAsset(Name);
+
+	LXString key = Name;
+	key.MakeLower();
+
+	auto It = _MapAssets.find(key);
+	
+	// Only the meshes: the other assets are used as soon as they are referenced
+	LXAssetMesh* AssetMesh = It != _MapAssets.end() ? dynamic_cast<LXAssetMesh*>(It->second) : nullptr;
+	if (!AssetMesh)
+		return GetAsset(Name);
+
+	if (AssetMesh->State == LXAsset::EResourceState::LXResourceState_Unloaded)
+		LoadAssetAsync(AssetMesh, Priority);
+
+	return AssetMesh;
+}
+
+void LXAssetManager::FinishLoading(LXAsset* Asset) const
+{
+	_AssetLoader->Finish(Asset);
+}
+
+void LXAssetManager::Synchronize()
+{
+	_AssetLoader->Synchronize(SynchronizeBudget);
+	GetStatManager()->SetFrameCounter(L"AssetManager.PendingLoads", _AssetLoader->GetPendingCount());
+
+	set<LXAsset*> AssetsToUse;
+	{
+		std::lock_guard<std::mutex> Lock(_UseMutex);
+		AssetsToUse.swap(_AssetsToUse);
+	}
+
+	for (LXAsset* Asset : AssetsToUse)
+		UseAsset(Asset);
+
+	if (GetCore().Frame % MemoryBudgetPeriod == 0)
+		UpdateMemoryBudget();
+}
+
+void LXAssetManager::UseAsset(LXAsset* Asset)
+{
+	Asset->MarkUsed();
+
+	if (Asset->State == LXAsset::EResourceState::LXResourceState_Loading)
+	{
+		FinishLoading(Asset);
+	}
+	else if (Asset->State == LXAsset::EResourceState::LXResourceState_Unloaded)
+	{
+		Asset->Load();
+		LogI(AssetManager, L"Loaded %s", Asset->GetFilepath().GetBuffer());
+	}
+}
+
+void LXAssetManager::RequestUse(LXAsset* Asset)
+{
+	Asset->MarkUsed();
+
+	std::lock_guard<std::mutex> Lock(_UseMutex);
+	_AssetsToUse.insert(Asset);
+}
+
+void LXAssetManager::UpdateMemoryBudget()
+{
+	const __int64 LastUsedFrame = GetCore().Frame - CSet_AssetEvictionDelay.GetValue();
+	
+	vector<LXAsset*> Candidates[(int)EAssetType::Count];
+
+	for (int Type = 0; Type < (int)EAssetType::Count; Type++)
+	{
+		_MemorySizes[Type] = 0;
+		_ResidentCounts[Type] = 0;
+	}
+
+	for (auto& It : _MapAssets)
+	{
+		LXAsset* Asset = It.second;
+		if (Asset->State != LXAsset::EResourceState::LXResourceState_Loaded)
+			continue;
+
+		const int Type = (int)GetAssetType(Asset);
+		_MemorySizes[Type] += Asset->GetMemorySize();
+		_ResidentCounts[Type]++;
+
+		if (Asset->LastUsedFrame < LastUsedFrame)
+			Candidates[Type].push_back(Asset);
+	}
+
+	uint ReleasedCount = 0;
+
+	for (int Type = 0; Type < (int)EAssetType::Count; Type++)
+	{
+		const uint64 Budget = GetMemoryBudget((EAssetType)Type);
+		if (Budget == 0 || _MemorySizes[Type] <= Budget)
+			continue;
+
+		// Least recently used first
+		vector<LXAsset*>& Assets = Candidates[Type];
+		std::sort(Assets.begin(), Assets.end(), [](const LXAsset* a, const LXAsset* b) { return a->LastUsedFrame < b->LastUsedFrame; });
+
+		for (LXAsset* Asset : Assets)
+		{
+			if (_MemorySizes[Type] <= Budget)
+				break;
+
+			const uint64 Size = Asset->GetMemorySize();
+			if (Size > 0 && Asset->ReleaseData())
+			{
+				_MemorySizes[Type] -= Size;
+				_ResidentCounts[Type]--;
+				ReleasedCount++;
+			}
+		}
+
+		if (_MemorySizes[Type] > Budget)
+			LogW(AssetManager, L"%s: %.1f MB used, over the budget of %.0f MB", AssetTypeNames[Type], _MemorySizes[Type] / (1024. * 1024.), Budget / (1024. * 1024.));
+	}
+
+	if (ReleasedCount > 0)
+		LogI(AssetManager, L"Memory budget: released the data of %u assets", ReleasedCount);
+
+	for (int Type = 0; Type < (int)EAssetType::Count; Type++)
+	{
+		GetStatManager()->SetFrameCounter(wstring(L"AssetMemory.") + AssetTypeNames[Type], (uint)(_MemorySizes[Type] / 1024));
+	}
+}
+
 template <typename T>
 T LXAssetManager::GetResourceT(const LXString& Name) const
 {
@@ -493,16 +747,18 @@ void LXAssetManager::Add(LXAsset* Resource)
 
 void LXAssetManager::LoadFromFolder(const LXFilepath& Folderpath, EResourceOwner ResourceOwner)
 {
-	LXFilepath AssetFolderpath = Folderpath;
-	LXFilepath Path = AssetFolderpath + "*";
-	//Path += "*";
-	LXDirectory dir(Path);
-	for (auto& FileInfo : dir.GetListFileNames())
+	LXPerformance Perf;
+
+	// Only the folders changed since the last launch are scanned
+	unique_ptr<LXAssetRegistry>& Registry = _AssetRegistries[ResourceOwner];
+	Registry = make_unique<LXAssetRegistry>(Folderpath);
+	Registry->Update();
+
+	const LXFilepath AssetFolderpath = Folderpath;
+	uint AssetCount = 0;
+
+	Registry->ForEachAsset([&](const LXString& RelativeFilepath, const TAssetRegistryEntry& Entry)
 	{
-		LXFilepath Filepath(FileInfo.FullFileName);
-		LXFilepath RelativeFilepath = AssetFolderpath.GetRelativeFilepath(Filepath);
-		LXString Extension = Filepath.GetExtension().MakeLower();
-		
 		LXString AssetKey = BuildKey(ResourceOwner, RelativeFilepath);
 		AssetKey.MakeLower();
 
@@ -510,69 +766,39 @@ void LXAssetManager::LoadFromFolder(const LXFilepath& Folderpath, EResourceOwner
 		if (Asset)
 		{
 			LogE(AssetManager, L"Asset %s already exist", AssetKey.GetBuffer())
-			continue;
-		}
-		
-		if (Extension == LX_MATERIAL_EXT)
-		{
-			LXMaterial* pMaterial = new LXMaterial;
-			pMaterial->SetFilepath(Filepath);
-			pMaterial->Owner = ResourceOwner;
-			_MapAssets[AssetKey] = pMaterial;
-			LogI(AssetManager,L"Added %s", Filepath.GetBuffer());
+			return;
 		}
-		else if (Extension == LX_TEXTURE_EXT)
-		{
-			LXTexture* pTexture = new LXTexture();
-			pTexture->SetFilepath(Filepath);
-			pTexture->Owner = ResourceOwner;
-			_MapAssets[AssetKey] = pTexture;
-			LogI(AssetManager,L"Added %s", Filepath.GetBuffer());
-		}
-		else if (Extension == LX_MESH_EXT)
-		{
-			LXAssetMesh* pMesh = new LXAssetMesh();
-			pMesh->SetFilepath(Filepath);
-			pMesh->Owner = ResourceOwner;
-			_MapAssets[AssetKey] = pMesh;
-			LogI(AssetManager, L"Added %s", Filepath.GetBuffer());
-		}
-		else if (Extension == LX_SHADER_EXT)
-		{
-			LXShader* Shader = new LXShader();
-			Shader->SetFilepath(Filepath);
-			Shader->Owner = ResourceOwner;
-			_MapAssets[AssetKey] = Shader;
-			LogI(AssetManager, L"Added %s", Filepath.GetBuffer());
-		}
-		else if (Extension == LX_ANIMATION_EXT)
-		{
-			LXAnimation* Shader = new LXAnimation();
-			Shader->SetFilepath(Filepath);
-			Shader->Owner = ResourceOwner;
-			_MapAssets[AssetKey] = Shader;
-			LogI(AssetManager, L"Added %s", Filepath.GetBuffer());
-		}
-				
 
+		switch (Entry.Type)
+		{
+		case EAssetType::Material: Asset = new LXMaterial(); break;
+		case EAssetType::Texture: Asset = new LXTexture(); break;
+		case EAssetType::Mesh: Asset = new LXAssetMesh(); break;
+		case EAssetType::Shader: Asset = new LXShader(); break;
+		case EAssetType::Animation: Asset = new LXAnimation(); break;
 #ifdef LX_USE_RAW_TEXTURES_AS_ASSETS
-		else if ((Extension == L"jpg") || 
-				 (Extension == L"pbm") || 
-				 (Extension == L"png") || 
-				 (Extension == L"tga"))
+		case EAssetType::RawTexture:
 		{
 			LXTexture* pTexture = new LXTexture();
 			pTexture->SetSource(RelativeFilepath);
 			pTexture->Owner = ResourceOwner;
 			_MapAssets[AssetKey] = pTexture;
-			LogI(AssetManager,L"Added %s", Filepath.GetBuffer());
+			AssetCount++;
+			return;
 		}
-#endif 	
-		else
-		{
-			//LogE(AssetManager, L"Unknow resource file format %s", Filepath.GetBuffer());
+#endif
+		default: return;
 		}
-	}
+
+		Asset->SetFilepath(AssetFolderpath + RelativeFilepath);
+		Asset->Owner = ResourceOwner;
+		_MapAssets[AssetKey] = Asset;
+		AssetCount++;
+	});
+
+	Registry->Save();
+
+	LogI(AssetManager, L"Added %u assets from %s in %.2f ms (%u/%u folders scanned)", AssetCount, Folderpath.GetBuffer(), Perf.GetTime(), Registry->GetScannedFolderCount(), Registry->GetFolderCount());
 }
 
 LXMaterial* LXAssetManager::CreateEngineMaterial(const wchar_t* szName)
@@ -667,6 +893,31 @@ LXAsset* LXAssetManager::FindAsset(const LXString& RelativeFilepath) const
 		return nullptr;
 }
 
+void LXAssetManager::OnAssetSaved(LXAsset* Asset)
+{
+	// The folder time is unchanged: the registry would not see the new content
+	auto It = _AssetRegistries.find(Asset->Owner);
+	if (It != _AssetRegistries.end())
+		It->second->UpdateFile(Asset->GetRelativeFilename());
+}
+
+void LXAssetManager::GetDependencies(const LXAsset* Asset, list<LXAsset*>& listDependencies) const
+{
+	auto It = _AssetRegistries.find(Asset->Owner);
+	if (It == _AssetRegistries.end())
+		return;
+
+	const TAssetRegistryEntry* Entry = It->second->FindEntry(Asset->GetRelativeFilename());
+	if (!Entry)
+		return;
+
+	for (const std::wstring& Dependency : Entry->Dependencies)
+	{
+		if (LXAsset* DependencyAsset = FindAsset(Dependency.c_str()))
+			listDependencies.push_back(DependencyAsset);
+	}
+}
+
 void LXAssetManager::GetTextures(list<LXTexture*>& listTextures)const
 {
 	GetAssets<LXTexture*>(listTextures);
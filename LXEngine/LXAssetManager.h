@@ -10,6 +10,8 @@
 
 #include "LXSmartObject.h"
 #include "LXAsset.h"
+#include "LXAssetLoader.h"
+#include "LXAssetRegistry.h"
 
 class LXAnimation;
 class LXAssetMesh;
@@ -39,6 +41,38 @@ public:
 
 	// Asset
 	LXAsset*			GetAsset(const LXString& Name) const;
+
+	//
+	// Asynchronous loading: the requesters are called back on the Main thread, at the sync point.
+	//
+
+	LXAssetRequestPtr	LoadAssetAsync(LXAsset* Asset, EAssetPriority Priority, std::function<void(LXAsset*)> OnLoaded = nullptr);
+	void				SetPriority(const LXAssetRequestPtr& Request, EAssetPriority Priority);
+	void				Cancel(const LXAssetRequestPtr& Request);
+
+	// Returns the asset at once. Its load, when it can be done asynchronously, is completed later.
+	LXAsset*			GetAssetAsync(const LXString& Name, EAssetPriority Priority);
+
+	// Waits for the asynchronous load of the Asset and completes it
+	void				FinishLoading(LXAsset* Asset) const;
+
+	// LXController sync point
+	void				Synchronize();
+
+	//
+	// Memory budget: the least recently used CPU data is released when a class is over its budget,
+	// and read again, through the Unloaded state, when used.
+	//
+
+	// Marks the asset used and loads its released data
+	void				UseAsset(LXAsset* Asset);
+
+	// From any thread: UseAsset at the next sync point
+	void				RequestUse(LXAsset* Asset);
+
+	// CPU data of the loaded assets, at the last budget update
+	uint64				GetMemorySize(EAssetType Type) const { return _MemorySizes[(int)Type]; }
+	uint				GetResidentCount(EAssetType Type) const { return _ResidentCounts[(int)Type]; }
 	
 	// Material
 	LXMaterial*			GetDefaultMaterial();
@@ -91,6 +125,12 @@ public:
 	// Update the renamed asset in the map
 	void				OnAssetRenamed(const LXString& Path, const LXString& OldName, const LXString& NewName, EResourceOwner ResourceOwner);
 
+	// Update the asset registry entry of a file written in place
+	void				OnAssetSaved(LXAsset* Asset);
+
+	// Assets referenced by the Asset file, from the asset registry
+	void				GetDependencies(const LXAsset* Asset, list<LXAsset*>& listDependencies) const;
+
 	const LXGraphTemplate* GetGraphMaterialTemplate() 
 	{
 		return _graphMaterialTemplate.get();
@@ -102,6 +142,7 @@ private:
 	T GetResourceT(const LXString& Name) const;
 
 	void LoadFromFolder(const LXFilepath& Folderpath, EResourceOwner ResourceOwner);
+	void UpdateMemoryBudget();
 	void Add(LXAsset* Resource);
 	LXMaterial* CreateEngineMaterial(const wchar_t* szName);
 	LXString BuildKey(EResourceOwner ResourceOwner, const LXString& RelativeFilepath);
@@ -114,6 +155,12 @@ protected:
 private:
 
 	unique_ptr<LXGraphTemplate> _graphMaterialTemplate;
+	unique_ptr<LXAssetLoader> _AssetLoader;
+	map<EResourceOwner, unique_ptr<LXAssetRegistry>> _AssetRegistries;
+	uint64			_MemorySizes[(int)EAssetType::Count] = {};
+	uint			_ResidentCounts[(int)EAssetType::Count] = {};
+	std::mutex		_UseMutex;
+	set<LXAsset*>	_AssetsToUse;
 	list<LXString>	_ListAssetExtentions;
 
 };
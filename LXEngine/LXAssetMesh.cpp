@@ -12,6 +12,7 @@
 #include "LXSmartObject.h"
 #include "LXMSXMLNode.h"
 #include "LXFile.h"
+#include "LXGeometryContainer.h"
 #include "LXPrimitive.h"
 #include "LXAssetManager.h"
 #include "LXCore.h"
@@ -44,144 +45,121 @@ bool LXAssetMesh::Load()
 	LXFilepath strFilenameGeo = _filepath;
 	strFilenameGeo.ChangeExtensionTo(LX_MESHBIN_EXT);
 	
-	bool Result = false;
+	// Read here when the asset is not loaded through LXAssetLoader
+	MapPrimitiveGeometries Geometries;
+	bool Result = _GeometriesLoaded || LoadGeometries(strFilenameGeo, _LoadedGeometries);
+	Geometries.swap(_LoadedGeometries);
+	_GeometriesLoaded = false;
+
+	if (_DataReleased)
+	{
+		// The meshes are there: the arrays are moved in the same primitives
+		Result = Result && Geometries.size() == _mapGeometries.size();
+
+		for (auto It = _mapGeometries.begin(); Result && It != _mapGeometries.end(); It++)
+			Result = Geometries.find(It->first) != Geometries.end();
+
+		if (Result)
+		{
+			for (auto& It : _mapGeometries)
+				It.second->SwapGeometry(Geometries[It.first]);
+
+			_DataReleased = false;
+			State = EResourceState::LXResourceState_Loaded;
+			MarkUsed();
+		}
+
+		return false;
+	}
 	
-	if (LoadGeometries(strFilenameGeo, _mapGeometries) == true)
+	if (Result)
+	{
+		// Only the smart objects are created on the Main thread
+		for (auto& It : Geometries)
+		{
+			shared_ptr<LXPrimitive>& Primitive = _mapGeometries[It.first];
+			Primitive = make_shared<LXPrimitive>();
+			Primitive->SwapGeometry(It.second);
+		}
+
 		Result = LoadWithMSXML(_filepath);
+	}
 
 	if (Result)
+	{
 		State = EResourceState::LXResourceState_Loaded;
+		MarkUsed();
+		InvokeCB(L"Loaded");
+	}
 		
 	return false;
 }
 
-LXMesh* LXAssetMesh::GetMesh()
+uint64 LXAssetMesh::GetMemorySize() const
 {
-	return _Root;
+	uint64 Size = 0;
+	for (const auto& It : _mapGeometries)
+		Size += It.second->GetMemorySize();
+	return Size;
 }
 
-bool LXAssetMesh::LoadGeometries(const LXFilepath& strFilename, MapGeometries& mapGeometries)
+bool LXAssetMesh::ReleaseData()
 {
-	LXFile file;
+	// Not the imported meshes, nor the modified ones
+	if (State != EResourceState::LXResourceState_Loaded || !_Root || _mapGeometries.empty() || IsNeedSave())
+		return false;
 
-	if (!file.Open(strFilename, L"rb"))
+	LXFilepath strFilenameGeo = _filepath;
+	strFilenameGeo.ChangeExtensionTo(LX_MESHBIN_EXT);
+	if (!strFilenameGeo.IsFileExist())
 		return false;
 
-	LXPrimitive* Primitive = nullptr;
+	for (auto& It : _mapGeometries)
+		It.second->ReleaseArrays();
+
+	_DataReleased = true;
+	State = EResourceState::LXResourceState_Unloaded;
+	return true;
+}
 
-	TFileTag fileTag;
+bool LXAssetMesh::LoadData()
+{
+	// The geometries are read, decoded and optimized here. The primitives are smart objects, created on the
+	// Main thread by Load. The XML is only read into the system cache.
+	LXFilepath strFilenameGeo = _filepath;
+	strFilenameGeo.ChangeExtensionTo(LX_MESHBIN_EXT);
 
-	while (file.Read(&fileTag, sizeof(TFileTag)))
+	_LoadedGeometries.clear();
+	_GeometriesLoaded = LoadGeometries(strFilenameGeo, _LoadedGeometries);
+	if (!_GeometriesLoaded)
 	{
-		if (fileTag.nId != -1)
-		{
-			shared_ptr<LXPrimitive>& PrimitivePtr = mapGeometries[fileTag.nId];
-			CHK(PrimitivePtr.get() == nullptr);
-			PrimitivePtr = make_shared<LXPrimitive>();
-			Primitive = PrimitivePtr.get();
-			Primitive->SetTopology(fileTag.eMode);
-		}
-		else
-		{
-			switch (fileTag.eDataTarget)
-			{
-			case LX_INDICES:
-			{
-				uint nSize = fileTag.nCount / sizeof(uint);
-				uint* pIndices = new uint[nSize];
-				file.Read(pIndices, fileTag.nCount);
-				ArrayUint& arrayIndices = Primitive->GetArrayIndices();
-				arrayIndices.reserve(nSize);
-				for (uint i = 0; i < nSize; i++)
-					arrayIndices.push_back(pIndices[i]);
-
-				delete[] pIndices;
-			}
-			break;
-
-			case LX_VERTICES:
-			{
-				uint nSize = fileTag.nCount / sizeof(vec3f);
-				vec3f* pVertices = new vec3f[nSize];
-				file.Read(pVertices, fileTag.nCount);
-
-				ArrayVec3f& arrayVertices = const_cast<ArrayVec3f&>(Primitive->GetArrayPositions());
-				arrayVertices.reserve(nSize);
-				for (uint i = 0; i < nSize; i++)
-					arrayVertices.push_back(pVertices[i]);
-				
-				delete[] pVertices;
-			}
-			break;
-
-			case LX_TEXTCOORD:
-			{
-				uint nSize = fileTag.nCount / sizeof(vec2f);
-				vec2f* pTexCoords = new vec2f[nSize];
-				file.Read(pTexCoords, fileTag.nCount);
-
-				ArrayVec2f& arrayTexCoords = const_cast<ArrayVec2f&>(Primitive->GetArrayTexCoords());
-				arrayTexCoords.reserve(nSize);
-				for (uint i = 0; i < nSize; i++)
-					arrayTexCoords.push_back(pTexCoords[i]);
-
-				delete[] pTexCoords;
-			}
-			break;
-
-			case LX_NORMALS:
-			{
-				uint nSize = fileTag.nCount / sizeof(vec3f);
-				vec3f* pNormals = new vec3f[nSize];
-				file.Read(pNormals, fileTag.nCount);
-
-				ArrayVec3f& arrayNormals = const_cast<ArrayVec3f&>(Primitive->GetArrayNormals());
-				arrayNormals.reserve(nSize);
-				for (uint i = 0; i < nSize; i++)
-					arrayNormals.push_back(pNormals[i] * -1.f);
-
-				delete[] pNormals;
-
-			}
-			break;
-
-			case LX_TANGENTS:
-			{
-				uint nSize = fileTag.nCount / sizeof(vec3f);
-				vec3f* pTangents = new vec3f[nSize];
-				file.Read(pTangents, fileTag.nCount);
-
-				ArrayVec3f& arrayTangents = const_cast<ArrayVec3f&>(Primitive->GetArrayTangents());
-				arrayTangents.reserve(nSize);
-				for (uint i = 0; i < nSize; i++)
-					arrayTangents.push_back(pTangents[i]);
-
-				delete[] pTangents; 
-			}
-			break;
-
-
-			case LX_BINORMALS:
-			{
-				uint nSize = fileTag.nCount / sizeof(vec3f);
-				vec3f* pBiNormals = new vec3f[nSize];
-				file.Read(pBiNormals, fileTag.nCount);
-
-				ArrayVec3f& arrayBiNormals = const_cast<ArrayVec3f&>(Primitive->GetArrayBiNormals());
-				arrayBiNormals.reserve(nSize);
-				for (uint i = 0; i < nSize; i++)
-					arrayBiNormals.push_back(pBiNormals[i]);
-
-				delete[] pBiNormals;
-			}
-			break;
-
-			default:CHK(0);
-			}
-		}
+		_LoadedGeometries.clear();
+		return false;
 	}
 
-	file.Close();
+	LXMappedFile File;
+	if (!File.Open(_filepath))
+		return false;
+
+	const volatile uint8* Data = File.GetData();
+	for (uint64 i = 0; i < File.GetSize(); i += 4096)
+		Data[i];
+
+	return true;
+}
+
+LXMesh* LXAssetMesh::GetMesh()
+{
+	return _Root;
+}
+
+bool LXAssetMesh::LoadGeometries(const LXFilepath& strFilename, MapPrimitiveGeometries& Geometries)
+{
+	if (!LXGeometryContainer::Load(strFilename, Geometries))
+		return false;
+
+	// Import: the geometries saved without their LOD chain, nor optimized
+	LXGeometryContainer::GenerateLODsAndOptimize(Geometries);
 	return true;
 }
 
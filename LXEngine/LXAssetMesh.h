@@ -8,9 +8,9 @@
 
 #pragma once
 #include "LXAsset.h"
+#include "LXPrimitive.h"
 
 class LXMesh;
-class LXPrimitive;
 
 typedef map<int, shared_ptr<LXPrimitive>> MapGeometries;
 
@@ -30,6 +30,9 @@ public:
 	//
 
 	bool Load() override;
+	bool LoadData() override;
+	uint64 GetMemorySize() const override;
+	bool ReleaseData() override;
 	LXString GetFileExtension() override { return LX_MESH_EXT; }
 
 	LXMesh* GetMesh();
@@ -38,7 +41,7 @@ private:
 
 	// Load & Save tools
 	const MapGeometries& GetPrimitives() const { return _mapGeometries; }
-	bool LoadGeometries(const LXFilepath& strFilename, MapGeometries& mapGeometries);
+	bool LoadGeometries(const LXFilepath& strFilename, MapPrimitiveGeometries& Geometries);
 	LXFile* GetGeometryFile() { return nullptr; }
 
 	//
@@ -59,4 +62,8 @@ private:
 	LXAssetMesh* _AssetMesh = nullptr;
 	MapGeometries _mapGeometries; 
 
+	// Read by LoadData on a loader thread, moved in the primitives by Load on the Main thread
+	MapPrimitiveGeometries _LoadedGeometries;
+	bool _GeometriesLoaded = false;
+
 };
\ No newline at end of file
@@ -0,0 +1,496 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXAssetRegistry.h"
+#include "LXFile.h"
+#include "LXLogger.h"
+#include "LXThreadManager.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	uint64 ToUint64(const FILETIME& Time)
+	{
+		return ((uint64)Time.dwHighDateTime << 32) | Time.dwLowDateTime;
+	}
+
+	// 0 when the folder does not exist
+	uint64 GetFolderLastWriteTime(const std::wstring& Folderpath)
+	{
+		std::wstring Path = Folderpath;
+		if (!Path.empty() && (Path.back() == L'/' || Path.back() == L'\\'))
+			Path.pop_back();
+
+		WIN32_FILE_ATTRIBUTE_DATA Data;
+		if (!::GetFileAttributesEx(Path.c_str(), GetFileExInfoStandard, &Data) || !(Data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			return 0;
+
+		return ToUint64(Data.ftLastWriteTime);
+	}
+
+	EAssetType GetFileAssetType(const std::wstring& Filename)
+	{
+		const size_t Dot = Filename.rfind(L'.');
+		return Dot == std::wstring::npos ? EAssetType::Unknown : LXAssetRegistry::GetAssetType(Filename.substr(Dot + 1).c_str());
+	}
+
+	//
+	// Registry file: header, then the folders.
+	// Folder: path, time, sub-folder names, entries. Entry: name, type, size, time, dependencies.
+	//
+
+	struct TAssetRegistryHeader
+	{
+		uint Magic;
+		uint Version;
+		uint FolderCount;
+		uint Reserved;
+	};
+
+	class TWriter
+	{
+	public:
+
+		template<typename T>
+		void Write(const T& Value)
+		{
+			const uint8* Data = reinterpret_cast<const uint8*>(&Value);
+			Buffer.insert(Buffer.end(), Data, Data + sizeof(T));
+		}
+
+		void WriteString(const std::wstring& Value)
+		{
+			Write((uint)Value.size());
+			const uint8* Data = reinterpret_cast<const uint8*>(Value.data());
+			Buffer.insert(Buffer.end(), Data, Data + Value.size() * sizeof(wchar_t));
+		}
+
+		vector<uint8> Buffer;
+	};
+
+	class TReader
+	{
+	public:
+
+		TReader(const uint8* InData, uint64 InSize) :Data(InData), Size(InSize) {}
+
+		template<typename T>
+		bool Read(T& Value)
+		{
+			if (Offset + sizeof(T) > Size)
+				return false;
+
+			memcpy(&Value, Data + Offset, sizeof(T));
+			Offset += sizeof(T);
+			return true;
+		}
+
+		bool ReadString(std::wstring& Value)
+		{
+			uint Length;
+			if (!Read(Length) || Offset + (uint64)Length * sizeof(wchar_t) > Size)
+				return false;
+
+			Value.assign(reinterpret_cast<const wchar_t*>(Data + Offset), Length);
+			Offset += (uint64)Length * sizeof(wchar_t);
+			return true;
+		}
+
+		bool ReadStrings(vector<std::wstring>& Values)
+		{
+			uint Count;
+			if (!Read(Count) || Count > Size)
+				return false;
+
+			Values.resize(Count);
+			for (std::wstring& Value : Values)
+			{
+				if (!ReadString(Value))
+					return false;
+			}
+			return true;
+		}
+
+	private:
+
+		const uint8* Data;
+		uint64 Size;
+		uint64 Offset = 0;
+	};
+};
+
+LXAssetRegistry::LXAssetRegistry(const LXFilepath& Folderpath)
+{
+	std::wstring Path = Folderpath.GetBuffer();
+	if (!Path.empty() && (Path.back() == L'/' || Path.back() == L'\\'))
+		Path.pop_back();
+
+	// Aside the folder: written without changing the folder time
+	_Folderpath = (Path + L"/").c_str();
+	_RegistryFilepath = (Path + L".registry").c_str();
+}
+
+EAssetType LXAssetRegistry::GetAssetType(const LXString& Extension)
+{
+	const LXString Ext = Extension.ToLower();
+
+	if (Ext == LX_MATERIAL_EXT)
+		return EAssetType::Material;
+	else if (Ext == LX_TEXTURE_EXT)
+		return EAssetType::Texture;
+	else if (Ext == LX_MESH_EXT)
+		return EAssetType::Mesh;
+	else if (Ext == LX_SHADER_EXT)
+		return EAssetType::Shader;
+	else if (Ext == LX_ANIMATION_EXT)
+		return EAssetType::Animation;
+#ifdef LX_USE_RAW_TEXTURES_AS_ASSETS
+	else if (Ext == L"jpg" || Ext == L"pbm" || Ext == L"png" || Ext == L"tga")
+		return EAssetType::RawTexture;
+#endif
+	else
+		return EAssetType::Unknown;
+}
+
+bool LXAssetRegistry::Load()
+{
+	_Folders.clear();
+
+	LXMappedFile File;
+	if (!File.Open(_RegistryFilepath))
+		return false;
+
+	TReader Reader(File.GetData(), File.GetSize());
+
+	TAssetRegistryHeader Header;
+	if (!Reader.Read(Header) || Header.Magic != kMagic || Header.Version != kVersion)
+	{
+		LogW(AssetRegistry, L"%s: unknown format, the folder is scanned", _RegistryFilepath.GetBuffer());
+		return false;
+	}
+
+	for (uint i = 0; i < Header.FolderCount; i++)
+	{
+		std::wstring Path;
+		TAssetRegistryFolder Folder;
+		uint EntryCount = 0;
+
+		bool Result = Reader.ReadString(Path) && Reader.Read(Folder.LastWriteTime) && Reader.ReadStrings(Folder.SubFolders) && Reader.Read(EntryCount) && EntryCount <= File.GetSize();
+
+		if (Result)
+		{
+			Folder.Entries.resize(EntryCount);
+			for (TAssetRegistryEntry& Entry : Folder.Entries)
+			{
+				Result = Result && Reader.ReadString(Entry.FileName) && Reader.Read(Entry.Type) && Reader.Read(Entry.Size) && Reader.Read(Entry.LastWriteTime) && Reader.ReadStrings(Entry.Dependencies);
+			}
+		}
+
+		if (!Result)
+		{
+			LogE(AssetRegistry, L"%s: truncated file, the folder is scanned", _RegistryFilepath.GetBuffer());
+			_Folders.clear();
+			return false;
+		}
+
+		_Folders[Path] = move(Folder);
+	}
+
+	return true;
+}
+
+bool LXAssetRegistry::Save()
+{
+	if (!_Modified)
+		return true;
+
+	TWriter Writer;
+	Writer.Write(TAssetRegistryHeader{ kMagic, kVersion, (uint)_Folders.size(), 0 });
+
+	for (const auto& It : _Folders)
+	{
+		const TAssetRegistryFolder& Folder = It.second;
+
+		Writer.WriteString(It.first);
+		Writer.Write(Folder.LastWriteTime);
+		Writer.Write((uint)Folder.SubFolders.size());
+		for (const std::wstring& SubFolder : Folder.SubFolders)
+			Writer.WriteString(SubFolder);
+
+		Writer.Write((uint)Folder.Entries.size());
+		for (const TAssetRegistryEntry& Entry : Folder.Entries)
+		{
+			Writer.WriteString(Entry.FileName);
+			Writer.Write(Entry.Type);
+			Writer.Write(Entry.Size);
+			Writer.Write(Entry.LastWriteTime);
+			Writer.Write((uint)Entry.Dependencies.size());
+			for (const std::wstring& Dependency : Entry.Dependencies)
+				Writer.WriteString(Dependency);
+		}
+	}
+
+	// Written aside then moved: an interrupted write leaves the previous registry
+	const LXFilepath TempFilepath = _RegistryFilepath + L".tmp";
+
+	LXFile File;
+	if (!File.Open(TempFilepath, L"wb"))
+	{
+		LogE(AssetRegistry, L"Unable to write %s", TempFilepath.GetBuffer());
+		return false;
+	}
+
+	const bool Written = File.Write(Writer.Buffer.data(), Writer.Buffer.size());
+	File.Close();
+
+	if (!Written || !::MoveFileEx(TempFilepath, _RegistryFilepath, MOVEFILE_REPLACE_EXISTING))
+	{
+		LogE(AssetRegistry, L"Unable to write %s", _RegistryFilepath.GetBuffer());
+		::DeleteFile(TempFilepath);
+		return false;
+	}
+
+	_Modified = false;
+	return true;
+}
+
+void LXAssetRegistry::Update()
+{
+	if (!Load())
+		_Modified = true;
+
+	_ScannedFolderCount = 0;
+
+	const std::wstring Root = _Folderpath.GetBuffer();
+	vector<std::wstring> ToScan;
+
+	if (_Folders.find(L"") == _Folders.end())
+	{
+		ToScan.push_back(L"");
+	}
+	else
+	{
+		// One time query per registered folder
+		vector<const std::wstring*> Paths;
+		Paths.reserve(_Folders.size());
+		for (const auto& It : _Folders)
+			Paths.push_back(&It.first);
+
+		vector<uint64> Times(Paths.size());
+		ParallelFor((uint)Paths.size(), [&](uint i)
+		{
+			Times[i] = GetFolderLastWriteTime(Root + *Paths[i]);
+		});
+
+		for (size_t i = 0; i < Paths.size(); i++)
+		{
+			if (Times[i] != _Folders[*Paths[i]].LastWriteTime)
+				ToScan.push_back(*Paths[i]);
+		}
+	}
+
+	// Changed folders, then by waves the sub-folders they added
+	while (!ToScan.empty())
+	{
+		vector<TAssetRegistryFolder> Scanned(ToScan.size());
+
+		ParallelFor((uint)ToScan.size(), 1, [&](uint i)
+		{
+			auto It = _Folders.find(ToScan[i]);
+			ScanFolder(ToScan[i], It != _Folders.end() ? &It->second : nullptr, Scanned[i]);
+		});
+
+		vector<std::wstring> NewFolders;
+
+		for (size_t i = 0; i < ToScan.size(); i++)
+		{
+			for (const std::wstring& SubFolder : Scanned[i].SubFolders)
+			{
+				const std::wstring Path = ToScan[i] + SubFolder + L"/";
+				if (_Folders.find(Path) == _Folders.end())
+					NewFolders.push_back(Path);
+			}
+		}
+
+		for (size_t i = 0; i < ToScan.size(); i++)
+			_Folders[ToScan[i]] = move(Scanned[i]);
+
+		_ScannedFolderCount += (uint)ToScan.size();
+		_Modified = true;
+		ToScan = move(NewFolders);
+	}
+
+	// The removed folders are no longer listed by their parent
+	set<std::wstring> Reachable;
+	vector<std::wstring> Stack = { L"" };
+
+	while (!Stack.empty())
+	{
+		const std::wstring Path = move(Stack.back());
+		Stack.pop_back();
+
+		auto It = _Folders.find(Path);
+		if (It == _Folders.end() || !Reachable.insert(Path).second)
+			continue;
+
+		for (const std::wstring& SubFolder : It->second.SubFolders)
+			Stack.push_back(Path + SubFolder + L"/");
+	}
+
+	for (auto It = _Folders.begin(); It != _Folders.end();)
+	{
+		if (Reachable.find(It->first) == Reachable.end())
+		{
+			It = _Folders.erase(It);
+			_Modified = true;
+		}
+		else
+		{
+			++It;
+		}
+	}
+}
+
+void LXAssetRegistry::ScanFolder(const std::wstring& RelativeFolder, const TAssetRegistryFolder* Previous, TAssetRegistryFolder& OutFolder) const
+{
+	const std::wstring Folderpath = std::wstring(_Folderpath.GetBuffer()) + RelativeFolder;
+
+	// Read before the scan: a change during the scan is seen by the next Update
+	OutFolder.LastWriteTime = GetFolderLastWriteTime(Folderpath);
+	if (OutFolder.LastWriteTime == 0)
+		return;
+
+	map<std::wstring, const TAssetRegistryEntry*> PreviousEntries;
+	if (Previous)
+	{
+		for (const TAssetRegistryEntry& Entry : Previous->Entries)
+			PreviousEntries[Entry.FileName] = &Entry;
+	}
+
+	WIN32_FIND_DATA FindData;
+	HANDLE Find = ::FindFirstFileEx((Folderpath + L"*").c_str(), FindExInfoBasic, &FindData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+	if (Find == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if ((wcscmp(FindData.cFileName, L".") != 0) && (wcscmp(FindData.cFileName, L"..") != 0))
+				OutFolder.SubFolders.push_back(FindData.cFileName);
+			continue;
+		}
+
+		TAssetRegistryEntry Entry;
+		Entry.FileName = FindData.cFileName;
+		Entry.Type = GetFileAssetType(Entry.FileName);
+
+		if (Entry.Type == EAssetType::Unknown)
+			continue;
+
+		Entry.Size = ((uint64)FindData.nFileSizeHigh << 32) | FindData.nFileSizeLow;
+		Entry.LastWriteTime = ToUint64(FindData.ftLastWriteTime);
+
+		// Unchanged file: its dependencies are kept
+		auto It = PreviousEntries.find(Entry.FileName);
+		if (It != PreviousEntries.end() && It->second->Size == Entry.Size && It->second->LastWriteTime == Entry.LastWriteTime)
+			Entry.Dependencies = It->second->Dependencies;
+		else
+			ParseDependencies(Folderpath + Entry.FileName, Entry.Type, Entry.Dependencies);
+
+		OutFolder.Entries.push_back(move(Entry));
+	}
+	while (::FindNextFile(Find, &FindData));
+
+	::FindClose(Find);
+}
+
+void LXAssetRegistry::ParseDependencies(const std::wstring& Filepath, EAssetType Type, vector<std::wstring>& OutDependencies)
+{
+	OutDependencies.clear();
+
+	// Only the XML assets reference other assets
+	if (Type == EAssetType::Shader || Type == EAssetType::RawTexture)
+		return;
+
+	LXMappedFile File;
+	if (!File.Open(Filepath.c_str()))
+		return;
+
+	// The asset properties are saved as <Name Value="RelativeFilepath"/>
+	static const char Pattern[] = "Value=\"";
+	const char* Text = reinterpret_cast<const char*>(File.GetData());
+	const char* TextEnd = Text + File.GetSize();
+	const char* Position = Text;
+
+	while (true)
+	{
+		const char* Begin = std::search(Position, TextEnd, Pattern, Pattern + sizeof(Pattern) - 1);
+		if (Begin == TextEnd)
+			break;
+
+		Begin += sizeof(Pattern) - 1;
+		const char* End = std::find(Begin, TextEnd, '"');
+		if (End == TextEnd)
+			break;
+
+		const std::wstring Value(Begin, End);
+		if (GetFileAssetType(Value) != EAssetType::Unknown && std::find(OutDependencies.begin(), OutDependencies.end(), Value) == OutDependencies.end())
+			OutDependencies.push_back(Value);
+
+		Position = End + 1;
+	}
+}
+
+void LXAssetRegistry::ForEachAsset(const std::function<void(const LXString& RelativeFilepath, const TAssetRegistryEntry& Entry)>& Func) const
+{
+	for (const auto& It : _Folders)
+	{
+		for (const TAssetRegistryEntry& Entry : It.second.Entries)
+			Func((It.first + Entry.FileName).c_str(), Entry);
+	}
+}
+
+const TAssetRegistryEntry* LXAssetRegistry::FindEntry(const LXString& RelativeFilepath) const
+{
+	const std::wstring Path = RelativeFilepath.GetBuffer();
+	const size_t Separator = Path.find_last_of(L"/\\");
+	const std::wstring Folder = Separator == std::wstring::npos ? L"" : Path.substr(0, Separator + 1);
+	const std::wstring FileName = Separator == std::wstring::npos ? Path : Path.substr(Separator + 1);
+
+	auto It = _Folders.find(Folder);
+	if (It == _Folders.end())
+		return nullptr;
+
+	for (const TAssetRegistryEntry& Entry : It->second.Entries)
+	{
+		if (_wcsicmp(Entry.FileName.c_str(), FileName.c_str()) == 0)
+			return &Entry;
+	}
+
+	return nullptr;
+}
+
+void LXAssetRegistry::UpdateFile(const LXString& RelativeFilepath)
+{
+	TAssetRegistryEntry* Entry = const_cast<TAssetRegistryEntry*>(FindEntry(RelativeFilepath));
+	if (!Entry)
+		return;
+
+	const std::wstring Filepath = std::wstring(_Folderpath.GetBuffer()) + RelativeFilepath.GetBuffer();
+
+	WIN32_FILE_ATTRIBUTE_DATA Data;
+	if (!::GetFileAttributesEx(Filepath.c_str(), GetFileExInfoStandard, &Data))
+		return;
+
+	Entry->Size = ((uint64)Data.nFileSizeHigh << 32) | Data.nFileSizeLow;
+	Entry->LastWriteTime = ToUint64(Data.ftLastWriteTime);
+	ParseDependencies(Filepath, Entry->Type, Entry->Dependencies);
+	_Modified = true;
+}
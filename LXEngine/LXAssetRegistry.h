@@ -0,0 +1,95 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXFilepath.h"
+#include <functional>
+#include <string>
+
+enum class EAssetType : uint
+{
+	Unknown,
+	Material,
+	Texture,
+	Mesh,
+	Shader,
+	Animation,
+	RawTexture,		// LX_USE_RAW_TEXTURES_AS_ASSETS
+	Count
+};
+
+struct TAssetRegistryEntry
+{
+	std::wstring FileName;
+	EAssetType Type = EAssetType::Unknown;
+	uint64 Size = 0;
+	uint64 LastWriteTime = 0;
+	vector<std::wstring> Dependencies;	// Relative filepaths of the referenced assets
+};
+
+struct TAssetRegistryFolder
+{
+	uint64 LastWriteTime = 0;
+	vector<std::wstring> SubFolders;
+	vector<TAssetRegistryEntry> Entries;
+};
+
+//
+// Persistent list of the assets of a folder and its sub-folders, saved aside the folder (<Folder>.registry).
+// A folder LastWriteTime changes when a file or a sub-folder is added, removed or renamed in it:
+// Update checks the time of each registered folder and scans again only the changed ones, in parallel.
+// In a scanned folder, the dependencies are parsed again only for the files whose size or time changed.
+// The files written in place are reported by UpdateFile.
+//
+
+class LXAssetRegistry
+{
+
+public:
+
+	static const uint kMagic = 0x52414C58;	// "LXAR"
+	static const uint kVersion = 1;
+
+	LXAssetRegistry(const LXFilepath& Folderpath);
+
+	// Loads the registry file and validates it against the file system
+	void Update();
+
+	// Writes the registry file when it changed
+	bool Save();
+
+	// RelativeFilepath as LXFilepath::GetRelativeFilepath from the folder
+	void ForEachAsset(const std::function<void(const LXString& RelativeFilepath, const TAssetRegistryEntry& Entry)>& Func) const;
+	const TAssetRegistryEntry* FindEntry(const LXString& RelativeFilepath) const;
+
+	// Reads again the size, time and dependencies of a file written in place
+	void UpdateFile(const LXString& RelativeFilepath);
+
+	static EAssetType GetAssetType(const LXString& Extension);
+
+	uint GetFolderCount() const { return (uint)_Folders.size(); }
+	uint GetScannedFolderCount() const { return _ScannedFolderCount; }
+
+private:
+
+	bool Load();
+	void ScanFolder(const std::wstring& RelativeFolder, const TAssetRegistryFolder* Previous, TAssetRegistryFolder& OutFolder) const;
+	static void ParseDependencies(const std::wstring& Filepath, EAssetType Type, vector<std::wstring>& OutDependencies);
+
+private:
+
+	LXFilepath _Folderpath;			// With the trailing '/'
+	LXFilepath _RegistryFilepath;
+
+	// By relative folder, with the trailing '/', the root folder is ""
+	map<std::wstring, TAssetRegistryFolder> _Folders;
+
+	uint _ScannedFolderCount = 0;
+	bool _Modified = false;
+};
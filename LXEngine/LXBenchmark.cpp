@@ -0,0 +1,1161 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+//
+// CPU micro-benchmarks, launched from the console ("Benchmark.XXX" commands).
+// Results are written in the log.
+//
+
+#include "stdafx.h"
+#include "LXAssetRegistry.h"
+#include "LXClusteredLights.h"
+#include "LXConsoleManager.h"
+#include "LXDirectory.h"
+#include "LXFace.h"
+#include "LXFile.h"
+#include "LXFrustum.h"
+#include "LXGeometryContainer.h"
+#include "LXGeometryAllocator.h"
+#include "LXLogger.h"
+#include "LXMatrix.h"
+#include "LXOcclusionCulling.h"
+#include "LXPerformance.h"
+#include "LXPrimitive.h"
+#include "LXRenderBackendNull.h"
+#include "LXRenderCapture.h"
+#include "LXRenderCluster.h"
+#include "LXRenderCommandList.h"
+#include "LXSettings.h"
+#include "LXShadowAtlas.h"
+#include "LXSpacePartitioning.h"
+#include "LXVertexCacheOptimizer.h"
+#include <random>
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	const uint kBenchmarkFrames = 10;
+	const uint kReplayDefaultCount = 100;
+
+	//
+	// RenderCommandList: previous heap allocated commands, kept as reference
+	//
+
+	uint LegacyExecuteCount = 0;
+
+	class LXLegacyRenderCommand
+	{
+	public:
+		virtual ~LXLegacyRenderCommand() {}
+		virtual void Execute(LXRenderCommandList*) = 0;
+	};
+
+	class LXLegacyRenderCommand_VSSetConstantBuffers : public LXLegacyRenderCommand
+	{
+	public:
+		LXLegacyRenderCommand_VSSetConstantBuffers(UINT In0, UINT In1, LXConstantBufferD3D11* In2) :StartSlot(In0), NumBuffers(In1), ConstantBuffer(In2) {}
+		void Execute(LXRenderCommandList*) override { LegacyExecuteCount++; }
+		UINT StartSlot; UINT NumBuffers; LXConstantBufferD3D11* ConstantBuffer;
+	};
+
+	class LXLegacyRenderCommand_PSSetShader : public LXLegacyRenderCommand
+	{
+	public:
+		LXLegacyRenderCommand_PSSetShader(LXShaderD3D11* In0) :PixelShader(In0) {}
+		void Execute(LXRenderCommandList*) override { LegacyExecuteCount++; }
+		LXShaderD3D11* PixelShader;
+	};
+
+	class LXLegacyRenderCommand_DrawIndexed : public LXLegacyRenderCommand
+	{
+	public:
+		LXLegacyRenderCommand_DrawIndexed(UINT In0) :IndexCount(In0) {}
+		void Execute(LXRenderCommandList*) override { LegacyExecuteCount++; }
+		UINT IndexCount;
+	};
+
+	struct TBenchmarkTimes
+	{
+		double Record = 0.;
+		double Execute = 0.;
+		double Empty = 0.;
+	};
+
+	void LogTimes(const wchar_t* Name, const TBenchmarkTimes& Times, uint CommandCount)
+	{
+		const double Scale = 100000. / (double)(CommandCount * kBenchmarkFrames);
+		LogI(Benchmark, L"%s: Record %.3f ms, Execute %.3f ms, Empty %.3f ms (per 100k commands)", Name, Times.Record * Scale, Times.Execute * Scale, Times.Empty * Scale);
+	}
+
+	// Sorts Times in place
+	void LogPercentiles(const wchar_t* Name, vector<double>& Times)
+	{
+		CHK(!Times.empty());
+		std::sort(Times.begin(), Times.end());
+		const size_t P99 = std::min(Times.size() - 1, (size_t)(Times.size() * 0.99));
+		LogI(Benchmark, L"%s: Min %.3f ms, Median %.3f ms, P99 %.3f ms (%u runs)", Name, Times.front(), Times[Times.size() / 2], Times[P99], (uint)Times.size());
+	}
+
+	// The tiles are in the atlas and do not overlap, counted in MinSize cells
+	void CheckShadowAtlasTiles(const vector<TShadowAtlasTile>& Tiles, uint AtlasSize, uint MinSize)
+	{
+		const uint CellCount = AtlasSize / MinSize;
+		vector<uint8> Cells(CellCount * CellCount, 0);
+
+		for (const TShadowAtlasTile& Tile : Tiles)
+		{
+			if (Tile.Size == 0)
+				continue;
+
+			CHK(Tile.X + Tile.Size <= AtlasSize && Tile.Y + Tile.Size <= AtlasSize);
+			CHK(Tile.X % Tile.Size == 0 && Tile.Y % Tile.Size == 0);
+
+			for (uint y = Tile.Y / MinSize; y < (Tile.Y + Tile.Size) / MinSize; y++)
+			{
+				for (uint x = Tile.X / MinSize; x < (Tile.X + Tile.Size) / MinSize; x++)
+				{
+					CHK(Cells[y * CellCount + x] == 0);
+					Cells[y * CellCount + x] = 1;
+				}
+			}
+		}
+	}
+
+	// Brute force binning of spheres (x, y, z, radius) in view space, each cluster box tested
+	uint CheckClusteredLights(const LXClusteredLights& ClusteredLights, const vector<vec4f>& Spheres)
+	{
+		const vector<TClusterRange>& Ranges = ClusteredLights.GetClusterRanges();
+		const vector<uint>& Indices = ClusteredLights.GetLightIndices();
+		uint IndexCount = 0;
+
+		for (uint z = 0; z < kClusterCountZ; z++)
+		{
+			for (uint y = 0; y < kClusterCountY; y++)
+			{
+				for (uint x = 0; x < kClusterCountX; x++)
+				{
+					vec3f Min, Max;
+					ClusteredLights.GetClusterBounds(x, y, z, Min, Max);
+					const TClusterRange& Range = Ranges[ClusteredLights.GetCluster(x, y, z)];
+					uint Count = 0;
+
+					for (uint i = 0; i < (uint)Spheres.size(); i++)
+					{
+						const vec4f& Sphere = Spheres[i];
+						const float dx = std::max(0.f, std::max(Min.x - Sphere.x, Sphere.x - Max.x));
+						const float dy = std::max(0.f, std::max(Min.y - Sphere.y, Sphere.y - Max.y));
+						const float dz = std::max(0.f, std::max(Min.z - Sphere.z, Sphere.z - Max.z));
+
+						// Same expression as the binning
+						if (dx * dx + dy * dy <= Sphere.w * Sphere.w - dz * dz)
+						{
+							CHK(Count < Range.Count && Indices[Range.Offset + Count] == i);
+							Count++;
+						}
+					}
+
+					CHK(Count == Range.Count);
+					IndexCount += Count;
+				}
+			}
+		}
+
+		return IndexCount;
+	}
+
+	// Same decoding as the packed vertex shader input
+	vec3f UnpackOctahedron(const int16* Packed)
+	{
+		const float ex = std::max(Packed[0] / 32767.f, -1.f);
+		const float ey = std::max(Packed[1] / 32767.f, -1.f);
+		vec3f n(ex, ey, 1.f - fabsf(ex) - fabsf(ey));
+		const float t = std::max(-n.z, 0.f);
+		n.x += n.x >= 0.f ? -t : t;
+		n.y += n.y >= 0.f ? -t : t;
+		n.Normalize();
+		return n;
+	}
+};
+
+//------------------------------------------------------------------------------------------------------
+// RenderCommandList record/execute cost.
+// Execute measures the dispatch only (no device): the command bodies are not called.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkRenderCommandList(L"Benchmark.RenderCommandList", []()
+{
+	const uint kClusters = 100000 / 3;
+	const uint kCommandCount = kClusters * 3;
+
+	// Heap allocated commands + virtual Execute
+	TBenchmarkTimes LegacyTimes;
+	vector<LXLegacyRenderCommand*> LegacyCommands;
+
+	for (uint Frame = 0; Frame < kBenchmarkFrames; Frame++)
+	{
+		LXPerformance Perf;
+		for (uint i = 0; i < kClusters; i++)
+		{
+			LegacyCommands.push_back(new LXLegacyRenderCommand_PSSetShader(nullptr));
+			LegacyCommands.push_back(new LXLegacyRenderCommand_VSSetConstantBuffers(1, 1, nullptr));
+			LegacyCommands.push_back(new LXLegacyRenderCommand_DrawIndexed(i));
+		}
+		LegacyTimes.Record += Perf.GetTime();
+
+		Perf.Reset();
+		for (LXLegacyRenderCommand* Command : LegacyCommands)
+		{
+			Command->Execute(nullptr);
+		}
+		LegacyTimes.Execute += Perf.GetTime();
+
+		Perf.Reset();
+		for (LXLegacyRenderCommand* Command : LegacyCommands)
+		{
+			delete Command;
+		}
+		LegacyCommands.clear();
+		LegacyTimes.Empty += Perf.GetTime();
+	}
+
+	// Linear command buffer + switch
+	TBenchmarkTimes LinearTimes;
+	LXRenderCommandList* RCL = new LXRenderCommandList();
+	RCL->DirectMode = false;
+	RCL->StateFiltering = false; // Same commands as the legacy path
+	uint ExecuteCount = 0;
+
+	for (uint Frame = 0; Frame < kBenchmarkFrames; Frame++)
+	{
+		LXPerformance Perf;
+		for (uint i = 0; i < kClusters; i++)
+		{
+			RCL->PSSetShader(nullptr);
+			RCL->VSSetConstantBuffers(1, 1, nullptr);
+			RCL->DrawIndexed(i);
+		}
+		LinearTimes.Record += Perf.GetTime();
+
+		Perf.Reset();
+		RCL->Commands.ForEach([&ExecuteCount](const LXRenderCommand* Command)
+		{
+			switch (Command->Type)
+			{
+			case ERenderCommand::PSSetShader:
+			case ERenderCommand::VSSetConstantBuffers:
+			case ERenderCommand::DrawIndexed: ExecuteCount++; break;
+			default: CHK(0);
+			}
+		});
+		LinearTimes.Execute += Perf.GetTime();
+
+		Perf.Reset();
+		RCL->Empty();
+		LinearTimes.Empty += Perf.GetTime();
+	}
+
+	CHK(ExecuteCount == LegacyExecuteCount);
+	LegacyExecuteCount = 0;
+
+	LogTimes(L"vector<LXRenderCommand*>", LegacyTimes, kCommandCount);
+	LogTimes(L"LXRenderCommandBuffer", LinearTimes, kCommandCount);
+	LogI(Benchmark, L"LXRenderCommandBuffer capacity: %.2f KB", RCL->Commands.GetCapacity() / 1024.);
+
+	delete RCL;
+});
+
+//------------------------------------------------------------------------------------------------------
+// Replays a frame captured by the CaptureFrame command: Benchmark.Replay [File] [Count]
+// The captured objects are placeholders, so the commands are executed by the Null backend.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommand2S CCBenchmarkReplay(L"Benchmark.Replay", [](const LXString& File, const LXString& Count)
+{
+	LXRenderCapture RenderCapture;
+	if (!RenderCapture.Load(File.IsEmpty() ? L"Frame.lxcapture" : (const wchar_t*)File))
+		return;
+
+	const uint ReplayCount = Count.IsEmpty() ? kReplayDefaultCount : std::max(1, _wtoi(Count));
+
+	LXRenderBackendNull RenderBackend;
+	LXPerformance Perf;
+	LXRenderCommandList* RCL = RenderCapture.Replay(&RenderBackend);
+	const double RecordTime = Perf.GetTime();
+
+	if (!RCL)
+		return;
+
+	vector<double> Times(ReplayCount);
+
+	for (uint i = 0; i < ReplayCount; i++)
+	{
+		Perf.Reset();
+		RenderBackend.Execute(RCL);
+		Times[i] = Perf.GetTime();
+	}
+
+	LogI(Benchmark, L"Replay: %u commands, %u objects, %.2f KB payloads, rebuilt in %.3f ms", RenderCapture.GetCommandCount(), RenderCapture.GetObjectCount(), RenderCapture.GetPayloadSize() / 1024., RecordTime);
+	LogI(Benchmark, L"Replay: %u draw calls, %u errors per run", RenderBackend.GetDrawCallCount() / ReplayCount, RenderBackend.GetErrorCount() / ReplayCount);
+	LogPercentiles(RenderBackend.GetName(), Times);
+});
+
+//------------------------------------------------------------------------------------------------------
+// RenderCluster sort: 50k clusters, 200 materials.
+// Compares the radix sort to std::sort, and counts the state changes of the submission order.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkSortRenderClusters(L"Benchmark.SortRenderClusters", []()
+{
+	const uint kClusters = 50000;
+	const uint kMaterials = 200;
+	const uint kShaderPrograms = 20;
+	const uint kPrimitives = 2000;
+	const uint kRuns = 50;
+
+	std::mt19937 Random(1234);
+	std::uniform_real_distribution<float> RandomDistance(1.f, 10000.f);
+
+	vector<TRenderClusterSortItem> Source(kClusters);
+	for (TRenderClusterSortItem& Item : Source)
+	{
+		// A material always uses the same shaders
+		const uint Material = Random() % kMaterials;
+		const uint ShaderProgram = Material % kShaderPrograms;
+		const float Distance = RandomDistance(Random);
+		Item.Key = MakeRenderClusterStateKey(ERenderPass::GBuffer, ShaderProgram, Material, Random() % kPrimitives) | MakeRenderClusterDepthKey(Distance * Distance);
+		Item.RenderCluster = nullptr;
+	}
+
+	// Material and shader changes when submitted in this order
+	auto CountStateChanges = [](const vector<TRenderClusterSortItem>& Items)
+	{
+		const uint64 kStateMask = ~0ull << 32; // Pass | ShaderProgram | Material
+		uint Changes = 0;
+		for (size_t i = 1; i < Items.size(); i++)
+		{
+			Changes += (Items[i].Key & kStateMask) != (Items[i - 1].Key & kStateMask);
+		}
+		return Changes;
+	};
+
+	vector<TRenderClusterSortItem> Items;
+	vector<double> StdSortTimes, RadixSortTimes;
+
+	for (uint i = 0; i < kRuns; i++)
+	{
+		Items = Source;
+		LXPerformance Perf;
+		std::sort(Items.begin(), Items.end(), [](const TRenderClusterSortItem& a, const TRenderClusterSortItem& b) { return a.Key < b.Key; });
+		StdSortTimes.push_back(Perf.GetTime());
+	}
+
+	const vector<TRenderClusterSortItem> StdSorted = Items;
+
+	for (uint i = 0; i < kRuns; i++)
+	{
+		Items = Source;
+		LXPerformance Perf;
+		SortRenderClusters(Items);
+		RadixSortTimes.push_back(Perf.GetTime());
+	}
+
+	for (uint i = 0; i < kClusters; i++)
+	{
+		CHK(Items[i].Key == StdSorted[i].Key);
+	}
+
+	LogI(Benchmark, L"SortRenderClusters: %u clusters, %u materials. State changes: %u unsorted, %u sorted", kClusters, kMaterials, CountStateChanges(Source), CountStateChanges(Items));
+	LogPercentiles(L"std::sort", StdSortTimes);
+	LogPercentiles(L"LXRadixSort64", RadixSortTimes);
+});
+
+//------------------------------------------------------------------------------------------------------
+// Frustum culling: 10k, 100k and 1M random boxes.
+// Compares IsBoxIn per box to the batched CullBoxes and to the BVH query, and checks they agree.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkFrustumCulling(L"Benchmark.FrustumCulling", []()
+{
+	const uint kBoxCounts[] = { 10000, 100000, 1000000 };
+	const uint kRuns = 20;
+
+	LXMatrix MatrixProjection;
+	MatrixProjection.SetPerspectiveLH(60.f, 16.f / 9.f, 1.f, 10000.f);
+
+	LXFrustum Frustum;
+	Frustum.Update(MatrixProjection);
+
+	std::mt19937 Random(1234);
+	std::uniform_real_distribution<float> RandomPosition(-10000.f, 10000.f);
+	std::uniform_real_distribution<float> RandomSize(1.f, 200.f);
+
+	LogI(Benchmark, L"FrustumCulling: batch width %u", LXFrustum::GetBoxBatchWidth());
+
+	for (uint BoxCount : kBoxCounts)
+	{
+		vector<float> MinX(BoxCount), MinY(BoxCount), MinZ(BoxCount), MaxX(BoxCount), MaxY(BoxCount), MaxZ(BoxCount);
+		for (uint i = 0; i < BoxCount; i++)
+		{
+			MinX[i] = RandomPosition(Random);
+			MinY[i] = RandomPosition(Random);
+			MinZ[i] = RandomPosition(Random);
+			MaxX[i] = MinX[i] + RandomSize(Random);
+			MaxY[i] = MinY[i] + RandomSize(Random);
+			MaxZ[i] = MinZ[i] + RandomSize(Random);
+		}
+
+		TFrustumBoxes Boxes;
+		Boxes.MinX = MinX.data();
+		Boxes.MinY = MinY.data();
+		Boxes.MinZ = MinZ.data();
+		Boxes.MaxX = MaxX.data();
+		Boxes.MaxY = MaxY.data();
+		Boxes.MaxZ = MaxZ.data();
+		Boxes.Count = BoxCount;
+
+		vector<uint> ScalarIndices, BatchIndices(BoxCount), BVHIndices;
+		vector<double> ScalarTimes, BatchTimes, BVHTimes;
+		uint BatchCount = 0;
+
+		LXPerformance PerfBuild;
+		LXBVH BVH;
+		BVH.Build(Boxes, vector<uint>());
+		const double BuildTime = PerfBuild.GetTime();
+
+		for (uint Run = 0; Run < kRuns; Run++)
+		{
+			ScalarIndices.clear();
+			LXPerformance Perf;
+			for (uint i = 0; i < BoxCount; i++)
+			{
+				if (Frustum.IsBoxIn(MinX[i], MinY[i], MinZ[i], MaxX[i], MaxY[i], MaxZ[i]))
+					ScalarIndices.push_back(i);
+			}
+			ScalarTimes.push_back(Perf.GetTime());
+
+			Perf.Reset();
+			BatchCount = Frustum.CullBoxes(Boxes, BatchIndices.data());
+			BatchTimes.push_back(Perf.GetTime());
+
+			BVHIndices.clear();
+			Perf.Reset();
+			BVH.QueryFrustum(Frustum, BVHIndices);
+			BVHTimes.push_back(Perf.GetTime());
+		}
+
+		CHK(BatchCount == ScalarIndices.size());
+		CHK(std::equal(ScalarIndices.begin(), ScalarIndices.end(), BatchIndices.begin()));
+
+		std::sort(BVHIndices.begin(), BVHIndices.end());
+		CHK(BVHIndices == ScalarIndices);
+
+		LogI(Benchmark, L"FrustumCulling: %u boxes, %u visible. BVH: %u nodes, built in %.3f ms", BoxCount, BatchCount, BVH.GetNodeCount(), BuildTime);
+		LogPercentiles(L"IsBoxIn", ScalarTimes);
+		LogPercentiles(L"CullBoxes", BatchTimes);
+		LogPercentiles(L"LXBVH::QueryFrustum", BVHTimes);
+	}
+});
+
+//------------------------------------------------------------------------------------------------------
+// Occlusion culling: a wall of 16x16 quads in front of 100k random boxes.
+// Times the occluder rasterization and the box tests. No box in front of the wall may be culled.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkOcclusionCulling(L"Benchmark.OcclusionCulling", []()
+{
+	const uint kBoxCount = 100000;
+	const uint kWallQuads = 16;
+	const float kWallSize = 200.f;
+	const float kWallZ = 200.f;
+	const uint kRuns = 20;
+
+	LXMatrix MatrixProjection;
+	MatrixProjection.SetPerspectiveLH(60.f, 16.f / 9.f, 1.f, 10000.f);
+
+	// Wall centered on the view axis
+	vector<vec3f> Positions;
+	vector<uint> Indices;
+	const float QuadSize = kWallSize / kWallQuads;
+	for (uint i = 0; i < kWallQuads; i++)
+	{
+		for (uint j = 0; j < kWallQuads; j++)
+		{
+			const float x = -0.5f * kWallSize + i * QuadSize;
+			const float y = -0.5f * kWallSize + j * QuadSize;
+			const uint First = (uint)Positions.size();
+			Positions.push_back(vec3f(x, y, kWallZ));
+			Positions.push_back(vec3f(x + QuadSize, y, kWallZ));
+			Positions.push_back(vec3f(x + QuadSize, y + QuadSize, kWallZ));
+			Positions.push_back(vec3f(x, y + QuadSize, kWallZ));
+			const uint Quad[] = { First, First + 1, First + 2, First, First + 2, First + 3 };
+			Indices.insert(Indices.end(), Quad, Quad + 6);
+		}
+	}
+
+	std::mt19937 Random(1234);
+	std::uniform_real_distribution<float> RandomPosition(-300.f, 300.f);
+	std::uniform_real_distribution<float> RandomDepth(10.f, 1000.f);
+	std::uniform_real_distribution<float> RandomSize(1.f, 20.f);
+
+	vector<float> MinX(kBoxCount), MinY(kBoxCount), MinZ(kBoxCount), MaxX(kBoxCount), MaxY(kBoxCount), MaxZ(kBoxCount);
+	for (uint i = 0; i < kBoxCount; i++)
+	{
+		MinX[i] = RandomPosition(Random);
+		MinY[i] = RandomPosition(Random);
+		MinZ[i] = RandomDepth(Random);
+		MaxX[i] = MinX[i] + RandomSize(Random);
+		MaxY[i] = MinY[i] + RandomSize(Random);
+		MaxZ[i] = MinZ[i] + RandomSize(Random);
+	}
+
+	TFrustumBoxes Boxes;
+	Boxes.MinX = MinX.data();
+	Boxes.MinY = MinY.data();
+	Boxes.MinZ = MinZ.data();
+	Boxes.MaxX = MaxX.data();
+	Boxes.MaxY = MaxY.data();
+	Boxes.MaxZ = MaxZ.data();
+	Boxes.Count = kBoxCount;
+
+	LXOcclusionCulling OcclusionCulling;
+	LXMatrix MatrixWorld;
+	vector<uint> VisibleIndices;
+	vector<double> RasterizeTimes, CullTimes;
+	uint CulledCount = 0;
+
+	for (uint Run = 0; Run < kRuns; Run++)
+	{
+		LXPerformance Perf;
+		OcclusionCulling.Begin(MatrixProjection);
+		OcclusionCulling.AddOccluder(Positions.data(), (uint)Positions.size(), Indices.data(), (uint)Indices.size(), MatrixWorld);
+		OcclusionCulling.Rasterize();
+		RasterizeTimes.push_back(Perf.GetTime());
+
+		VisibleIndices.resize(kBoxCount);
+		for (uint i = 0; i < kBoxCount; i++)
+		{
+			VisibleIndices[i] = i;
+		}
+
+		Perf.Reset();
+		CulledCount = OcclusionCulling.CullBoxes(Boxes, VisibleIndices);
+		CullTimes.push_back(Perf.GetTime());
+	}
+
+	// Conservative: the boxes in front of the wall are kept
+	vector<uint8> Visibles(kBoxCount, 0);
+	for (uint i : VisibleIndices)
+	{
+		Visibles[i] = 1;
+	}
+
+	for (uint i = 0; i < kBoxCount; i++)
+	{
+		CHK(Visibles[i] || MinZ[i] > kWallZ);
+	}
+
+	LogI(Benchmark, L"OcclusionCulling: %ux%u buffer, %u triangles, %u boxes, %u culled", OcclusionCulling.GetWidth(), OcclusionCulling.GetHeight(), OcclusionCulling.GetTriangleCount(), kBoxCount, CulledCount);
+	LogPercentiles(L"LXOcclusionCulling::Rasterize", RasterizeTimes);
+	LogPercentiles(L"LXOcclusionCulling::CullBoxes", CullTimes);
+});
+
+//------------------------------------------------------------------------------------------------------
+// Shadow atlas: random allocations and frees in the packer, then 1000 lights with moving coverages.
+// Checks the tiles never overlap, the hysteresis and the LRU reuse, and times the atlas Update.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkShadowAtlas(L"Benchmark.ShadowAtlas", []()
+{
+	const uint kAtlasSize = 2048;
+	const uint kMinSize = 128;
+	const uint kMaxSize = 1024;
+	const uint kOperations = 100000;
+	const uint kLightCount = 1000;
+	const uint kFrames = 200;
+
+	std::mt19937 Random(1234);
+
+	// Packer: the freed tiles merge back
+	{
+		LXShadowAtlasPacker Packer(kAtlasSize, kMinSize);
+		vector<TShadowAtlasTile> Tiles;
+
+		for (uint i = 0; i < kOperations; i++)
+		{
+			if (Tiles.empty() || Random() % 2)
+			{
+				TShadowAtlasTile Tile;
+				if (Packer.Allocate(kMinSize << (Random() % 4), Tile))
+					Tiles.push_back(Tile);
+			}
+			else
+			{
+				const uint Index = Random() % Tiles.size();
+				Packer.Free(Tiles[Index]);
+				Tiles[Index] = Tiles.back();
+				Tiles.pop_back();
+			}
+
+			if (i % 1000 == 0)
+				CheckShadowAtlasTiles(Tiles, kAtlasSize, kMinSize);
+		}
+
+		for (const TShadowAtlasTile& Tile : Tiles)
+		{
+			Packer.Free(Tile);
+		}
+
+		TShadowAtlasTile Tile;
+		CHK(Packer.GetUsedArea() == 0);
+		CHK(Packer.Allocate(kAtlasSize, Tile) && Tile.Size == kAtlasSize);
+	}
+
+	// Hysteresis: a coverage alternating faster than the resize delay keeps the tile
+	{
+		LXShadowAtlas ShadowAtlas(kAtlasSize, kMinSize, kMaxSize);
+		const uint Key = 0;
+		uint ResizeCount = 0;
+
+		for (uint Frame = 0; Frame < 100; Frame++)
+		{
+			ShadowAtlas.Request(&Key, (Frame / 5) % 2 ? 1.f : 0.25f, 1.f);
+			ShadowAtlas.Update();
+			ResizeCount += ShadowAtlas.GetResizeCount();
+		}
+
+		CHK(ResizeCount == 0);
+	}
+
+	// LRU: a light coming back gets its tile back
+	{
+		LXShadowAtlas ShadowAtlas(kAtlasSize, kMinSize, kMaxSize);
+		const uint Keys[2] = {};
+
+		ShadowAtlas.Request(&Keys[0], 1.f, 1.f);
+		ShadowAtlas.Update();
+		const TShadowAtlasTile Tile = ShadowAtlas.GetTile(&Keys[0]);
+
+		ShadowAtlas.Request(&Keys[1], 0.01f, 1.f);
+		ShadowAtlas.Update();
+		CHK(ShadowAtlas.GetTile(&Keys[0]).Size == 0);
+
+		ShadowAtlas.Request(&Keys[0], 1.f, 1.f);
+		ShadowAtlas.Update();
+		CHK(ShadowAtlas.GetTile(&Keys[0]).X == Tile.X && ShadowAtlas.GetTile(&Keys[0]).Y == Tile.Y && ShadowAtlas.GetEvictionCount() == 0);
+	}
+
+	// Lights: random coverages, a tenth changing each frame
+	LXShadowAtlas ShadowAtlas(kAtlasSize, kMinSize, kMaxSize);
+	vector<float> Coverages(kLightCount);
+	vector<float> Distances(kLightCount);
+	vector<TShadowAtlasTile> Tiles(kLightCount);
+	std::uniform_real_distribution<float> RandomUnit(0.f, 1.f);
+
+	for (uint i = 0; i < kLightCount; i++)
+	{
+		Coverages[i] = powf(RandomUnit(Random), 4.f);
+		Distances[i] = RandomUnit(Random) * 1000.f;
+	}
+
+	vector<double> UpdateTimes;
+	uint EvictionCount = 0;
+	uint ResizeCount = 0;
+
+	for (uint Frame = 0; Frame < kFrames; Frame++)
+	{
+		for (uint i = 0; i < kLightCount / 10; i++)
+		{
+			Coverages[Random() % kLightCount] = powf(RandomUnit(Random), 4.f);
+		}
+
+		LXPerformance Perf;
+		for (uint i = 0; i < kLightCount; i++)
+		{
+			ShadowAtlas.Request(&Coverages[i], Coverages[i], Distances[i]);
+		}
+		ShadowAtlas.Update();
+		UpdateTimes.push_back(Perf.GetTime());
+
+		for (uint i = 0; i < kLightCount; i++)
+		{
+			Tiles[i] = ShadowAtlas.GetTile(&Coverages[i]);
+		}
+
+		CheckShadowAtlasTiles(Tiles, kAtlasSize, kMinSize);
+		EvictionCount += ShadowAtlas.GetEvictionCount();
+		ResizeCount += ShadowAtlas.GetResizeCount();
+	}
+
+	const uint64 AtlasArea = (uint64)kAtlasSize * kAtlasSize;
+	LogI(Benchmark, L"ShadowAtlas: %u lights, %u tiles, %.1f%% used, %u evictions, %u resizes in %u frames", kLightCount, ShadowAtlas.GetTileCount(), 100. * ShadowAtlas.GetPacker().GetUsedArea() / AtlasArea, EvictionCount, ResizeCount, kFrames);
+	LogPercentiles(L"LXShadowAtlas::Update", UpdateTimes);
+});
+
+//------------------------------------------------------------------------------------------------------
+// Clustered lights: binning of 1024 and 4096 lights in the clusters, multithreaded.
+// The point lights are checked against a brute force binning, then the Build is timed with spots.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkLightBinning(L"Benchmark.LightBinning", []()
+{
+	const float kNear = 1.f;
+	const float kFar = 10000.f;
+	const uint kLightCounts[] = { 1024, 4096 };
+
+	// View space = world space
+	LXMatrix MatrixView;
+	LXMatrix MatrixProjection;
+	MatrixProjection.SetPerspectiveLH(60.f, 16.f / 9.f, kNear, kFar);
+
+	std::mt19937 Random(1234);
+	std::uniform_real_distribution<float> RandomUnit(0.f, 1.f);
+	const vec4f Color(1.f, 1.f, 1.f, 1.f);
+
+	for (uint LightCount : kLightCounts)
+	{
+		// Around the frustum from 100 to 3000, ranges from 10 to 100
+		vector<vec4f> Spheres(LightCount);
+		for (vec4f& Sphere : Spheres)
+		{
+			const float z = 100.f + RandomUnit(Random) * 2900.f;
+			Sphere = vec4f((RandomUnit(Random) * 2.f - 1.f) * z, (RandomUnit(Random) * 2.f - 1.f) * z * 0.6f, z, 10.f + RandomUnit(Random) * 90.f);
+		}
+
+		LXClusteredLights ClusteredLights(LightCount);
+		ClusteredLights.Begin(MatrixView, MatrixProjection, kNear, kFar);
+
+		for (const vec4f& Sphere : Spheres)
+		{
+			CHK(ClusteredLights.AddOmniLight(vec3f(Sphere.x, Sphere.y, Sphere.z), Sphere.w, Color, 1.f));
+		}
+
+		ClusteredLights.Build();
+		CHK(ClusteredLights.GetOverflowCount() == 0);
+
+		LXPerformance Perf;
+		const uint IndexCount = CheckClusteredLights(ClusteredLights, Spheres);
+		const double ReferenceTime = Perf.GetTime();
+		CHK(IndexCount == ClusteredLights.GetIndexCount());
+
+		// Half spots, pointing anywhere
+		vector<double> BuildTimes;
+		for (uint Frame = 0; Frame < kBenchmarkFrames; Frame++)
+		{
+			ClusteredLights.Begin(MatrixView, MatrixProjection, kNear, kFar);
+
+			for (uint i = 0; i < LightCount; i++)
+			{
+				const vec3f Position(Spheres[i].x, Spheres[i].y, Spheres[i].z);
+				if (i % 2)
+				{
+					vec3f Direction(RandomUnit(Random) - 0.5f, RandomUnit(Random) - 0.5f, RandomUnit(Random) - 0.5f);
+					Direction.Normalize();
+					ClusteredLights.AddSpotLight(Position, Direction, Spheres[i].w, 20.f + RandomUnit(Random) * 100.f, Color, 1.f);
+				}
+				else
+				{
+					ClusteredLights.AddOmniLight(Position, Spheres[i].w, Color, 1.f);
+				}
+			}
+
+			Perf.Reset();
+			ClusteredLights.Build();
+			BuildTimes.push_back(Perf.GetTime());
+		}
+
+		LogI(Benchmark, L"LightBinning: %u lights, %u clusters, %u indices, %u overflow, brute force %.2f ms", LightCount, kClusterCount, ClusteredLights.GetIndexCount(), ClusteredLights.GetOverflowCount(), ReferenceTime);
+		LogPercentiles(L"LXClusteredLights::Build", BuildTimes);
+	}
+});
+
+//------------------------------------------------------------------------------------------------------
+// Mesh simplification: LOD chain of a 400x400 bumpy sphere (320k triangles).
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkMeshSimplify(L"Benchmark.MeshSimplify", []()
+{
+	const uint kSegments = 400;
+	const float kPi = 3.14159265f;
+
+	LXPrimitive Primitive;
+	Primitive.SetTopology(LX_TRIANGLES);
+
+	ArrayVec3f& Positions = Primitive.GetArrayPositions();
+	ArrayVec3f& Normals = Primitive.GetArrayNormals();
+	ArrayUint& Indices = Primitive.GetArrayIndices();
+
+	for (uint j = 0; j <= kSegments; j++)
+	{
+		const float Theta = kPi * j / kSegments;
+		for (uint i = 0; i <= kSegments; i++)
+		{
+			const float Phi = 2.f * kPi * i / kSegments;
+			const vec3f Normal(sinf(Theta) * cosf(Phi), sinf(Theta) * sinf(Phi), cosf(Theta));
+			const float Radius = 100.f + 2.f * sinf(Theta * 12.f) * sinf(Phi * 12.f);
+			Positions.push_back(Normal * Radius);
+			Normals.push_back(Normal);
+		}
+	}
+
+	const uint Stride = kSegments + 1;
+	for (uint j = 0; j < kSegments; j++)
+	{
+		for (uint i = 0; i < kSegments; i++)
+		{
+			const uint v0 = j * Stride + i;
+			const uint v1 = v0 + 1;
+			const uint v2 = v0 + Stride;
+			const uint v3 = v2 + 1;
+			Indices.insert(Indices.end(), { v0, v2, v1, v1, v2, v3 });
+		}
+	}
+
+	LXPerformance Perf;
+	Primitive.GenerateLODs();
+	const double Time = Perf.GetTime();
+
+	LogI(Benchmark, L"MeshSimplify: %u triangles, %u LODs in %.2f ms", (uint)Indices.size() / 3, (uint)Primitive.GetLODs().size(), Time);
+
+	for (size_t i = 0; i < Primitive.GetLODs().size(); i++)
+	{
+		const TPrimitiveLOD& LOD = Primitive.GetLODs()[i];
+		LogI(Benchmark, L"MeshSimplify: LOD %u, %u triangles, error %.5f", (uint)i + 1, (uint)LOD.Indices.size() / 3, LOD.Error);
+	}
+});
+
+//------------------------------------------------------------------------------------------------------
+// Vertex cache: a 300x300 grid (180k triangles) in shuffled triangle order, optimized for the cache,
+// then for the overdraw, then for the vertex fetch.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkVertexCache(L"Benchmark.VertexCache", []()
+{
+	const uint kSegments = 300;
+	const uint kCacheSize = 16;
+
+	ArrayVec3f Positions;
+	for (uint j = 0; j <= kSegments; j++)
+		for (uint i = 0; i <= kSegments; i++)
+			Positions.push_back(vec3f((float)i, (float)j, sinf(i * 0.1f) * cosf(j * 0.1f) * 4.f));
+
+	const uint VertexCount = (uint)Positions.size();
+	const uint Stride = kSegments + 1;
+
+	vector<vec3ui> Triangles;
+	for (uint j = 0; j < kSegments; j++)
+	{
+		for (uint i = 0; i < kSegments; i++)
+		{
+			const uint v0 = j * Stride + i;
+			Triangles.push_back(vec3ui(v0, v0 + Stride, v0 + 1));
+			Triangles.push_back(vec3ui(v0 + 1, v0 + Stride, v0 + Stride + 1));
+		}
+	}
+
+	std::mt19937 Random(1234);
+	std::shuffle(Triangles.begin(), Triangles.end(), Random);
+
+	ArrayUint Indices;
+	for (const vec3ui& Triangle : Triangles)
+		Indices.insert(Indices.end(), { Triangle.x, Triangle.y, Triangle.z });
+
+	const TVertexCacheStats Before = LXVertexCacheOptimizer::AnalyzeVertexCache(Indices, VertexCount, kCacheSize);
+
+	LXPerformance Perf;
+	LXVertexCacheOptimizer::OptimizeVertexCache(Indices, VertexCount);
+	const double CacheTime = Perf.GetTime();
+	const TVertexCacheStats AfterCache = LXVertexCacheOptimizer::AnalyzeVertexCache(Indices, VertexCount, kCacheSize);
+
+	Perf.Reset();
+	LXVertexCacheOptimizer::OptimizeOverdraw(Indices, Positions, 1.05f);
+	const double OverdrawTime = Perf.GetTime();
+	const TVertexCacheStats AfterOverdraw = LXVertexCacheOptimizer::AnalyzeVertexCache(Indices, VertexCount, kCacheSize);
+
+	ArrayUint Remap;
+	Perf.Reset();
+	const uint ReferencedCount = LXVertexCacheOptimizer::OptimizeVertexFetch(Indices, VertexCount, Remap);
+	const double FetchTime = Perf.GetTime();
+	CHK(ReferencedCount == VertexCount);
+
+	LogI(Benchmark, L"VertexCache: %u triangles, ACMR %.3f -> %.3f in %.2f ms, ATVR %.3f -> %.3f", (uint)Triangles.size(), Before.ACMR, AfterCache.ACMR, CacheTime, Before.ATVR, AfterCache.ATVR);
+	LogI(Benchmark, L"VertexCache: overdraw ACMR %.3f in %.2f ms, fetch remap in %.2f ms", AfterOverdraw.ACMR, OverdrawTime, FetchTime);
+});
+
+//------------------------------------------------------------------------------------------------------
+// Packed vertices: a 400x400 sphere with tangents in the PNABT and the packed PNABT layouts.
+// Reports the size, the packing time and the position and normal errors.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkPackedVertices(L"Benchmark.PackedVertices", []()
+{
+	const uint kSegments = 400;
+	const float kPi = 3.14159265f;
+	const float kRadius = 100.f;
+
+	LXPrimitive Primitive;
+	for (uint j = 0; j <= kSegments; j++)
+	{
+		const float Theta = kPi * j / kSegments;
+		for (uint i = 0; i <= kSegments; i++)
+		{
+			const float Phi = 2.f * kPi * i / kSegments;
+			const vec3f Normal(sinf(Theta) * cosf(Phi), sinf(Theta) * sinf(Phi), cosf(Theta));
+			const vec3f Tangent(-sinf(Phi), cosf(Phi), 0.f);
+			Primitive.GetArrayPositions().push_back(Normal * kRadius);
+			Primitive.GetArrayNormals().push_back(Normal);
+			Primitive.GetArrayTangents().push_back(Tangent);
+			Primitive.GetArrayBiNormals().push_back(CrossProduct(Normal, Tangent));
+			Primitive.GetArrayTexCoords().push_back(vec2f((float)i / kSegments, (float)j / kSegments));
+		}
+	}
+
+	const int Mask = LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TANGENTS | LX_PRIMITIVE_BINORMALS | LX_PRIMITIVE_TEXCOORDS;
+	const int VertexCount = (int)Primitive.GetVertices();
+	int VertexSize = 0;
+	int PackedVertexSize = 0;
+
+	LXPerformance Perf;
+	Vertex_PNABT* Vertices = (Vertex_PNABT*)Primitive.CreateInterleavedVertexArray(Mask, VertexCount, &VertexSize);
+	const double Time = Perf.GetTime();
+
+	Perf.Reset();
+	Vertex_PackedPNABT* PackedVertices = (Vertex_PackedPNABT*)Primitive.CreateInterleavedVertexArray(Mask | LX_PRIMITIVE_PACKED, VertexCount, &PackedVertexSize);
+	const double PackedTime = Perf.GetTime();
+
+	vec3f Offset;
+	float Scale;
+	Primitive.GetPackedPositionTransform(Offset, Scale);
+
+	float MaxPositionError = 0.f;
+	float MinNormalDot = 1.f;
+	float MinTangentDot = 1.f;
+
+	for (int i = 0; i < VertexCount; i++)
+	{
+		const uint16* Packed = PackedVertices[i].position;
+		const vec3f Position = Offset + vec3f(Packed[0] / 65535.f, Packed[1] / 65535.f, Packed[2] / 65535.f) * Scale;
+		MaxPositionError = std::max(MaxPositionError, Position.Distance(Vertices[i].position));
+		MinNormalDot = std::min(MinNormalDot, Dot(UnpackOctahedron(PackedVertices[i].normalTangent), Vertices[i].normal));
+		MinTangentDot = std::min(MinTangentDot, Dot(UnpackOctahedron(PackedVertices[i].normalTangent + 2), Vertices[i].tangent));
+	}
+
+	LogI(Benchmark, L"PackedVertices: %i vertices, %i -> %i bytes per vertex, %.2f -> %.2f ms", VertexCount, VertexSize, PackedVertexSize, Time, PackedTime);
+	LogI(Benchmark, L"PackedVertices: position error %.5f for a %.0f extent, normal error %.4f deg, tangent error %.4f deg", MaxPositionError, Scale, acosf(std::min(MinNormalDot, 1.f)) * 180.f / kPi, acosf(std::min(MinTangentDot, 1.f)) * 180.f / kPi);
+
+	delete[] Vertices;
+	delete[] PackedVertices;
+});
+
+//------------------------------------------------------------------------------------------------------
+// Geometry allocator: random allocations and frees of mesh-like sizes in a 16M elements range,
+// checked against the live allocations, then defragmented. Reports the times and the fragmentation.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommandNoArg CCBenchmarkGeometryAllocator(L"Benchmark.GeometryAllocator", []()
+{
+	const uint kCapacity = 16 * 1024 * 1024;
+	const uint kOperationCount = 200000;
+
+	LXGeometryAllocator Allocator(kCapacity);
+	vector<uint> Allocations;
+	std::mt19937 Random(1234);
+
+	// No overlap between the live allocations
+	auto Check = [&Allocator, &Allocations]()
+	{
+		vector<pair<uint, uint>> Ranges;
+		for (uint Allocation : Allocations)
+			Ranges.push_back(make_pair(Allocator.GetOffset(Allocation), Allocator.GetSize(Allocation)));
+
+		std::sort(Ranges.begin(), Ranges.end());
+		for (size_t i = 1; i < Ranges.size(); i++)
+			CHK(Ranges[i - 1].first + Ranges[i - 1].second <= Ranges[i].first);
+
+		CHK(Ranges.empty() || Ranges.back().first + Ranges.back().second <= Allocator.GetCapacity());
+		CHK(Allocator.Validate());
+	};
+
+	uint FailedCount = 0;
+	LXPerformance Perf;
+	double OperationTime = 0.;
+
+	for (uint i = 0; i < kOperationCount; i++)
+	{
+		Perf.Reset();
+
+		if (Allocations.empty() || Random() % 100 < 52)
+		{
+			// Mostly small meshes, some large ones
+			const uint Size = Random() % 10 == 0 ? 1 + Random() % 65536 : 1 + Random() % 2048;
+			const uint Allocation = Allocator.Allocate(Size);
+			OperationTime += Perf.GetTime();
+
+			if (Allocation == LXGeometryAllocator::kInvalid)
+				FailedCount++;
+			else
+				Allocations.push_back(Allocation);
+		}
+		else
+		{
+			const size_t Index = Random() % Allocations.size();
+			Allocator.Free(Allocations[Index]);
+			OperationTime += Perf.GetTime();
+
+			Allocations[Index] = Allocations.back();
+			Allocations.pop_back();
+		}
+
+		if (i % 10000 == 0)
+			Check();
+	}
+
+	Check();
+
+	const uint FreeSize = Allocator.GetFreeSize();
+	const uint LargestFreeSize = Allocator.GetLargestFreeSize();
+
+	vector<TGeometryMove> Moves;
+	Perf.Reset();
+	Allocator.Defragment(Moves);
+	const double DefragmentTime = Perf.GetTime();
+
+	Check();
+	CHK(Allocator.GetLargestFreeSize() == Allocator.GetFreeSize());
+
+	uint64 MovedSize = 0;
+	for (size_t i = 0; i < Moves.size(); i++)
+	{
+		CHK(Moves[i].DstOffset < Moves[i].SrcOffset);
+		CHK(i == 0 || Moves[i - 1].DstOffset + Moves[i - 1].Size == Moves[i].DstOffset);
+		MovedSize += Moves[i].Size;
+	}
+
+	for (uint Allocation : Allocations)
+		Allocator.Free(Allocation);
+
+	CHK(Allocator.Validate() && Allocator.GetAllocationCount() == 0 && Allocator.GetLargestFreeSize() == kCapacity);
+
+	LogI(Benchmark, L"GeometryAllocator: %u operations in %.2f ms (%.1f ns each), %u failed", kOperationCount, OperationTime, OperationTime * 1e6 / kOperationCount, FailedCount);
+	LogI(Benchmark, L"GeometryAllocator: %u allocations, largest free range %.1f%% of the free space", (uint)Allocations.size(), FreeSize ? 100.f * LargestFreeSize / FreeSize : 100.f);
+	LogI(Benchmark, L"GeometryAllocator: defragmented in %.2f ms, %u moves, %.1f M elements moved", DefragmentTime, (uint)Moves.size(), MovedSize / 1e6);
+});
+
+//------------------------------------------------------------------------------------------------------
+// Geometry load: Benchmark.MeshLoad [Folder]
+// Loads the legacy geometry files of the folder, then the same geometries as raw and compressed
+// containers (written aside and deleted). Run it twice for warm system cache timings.
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommand1S CCBenchmarkMeshLoad(L"Benchmark.MeshLoad", [](const LXString& Folder)
+{
+	LXFilepath Folderpath = Folder.IsEmpty() ? GetSettings().GetDataFolder() : LXFilepath(Folder);
+	if (Folderpath.Right(1) != L"/")
+		Folderpath += L"/";
+
+	auto GetFileSize = [](const LXFilepath& Filepath)
+	{
+		LXMappedFile File;
+		return File.Open(Filepath) ? File.GetSize() : 0ull;
+	};
+
+	uint FileCount = 0;
+	uint64 LegacySize = 0;
+	uint64 ContainerSize = 0;
+	uint64 CompressedSize = 0;
+	double LegacyTime = 0.;
+	double ProcessTime = 0.;
+	double ContainerTime = 0.;
+	double CompressedTime = 0.;
+
+	LXDirectory Directory(Folderpath + L"*");
+
+	for (const LXFileInfo& FileInfo : Directory.GetListFileNames())
+	{
+		const LXFilepath Filepath(FileInfo.FullFileName.c_str());
+		if (Filepath.GetExtension().MakeLower() != LX_MESHBIN_EXT || LXGeometryContainer::IsContainer(Filepath))
+			continue;
+
+		LXPerformance Perf;
+		MapPrimitiveGeometries Geometries;
+		if (!LXGeometryContainer::LoadLegacy(Filepath, Geometries))
+			continue;
+		LegacyTime += Perf.GetTime();
+
+		Perf.Reset();
+		LXGeometryContainer::GenerateLODsAndOptimize(Geometries);
+		ProcessTime += Perf.GetTime();
+
+		const LXFilepath ContainerFilepath = Filepath + L".lxgc";
+		if (!LXGeometryContainer::Save(ContainerFilepath, Geometries))
+			continue;
+
+		Perf.Reset();
+		MapPrimitiveGeometries ContainerGeometries;
+		VRF(LXGeometryContainer::Load(ContainerFilepath, ContainerGeometries));
+		ContainerTime += Perf.GetTime();
+		CHK(ContainerGeometries.size() == Geometries.size());
+
+		const LXFilepath CompressedFilepath = Filepath + L".lxgcz";
+		if (!LXGeometryContainer::Save(CompressedFilepath, Geometries, true))
+			continue;
+
+		Perf.Reset();
+		MapPrimitiveGeometries CompressedGeometries;
+		VRF(LXGeometryContainer::Load(CompressedFilepath, CompressedGeometries));
+		CompressedTime += Perf.GetTime();
+		CHK(CompressedGeometries.size() == Geometries.size());
+
+		FileCount++;
+		LegacySize += GetFileSize(Filepath);
+		ContainerSize += GetFileSize(ContainerFilepath);
+		CompressedSize += GetFileSize(CompressedFilepath);
+		::DeleteFile(ContainerFilepath);
+		::DeleteFile(CompressedFilepath);
+	}
+
+	auto Throughput = [](uint64 Size, double Time) { return Time > 0. ? Size / (1024. * 1024.) / (Time / 1000.) : 0.; };
+
+	LogI(Benchmark, L"MeshLoad: %u legacy files, %.1f MB, containers %.1f MB, compressed %.1f MB", FileCount, LegacySize / (1024. * 1024.), ContainerSize / (1024. * 1024.), CompressedSize / (1024. * 1024.));
+	LogI(Benchmark, L"MeshLoad: legacy %.1f ms (%.0f MB/s), + %.1f ms of LODs and optimization at load", LegacyTime, Throughput(LegacySize, LegacyTime), ProcessTime);
+	LogI(Benchmark, L"MeshLoad: container %.1f ms (%.0f MB/s)", ContainerTime, Throughput(ContainerSize, ContainerTime));
+	LogI(Benchmark, L"MeshLoad: compressed container %.1f ms (%.0f MB/s of raw container)", CompressedTime, Throughput(ContainerSize, CompressedTime));
+});
+
+//------------------------------------------------------------------------------------------------------
+// Asset registry: Benchmark.AssetRegistry [Folder]
+// Full recursive scan of the folder, as done at each launch before the registry, against the
+// validation of its registry (written by the first run).
+//------------------------------------------------------------------------------------------------------
+
+LXConsoleCommand1S CCBenchmarkAssetRegistry(L"Benchmark.AssetRegistry", [](const LXString& Folder)
+{
+	LXFilepath Folderpath = Folder.IsEmpty() ? GetSettings().GetDataFolder() : LXFilepath(Folder);
+	if (Folderpath.Right(1) != L"/")
+		Folderpath += L"/";
+
+	LXPerformance Perf;
+	LXDirectory Directory(Folderpath + L"*");
+	const double ScanTime = Perf.GetTime();
+
+	{
+		LXAssetRegistry Registry(Folderpath);
+		Registry.Update();
+		Registry.Save();
+	}
+
+	Perf.Reset();
+	LXAssetRegistry Registry(Folderpath);
+	Registry.Update();
+	const double UpdateTime = Perf.GetTime();
+
+	uint AssetCount = 0;
+	Registry.ForEachAsset([&AssetCount](const LXString&, const TAssetRegistryEntry&) { AssetCount++; });
+
+	LogI(Benchmark, L"AssetRegistry: full scan %.2f ms, %u files", ScanTime, (uint)Directory.GetListFileNames().size());
+	LogI(Benchmark, L"AssetRegistry: validated in %.2f ms, %u assets, %u/%u folders scanned", UpdateTime, AssetCount, Registry.GetScannedFolderCount(), Registry.GetFolderCount());
+});
@@ -0,0 +1,275 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXClusteredLights.h"
+#include "LXMath.h"
+#include "LXThreadManager.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	const uint kSliceClusterCount = kClusterCountX * kClusterCountY;
+
+	// Slice items: light index in the high bits, cluster in the slice in the low byte
+	const uint kItemClusterBits = 8;
+	const uint kItemClusterMask = (1 << kItemClusterBits) - 1;
+
+	static_assert(kSliceClusterCount <= (1 << kItemClusterBits), "Slice cluster count too large for the item packing");
+	static_assert(sizeof(TClusteredLight) % 16 == 0, "TClusteredLight must be 16 bytes aligned");
+
+	// Distance from Value to the [Min, Max] interval
+	float GetIntervalDistance(float Value, float Min, float Max)
+	{
+		return std::max(0.f, std::max(Min - Value, Value - Max));
+	}
+};
+
+LXClusteredLights::LXClusteredLights(uint MaxLights, uint MaxIndices)
+{
+	_Lights.resize(MaxLights);
+	_LightBounds.reserve(MaxLights);
+	_ClusterRanges.resize(kClusterCount);
+	_LightIndices.resize(MaxIndices);
+	_Slices.resize(kClusterCountZ);
+}
+
+LXClusteredLights::~LXClusteredLights()
+{
+}
+
+void LXClusteredLights::Begin(const LXMatrix& MatrixView, const LXMatrix& MatrixProjection, float Near, float Far)
+{
+	CHK(Near > 0.f && Far > Near);
+
+	_MatrixView = MatrixView;
+	_ProjectionX = MatrixProjection.GetPtr()[0];
+	_ProjectionY = MatrixProjection.GetPtr()[5];
+	_Near = Near;
+	_Far = Far;
+
+	const float LogRatio = logf(Far / Near);
+	_SliceScale = kClusterCountZ / LogRatio;
+	_SliceBias = -kClusterCountZ * logf(Near) / LogRatio;
+
+	_LightBounds.clear();
+	_LightCount = 0;
+	_IndexCount = 0;
+	_OverflowCount = 0;
+}
+
+float LXClusteredLights::GetSliceDepth(uint Z) const
+{
+	return _Near * powf(_Far / _Near, (float)Z / kClusterCountZ);
+}
+
+bool LXClusteredLights::AddSpotLight(const vec3f& Position, const vec3f& Direction, float Range, float SpotAngle, const vec4f& Color, float Intensity)
+{
+	if (_LightCount == (uint)_Lights.size())
+		return false;
+
+	vec3f ViewPosition = Position;
+	vec3f ViewDirection = Direction;
+	_MatrixView.LocalToParentPoint(ViewPosition);
+	_MatrixView.LocalToParentVector(ViewDirection);
+	ViewDirection.Normalize();
+
+	const float HalfAngle = std::min(LX_DEGTORAD(SpotAngle) * 0.5f, LX_PI * 0.5f);
+	const float CosAngle = cosf(HalfAngle);
+
+	// Bounding sphere of the cone: around the base disk for the wide cones
+	TLightBounds Bounds;
+	if (CosAngle < 0.70710678f)
+	{
+		Bounds.Center = ViewPosition + ViewDirection * (Range * CosAngle);
+		Bounds.Radius = Range * sinf(HalfAngle);
+	}
+	else
+	{
+		Bounds.Radius = Range / (2.f * CosAngle);
+		Bounds.Center = ViewPosition + ViewDirection * Bounds.Radius;
+	}
+
+	TClusteredLight& Light = _Lights[_LightCount++];
+	Light.Position = ViewPosition;
+	Light.Range = Range;
+	Light.Direction = ViewDirection;
+	Light.SpotCosAngle = CosAngle;
+	Light.Color = vec3f(Color.x, Color.y, Color.z);
+	Light.Intensity = Intensity;
+	Light.Type = kClusteredLightTypeSpot;
+
+	_LightBounds.push_back(Bounds);
+	return true;
+}
+
+bool LXClusteredLights::AddOmniLight(const vec3f& Position, float Range, const vec4f& Color, float Intensity)
+{
+	if (_LightCount == (uint)_Lights.size())
+		return false;
+
+	vec3f ViewPosition = Position;
+	_MatrixView.LocalToParentPoint(ViewPosition);
+
+	TClusteredLight& Light = _Lights[_LightCount++];
+	Light.Position = ViewPosition;
+	Light.Range = Range;
+	Light.Direction = vec3f(0.f, 0.f, 1.f);
+	Light.SpotCosAngle = -1.f;
+	Light.Color = vec3f(Color.x, Color.y, Color.z);
+	Light.Intensity = Intensity;
+	Light.Type = kClusteredLightTypeOmni;
+
+	_LightBounds.push_back({ ViewPosition, Range });
+	return true;
+}
+
+void LXClusteredLights::GetClusterBounds(uint X, uint Y, uint Z, vec3f& Min, vec3f& Max) const
+{
+	const float ZMin = GetSliceDepth(Z);
+	const float ZMax = GetSliceDepth(Z + 1);
+
+	// NDC interval of the tile, Y from the top of the screen
+	const float X0 = -1.f + 2.f * X / kClusterCountX;
+	const float X1 = -1.f + 2.f * (X + 1) / kClusterCountX;
+	const float Y0 = 1.f - 2.f * (Y + 1) / kClusterCountY;
+	const float Y1 = 1.f - 2.f * Y / kClusterCountY;
+
+	Min.x = std::min(X0 * ZMin, X0 * ZMax) / _ProjectionX;
+	Max.x = std::max(X1 * ZMin, X1 * ZMax) / _ProjectionX;
+	Min.y = std::min(Y0 * ZMin, Y0 * ZMax) / _ProjectionY;
+	Max.y = std::max(Y1 * ZMin, Y1 * ZMax) / _ProjectionY;
+	Min.z = ZMin;
+	Max.z = ZMax;
+}
+
+void LXClusteredLights::BinSlice(uint Z)
+{
+	TSlice& Slice = _Slices[Z];
+	Slice.Items.clear();
+	std::fill(Slice.Counts, Slice.Counts + kSliceClusterCount, 0);
+
+	// The cluster boxes of a slice are the products of the column and row intervals
+	float ColumnMin[kClusterCountX], ColumnMax[kClusterCountX];
+	float RowMin[kClusterCountY], RowMax[kClusterCountY];
+	vec3f Min, Max;
+
+	for (uint x = 0; x < kClusterCountX; x++)
+	{
+		GetClusterBounds(x, 0, Z, Min, Max);
+		ColumnMin[x] = Min.x;
+		ColumnMax[x] = Max.x;
+	}
+
+	for (uint y = 0; y < kClusterCountY; y++)
+	{
+		GetClusterBounds(0, y, Z, Min, Max);
+		RowMin[y] = Min.y;
+		RowMax[y] = Max.y;
+	}
+
+	const float ZMin = GetSliceDepth(Z);
+	const float ZMax = GetSliceDepth(Z + 1);
+
+	float ColumnDistances[kClusterCountX];
+	float RowDistances[kClusterCountY];
+
+	for (uint i = 0; i < _LightCount; i++)
+	{
+		const TLightBounds& Bounds = _LightBounds[i];
+		const float DistanceZ = GetIntervalDistance(Bounds.Center.z, ZMin, ZMax);
+		const float Remaining = Bounds.Radius * Bounds.Radius - DistanceZ * DistanceZ;
+		if (Remaining < 0.f)
+			continue;
+
+		// Sphere against the boxes, with the squared distances per axis
+		uint FirstX = kClusterCountX, LastX = 0;
+		for (uint x = 0; x < kClusterCountX; x++)
+		{
+			const float d = GetIntervalDistance(Bounds.Center.x, ColumnMin[x], ColumnMax[x]);
+			ColumnDistances[x] = d * d;
+			if (ColumnDistances[x] <= Remaining)
+			{
+				FirstX = std::min(FirstX, x);
+				LastX = x;
+			}
+		}
+
+		if (FirstX > LastX)
+			continue;
+
+		for (uint y = 0; y < kClusterCountY; y++)
+		{
+			const float d = GetIntervalDistance(Bounds.Center.y, RowMin[y], RowMax[y]);
+			RowDistances[y] = d * d;
+			if (RowDistances[y] > Remaining)
+				continue;
+
+			for (uint x = FirstX; x <= LastX; x++)
+			{
+				if (ColumnDistances[x] + RowDistances[y] <= Remaining)
+				{
+					const uint Cluster = y * kClusterCountX + x;
+					Slice.Items.push_back((i << kItemClusterBits) | Cluster);
+					Slice.Counts[Cluster]++;
+				}
+			}
+		}
+	}
+}
+
+void LXClusteredLights::WriteSlice(uint Z)
+{
+	const TSlice& Slice = _Slices[Z];
+	const uint Capacity = (uint)_LightIndices.size();
+	TClusterRange* ClusterRanges = &_ClusterRanges[GetCluster(0, 0, Z)];
+
+	// Counting sort of the items by cluster, the lights stay in order
+	uint Cursors[kSliceClusterCount];
+	uint Offset = Slice.Offset;
+
+	for (uint i = 0; i < kSliceClusterCount; i++)
+	{
+		const uint First = std::min(Offset, Capacity);
+		ClusterRanges[i].Offset = First;
+		ClusterRanges[i].Count = std::min(Offset + Slice.Counts[i], Capacity) - First;
+		Cursors[i] = Offset;
+		Offset += Slice.Counts[i];
+	}
+
+	for (uint Item : Slice.Items)
+	{
+		uint& Cursor = Cursors[Item & kItemClusterMask];
+		if (Cursor < Capacity)
+			_LightIndices[Cursor] = Item >> kItemClusterBits;
+		Cursor++;
+	}
+}
+
+void LXClusteredLights::Build()
+{
+	ParallelFor(kClusterCountZ, [this](uint Z)
+	{
+		BinSlice(Z);
+	});
+
+	uint Offset = 0;
+	for (TSlice& Slice : _Slices)
+	{
+		Slice.Offset = Offset;
+		Offset += (uint)Slice.Items.size();
+	}
+
+	_IndexCount = std::min(Offset, (uint)_LightIndices.size());
+	_OverflowCount = Offset - _IndexCount;
+
+	ParallelFor(kClusterCountZ, [this](uint Z)
+	{
+		WriteSlice(Z);
+	});
+}
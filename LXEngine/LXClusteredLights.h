@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXMatrix.h"
+#include "LXVec3.h"
+#include "LXVec4.h"
+
+//
+// Clustered light culling: the view frustum is divided in a 3D grid of clusters (froxels), screen tiles
+// sliced exponentially in depth. The lights, bounded by spheres, are binned in the clusters they touch.
+// The binning runs per depth slice on the worker threads. The output is compact: per cluster, an offset
+// and a count in a single light index list, read by the lighting shader (LightingClustered.hlsl).
+// Positions and directions are in view space, the view looks toward +z.
+//
+
+const uint kClusterCountX = 16;
+const uint kClusterCountY = 9;
+const uint kClusterCountZ = 24;
+const uint kClusterCount = kClusterCountX * kClusterCountY * kClusterCountZ;
+
+const uint kClusteredLightTypeSpot = 0;
+const uint kClusteredLightTypeOmni = 1;
+
+// Shader layout
+struct TClusteredLight
+{
+	vec3f Position;
+	float Range;
+	vec3f Direction;
+	float SpotCosAngle;		// Cosine of the half angle
+	vec3f Color;
+	float Intensity;
+	uint Type;
+	uint Pad[3];
+};
+
+struct TClusterRange
+{
+	uint Offset;
+	uint Count;
+};
+
+class LXClusteredLights
+{
+
+public:
+
+	LXClusteredLights(uint MaxLights = 4096, uint MaxIndices = kClusterCount * 64);
+	~LXClusteredLights();
+
+	// Clears the lights. MatrixProjection is a symmetric perspective.
+	void Begin(const LXMatrix& MatrixView, const LXMatrix& MatrixProjection, float Near, float Far);
+
+	// World space. SpotAngle is the full angle in degrees. Returns false when MaxLights is reached.
+	bool AddSpotLight(const vec3f& Position, const vec3f& Direction, float Range, float SpotAngle, const vec4f& Color, float Intensity);
+	bool AddOmniLight(const vec3f& Position, float Range, const vec4f& Color, float Intensity);
+
+	// Bins the lights. The indices past MaxIndices are dropped, see GetOverflowCount.
+	void Build();
+
+	// Shader constants: slice = log(z) * SliceScale + SliceBias
+	float GetSliceScale() const { return _SliceScale; }
+	float GetSliceBias() const { return _SliceBias; }
+	uint GetCluster(uint X, uint Y, uint Z) const { return (Z * kClusterCountY + Y) * kClusterCountX + X; }
+
+	// View space box of a cluster
+	void GetClusterBounds(uint X, uint Y, uint Z, vec3f& Min, vec3f& Max) const;
+
+	// Results, sized to the capacities for the upload
+	const vector<TClusteredLight>& GetLights() const { return _Lights; }
+	const vector<TClusterRange>& GetClusterRanges() const { return _ClusterRanges; }
+	const vector<uint>& GetLightIndices() const { return _LightIndices; }
+
+	uint GetLightCount() const { return _LightCount; }
+	uint GetIndexCount() const { return _IndexCount; }
+	uint GetOverflowCount() const { return _OverflowCount; }
+
+private:
+
+	// Bounding sphere in view space
+	struct TLightBounds
+	{
+		vec3f Center;
+		float Radius;
+	};
+
+	// Light index and cluster in the slice, packed in a uint
+	struct TSlice
+	{
+		vector<uint> Items;
+		uint Counts[kClusterCountX * kClusterCountY];
+		uint Offset;
+	};
+
+	float GetSliceDepth(uint Z) const;
+	void BinSlice(uint Z);
+	void WriteSlice(uint Z);
+
+private:
+
+	LXMatrix _MatrixView;
+	float _ProjectionX = 1.f;	// NDC x = _ProjectionX * x / z
+	float _ProjectionY = 1.f;
+	float _Near = 1.f;
+	float _Far = 1000.f;
+	float _SliceScale = 0.f;
+	float _SliceBias = 0.f;
+
+	vector<TClusteredLight> _Lights;
+	vector<TLightBounds> _LightBounds;
+	vector<TClusterRange> _ClusterRanges;
+	vector<uint> _LightIndices;
+	vector<TSlice> _Slices;
+
+	uint _LightCount = 0;
+	uint _IndexCount = 0;
+	uint _OverflowCount = 0;
+};
@@ -179,8 +179,25 @@ void LXConsoleCommandT<bool>::Execute(const vector<LXString>& Arguments)
 	*Var = !*Var;
 }
 
+template<>
+void LXConsoleCommandT<int>::SetValueFromString(const LXString& Value)
+{
+	*Var = _wtoi(Value);
+}
+
+// With a value argument, sets the value. Logs it otherwise.
+template<>
+void LXConsoleCommandT<int>::Execute(const vector<LXString>& Arguments)
+{
+	GetValue();
+	if (Arguments.size() > 1)
+		SetValueFromString(Arguments[1]);
+	LogI(ConsoleManager, L"%s = %i", Name.GetBuffer(), *Var);
+}
+
 // Explicit class Instantiation
 template class LXCORE_API LXConsoleCommandT<bool>;
+template class LXCORE_API LXConsoleCommandT<int>;
 
 //------------------------------------------------------------------------------------------------------
 // LXConsoleCommandCall2
@@ -9,6 +9,7 @@
 #include "stdafx.h"
 #include "LXConstantBufferD3D11.h"
 #include "LXDirectX11.h"
+#include "LXRenderBackend.h"
 #include "LXStatistic.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
@@ -34,6 +35,9 @@ bool LXConstantBufferD3D11::CreateConstantBuffer(void* Buffer, int BufferSize)
 {
 	CHK(((16 - (BufferSize % 16)) % 16) == 0);
 
+	if (LXRenderBackend::IsNullDevice())
+		return true;
+
 	auto *D3D11Device = LXDirectX11::GetCurrentDevice();
 	auto *D3D11DeviceContext = LXDirectX11::GetCurrentDeviceContext();
 
@@ -16,7 +16,7 @@ struct LXConstantBufferDataSpotLight
 {
 	LXMatrix MatrixLightView;		// Row-major
 	LXMatrix MatrixLightProjection; // Row-major
-	vec4f ShadowMapCoords;
+	vec4f ShadowMapCoords;			// Tile in the shadow atlas: x, y position and z, w size (512 without Renderer.ShadowVariableTiles), in pixels
 	vec4f LightPosition;
 	vec4f LightDirection;
 	vec4f Color;
@@ -25,6 +25,17 @@ struct LXConstantBufferDataSpotLight
 	bool CastShadow;
 };
 
+struct LXConstantBufferDataClusteredLights
+{
+	uint ClusterCountX;
+	uint ClusterCountY;
+	uint ClusterCountZ;
+	uint LightCount;
+	float SliceScale;		// Slice = log(ViewZ) * SliceScale + SliceBias
+	float SliceBias;
+	vec2f TileSize;			// Pixels
+};
+
 struct LXConstantBufferDataIBL
 {
 	float AmbientIntensity;
@@ -20,6 +20,12 @@
 #include "LXNode.h"
 #include "LXGraph.h"
 #include "LXGraphMaterial.h"
+#include "LXProject.h"
+#include "LXAssetManager.h"
+#include "LXAssetMesh.h"
+#include "LXPrimitive.h"
+#include "LXPrimitiveInstance.h"
+#include "LXTexture.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
 LXController::LXController()
@@ -184,6 +190,12 @@ void LXController::Run()
 	// Now the RenderTread is waiting
 	// TODO CHK(RenderThread.IsWaiting());
 	
+	// Asynchronous loads: the ready assets are completed, their actors are updated below
+	if (LXProject* Project = GetCore().GetProject())
+	{
+		Project->GetAssetManager().Synchronize();
+	}
+
 	// All updates should be consumed.
 	//CHK(RendererUpdates.size() == 0);
 	
@@ -205,6 +217,7 @@ void LXController::Run()
 		// Lock, _SetActorToUpdateRenderState can be modified by the LoadingThread.
 		_mutex->Lock();
 		SetActors& Actors = _SetActorToUpdateRenderState;
+		SetMaterials Materials;
 		// Previous actors should be consumed
 		CHK(_SetActorToUpdateRenderState_RT.size() == 0);
 		_SetActorToUpdateRenderState_RT.insert(Actors.begin(), Actors.end());
@@ -213,7 +226,14 @@ void LXController::Run()
 		{
 			if (LXActorMesh* actorMesh = dynamic_cast<LXActorMesh*>(const_cast<LXActor*>(Actor)))
 			{
-				actorMesh->GetAllPrimitives();
+				// The released data is loaded again before the RenderThread uploads it
+				if (LXAssetMesh* AssetMesh = actorMesh->GetAssetMesh())
+					GetCore().GetProject()->GetAssetManager().UseAsset(AssetMesh);
+
+				for (const LXWorldPrimitive& WorldPrimitive : actorMesh->GetAllPrimitives())
+				{
+					Materials.insert(WorldPrimitive.PrimitiveInstance->Primitive->GetMaterial());
+				}
 			}
 
 			LogD(LXController, L"Synchronized: %s", Actor->GetName().GetBuffer());
@@ -221,6 +241,25 @@ void LXController::Run()
 		
 		Actors.clear();
 		_mutex->Unlock();
+
+		Materials.insert(_SetMaterialToUpdateRenderState.begin(), _SetMaterialToUpdateRenderState.end());
+		Materials.insert(_SetMaterialToRebuild.begin(), _SetMaterialToRebuild.end());
+		Materials.erase(nullptr);
+
+		// The released textures are loaded again before the RenderThread creates the materials using them
+		set<LXTexture*> Textures;
+		for (const LXMaterial* Material : Materials)
+		{
+			Material->GetGraph()->GetTextures(Textures);
+		}
+
+		if (LXProject* Project = GetCore().GetProject())
+		{
+			for (LXTexture* Texture : Textures)
+			{
+				Project->GetAssetManager().UseAsset(Texture);
+			}
+		}
 	}
 
 	//
@@ -111,6 +111,7 @@ LXCore::~LXCore()
 	delete m_viewportManager;
 	delete m_propertyManager;
 	delete StatManager;
+	delete ThreadManager;
 
 	LXConsoleManager::DeleteSingleton();
 		
@@ -126,6 +127,7 @@ void LXCore::Init()
 	LogI(Core, L"------ Seetron Engine ------");
 
 	StatManager = new LXStatManager();
+	ThreadManager = new LXThreadManager();
 	_settings = std::make_unique<LXSettings>();
 
 	GetLogger().LogConfigurationAndPlatform();
@@ -29,6 +29,7 @@ class LXSelectionManager;
 class LXSettings;
 class LXStatManager;
 class LXThread;
+class LXThreadManager;
 class LXViewport;
 class LXViewportManager;
 
@@ -94,6 +95,7 @@ public:
 	LXController*		GetController() { return _Controller.get(); }
 	LXSettings*			GetSettings() { return _settings.get(); }
 	LXStatManager*		GetStatManager() { return StatManager; }
+	LXThreadManager*	GetThreadManager() { return ThreadManager; }
 
 	// Animation
 	void				SetPlayMode(bool bPlay);
@@ -154,6 +156,7 @@ private:
 	LXPropertyManager*	 m_propertyManager;
 	LXScriptEngine*		 m_pScriptEngine;
 	LXStatManager*		 StatManager;
+	LXThreadManager*	 ThreadManager = nullptr;
 	
 	std::unique_ptr<LXSettings> _settings;
 	std::unique_ptr<LXActorFactory> _ActorFactory;
@@ -100,6 +100,57 @@ ULONG LXFile::Tell()
 	return (ULONG)ftell(m_pFile);
 }
 
+LXMappedFile::~LXMappedFile()
+{
+	Close();
+}
+
+bool LXMappedFile::Open(const LXString& strFilename)
+{
+	CHK(!_Data);
+	
+	_File = ::CreateFile(strFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (_File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(_File, &Size) || Size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	_Mapping = ::CreateFileMapping(_File, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (_Mapping)
+		_Data = (const uint8*)::MapViewOfFile(_Mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!_Data)
+	{
+		Close();
+		return false;
+	}
+
+	_Size = (uint64)Size.QuadPart;
+	return true;
+}
+
+void LXMappedFile::Close()
+{
+	if (_Data)
+		::UnmapViewOfFile(_Data);
+
+	if (_Mapping)
+		::CloseHandle(_Mapping);
+
+	if (_File != INVALID_HANDLE_VALUE)
+		::CloseHandle(_File);
+
+	_File = INVALID_HANDLE_VALUE;
+	_Mapping = nullptr;
+	_Data = nullptr;
+	_Size = 0;
+}
+
 bool LXFileUtility::ReadTextFile(const wchar_t* strFilename, LXStringA& Text)
 {
 	std::string str;
@@ -41,6 +41,32 @@ private:
 
 };
 
+//
+// Read-only mapping of a whole file: the pages are read from the system cache on first access, without intermediate copy.
+//
+
+class LXCORE_API LXMappedFile
+{
+
+public:
+
+	LXMappedFile() {}
+	~LXMappedFile();
+
+	bool Open(const LXString& strFilename);
+	void Close();
+
+	const uint8* GetData() const { return _Data; }
+	uint64 GetSize() const { return _Size; }
+
+private:
+
+	HANDLE _File = INVALID_HANDLE_VALUE;
+	HANDLE _Mapping = nullptr;
+	const uint8* _Data = nullptr;
+	uint64 _Size = 0;
+};
+
 class LXFileUtility
 {
 
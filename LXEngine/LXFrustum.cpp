@@ -11,8 +11,29 @@
 #include "LXCore.h"
 #include "LXMatrix.h"
 #include "LXTexture.h" // LEFT RIGHT ...
+#include <immintrin.h>
 #include "LXMemory.h" // --- Must be the last included ---
 
+#if defined(__AVX__)
+#define LX_FRUSTUM_AVX 1
+#endif
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define LX_FRUSTUM_SSE 1
+#endif
+
+namespace
+{
+	// Plane prepared for a batch: the coordinates of the box corner the farthest along the normal (P)
+	// and the nearest (N) are read from the MinX or MaxX... arrays according the normal signs.
+	struct TBatchPlane
+	{
+		float Nx, Ny, Nz, D;
+		const float* PX; const float* PY; const float* PZ;
+		const float* NX; const float* NY; const float* NZ;
+	};
+};
+
 LXFrustum::LXFrustum(void)
 {
 }
@@ -85,6 +106,27 @@ bool LXFrustum::IsBoxIn( float x, float y, float z, float x2, float y2, float z2
 	return true;
 }
 
+EFrustumTestResult LXFrustum::ClassifyBox( const vec3f& v0, const vec3f& v1 ) const
+{
+	EFrustumTestResult Result = EFrustumTestResult::Inside;
+
+	for (int i = 0; i < 6; i++)
+	{
+		// Corners the farthest along and against the normal
+		const vec3f& n = *m_Frustum[i].m_vNormal;
+		const vec3f p(n.x >= 0.f ? v1.x : v0.x, n.y >= 0.f ? v1.y : v0.y, n.z >= 0.f ? v1.z : v0.z);
+		const vec3f q(n.x >= 0.f ? v0.x : v1.x, n.y >= 0.f ? v0.y : v1.y, n.z >= 0.f ? v0.z : v1.z);
+
+		if (m_Frustum[i].Distance(p) <= 0.f)
+			return EFrustumTestResult::Outside;
+
+		if (m_Frustum[i].Distance(q) < 0.f)
+			Result = EFrustumTestResult::Cut;
+	}
+
+	return Result;
+}
+
 bool LXFrustum::IsSphereIn( const vec3f& vPoint, float radius ) const
 {
 	for(int i = 0; i < 6; i++ )	
@@ -135,4 +177,174 @@ bool LXFrustum::IsTriangleIn ( const vec3f& v0, const vec3f& v1, const vec3f& v2
 		return true;
 	else
 		return IsPointIn(v2.x, v2.y, v2.z);
-}
\ No newline at end of file
+}
+//------------------------------------------------------------------------------------------------------
+// Batched box tests
+//------------------------------------------------------------------------------------------------------
+
+template<bool Classify, typename F>
+void LXFrustum::ForEachBoxBatch(const TFrustumBoxes& Boxes, F&& Function) const
+{
+	TBatchPlane Planes[6];
+
+	for (int i = 0; i < 6; i++)
+	{
+		const vec3f& Normal = *m_Frustum[i].m_vNormal;
+		TBatchPlane& Plane = Planes[i];
+		Plane.Nx = Normal.x;
+		Plane.Ny = Normal.y;
+		Plane.Nz = Normal.z;
+		Plane.D = m_Frustum[i].m_fDistance;
+		Plane.PX = Normal.x >= 0.f ? Boxes.MaxX : Boxes.MinX;
+		Plane.PY = Normal.y >= 0.f ? Boxes.MaxY : Boxes.MinY;
+		Plane.PZ = Normal.z >= 0.f ? Boxes.MaxZ : Boxes.MinZ;
+		Plane.NX = Normal.x >= 0.f ? Boxes.MinX : Boxes.MaxX;
+		Plane.NY = Normal.y >= 0.f ? Boxes.MinY : Boxes.MaxY;
+		Plane.NZ = Normal.z >= 0.f ? Boxes.MinZ : Boxes.MaxZ;
+	}
+
+	// The distances are summed in the IsBoxIn order, so the results match
+	uint i = 0;
+
+#if LX_FRUSTUM_AVX
+	for (; i + 8 <= Boxes.Count; i += 8)
+	{
+		const __m256 Zero = _mm256_setzero_ps();
+		__m256 Visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		__m256 Inside = Visible;
+
+		for (const TBatchPlane& Plane : Planes)
+		{
+			const __m256 Nx = _mm256_set1_ps(Plane.Nx);
+			const __m256 Ny = _mm256_set1_ps(Plane.Ny);
+			const __m256 Nz = _mm256_set1_ps(Plane.Nz);
+			const __m256 D = _mm256_set1_ps(Plane.D);
+
+			const __m256 DistanceP = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Nx, _mm256_loadu_ps(Plane.PX + i)), _mm256_mul_ps(Ny, _mm256_loadu_ps(Plane.PY + i))), _mm256_mul_ps(Nz, _mm256_loadu_ps(Plane.PZ + i))), D);
+			Visible = _mm256_and_ps(Visible, _mm256_cmp_ps(DistanceP, Zero, _CMP_GT_OQ));
+
+			if (Classify)
+			{
+				const __m256 DistanceN = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Nx, _mm256_loadu_ps(Plane.NX + i)), _mm256_mul_ps(Ny, _mm256_loadu_ps(Plane.NY + i))), _mm256_mul_ps(Nz, _mm256_loadu_ps(Plane.NZ + i))), D);
+				Inside = _mm256_and_ps(Inside, _mm256_cmp_ps(DistanceN, Zero, _CMP_GE_OQ));
+			}
+			else if (_mm256_movemask_ps(Visible) == 0)
+			{
+				break;
+			}
+		}
+
+		const uint VisibleBits = (uint)_mm256_movemask_ps(Visible);
+		Function(i, 8u, VisibleBits, Classify ? VisibleBits & (uint)_mm256_movemask_ps(Inside) : 0u);
+	}
+#endif
+
+#if LX_FRUSTUM_SSE
+	for (; i + 4 <= Boxes.Count; i += 4)
+	{
+		const __m128 Zero = _mm_setzero_ps();
+		__m128 Visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		__m128 Inside = Visible;
+
+		for (const TBatchPlane& Plane : Planes)
+		{
+			const __m128 Nx = _mm_set1_ps(Plane.Nx);
+			const __m128 Ny = _mm_set1_ps(Plane.Ny);
+			const __m128 Nz = _mm_set1_ps(Plane.Nz);
+			const __m128 D = _mm_set1_ps(Plane.D);
+
+			const __m128 DistanceP = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Nx, _mm_loadu_ps(Plane.PX + i)), _mm_mul_ps(Ny, _mm_loadu_ps(Plane.PY + i))), _mm_mul_ps(Nz, _mm_loadu_ps(Plane.PZ + i))), D);
+			Visible = _mm_and_ps(Visible, _mm_cmpgt_ps(DistanceP, Zero));
+
+			if (Classify)
+			{
+				const __m128 DistanceN = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(Nx, _mm_loadu_ps(Plane.NX + i)), _mm_mul_ps(Ny, _mm_loadu_ps(Plane.NY + i))), _mm_mul_ps(Nz, _mm_loadu_ps(Plane.NZ + i))), D);
+				Inside = _mm_and_ps(Inside, _mm_cmpge_ps(DistanceN, Zero));
+			}
+			else if (_mm_movemask_ps(Visible) == 0)
+			{
+				break;
+			}
+		}
+
+		const uint VisibleBits = (uint)_mm_movemask_ps(Visible);
+		Function(i, 4u, VisibleBits, Classify ? VisibleBits & (uint)_mm_movemask_ps(Inside) : 0u);
+	}
+#endif
+
+	// Remaining boxes, or all without SIMD support
+	for (; i < Boxes.Count; i++)
+	{
+		uint VisibleBits = 1;
+		uint InsideBits = 1;
+
+		for (const TBatchPlane& Plane : Planes)
+		{
+			if (Plane.Nx * Plane.PX[i] + Plane.Ny * Plane.PY[i] + Plane.Nz * Plane.PZ[i] + Plane.D <= 0.f)
+			{
+				VisibleBits = 0;
+				break;
+			}
+
+			if (Classify && Plane.Nx * Plane.NX[i] + Plane.Ny * Plane.NY[i] + Plane.Nz * Plane.NZ[i] + Plane.D < 0.f)
+				InsideBits = 0;
+		}
+
+		Function(i, 1u, VisibleBits, Classify ? VisibleBits & InsideBits : 0u);
+	}
+}
+
+uint LXFrustum::CullBoxes(const TFrustumBoxes& Boxes, uint* Indices) const
+{
+	uint Count = 0;
+
+	ForEachBoxBatch<false>(Boxes, [Indices, &Count](uint First, uint Width, uint VisibleBits, uint)
+	{
+		// Branchless compaction: Count <= First + Bit, the write stays in the Indices range
+		for (uint Bit = 0; Bit < Width; Bit++)
+		{
+			Indices[Count] = First + Bit;
+			Count += (VisibleBits >> Bit) & 1;
+		}
+	});
+
+	return Count;
+}
+
+void LXFrustum::CullBoxes(const TFrustumBoxes& Boxes, uint64* Mask) const
+{
+	memset(Mask, 0, ((Boxes.Count + 63) / 64) * sizeof(uint64));
+
+	// A batch starts at a multiple of its width, so never straddles two words
+	ForEachBoxBatch<false>(Boxes, [Mask](uint First, uint, uint VisibleBits, uint)
+	{
+		Mask[First / 64] |= (uint64)VisibleBits << (First % 64);
+	});
+}
+
+void LXFrustum::ClassifyBoxes(const TFrustumBoxes& Boxes, EFrustumTestResult* Results) const
+{
+	ForEachBoxBatch<true>(Boxes, [Results](uint First, uint Width, uint VisibleBits, uint InsideBits)
+	{
+		for (uint Bit = 0; Bit < Width; Bit++)
+		{
+			if (!((VisibleBits >> Bit) & 1))
+				Results[First + Bit] = EFrustumTestResult::Outside;
+			else if ((InsideBits >> Bit) & 1)
+				Results[First + Bit] = EFrustumTestResult::Inside;
+			else
+				Results[First + Bit] = EFrustumTestResult::Cut;
+		}
+	});
+}
+
+uint LXFrustum::GetBoxBatchWidth()
+{
+#if LX_FRUSTUM_AVX
+	return 8;
+#elif LX_FRUSTUM_SSE
+	return 4;
+#else
+	return 1;
+#endif
+}
@@ -30,6 +30,21 @@ enum class EViewFrustumPlane
 	Down
 };
 
+//
+// Boxes in structure of arrays (see LXRenderClusterStore), for the batched tests.
+//
+
+struct TFrustumBoxes
+{
+	const float* MinX = nullptr;
+	const float* MinY = nullptr;
+	const float* MinZ = nullptr;
+	const float* MaxX = nullptr;
+	const float* MaxY = nullptr;
+	const float* MaxZ = nullptr;
+	uint Count = 0;
+};
+
 class LXCORE_API LXFrustum : public LXObject
 {
 
@@ -43,6 +58,14 @@ public:
 
 	bool			IsBoxIn			( const vec3f& v0, const vec3f& v1 ) const { 	return IsBoxIn( v0.x, v0.y, v0.z, v1.x, v1.y, v1.z); }
 	bool			IsBoxIn			( float x, float y, float z, float x2, float y2, float z2 ) const ;
+	EFrustumTestResult ClassifyBox	( const vec3f& v0, const vec3f& v1 ) const;
+
+	// Batched box tests, 8 boxes per iteration with AVX, 4 with SSE, 1 without SIMD support (see GetBoxBatchWidth).
+	// A box is Outside as with IsBoxIn, Inside when all its corners are in front of the planes.
+	uint			CullBoxes		( const TFrustumBoxes& Boxes, uint* Indices ) const;			// Writes the indices of the boxes not Outside and returns their count. Indices holds Boxes.Count entries.
+	void			CullBoxes		( const TFrustumBoxes& Boxes, uint64* Mask ) const;				// Bit i of Mask[i / 64] is set when the box i is not Outside. Mask holds (Boxes.Count + 63) / 64 words.
+	void			ClassifyBoxes	( const TFrustumBoxes& Boxes, EFrustumTestResult* Results ) const;
+	static uint		GetBoxBatchWidth( );
 	
 	bool			IsSphereIn		( const vec3f& vPoint, float radius ) const;
 	bool			IsSphereIn		( const vec3f& vPoint, float radius, EFrustumTestResult& ftr ) const;
@@ -53,5 +76,11 @@ public:
 protected:
 
 	LXPlane			m_Frustum[6];
+
+private:
+
+	// Calls Function(First, Width, VisibleBits, InsideBits) for each batch. InsideBits is computed only when Classify is set.
+	template<bool Classify, typename F>
+	void			ForEachBoxBatch	( const TFrustumBoxes& Boxes, F&& Function ) const;
 };
 
@@ -0,0 +1,440 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXGeometryAllocator.h"
+#include <intrin.h>
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	// Mask must not be 0
+	uint FindFirstSet(uint Mask)
+	{
+		unsigned long Index;
+		_BitScanForward(&Index, Mask);
+		return (uint)Index;
+	}
+
+	uint FindLastSet(uint Mask)
+	{
+		unsigned long Index;
+		_BitScanReverse(&Index, Mask);
+		return (uint)Index;
+	}
+};
+
+LXGeometryAllocator::LXGeometryAllocator(uint InCapacity)
+{
+	Reset(InCapacity);
+}
+
+void LXGeometryAllocator::Reset(uint InCapacity)
+{
+	_Blocks.clear();
+	_DeletedBlocks.clear();
+	_FirstRange = _LastRange = kInvalid;
+	_FirstLevelBitmap = 0;
+
+	for (uint i = 0; i < kFirstLevelCount; i++)
+	{
+		_SecondLevelBitmaps[i] = 0;
+		for (uint j = 0; j < kSecondLevelCount; j++)
+		{
+			_FreeLists[i][j] = kInvalid;
+		}
+	}
+
+	_Capacity = 0;
+	_UsedSize = 0;
+	_AllocationCount = 0;
+
+	Grow(InCapacity);
+}
+
+void LXGeometryAllocator::Mapping(uint Size, uint& FirstLevel, uint& SecondLevel)
+{
+	if (Size < kSecondLevelCount)
+	{
+		FirstLevel = 0;
+		SecondLevel = Size;
+	}
+	else
+	{
+		const uint Msb = FindLastSet(Size);
+		FirstLevel = Msb - kSecondLevelLog2 + 1;
+		SecondLevel = (Size >> (Msb - kSecondLevelLog2)) ^ kSecondLevelCount;
+	}
+}
+
+uint LXGeometryAllocator::NewBlock()
+{
+	uint Block;
+
+	if (_DeletedBlocks.size() > 0)
+	{
+		Block = _DeletedBlocks.back();
+		_DeletedBlocks.pop_back();
+		_Blocks[Block] = TBlock();
+	}
+	else
+	{
+		Block = (uint)_Blocks.size();
+		_Blocks.push_back(TBlock());
+	}
+
+	return Block;
+}
+
+void LXGeometryAllocator::DeleteBlock(uint Block)
+{
+	// Free with no size: a second Free is caught
+	_Blocks[Block] = TBlock();
+	_Blocks[Block].Free = true;
+	_DeletedBlocks.push_back(Block);
+}
+
+void LXGeometryAllocator::InsertFree(uint Block)
+{
+	uint FirstLevel, SecondLevel;
+	Mapping(_Blocks[Block].Size, FirstLevel, SecondLevel);
+
+	uint& Head = _FreeLists[FirstLevel][SecondLevel];
+	TBlock& B = _Blocks[Block];
+	B.Free = true;
+	B.PrevFree = kInvalid;
+	B.NextFree = Head;
+
+	if (Head != kInvalid)
+		_Blocks[Head].PrevFree = Block;
+
+	Head = Block;
+	_FirstLevelBitmap |= 1u << FirstLevel;
+	_SecondLevelBitmaps[FirstLevel] |= 1u << SecondLevel;
+}
+
+void LXGeometryAllocator::RemoveFree(uint Block)
+{
+	uint FirstLevel, SecondLevel;
+	Mapping(_Blocks[Block].Size, FirstLevel, SecondLevel);
+
+	TBlock& B = _Blocks[Block];
+
+	if (B.PrevFree != kInvalid)
+		_Blocks[B.PrevFree].NextFree = B.NextFree;
+	else
+		_FreeLists[FirstLevel][SecondLevel] = B.NextFree;
+
+	if (B.NextFree != kInvalid)
+		_Blocks[B.NextFree].PrevFree = B.PrevFree;
+
+	B.PrevFree = B.NextFree = kInvalid;
+
+	if (_FreeLists[FirstLevel][SecondLevel] == kInvalid)
+	{
+		_SecondLevelBitmaps[FirstLevel] &= ~(1u << SecondLevel);
+		if (_SecondLevelBitmaps[FirstLevel] == 0)
+			_FirstLevelBitmap &= ~(1u << FirstLevel);
+	}
+}
+
+uint LXGeometryAllocator::FindFree(uint Size) const
+{
+	// Rounded up to the next size class: any block of the found list fits
+	uint Rounded = Size;
+	if (Size >= kSecondLevelCount)
+	{
+		const uint Round = (1u << (FindLastSet(Size) - kSecondLevelLog2)) - 1;
+		Rounded = Size <= ~0u - Round ? Size + Round : ~0u;
+	}
+
+	uint FirstLevel, SecondLevel;
+	Mapping(Rounded, FirstLevel, SecondLevel);
+
+	uint SecondLevelMap = _SecondLevelBitmaps[FirstLevel] & (~0u << SecondLevel);
+	if (SecondLevelMap == 0)
+	{
+		const uint FirstLevelMap = FirstLevel + 1 < 32 ? _FirstLevelBitmap & (~0u << (FirstLevel + 1)) : 0;
+		if (FirstLevelMap != 0)
+		{
+			FirstLevel = FindFirstSet(FirstLevelMap);
+			SecondLevelMap = _SecondLevelBitmaps[FirstLevel];
+		}
+	}
+
+	if (SecondLevelMap != 0)
+		return _FreeLists[FirstLevel][FindFirstSet(SecondLevelMap)];
+
+	// The list of Size itself may still hold a large enough block
+	Mapping(Size, FirstLevel, SecondLevel);
+	for (uint Block = _FreeLists[FirstLevel][SecondLevel]; Block != kInvalid; Block = _Blocks[Block].NextFree)
+	{
+		if (_Blocks[Block].Size >= Size)
+			return Block;
+	}
+
+	return kInvalid;
+}
+
+uint LXGeometryAllocator::Allocate(uint Size)
+{
+	CHK(Size > 0);
+	if (Size == 0)
+		return kInvalid;
+
+	const uint Block = FindFree(Size);
+	if (Block == kInvalid)
+		return kInvalid;
+
+	RemoveFree(Block);
+
+	// Split, the remainder stays free
+	if (_Blocks[Block].Size > Size)
+	{
+		const uint Rest = NewBlock();
+		TBlock& B = _Blocks[Block];
+		TBlock& R = _Blocks[Rest];
+
+		R.Offset = B.Offset + Size;
+		R.Size = B.Size - Size;
+		R.PrevRange = Block;
+		R.NextRange = B.NextRange;
+
+		if (B.NextRange != kInvalid)
+			_Blocks[B.NextRange].PrevRange = Rest;
+		else
+			_LastRange = Rest;
+
+		B.NextRange = Rest;
+		B.Size = Size;
+		InsertFree(Rest);
+	}
+
+	_Blocks[Block].Free = false;
+	_UsedSize += Size;
+	_AllocationCount++;
+	return Block;
+}
+
+void LXGeometryAllocator::Free(uint Allocation)
+{
+	CHK(Allocation < (uint)_Blocks.size() && !_Blocks[Allocation].Free);
+	if (Allocation >= (uint)_Blocks.size() || _Blocks[Allocation].Free)
+		return;
+
+	uint Block = Allocation;
+	_UsedSize -= _Blocks[Block].Size;
+	_AllocationCount--;
+
+	// Merge with the next range
+	const uint Next = _Blocks[Block].NextRange;
+	if (Next != kInvalid && _Blocks[Next].Free)
+	{
+		RemoveFree(Next);
+		TBlock& B = _Blocks[Block];
+		B.Size += _Blocks[Next].Size;
+		B.NextRange = _Blocks[Next].NextRange;
+
+		if (B.NextRange != kInvalid)
+			_Blocks[B.NextRange].PrevRange = Block;
+		else
+			_LastRange = Block;
+
+		DeleteBlock(Next);
+	}
+
+	// Merge with the previous range
+	const uint Prev = _Blocks[Block].PrevRange;
+	if (Prev != kInvalid && _Blocks[Prev].Free)
+	{
+		RemoveFree(Prev);
+		TBlock& P = _Blocks[Prev];
+		P.Size += _Blocks[Block].Size;
+		P.NextRange = _Blocks[Block].NextRange;
+
+		if (P.NextRange != kInvalid)
+			_Blocks[P.NextRange].PrevRange = Prev;
+		else
+			_LastRange = Prev;
+
+		DeleteBlock(Block);
+		Block = Prev;
+	}
+
+	InsertFree(Block);
+}
+
+void LXGeometryAllocator::Grow(uint NewCapacity)
+{
+	CHK(NewCapacity >= _Capacity);
+	if (NewCapacity <= _Capacity)
+		return;
+
+	const uint Added = NewCapacity - _Capacity;
+
+	if (_LastRange != kInvalid && _Blocks[_LastRange].Free)
+	{
+		RemoveFree(_LastRange);
+		_Blocks[_LastRange].Size += Added;
+		InsertFree(_LastRange);
+	}
+	else
+	{
+		const uint Block = NewBlock();
+		_Blocks[Block].Offset = _Capacity;
+		_Blocks[Block].Size = Added;
+		_Blocks[Block].PrevRange = _LastRange;
+
+		if (_LastRange != kInvalid)
+			_Blocks[_LastRange].NextRange = Block;
+		else
+			_FirstRange = Block;
+
+		_LastRange = Block;
+		InsertFree(Block);
+	}
+
+	_Capacity = NewCapacity;
+}
+
+void LXGeometryAllocator::Defragment(vector<TGeometryMove>& OutMoves)
+{
+	OutMoves.clear();
+
+	uint Offset = 0;
+	uint Previous = kInvalid;
+	uint Next;
+
+	for (uint Block = _FirstRange; Block != kInvalid; Block = Next)
+	{
+		Next = _Blocks[Block].NextRange;
+
+		if (_Blocks[Block].Free)
+		{
+			RemoveFree(Block);
+			DeleteBlock(Block);
+			continue;
+		}
+
+		TBlock& B = _Blocks[Block];
+		if (B.Offset != Offset)
+		{
+			OutMoves.push_back({ Block, B.Offset, Offset, B.Size });
+			B.Offset = Offset;
+		}
+
+		B.PrevRange = Previous;
+		if (Previous != kInvalid)
+			_Blocks[Previous].NextRange = Block;
+		else
+			_FirstRange = Block;
+
+		Previous = Block;
+		Offset += B.Size;
+	}
+
+	if (Previous != kInvalid)
+		_Blocks[Previous].NextRange = kInvalid;
+	else
+		_FirstRange = kInvalid;
+
+	_LastRange = Previous;
+
+	// The free space in one range at the end
+	const uint Capacity = _Capacity;
+	_Capacity = Offset;
+	Grow(Capacity);
+}
+
+uint LXGeometryAllocator::GetLargestFreeSize() const
+{
+	if (_FirstLevelBitmap == 0)
+		return 0;
+
+	const uint FirstLevel = FindLastSet(_FirstLevelBitmap);
+	const uint SecondLevel = FindLastSet(_SecondLevelBitmaps[FirstLevel]);
+
+	uint Largest = 0;
+	for (uint Block = _FreeLists[FirstLevel][SecondLevel]; Block != kInvalid; Block = _Blocks[Block].NextFree)
+	{
+		Largest = std::max(Largest, _Blocks[Block].Size);
+	}
+
+	return Largest;
+}
+
+bool LXGeometryAllocator::Validate() const
+{
+	// Range list
+	uint Offset = 0;
+	uint Used = 0;
+	uint Allocations = 0;
+	uint FreeRanges = 0;
+	uint Previous = kInvalid;
+
+	for (uint Block = _FirstRange; Block != kInvalid; Block = _Blocks[Block].NextRange)
+	{
+		const TBlock& B = _Blocks[Block];
+
+		if (B.Offset != Offset || B.Size == 0 || B.PrevRange != Previous)
+			return false;
+
+		if (B.Free)
+		{
+			// Free neighbours are merged
+			if (Previous != kInvalid && _Blocks[Previous].Free)
+				return false;
+
+			FreeRanges++;
+		}
+		else
+		{
+			Used += B.Size;
+			Allocations++;
+		}
+
+		Offset += B.Size;
+		Previous = Block;
+	}
+
+	if (Offset != _Capacity || Previous != _LastRange || Used != _UsedSize || Allocations != _AllocationCount)
+		return false;
+
+	// Free lists and bitmaps
+	uint FreeBlocks = 0;
+
+	for (uint i = 0; i < kFirstLevelCount; i++)
+	{
+		for (uint j = 0; j < kSecondLevelCount; j++)
+		{
+			const bool Empty = _FreeLists[i][j] == kInvalid;
+			if (Empty == ((_SecondLevelBitmaps[i] & (1u << j)) != 0))
+				return false;
+
+			uint PrevFree = kInvalid;
+			for (uint Block = _FreeLists[i][j]; Block != kInvalid; Block = _Blocks[Block].NextFree)
+			{
+				const TBlock& B = _Blocks[Block];
+
+				uint FirstLevel, SecondLevel;
+				Mapping(B.Size, FirstLevel, SecondLevel);
+
+				if (!B.Free || B.Size == 0 || B.PrevFree != PrevFree || FirstLevel != i || SecondLevel != j)
+					return false;
+
+				PrevFree = Block;
+				FreeBlocks++;
+			}
+		}
+
+		if ((_SecondLevelBitmaps[i] != 0) != ((_FirstLevelBitmap & (1u << i)) != 0))
+			return false;
+	}
+
+	return FreeBlocks == FreeRanges;
+}
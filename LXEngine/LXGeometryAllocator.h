@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+// Allocation relocated by LXGeometryAllocator::Defragment
+struct TGeometryMove
+{
+	uint Allocation;
+	uint SrcOffset;
+	uint DstOffset;
+	uint Size;
+};
+
+//
+// Two-Level Segregated Fit allocator of ranges in [0, Capacity), in elements (vertices, indices).
+// Only the bookkeeping is done here, no memory is touched: the caller copies the data.
+// The allocations are identified by a handle, which stays valid when Defragment relocates them.
+// Allocate and Free are O(1), the freed ranges are merged with their free neighbours.
+//
+
+class LXGeometryAllocator
+{
+
+public:
+
+	static const uint kInvalid = ~0u;
+
+	LXGeometryAllocator(uint InCapacity = 0);
+
+	void Reset(uint InCapacity);
+
+	// Returns the allocation handle, kInvalid when no free range is large enough
+	uint Allocate(uint Size);
+	void Free(uint Allocation);
+
+	uint GetOffset(uint Allocation) const { return _Blocks[Allocation].Offset; }
+	uint GetSize(uint Allocation) const { return _Blocks[Allocation].Size; }
+
+	// The new space is appended after the last range
+	void Grow(uint NewCapacity);
+
+	// Packs the allocations at the beginning, in their current order. The moves go towards the
+	// beginning and are listed by increasing offset: they can be copied one after the other in place.
+	void Defragment(vector<TGeometryMove>& OutMoves);
+
+	uint GetCapacity() const { return _Capacity; }
+	uint GetUsedSize() const { return _UsedSize; }
+	uint GetFreeSize() const { return _Capacity - _UsedSize; }
+	uint GetAllocationCount() const { return _AllocationCount; }
+	uint GetLargestFreeSize() const;
+
+	// Consistency of the range list, the free lists and the bitmaps
+	bool Validate() const;
+
+private:
+
+	// Second level: 16 lists per power of two. The sizes under 16 have a list each.
+	static const uint kSecondLevelLog2 = 4;
+	static const uint kSecondLevelCount = 1 << kSecondLevelLog2;
+	static const uint kFirstLevelCount = 32 - kSecondLevelLog2 + 1;
+
+	struct TBlock
+	{
+		uint Offset = 0;
+		uint Size = 0;
+		uint PrevRange = kInvalid;	// Neighbours in the address order
+		uint NextRange = kInvalid;
+		uint PrevFree = kInvalid;	// Free list of the size class
+		uint NextFree = kInvalid;
+		bool Free = false;
+	};
+
+	static void Mapping(uint Size, uint& FirstLevel, uint& SecondLevel);
+	uint NewBlock();
+	void DeleteBlock(uint Block);
+	void InsertFree(uint Block);
+	void RemoveFree(uint Block);
+	uint FindFree(uint Size) const;
+
+private:
+
+	vector<TBlock> _Blocks;
+	vector<uint> _DeletedBlocks;	// Reused handles
+	uint _FirstRange = kInvalid;
+	uint _LastRange = kInvalid;
+
+	uint _FirstLevelBitmap = 0;
+	uint _SecondLevelBitmaps[kFirstLevelCount];
+	uint _FreeLists[kFirstLevelCount][kSecondLevelCount];
+
+	uint _Capacity = 0;
+	uint _UsedSize = 0;
+	uint _AllocationCount = 0;
+};
@@ -0,0 +1,512 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXGeometryCodec.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	// rANS, 32-bit state, byte-wise renormalization
+	const uint kProbabilityBits = 12;
+	const uint kProbabilityScale = 1 << kProbabilityBits;
+	const uint kRansLow = 1u << 23;
+
+	// Chunk modes
+	const uint8 kChunkStored = 0;
+	const uint8 kChunkRans = 1;
+
+	const int kDirectionMax = 32767;
+
+	void WriteVarint(vector<uint8>& Out, uint Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.push_back((uint8)(Value | 0x80));
+			Value >>= 7;
+		}
+		Out.push_back((uint8)Value);
+	}
+
+	bool ReadVarint(const uint8*& Data, const uint8* End, uint& OutValue)
+	{
+		OutValue = 0;
+		for (uint Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (Data == End)
+				return false;
+
+			const uint8 Byte = *Data++;
+			OutValue |= (uint)(Byte & 0x7F) << Shift;
+			if (!(Byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	uint ZigZag(int Value)
+	{
+		return ((uint)Value << 1) ^ (uint)(Value >> 31);
+	}
+
+	int UnZigZag(uint Value)
+	{
+		return (int)(Value >> 1) ^ -(int)(Value & 1);
+	}
+
+	// Frequencies summing to kProbabilityScale, at least 1 for each used symbol
+	void NormalizeFrequencies(const uint* Counts, uint Total, uint* OutFreqs)
+	{
+		uint Sum = 0;
+		for (uint s = 0; s < 256; s++)
+		{
+			OutFreqs[s] = Counts[s] ? std::max(1u, (uint)((uint64)Counts[s] * kProbabilityScale / Total)) : 0;
+			Sum += OutFreqs[s];
+		}
+
+		// Rounding error, taken on the most frequent symbol
+		while (Sum != kProbabilityScale)
+		{
+			uint Best = 0;
+			for (uint s = 1; s < 256; s++)
+			{
+				if (OutFreqs[s] > OutFreqs[Best])
+					Best = s;
+			}
+
+			if (Sum < kProbabilityScale)
+			{
+				OutFreqs[Best] += kProbabilityScale - Sum;
+				Sum = kProbabilityScale;
+			}
+			else
+			{
+				const uint Excess = std::min(Sum - kProbabilityScale, OutFreqs[Best] - 1);
+				OutFreqs[Best] -= Excess;
+				Sum -= Excess;
+			}
+		}
+	}
+
+	// Mode, size, then the stored bytes or the frequency table and the rANS stream
+	void EntropyEncode(const vector<uint8>& Bytes, vector<uint8>& Out)
+	{
+		const size_t Start = Out.size();
+		Out.push_back(kChunkRans);
+		WriteVarint(Out, (uint)Bytes.size());
+
+		uint Counts[256] = { 0 };
+		for (uint8 Byte : Bytes)
+			Counts[Byte]++;
+
+		uint Freqs[256];
+		uint Starts[256];
+		NormalizeFrequencies(Counts, std::max(1u, (uint)Bytes.size()), Freqs);
+
+		// Used symbols bitmap, then their frequencies
+		uint8 Bitmap[32] = { 0 };
+		uint Sum = 0;
+		for (uint s = 0; s < 256; s++)
+		{
+			Starts[s] = Sum;
+			Sum += Freqs[s];
+			if (Freqs[s])
+				Bitmap[s >> 3] |= 1 << (s & 7);
+		}
+
+		Out.insert(Out.end(), Bitmap, Bitmap + 32);
+		for (uint s = 0; s < 256; s++)
+		{
+			if (Freqs[s])
+				WriteVarint(Out, Freqs[s] - 1);
+		}
+
+		// Encoded backwards, so the bytes are read forwards
+		vector<uint8> Stream;
+		Stream.reserve(Bytes.size());
+		uint State = kRansLow;
+
+		for (size_t i = Bytes.size(); i-- > 0;)
+		{
+			const uint s = Bytes[i];
+			const uint StateMax = ((kRansLow >> kProbabilityBits) << 8) * Freqs[s];
+			while (State >= StateMax)
+			{
+				Stream.push_back((uint8)State);
+				State >>= 8;
+			}
+			State = ((State / Freqs[s]) << kProbabilityBits) + (State % Freqs[s]) + Starts[s];
+		}
+
+		for (uint i = 0; i < 4; i++)
+			Stream.push_back((uint8)(State >> (24 - 8 * i)));
+
+		Out.insert(Out.end(), Stream.rbegin(), Stream.rend());
+
+		// Incompressible
+		if (Out.size() - Start > Bytes.size() + 6)
+		{
+			Out.resize(Start);
+			Out.push_back(kChunkStored);
+			WriteVarint(Out, (uint)Bytes.size());
+			Out.insert(Out.end(), Bytes.begin(), Bytes.end());
+		}
+	}
+
+	bool EntropyDecode(const uint8* Data, const uint8* End, vector<uint8>& OutBytes)
+	{
+		uint Size;
+		if (Data == End)
+			return false;
+
+		const uint8 Mode = *Data++;
+		if (!ReadVarint(Data, End, Size))
+			return false;
+
+		if (Mode == kChunkStored)
+		{
+			if ((size_t)(End - Data) < Size)
+				return false;
+
+			OutBytes.assign(Data, Data + Size);
+			return true;
+		}
+
+		if (Mode != kChunkRans || End - Data < 32)
+			return false;
+
+		const uint8* Bitmap = Data;
+		Data += 32;
+
+		uint Freqs[256];
+		uint Starts[256];
+		uint8 Symbols[kProbabilityScale];
+		uint Sum = 0;
+
+		for (uint s = 0; s < 256; s++)
+		{
+			Freqs[s] = 0;
+			Starts[s] = Sum;
+
+			if (Bitmap[s >> 3] & (1 << (s & 7)))
+			{
+				if (!ReadVarint(Data, End, Freqs[s]) || Sum + ++Freqs[s] > kProbabilityScale)
+					return false;
+
+				memset(Symbols + Sum, s, Freqs[s]);
+				Sum += Freqs[s];
+			}
+		}
+
+		if (Sum != kProbabilityScale || End - Data < 4)
+			return false;
+
+		uint State = Data[0] | (Data[1] << 8) | (Data[2] << 16) | ((uint)Data[3] << 24);
+		Data += 4;
+
+		OutBytes.resize(Size);
+
+		for (uint i = 0; i < Size; i++)
+		{
+			const uint Slot = State & (kProbabilityScale - 1);
+			const uint8 s = Symbols[Slot];
+			OutBytes[i] = s;
+			State = Freqs[s] * (State >> kProbabilityBits) + Slot - Starts[s];
+
+			while (State < kRansLow)
+			{
+				if (Data == End)
+					return false;
+				State = (State << 8) | *Data++;
+			}
+		}
+
+		return true;
+	}
+
+	uint GetComponentCount(EGeometryCodec Codec)
+	{
+		switch (Codec)
+		{
+		case EGeometryCodec::Indices: return 1;
+		case EGeometryCodec::Positions: return 3;
+		case EGeometryCodec::Directions: return 2;	// Octahedral
+		case EGeometryCodec::TexCoords: return 2;
+		default: return 0;
+		}
+	}
+
+	void EncodeOctahedron(const float* v, int* Out)
+	{
+		const float L1 = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+		float x = L1 > 0.f ? v[0] / L1 : 0.f;
+		float y = L1 > 0.f ? v[1] / L1 : 0.f;
+
+		if (v[2] < 0.f)
+		{
+			const float FoldedX = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+			const float FoldedY = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+			x = FoldedX;
+			y = FoldedY;
+		}
+
+		Out[0] = (int)roundf(Clamp(x, -1.f, 1.f) * kDirectionMax);
+		Out[1] = (int)roundf(Clamp(y, -1.f, 1.f) * kDirectionMax);
+	}
+
+	void DecodeOctahedron(const int* In, float* v)
+	{
+		float x = Clamp((float)In[0] / kDirectionMax, -1.f, 1.f);
+		float y = Clamp((float)In[1] / kDirectionMax, -1.f, 1.f);
+		const float z = 1.f - fabsf(x) - fabsf(y);
+
+		if (z < 0.f)
+		{
+			const float UnfoldedX = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+			const float UnfoldedY = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+			x = UnfoldedX;
+			y = UnfoldedY;
+		}
+
+		const float InvLength = 1.f / sqrtf(x * x + y * y + z * z);
+		v[0] = x * InvLength;
+		v[1] = y * InvLength;
+		v[2] = z * InvLength;
+	}
+
+	// Quantized components of an element
+	void Quantize(EGeometryCodec Codec, const TGeometryCodecHeader& Header, const float* Element, int* Out)
+	{
+		if (Codec == EGeometryCodec::Directions)
+		{
+			EncodeOctahedron(Element, Out);
+			return;
+		}
+
+		const float Max = (float)((1 << LXGeometryCodec::kQuantizationBits) - 1);
+		for (uint c = 0; c < GetComponentCount(Codec); c++)
+		{
+			const float Value = Header.Scale[c] > 0.f ? (Element[c] - Header.Offset[c]) / Header.Scale[c] : 0.f;
+			Out[c] = (int)(Clamp(Value, 0.f, Max) + 0.5f);
+		}
+	}
+
+	void Dequantize(EGeometryCodec Codec, const TGeometryCodecHeader& Header, const int* In, float* Element)
+	{
+		if (Codec == EGeometryCodec::Directions)
+		{
+			DecodeOctahedron(In, Element);
+			return;
+		}
+
+		for (uint c = 0; c < GetComponentCount(Codec); c++)
+			Element[c] = Header.Offset[c] + In[c] * Header.Scale[c];
+	}
+
+	// Residuals of the chunk elements, as varints
+	void EncodeChunk(EGeometryCodec Codec, const TGeometryCodecHeader& Header, const uint8* Elements, uint Count, vector<uint8>& OutBytes)
+	{
+		if (Codec == EGeometryCodec::Indices)
+		{
+			const uint* Indices = reinterpret_cast<const uint*>(Elements);
+			uint Next = 0;
+			for (uint i = 0; i < Count; i++)
+			{
+				WriteVarint(OutBytes, ZigZag((int)(Indices[i] - Next)));
+				Next = std::max(Next, Indices[i] + 1);
+			}
+			return;
+		}
+
+		const uint ElementSize = LXGeometryCodec::GetElementSize(Codec);
+		const uint ComponentCount = GetComponentCount(Codec);
+		int Previous[3] = { 0 };
+
+		for (uint i = 0; i < Count; i++)
+		{
+			int Quantized[3];
+			Quantize(Codec, Header, reinterpret_cast<const float*>(Elements + i * ElementSize), Quantized);
+
+			for (uint c = 0; c < ComponentCount; c++)
+			{
+				WriteVarint(OutBytes, ZigZag(Quantized[c] - Previous[c]));
+				Previous[c] = Quantized[c];
+			}
+		}
+	}
+
+	bool DecodeChunkBytes(EGeometryCodec Codec, const TGeometryCodecHeader& Header, const vector<uint8>& Bytes, uint8* OutElements, uint Count)
+	{
+		const uint8* Data = Bytes.data();
+		const uint8* End = Data + Bytes.size();
+		uint Residual;
+
+		if (Codec == EGeometryCodec::Indices)
+		{
+			uint* Indices = reinterpret_cast<uint*>(OutElements);
+			uint Next = 0;
+			for (uint i = 0; i < Count; i++)
+			{
+				if (!ReadVarint(Data, End, Residual))
+					return false;
+
+				Indices[i] = Next + UnZigZag(Residual);
+				Next = std::max(Next, Indices[i] + 1);
+			}
+			return Data == End;
+		}
+
+		const uint ElementSize = LXGeometryCodec::GetElementSize(Codec);
+		const uint ComponentCount = GetComponentCount(Codec);
+		int Quantized[3] = { 0 };
+
+		for (uint i = 0; i < Count; i++)
+		{
+			for (uint c = 0; c < ComponentCount; c++)
+			{
+				if (!ReadVarint(Data, End, Residual))
+					return false;
+
+				Quantized[c] = (int)((uint)Quantized[c] + (uint)UnZigZag(Residual));
+			}
+
+			Dequantize(Codec, Header, Quantized, reinterpret_cast<float*>(OutElements + i * ElementSize));
+		}
+
+		return Data == End;
+	}
+
+	const TGeometryCodecHeader* GetHeader(const uint8* Data, uint64 Size)
+	{
+		if (Size < sizeof(TGeometryCodecHeader))
+			return nullptr;
+
+		const TGeometryCodecHeader* Header = reinterpret_cast<const TGeometryCodecHeader*>(Data);
+
+		// The counts come from the file: bounded before the elements are allocated
+		if (GetComponentCount((EGeometryCodec)Header->Codec) == 0 || Header->ChunkElementCount != LXGeometryCodec::kChunkElementCount ||
+			Header->ChunkCount != ((uint64)Header->ElementCount + LXGeometryCodec::kChunkElementCount - 1) / LXGeometryCodec::kChunkElementCount ||
+			Size < sizeof(TGeometryCodecHeader) + ((uint64)Header->ChunkCount + 1) * sizeof(uint))
+			return nullptr;
+
+		return Header;
+	}
+};
+
+uint LXGeometryCodec::GetElementSize(EGeometryCodec Codec)
+{
+	switch (Codec)
+	{
+	case EGeometryCodec::Indices: return sizeof(uint);
+	case EGeometryCodec::Positions: return 3 * sizeof(float);
+	case EGeometryCodec::Directions: return 3 * sizeof(float);
+	case EGeometryCodec::TexCoords: return 2 * sizeof(float);
+	default: return 0;
+	}
+}
+
+void LXGeometryCodec::Encode(EGeometryCodec Codec, const void* Elements, uint ElementCount, vector<uint8>& Out)
+{
+	CHK(GetComponentCount(Codec) > 0);
+
+	TGeometryCodecHeader Header = { (uint)Codec, ElementCount, kChunkElementCount, (ElementCount + kChunkElementCount - 1) / kChunkElementCount, { 0.f }, { 0.f } };
+	const uint8* Bytes = reinterpret_cast<const uint8*>(Elements);
+	const uint ElementSize = GetElementSize(Codec);
+
+	// Quantization bounds
+	if (Codec == EGeometryCodec::Positions || Codec == EGeometryCodec::TexCoords)
+	{
+		for (uint c = 0; c < GetComponentCount(Codec); c++)
+		{
+			float Min = FLT_MAX;
+			float Max = -FLT_MAX;
+			for (uint i = 0; i < ElementCount; i++)
+			{
+				const float Value = reinterpret_cast<const float*>(Bytes + i * ElementSize)[c];
+				Min = std::min(Min, Value);
+				Max = std::max(Max, Value);
+			}
+
+			Header.Offset[c] = ElementCount > 0 ? Min : 0.f;
+			Header.Scale[c] = ElementCount > 0 ? (Max - Min) / ((1 << kQuantizationBits) - 1) : 0.f;
+		}
+	}
+
+	const size_t Start = Out.size();
+	Out.resize(Start + sizeof(TGeometryCodecHeader) + (Header.ChunkCount + 1) * sizeof(uint));
+	memcpy(&Out[Start], &Header, sizeof(TGeometryCodecHeader));
+
+	const size_t OffsetsStart = Start + sizeof(TGeometryCodecHeader);
+	const size_t ChunksStart = Out.size();
+	vector<uint8> ChunkBytes;
+
+	for (uint Chunk = 0; Chunk <= Header.ChunkCount; Chunk++)
+	{
+		const uint ChunkOffset = (uint)(Out.size() - ChunksStart);
+		memcpy(&Out[OffsetsStart + Chunk * sizeof(uint)], &ChunkOffset, sizeof(uint));
+
+		if (Chunk == Header.ChunkCount)
+			break;
+
+		const uint First = Chunk * kChunkElementCount;
+		const uint Count = std::min((uint)kChunkElementCount, ElementCount - First);
+
+		ChunkBytes.clear();
+		EncodeChunk(Codec, Header, Bytes + (size_t)First * ElementSize, Count, ChunkBytes);
+		EntropyEncode(ChunkBytes, Out);
+	}
+}
+
+bool LXGeometryCodec::GetInfo(const uint8* Data, uint64 Size, EGeometryCodec& OutCodec, uint& OutElementCount, uint& OutChunkCount)
+{
+	const TGeometryCodecHeader* Header = GetHeader(Data, Size);
+	if (!Header)
+		return false;
+
+	const uint* ChunkOffsets = reinterpret_cast<const uint*>(Data + sizeof(TGeometryCodecHeader));
+	const uint64 ChunksSize = Size - sizeof(TGeometryCodecHeader) - (Header->ChunkCount + 1) * sizeof(uint);
+
+	// A chunk is never empty (its mode byte at least): the element count is bounded by the stream size
+	for (uint Chunk = 0; Chunk < Header->ChunkCount; Chunk++)
+	{
+		if (ChunkOffsets[Chunk] >= ChunkOffsets[Chunk + 1])
+			return false;
+	}
+
+	if (ChunkOffsets[Header->ChunkCount] > ChunksSize)
+		return false;
+
+	OutCodec = (EGeometryCodec)Header->Codec;
+	OutElementCount = Header->ElementCount;
+	OutChunkCount = Header->ChunkCount;
+	return true;
+}
+
+bool LXGeometryCodec::DecodeChunk(const uint8* Data, uint64 Size, uint Chunk, void* OutElements)
+{
+	const TGeometryCodecHeader* Header = GetHeader(Data, Size);
+	if (!Header || Chunk >= Header->ChunkCount)
+		return false;
+
+	const uint* ChunkOffsets = reinterpret_cast<const uint*>(Data + sizeof(TGeometryCodecHeader));
+	const uint8* Chunks = reinterpret_cast<const uint8*>(ChunkOffsets + Header->ChunkCount + 1);
+	const uint64 ChunksSize = Size - (Chunks - Data);
+
+	if (ChunkOffsets[Chunk] > ChunkOffsets[Chunk + 1] || ChunkOffsets[Chunk + 1] > ChunksSize)
+		return false;
+
+	vector<uint8> Bytes;
+	if (!EntropyDecode(Chunks + ChunkOffsets[Chunk], Chunks + ChunkOffsets[Chunk + 1], Bytes))
+		return false;
+
+	const EGeometryCodec Codec = (EGeometryCodec)Header->Codec;
+	const uint First = Chunk * Header->ChunkElementCount;
+	const uint Count = std::min(Header->ChunkElementCount, Header->ElementCount - First);
+
+	return DecodeChunkBytes(Codec, *Header, Bytes, reinterpret_cast<uint8*>(OutElements) + (size_t)First * GetElementSize(Codec), Count);
+}
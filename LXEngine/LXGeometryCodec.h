@@ -0,0 +1,59 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//
+// Compressed geometry streams of the LXGeometryContainer.
+// The elements are split in chunks of kChunkElementCount, each decodable alone: the chunks of a file are
+// decoded in parallel. In a chunk, each element is predicted from the previous one, the zigzag residuals are
+// written as varints, then the bytes are rANS coded (order 0, one frequency table per chunk).
+// Positions and texture coordinates are quantized on kQuantizationBits in the stream bounds,
+// the unit vectors are octahedral on 16 bits: only the indices are lossless.
+//
+
+enum class EGeometryCodec : uint
+{
+	None,			// Raw stream
+	Indices,		// uint, predicted as the next unused vertex
+	Positions,		// vec3f, quantized in the stream bounds
+	Directions,		// vec3f unit vectors, octahedral
+	TexCoords		// vec2f, quantized in the stream bounds
+};
+
+// Followed by ChunkCount + 1 chunk offsets (uint, from the end of the offsets), then the chunks
+struct TGeometryCodecHeader
+{
+	uint Codec;				// EGeometryCodec
+	uint ElementCount;
+	uint ChunkElementCount;
+	uint ChunkCount;
+	float Offset[3];		// Quantized: Value = Offset + Quantized * Scale
+	float Scale[3];
+};
+
+class LXGeometryCodec
+{
+
+public:
+
+	static const uint kChunkElementCount = 16384;
+	static const uint kQuantizationBits = 20;
+
+	static uint GetElementSize(EGeometryCodec Codec);
+
+	// Encodes the chunks on the calling thread
+	static void Encode(EGeometryCodec Codec, const void* Elements, uint ElementCount, vector<uint8>& Out);
+
+	// Checks the header and the chunk offsets
+	static bool GetInfo(const uint8* Data, uint64 Size, EGeometryCodec& OutCodec, uint& OutElementCount, uint& OutChunkCount);
+
+	// Decodes the Chunk in OutElements, the array of all the stream elements.
+	// The chunks of a stream can be decoded concurrently.
+	static bool DecodeChunk(const uint8* Data, uint64 Size, uint Chunk, void* OutElements);
+};
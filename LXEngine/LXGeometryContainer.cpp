@@ -0,0 +1,491 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXGeometryContainer.h"
+#include "LXDirectory.h"
+#include "LXFile.h"
+#include "LXGeometryCodec.h"
+#include "LXLogger.h"
+#include "LXPrimitive.h"
+#include "LXThreadManager.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	uint64 Align(uint64 Offset)
+	{
+		return (Offset + LXGeometryContainer::kAlignment - 1) & ~(uint64)(LXGeometryContainer::kAlignment - 1);
+	}
+
+	// One copy, from the mapped file to the array
+	template<typename T>
+	bool CopyStream(vector<T>& Array, const uint8* Data, uint64 Size)
+	{
+		if (Size % sizeof(T) != 0)
+			return false;
+
+		Array.resize((size_t)(Size / sizeof(T)));
+		if (Size > 0)
+			memcpy(Array.data(), Data, (size_t)Size);
+
+		return true;
+	}
+
+	struct TDecodeJob
+	{
+		const uint8* Data;
+		uint64 Size;
+		uint Chunk;
+		void* Elements;
+	};
+
+	// Copied now, or resized and queued for the parallel decoding
+	template<typename T>
+	bool LoadStream(vector<T>& Array, const uint8* Data, const TGeometryContainerStream& Stream, vector<TDecodeJob>& DecodeJobs)
+	{
+		if (Stream.Encoding == (uint)EGeometryCodec::None)
+			return CopyStream(Array, Data, Stream.Size);
+
+		EGeometryCodec Codec;
+		uint ElementCount;
+		uint ChunkCount;
+
+		if (!LXGeometryCodec::GetInfo(Data, Stream.Size, Codec, ElementCount, ChunkCount) || (uint)Codec != Stream.Encoding || LXGeometryCodec::GetElementSize(Codec) != sizeof(T))
+			return false;
+
+		Array.resize(ElementCount);
+		for (uint Chunk = 0; Chunk < ChunkCount; Chunk++)
+			DecodeJobs.push_back({ Data, Stream.Size, Chunk, Array.data() });
+
+		return true;
+	}
+
+	EGeometryCodec GetStreamCodec(int Target, int Type)
+	{
+		switch (Target)
+		{
+		case LX_INDICES:
+		case LX_LODINDICES: return EGeometryCodec::Indices;
+		case LX_VERTICES: return Type == LX_VEC3F ? EGeometryCodec::Positions : EGeometryCodec::None;
+		case LX_NORMALS:
+		case LX_TANGENTS:
+		case LX_BINORMALS: return EGeometryCodec::Directions;
+		case LX_TEXTCOORD: return EGeometryCodec::TexCoords;
+		default: return EGeometryCodec::None;
+		}
+	}
+
+	template<typename T>
+	bool ReadStream(LXFile& File, vector<T>& Array, uint Size)
+	{
+		if (Size % sizeof(T) != 0)
+			return false;
+
+		Array.resize(Size / sizeof(T));
+		return Size == 0 || File.Read(Array.data(), Size) == 1;
+	}
+};
+
+bool LXGeometryContainer::IsContainer(const LXFilepath& Filepath, bool* OutCompressed)
+{
+	LXMappedFile File;
+	if (!File.Open(Filepath) || File.GetSize() < sizeof(TGeometryContainerHeader))
+		return false;
+
+	const TGeometryContainerHeader& Header = *reinterpret_cast<const TGeometryContainerHeader*>(File.GetData());
+	if (Header.Magic != kMagic)
+		return false;
+
+	if (OutCompressed)
+	{
+		*OutCompressed = false;
+
+		const uint64 StreamsOffset = sizeof(TGeometryContainerHeader) + (uint64)Header.PrimitiveCount * sizeof(TGeometryContainerPrimitive);
+		if (StreamsOffset + (uint64)Header.StreamCount * sizeof(TGeometryContainerStream) <= File.GetSize())
+		{
+			const TGeometryContainerStream* Streams = reinterpret_cast<const TGeometryContainerStream*>(File.GetData() + StreamsOffset);
+			for (uint i = 0; i < Header.StreamCount && !*OutCompressed; i++)
+				*OutCompressed = Streams[i].Encoding != (uint)EGeometryCodec::None;
+		}
+	}
+
+	return true;
+}
+
+bool LXGeometryContainer::Load(const LXFilepath& Filepath, MapPrimitiveGeometries& OutGeometries)
+{
+	// Empty files cannot be mapped
+	LXMappedFile File;
+	if (!File.Open(Filepath))
+		return LoadLegacy(Filepath, OutGeometries);
+
+	const uint8* Data = File.GetData();
+	const uint64 Size = File.GetSize();
+
+	if (Size < sizeof(TGeometryContainerHeader) || reinterpret_cast<const TGeometryContainerHeader*>(Data)->Magic != kMagic)
+	{
+		File.Close();
+		return LoadLegacy(Filepath, OutGeometries);
+	}
+
+	const TGeometryContainerHeader& Header = *reinterpret_cast<const TGeometryContainerHeader*>(Data);
+
+	if (Header.Version == 0 || Header.Version > kVersion)
+	{
+		LogE(GeometryContainer, L"%s: version %u, %u supported", Filepath.GetBuffer(), Header.Version, kVersion);
+		return false;
+	}
+
+	const uint64 RecordsSize = sizeof(TGeometryContainerHeader) + (uint64)Header.PrimitiveCount * sizeof(TGeometryContainerPrimitive) + (uint64)Header.StreamCount * sizeof(TGeometryContainerStream);
+
+	if (Header.FileSize != Size || RecordsSize > Size)
+	{
+		LogE(GeometryContainer, L"%s: truncated file", Filepath.GetBuffer());
+		return false;
+	}
+
+	const TGeometryContainerPrimitive* Records = reinterpret_cast<const TGeometryContainerPrimitive*>(Data + sizeof(TGeometryContainerHeader));
+	const TGeometryContainerStream* Streams = reinterpret_cast<const TGeometryContainerStream*>(Records + Header.PrimitiveCount);
+	vector<TDecodeJob> DecodeJobs;
+
+	for (uint i = 0; i < Header.PrimitiveCount; i++)
+	{
+		const TGeometryContainerPrimitive& Record = Records[i];
+
+		if ((uint64)Record.FirstStream + Record.StreamCount > Header.StreamCount)
+		{
+			LogE(GeometryContainer, L"%s: invalid primitive %i", Filepath.GetBuffer(), Record.Id);
+			return false;
+		}
+
+		auto Inserted = OutGeometries.emplace(Record.Id, TPrimitiveGeometry());
+		if (!Inserted.second)
+		{
+			LogE(GeometryContainer, L"%s: duplicated primitive %i", Filepath.GetBuffer(), Record.Id);
+			return false;
+		}
+
+		// The map nodes do not move: the decode jobs point into the arrays
+		TPrimitiveGeometry& Geometry = Inserted.first->second;
+		Geometry.Topology = (LXPrimitiveTopology)Record.Topology;
+
+		for (uint j = Record.FirstStream; j < Record.FirstStream + Record.StreamCount; j++)
+		{
+			const TGeometryContainerStream& Stream = Streams[j];
+			bool Valid = Stream.Offset <= Size && Stream.Size <= Size - Stream.Offset;
+			const uint8* StreamData = Data + Stream.Offset;
+
+			if (Valid)
+			{
+				switch (Stream.Target)
+				{
+				case LX_INDICES: Valid = LoadStream(Geometry.Indices, StreamData, Stream, DecodeJobs); break;
+				case LX_TEXTCOORD: Valid = LoadStream(Geometry.TexCoords, StreamData, Stream, DecodeJobs); break;
+				case LX_NORMALS: Valid = LoadStream(Geometry.Normals, StreamData, Stream, DecodeJobs); break;
+				case LX_TANGENTS: Valid = LoadStream(Geometry.Tangents, StreamData, Stream, DecodeJobs); break;
+				case LX_BINORMALS: Valid = LoadStream(Geometry.BiNormals, StreamData, Stream, DecodeJobs); break;
+
+				case LX_VERTICES:
+					if (Stream.Type == LX_VEC4F)
+						Valid = LoadStream(Geometry.Positions4f, StreamData, Stream, DecodeJobs);
+					else
+						Valid = LoadStream(Geometry.Positions, StreamData, Stream, DecodeJobs);
+					break;
+
+				case LX_LODINDICES:
+				{
+					// The LODs are moved when the array grows: their index buffers stay in place
+					Geometry.LODs.push_back(TPrimitiveLOD());
+					Geometry.LODs.back().Error = Stream.Error;
+					Valid = LoadStream(Geometry.LODs.back().Indices, StreamData, Stream, DecodeJobs);
+				}
+				break;
+
+				default: Valid = false;
+				}
+			}
+
+			if (!Valid)
+			{
+				LogE(GeometryContainer, L"%s: invalid stream in primitive %i", Filepath.GetBuffer(), Record.Id);
+				return false;
+			}
+		}
+
+		Geometry.Optimized = (Record.Flags & kOptimized) != 0;
+		Geometry.LODsGenerated = (Record.Flags & kLODsGenerated) || !Geometry.LODs.empty();
+	}
+
+	std::atomic<bool> Failed(false);
+
+	ParallelFor((uint)DecodeJobs.size(), [&DecodeJobs, &Failed](uint i)
+	{
+		const TDecodeJob& Job = DecodeJobs[i];
+		if (!LXGeometryCodec::DecodeChunk(Job.Data, Job.Size, Job.Chunk, Job.Elements))
+			Failed = true;
+	});
+
+	if (Failed)
+	{
+		LogE(GeometryContainer, L"%s: corrupted compressed stream", Filepath.GetBuffer());
+		return false;
+	}
+
+	return true;
+}
+
+bool LXGeometryContainer::LoadLegacy(const LXFilepath& Filepath, MapPrimitiveGeometries& OutGeometries)
+{
+	LXFile File;
+
+	if (!File.Open(Filepath, L"rb"))
+		return false;
+
+	TPrimitiveGeometry* Geometry = nullptr;
+	TFileTag FileTag;
+
+	while (File.Read(&FileTag, sizeof(TFileTag)))
+	{
+		if (FileTag.nId != -1)
+		{
+			auto Inserted = OutGeometries.emplace(FileTag.nId, TPrimitiveGeometry());
+			if (!Inserted.second)
+			{
+				LogE(GeometryContainer, L"%s: duplicated primitive %i", Filepath.GetBuffer(), FileTag.nId);
+				return false;
+			}
+
+			Geometry = &Inserted.first->second;
+			Geometry->Topology = FileTag.eMode;
+			continue;
+		}
+
+		bool Valid = Geometry != nullptr;
+
+		if (Valid)
+		{
+			switch (FileTag.eDataTarget)
+			{
+			case LX_INDICES: Valid = ReadStream(File, Geometry->Indices, FileTag.nCount); break;
+			case LX_TEXTCOORD: Valid = ReadStream(File, Geometry->TexCoords, FileTag.nCount); break;
+			case LX_TANGENTS: Valid = ReadStream(File, Geometry->Tangents, FileTag.nCount); break;
+			case LX_BINORMALS: Valid = ReadStream(File, Geometry->BiNormals, FileTag.nCount); break;
+
+			case LX_VERTICES:
+				if (FileTag.eDataType == LX_VEC4F)
+					Valid = ReadStream(File, Geometry->Positions4f, FileTag.nCount);
+				else
+					Valid = ReadStream(File, Geometry->Positions, FileTag.nCount);
+				break;
+
+			case LX_NORMALS:
+			{
+				// The legacy files have the opposite convention
+				ArrayVec3f& Normals = Geometry->Normals;
+				Valid = ReadStream(File, Normals, FileTag.nCount);
+				for (vec3f& Normal : Normals)
+					Normal *= -1.f;
+			}
+			break;
+
+			case LX_LODINDICES:
+			{
+				TPrimitiveLOD LOD;
+				Valid = FileTag.nCount >= sizeof(float) && File.Read(&LOD.Error, sizeof(float)) == 1 && ReadStream(File, LOD.Indices, FileTag.nCount - sizeof(float));
+				Geometry->LODs.push_back(move(LOD));
+			}
+			break;
+
+			default: Valid = false;
+			}
+		}
+
+		if (!Valid)
+		{
+			CHK(0);
+			LogE(GeometryContainer, L"%s: invalid tag", Filepath.GetBuffer());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool LXGeometryContainer::Save(const LXFilepath& Filepath, const MapPrimitiveGeometries& Geometries, bool Compress)
+{
+	vector<TGeometryContainerPrimitive> Records;
+	vector<TGeometryContainerStream> Streams;
+	vector<const void*> StreamData;
+
+	auto AddStream = [&Streams, &StreamData](LXDataTarget Target, LXDataType Type, const void* Data, size_t Size, float Error)
+	{
+		if (Size == 0)
+			return;
+
+		Streams.push_back({ Target, Type, Error, 0, 0, Size });
+		StreamData.push_back(Data);
+	};
+
+	for (const auto& It : Geometries)
+	{
+		const TPrimitiveGeometry& Geometry = It.second;
+		TGeometryContainerPrimitive Record = { It.first, Geometry.Topology, (Geometry.Optimized ? kOptimized : 0) | (Geometry.LODsGenerated ? kLODsGenerated : 0), (uint)Streams.size(), 0 };
+
+		AddStream(LX_INDICES, LX_VEC3UI, Geometry.Indices.data(), sizeof(uint) * Geometry.Indices.size(), 0.f);
+		AddStream(LX_VERTICES, LX_VEC3F, Geometry.Positions.data(), sizeof(vec3f) * Geometry.Positions.size(), 0.f);
+		AddStream(LX_VERTICES, LX_VEC4F, Geometry.Positions4f.data(), sizeof(vec4f) * Geometry.Positions4f.size(), 0.f);
+		AddStream(LX_NORMALS, LX_VEC3F, Geometry.Normals.data(), sizeof(vec3f) * Geometry.Normals.size(), 0.f);
+		AddStream(LX_TEXTCOORD, LX_VEC2F, Geometry.TexCoords.data(), sizeof(vec2f) * Geometry.TexCoords.size(), 0.f);
+		AddStream(LX_TANGENTS, LX_VEC3F, Geometry.Tangents.data(), sizeof(vec3f) * Geometry.Tangents.size(), 0.f);
+		AddStream(LX_BINORMALS, LX_VEC3F, Geometry.BiNormals.data(), sizeof(vec3f) * Geometry.BiNormals.size(), 0.f);
+
+		for (const TPrimitiveLOD& LOD : Geometry.LODs)
+		{
+			AddStream(LX_LODINDICES, LX_VEC3UI, LOD.Indices.data(), sizeof(uint) * LOD.Indices.size(), LOD.Error);
+		}
+
+		Record.StreamCount = (uint)Streams.size() - Record.FirstStream;
+		Records.push_back(Record);
+	}
+
+	// Encoded in parallel, kept raw when not smaller
+	vector<vector<uint8>> EncodedStreams(Compress ? Streams.size() : 0);
+
+	ParallelFor((uint)EncodedStreams.size(), [&Streams, &StreamData, &EncodedStreams](uint i)
+	{
+		const EGeometryCodec Codec = GetStreamCodec(Streams[i].Target, Streams[i].Type);
+		if (Codec != EGeometryCodec::None)
+			LXGeometryCodec::Encode(Codec, StreamData[i], (uint)(Streams[i].Size / LXGeometryCodec::GetElementSize(Codec)), EncodedStreams[i]);
+	});
+
+	for (size_t i = 0; i < EncodedStreams.size(); i++)
+	{
+		if (!EncodedStreams[i].empty() && EncodedStreams[i].size() < Streams[i].Size)
+		{
+			Streams[i].Encoding = (uint)GetStreamCodec(Streams[i].Target, Streams[i].Type);
+			Streams[i].Size = EncodedStreams[i].size();
+			StreamData[i] = EncodedStreams[i].data();
+		}
+	}
+
+	// Layout
+	const uint64 RecordsSize = sizeof(TGeometryContainerHeader) + Records.size() * sizeof(TGeometryContainerPrimitive) + Streams.size() * sizeof(TGeometryContainerStream);
+	uint64 Offset = RecordsSize;
+
+	for (TGeometryContainerStream& Stream : Streams)
+	{
+		Stream.Offset = Align(Offset);
+		Offset = Stream.Offset + Stream.Size;
+	}
+
+	const TGeometryContainerHeader Header = { kMagic, kVersion, (uint)Records.size(), (uint)Streams.size(), Offset };
+
+	LXFile File;
+	if (!File.Open(Filepath, L"wb"))
+	{
+		LogE(GeometryContainer, L"Unable to write %s", Filepath.GetBuffer());
+		return false;
+	}
+
+	File.Write((void*)&Header, sizeof(Header));
+
+	if (Records.size() > 0)
+		File.Write(Records.data(), Records.size() * sizeof(TGeometryContainerPrimitive));
+
+	if (Streams.size() > 0)
+		File.Write(Streams.data(), Streams.size() * sizeof(TGeometryContainerStream));
+
+	uint8 Padding[kAlignment] = { 0 };
+	uint64 Position = RecordsSize;
+
+	for (size_t i = 0; i < Streams.size(); i++)
+	{
+		if (Streams[i].Offset > Position)
+			File.Write(Padding, (size_t)(Streams[i].Offset - Position));
+
+		File.Write((void*)StreamData[i], (size_t)Streams[i].Size);
+		Position = Streams[i].Offset + Streams[i].Size;
+	}
+
+	const bool Result = File.Tell() == Offset;
+	File.Close();
+	return Result;
+}
+
+void LXGeometryContainer::GenerateLODsAndOptimize(MapPrimitiveGeometries& Geometries)
+{
+	// Imported geometries: saved without their LOD chain, nor optimized
+	for (auto& It : Geometries)
+	{
+		TPrimitiveGeometry& Geometry = It.second;
+		if (Geometry.LODsGenerated && Geometry.Optimized)
+			continue;
+
+		if (!Geometry.LODsGenerated)
+			Geometry.GenerateLODs();
+
+		// The new LODs are optimized with LOD 0
+		Geometry.OptimizeIndices();
+	}
+}
+
+bool LXGeometryContainer::Convert(const LXFilepath& Filepath, bool Compress)
+{
+	MapPrimitiveGeometries Geometries;
+	bool Compressed = false;
+
+	if (IsContainer(Filepath, &Compressed))
+	{
+		if (!Compress || Compressed || !Load(Filepath, Geometries))
+			return false;
+	}
+	else
+	{
+		if (!LoadLegacy(Filepath, Geometries))
+			return false;
+
+		GenerateLODsAndOptimize(Geometries);
+	}
+
+	// Written aside, the legacy file is replaced once the container is complete
+	const LXFilepath TempFilepath = Filepath + L".tmp";
+
+	if (!Save(TempFilepath, Geometries, Compress))
+	{
+		::DeleteFile(TempFilepath);
+		return false;
+	}
+
+	return ::MoveFileEx(TempFilepath, Filepath, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+uint LXGeometryContainer::ConvertFolder(const LXFilepath& Folderpath, bool Compress)
+{
+	uint ConvertedCount = 0;
+	LXFilepath Folder = Folderpath;
+	if (!Folder.IsEmpty() && Folder.Right(1) != L"/")
+		Folder += L"/";
+
+	LXDirectory Directory(Folder + L"*");
+
+	for (const LXFileInfo& FileInfo : Directory.GetListFileNames())
+	{
+		const LXFilepath Filepath(FileInfo.FullFileName.c_str());
+		if (Filepath.GetExtension().MakeLower() != LX_MESHBIN_EXT)
+			continue;
+
+		if (Convert(Filepath, Compress))
+		{
+			LogI(GeometryContainer, L"Converted %s", Filepath.GetBuffer());
+			ConvertedCount++;
+		}
+	}
+
+	return ConvertedCount;
+}
@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXPrimitive.h"
+
+//
+// Geometry file of the LXAssetMesh (.sebin).
+// Header, primitive records, stream records, then the streams, each aligned on kAlignment.
+// The raw streams are the LXPrimitive arrays as they are in memory: the file is mapped and each stream
+// is copied once, in bulk, into its array. The compressed streams (LXGeometryCodec) are decoded by chunks,
+// all the chunks of the file in parallel.
+// The legacy files, a TFileTag sequence, are still loaded. Convert rewrites them as containers.
+//
+
+struct TGeometryContainerHeader
+{
+	uint Magic;
+	uint Version;
+	uint PrimitiveCount;
+	uint StreamCount;
+	uint64 FileSize;
+};
+
+struct TGeometryContainerPrimitive
+{
+	int Id;
+	int Topology;		// LXPrimitiveTopology
+	uint Flags;
+	uint FirstStream;
+	uint StreamCount;
+};
+
+struct TGeometryContainerStream
+{
+	int Target;			// LXDataTarget
+	int Type;			// LXDataType
+	float Error;		// LX_LODINDICES
+	uint Encoding;		// EGeometryCodec, None in version 1
+	uint64 Offset;		// From the file start
+	uint64 Size;		// Stored size, in bytes
+};
+
+class LXGeometryContainer
+{
+
+public:
+
+	static const uint kMagic = 0x4347584C;	// "LXGC"
+	static const uint kVersion = 2;
+	static const uint kAlignment = 64;
+
+	// Primitive flags
+	static const uint kOptimized = LX_BIT(0);
+	static const uint kLODsGenerated = LX_BIT(1);	// Without LOD stream when the mesh can not be simplified
+
+	// Container or legacy file
+	static bool Load(const LXFilepath& Filepath, MapPrimitiveGeometries& OutGeometries);
+	static bool LoadLegacy(const LXFilepath& Filepath, MapPrimitiveGeometries& OutGeometries);
+	// Compress: the streams are encoded with LXGeometryCodec, lossy for the vertex attributes
+	static bool Save(const LXFilepath& Filepath, const MapPrimitiveGeometries& Geometries, bool Compress = false);
+
+	static bool IsContainer(const LXFilepath& Filepath, bool* OutCompressed = nullptr);
+
+	// Rewrites a legacy file as a container, with its LOD chains and optimized indices.
+	// With Compress, the uncompressed containers are rewritten compressed too.
+	// Returns false when the file is left as is.
+	static bool Convert(const LXFilepath& Filepath, bool Compress = false);
+
+	// Converts the files of the folder and its sub-folders, returns the converted file count
+	static uint ConvertFolder(const LXFilepath& Folderpath, bool Compress = false);
+
+	// Done at load for the legacy files
+	static void GenerateLODsAndOptimize(MapPrimitiveGeometries& Geometries);
+};
@@ -0,0 +1,309 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXGeometryPoolD3D11.h"
+#include "LXCore.h"
+#include "LXDirectX11.h"
+#include "LXLogger.h"
+#include "LXPrimitiveD3D11.h"
+#include "LXRenderBackend.h"
+#include "LXStatManager.h"
+#include "LXThreadManager.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	// Initial capacities, in elements
+	const uint kInitialVertexCount = 64 * 1024;
+	const uint kInitialIndexCount = 256 * 1024;
+
+	// D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM, supported by every device
+	const uint64 kMaxBufferSize = 128ull * 1024 * 1024;
+
+	// A megabuffer is compacted when a quarter of it is free, but its largest free range holds less than half of the free space
+	const float kDefragmentFreeRatio = 0.25f;
+	const float kDefragmentLargestRatio = 0.5f;
+
+#ifdef INDEXTYPE_USHORT
+	const UINT kIndexStride = sizeof(unsigned short);
+#else
+	const UINT kIndexStride = sizeof(UINT);
+#endif
+
+	void CopyRegion(ID3D11Buffer* Dst, ID3D11Buffer* Src, UINT Stride, uint DstOffset, uint SrcOffset, uint Count)
+	{
+		if (Count == 0)
+			return;
+
+		const D3D11_BOX Box = { SrcOffset * Stride, 0, 0, (SrcOffset + Count) * Stride, 1, 1 };
+		LXDirectX11::GetCurrentDeviceContext()->CopySubresourceRegion(Dst, 0, DstOffset * Stride, 0, 0, Src, 0, &Box);
+	}
+};
+
+LXGeometryPoolD3D11::LXGeometryPoolD3D11()
+{
+	_IndexMegaBuffer.Stride = kIndexStride;
+	_IndexMegaBuffer.BindFlags = D3D11_BIND_INDEX_BUFFER;
+}
+
+LXGeometryPoolD3D11::~LXGeometryPoolD3D11()
+{
+	CHK(_Primitives.empty());
+
+	for (auto& It : _VertexMegaBuffers)
+	{
+		LX_SAFE_RELEASE(It.second.D3D11Buffer);
+	}
+
+	LX_SAFE_RELEASE(_IndexMegaBuffer.D3D11Buffer);
+}
+
+bool LXGeometryPoolD3D11::Add(LXPrimitiveD3D11* Primitive, const void* Vertices, UINT VertexCount, UINT VertexStride, const void* Indices, UINT IndexCount)
+{
+	CHK(IsRenderThread());
+	CHK(Primitive && !Primitive->GeometryPool);
+	CHK(VertexCount > 0 && IndexCount > 0);
+
+	// No device memory to share, the primitive keeps its own (null) buffers
+	if (LXRenderBackend::IsNullDevice())
+		return false;
+
+	TMegaBuffer& VertexMegaBuffer = _VertexMegaBuffers[VertexStride];
+	if (VertexMegaBuffer.Stride == 0)
+	{
+		VertexMegaBuffer.Stride = VertexStride;
+		VertexMegaBuffer.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	}
+
+	const uint VertexAllocation = Allocate(VertexMegaBuffer, VertexCount, Vertices);
+	if (VertexAllocation == LXGeometryAllocator::kInvalid)
+		return false;
+
+	const uint IndexAllocation = Allocate(_IndexMegaBuffer, IndexCount, Indices);
+	if (IndexAllocation == LXGeometryAllocator::kInvalid)
+	{
+		Release(VertexMegaBuffer, VertexAllocation);
+		return false;
+	}
+
+	Primitive->GeometryPool = this;
+	Primitive->VertexAllocation = VertexAllocation;
+	Primitive->IndexAllocation = IndexAllocation;
+	_Primitives.insert(Primitive);
+	SetLocations(Primitive);
+	return true;
+}
+
+void LXGeometryPoolD3D11::AddShared(LXPrimitiveD3D11* Primitive, const LXPrimitiveD3D11* Source)
+{
+	CHK(IsRenderThread());
+	CHK(Source->GeometryPool == this);
+	CHK(!Primitive->GeometryPool);
+	CHK(Primitive->VertexStride == Source->VertexStride);
+
+	_VertexMegaBuffers[Source->VertexStride].RefCounts[Source->VertexAllocation]++;
+	_IndexMegaBuffer.RefCounts[Source->IndexAllocation]++;
+
+	Primitive->GeometryPool = this;
+	Primitive->VertexAllocation = Source->VertexAllocation;
+	Primitive->IndexAllocation = Source->IndexAllocation;
+	_Primitives.insert(Primitive);
+	SetLocations(Primitive);
+}
+
+void LXGeometryPoolD3D11::Remove(LXPrimitiveD3D11* Primitive)
+{
+	CHK(IsRenderThread());
+	CHK(Primitive->GeometryPool == this);
+
+	Release(_VertexMegaBuffers[Primitive->VertexStride], Primitive->VertexAllocation);
+	Release(_IndexMegaBuffer, Primitive->IndexAllocation);
+	_Primitives.erase(Primitive);
+
+	Primitive->GeometryPool = nullptr;
+	Primitive->VertexBuffer = nullptr;
+	Primitive->IndexBuffer = nullptr;
+}
+
+uint LXGeometryPoolD3D11::Allocate(TMegaBuffer& MegaBuffer, UINT Count, const void* Data)
+{
+	if ((uint64)Count * MegaBuffer.Stride > kMaxBufferSize)
+		return LXGeometryAllocator::kInvalid;
+
+	uint Allocation = MegaBuffer.Allocator.Allocate(Count);
+
+	if (Allocation == LXGeometryAllocator::kInvalid)
+	{
+		// Grown when possible, the last free range is extended. Compacted otherwise.
+		if (Grow(MegaBuffer, Count) || (MegaBuffer.Allocator.GetFreeSize() >= Count && Compact(MegaBuffer)))
+		{
+			UpdatePrimitives();
+			Allocation = MegaBuffer.Allocator.Allocate(Count);
+		}
+
+		if (Allocation == LXGeometryAllocator::kInvalid)
+			return LXGeometryAllocator::kInvalid;
+	}
+
+	if (MegaBuffer.RefCounts.size() <= Allocation)
+		MegaBuffer.RefCounts.resize(Allocation + 1, 0);
+
+	MegaBuffer.RefCounts[Allocation] = 1;
+
+	const uint Offset = MegaBuffer.Allocator.GetOffset(Allocation);
+	const D3D11_BOX Box = { Offset * MegaBuffer.Stride, 0, 0, (Offset + Count) * MegaBuffer.Stride, 1, 1 };
+	LXDirectX11::GetCurrentDeviceContext()->UpdateSubresource(MegaBuffer.D3D11Buffer, 0, &Box, Data, 0, 0);
+	return Allocation;
+}
+
+void LXGeometryPoolD3D11::Release(TMegaBuffer& MegaBuffer, uint Allocation)
+{
+	CHK(Allocation < MegaBuffer.RefCounts.size() && MegaBuffer.RefCounts[Allocation] > 0);
+
+	if (--MegaBuffer.RefCounts[Allocation] == 0)
+		MegaBuffer.Allocator.Free(Allocation);
+}
+
+bool LXGeometryPoolD3D11::Grow(TMegaBuffer& MegaBuffer, uint Count)
+{
+	const uint MaxCapacity = (uint)(kMaxBufferSize / MegaBuffer.Stride);
+	const uint Capacity = MegaBuffer.Allocator.GetCapacity();
+	const uint InitialCapacity = MegaBuffer.BindFlags == D3D11_BIND_INDEX_BUFFER ? kInitialIndexCount : kInitialVertexCount;
+	const uint NewCapacity = std::min(std::max(std::max(Capacity * 2, Capacity + Count), InitialCapacity), MaxCapacity);
+
+	if (NewCapacity < Capacity + Count)
+		return false;
+
+	ID3D11Buffer* D3D11Buffer = CreateD3D11Buffer(MegaBuffer.BindFlags, NewCapacity * MegaBuffer.Stride);
+	if (!D3D11Buffer)
+		return false;
+
+	if (MegaBuffer.D3D11Buffer)
+	{
+		CopyRegion(D3D11Buffer, MegaBuffer.D3D11Buffer, MegaBuffer.Stride, 0, 0, Capacity);
+		MegaBuffer.D3D11Buffer->Release();
+	}
+
+	MegaBuffer.D3D11Buffer = D3D11Buffer;
+	MegaBuffer.Allocator.Grow(NewCapacity);
+	return true;
+}
+
+bool LXGeometryPoolD3D11::Compact(TMegaBuffer& MegaBuffer)
+{
+	// The allocations are copied to a new buffer: the copy regions of a resource onto itself must not overlap.
+	ID3D11Buffer* D3D11Buffer = CreateD3D11Buffer(MegaBuffer.BindFlags, MegaBuffer.Allocator.GetCapacity() * MegaBuffer.Stride);
+	if (!D3D11Buffer)
+		return false;
+
+	vector<TGeometryMove> Moves;
+	MegaBuffer.Allocator.Defragment(Moves);
+
+	// The allocations before the first move are in place
+	const uint InPlaceCount = Moves.empty() ? MegaBuffer.Allocator.GetUsedSize() : Moves[0].DstOffset;
+	CopyRegion(D3D11Buffer, MegaBuffer.D3D11Buffer, MegaBuffer.Stride, 0, 0, InPlaceCount);
+
+	for (const TGeometryMove& Move : Moves)
+	{
+		CopyRegion(D3D11Buffer, MegaBuffer.D3D11Buffer, MegaBuffer.Stride, Move.DstOffset, Move.SrcOffset, Move.Size);
+	}
+
+	MegaBuffer.D3D11Buffer->Release();
+	MegaBuffer.D3D11Buffer = D3D11Buffer;
+	return true;
+}
+
+void LXGeometryPoolD3D11::Defragment()
+{
+	CHK(IsRenderThread());
+
+	bool Changed = false;
+
+	auto DefragmentMegaBuffer = [&Changed, this](TMegaBuffer& MegaBuffer)
+	{
+		const LXGeometryAllocator& Allocator = MegaBuffer.Allocator;
+		const uint FreeSize = Allocator.GetFreeSize();
+
+		if (FreeSize >= Allocator.GetCapacity() * kDefragmentFreeRatio && Allocator.GetLargestFreeSize() < FreeSize * kDefragmentLargestRatio)
+			Changed |= Compact(MegaBuffer);
+	};
+
+	for (auto It = _VertexMegaBuffers.begin(); It != _VertexMegaBuffers.end();)
+	{
+		// No more vertices of this size
+		if (It->second.Allocator.GetAllocationCount() == 0)
+		{
+			LX_SAFE_RELEASE(It->second.D3D11Buffer);
+			It = _VertexMegaBuffers.erase(It);
+		}
+		else
+		{
+			DefragmentMegaBuffer(It->second);
+			It++;
+		}
+	}
+
+	DefragmentMegaBuffer(_IndexMegaBuffer);
+
+	if (Changed)
+		UpdatePrimitives();
+}
+
+ID3D11Buffer* LXGeometryPoolD3D11::CreateD3D11Buffer(UINT BindFlags, UINT ByteWidth)
+{
+	D3D11_BUFFER_DESC bd = { 0 };
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = ByteWidth;
+	bd.BindFlags = BindFlags;
+
+	ID3D11Buffer* D3D11Buffer = nullptr;
+	HRESULT hr = LXDirectX11::GetCurrentDevice()->CreateBuffer(&bd, nullptr, &D3D11Buffer);
+	if (FAILED(hr))
+	{
+		LogE(GeometryPool, L"Failed to create a %u KB megabuffer", ByteWidth / 1024);
+		return nullptr;
+	}
+
+	return D3D11Buffer;
+}
+
+void LXGeometryPoolD3D11::SetLocations(LXPrimitiveD3D11* Primitive) const
+{
+	const TMegaBuffer& VertexMegaBuffer = _VertexMegaBuffers.at(Primitive->VertexStride);
+
+	Primitive->VertexBuffer = VertexMegaBuffer.D3D11Buffer;
+	Primitive->BaseVertexLocation = (INT)VertexMegaBuffer.Allocator.GetOffset(Primitive->VertexAllocation);
+	Primitive->IndexBuffer = _IndexMegaBuffer.D3D11Buffer;
+	Primitive->StartIndexLocation = _IndexMegaBuffer.Allocator.GetOffset(Primitive->IndexAllocation);
+}
+
+void LXGeometryPoolD3D11::UpdatePrimitives()
+{
+	for (LXPrimitiveD3D11* Primitive : _Primitives)
+	{
+		SetLocations(Primitive);
+	}
+}
+
+void LXGeometryPoolD3D11::UpdateStats() const
+{
+	uint64 UsedSize = (uint64)_IndexMegaBuffer.Allocator.GetUsedSize() * _IndexMegaBuffer.Stride;
+	uint64 Capacity = (uint64)_IndexMegaBuffer.Allocator.GetCapacity() * _IndexMegaBuffer.Stride;
+
+	for (const auto& It : _VertexMegaBuffers)
+	{
+		UsedSize += (uint64)It.second.Allocator.GetUsedSize() * It.second.Stride;
+		Capacity += (uint64)It.second.Allocator.GetCapacity() * It.second.Stride;
+	}
+
+	GetStatManager()->SetFrameCounter(L"GeometryPool.Primitives", (uint)_Primitives.size());
+	GetStatManager()->SetFrameCounter(L"GeometryPool.MegaBuffers", (uint)_VertexMegaBuffers.size() + 1);
+	GetStatManager()->SetFrameCounter(L"GeometryPool.UsedKB", (uint)(UsedSize / 1024));
+	GetStatManager()->SetFrameCounter(L"GeometryPool.CapacityKB", (uint)(Capacity / 1024));
+}
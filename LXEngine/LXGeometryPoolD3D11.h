@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXGeometryAllocator.h"
+
+struct ID3D11Buffer;
+class LXPrimitiveD3D11;
+
+//
+// Vertex and index megabuffers shared by the primitives: one vertex buffer per vertex stride, one index buffer.
+// The primitives are drawn at their BaseVertexLocation and StartIndexLocation, so the ones sharing
+// the megabuffers share the input assembler bindings too.
+// The megabuffers grow by doubling and are compacted when their free space gets fragmented.
+// Both replace the D3D11 buffers: the buffers and locations of the pooled primitives are updated.
+// Render thread only.
+//
+
+class LXGeometryPoolD3D11
+{
+
+public:
+
+	LXGeometryPoolD3D11();
+	~LXGeometryPoolD3D11();
+
+	// Uploads the geometry and sets the buffers and locations of the Primitive.
+	// Returns false when the pool cannot hold it: the primitive has to create its own buffers.
+	bool Add(LXPrimitiveD3D11* Primitive, const void* Vertices, UINT VertexCount, UINT VertexStride, const void* Indices, UINT IndexCount);
+
+	// Primitive draws the geometry of Source (LXPrimitiveD3D11::CreateInstanced)
+	void AddShared(LXPrimitiveD3D11* Primitive, const LXPrimitiveD3D11* Source);
+
+	void Remove(LXPrimitiveD3D11* Primitive);
+
+	// Compacts the megabuffers whose free space is fragmented
+	void Defragment();
+
+	void UpdateStats() const;
+
+private:
+
+	struct TMegaBuffer
+	{
+		ID3D11Buffer* D3D11Buffer = nullptr;
+		LXGeometryAllocator Allocator;
+		vector<uint> RefCounts;	// Primitives per allocation
+		UINT Stride = 0;
+		UINT BindFlags = 0;
+	};
+
+	uint Allocate(TMegaBuffer& MegaBuffer, UINT Count, const void* Data);
+	void Release(TMegaBuffer& MegaBuffer, uint Allocation);
+
+	// Both replace the D3D11 buffer, the primitives have to be updated
+	bool Grow(TMegaBuffer& MegaBuffer, uint Count);
+	bool Compact(TMegaBuffer& MegaBuffer);
+
+	static ID3D11Buffer* CreateD3D11Buffer(UINT BindFlags, UINT ByteWidth);
+	void SetLocations(LXPrimitiveD3D11* Primitive) const;
+	void UpdatePrimitives();
+
+private:
+
+	map<UINT, TMegaBuffer> _VertexMegaBuffers;
+	TMegaBuffer _IndexMegaBuffer;
+	set<LXPrimitiveD3D11*> _Primitives;
+};
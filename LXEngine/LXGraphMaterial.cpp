@@ -53,6 +53,24 @@ LXTexture* LXGraphMaterial::GetTextureDisplacement(const LXString& textureName)
 	return nullptr;
 }
 
+void LXGraphMaterial::GetTextures(set<LXTexture*>& outTextures) const
+{
+	for (const LXNode* node : Nodes)
+	{
+		for (LXProperty* property : node->GetProperties())
+		{
+			if (property->GetType() == EPropertyType::AssetPtr)
+			{
+				LXPropertyAssetPtr* propertyAssetPtr = (LXPropertyAssetPtr*)property;
+				if (LXTexture* texture = dynamic_cast<LXTexture*>(propertyAssetPtr->GetValue()))
+				{
+					outTextures.insert(texture);
+				}
+			}
+		}
+	}
+}
+
 bool LXGraphMaterial::GetFloatParameter(const LXString& paramName, float& outValue) const
 {
 
@@ -25,6 +25,7 @@ public:
 	void GetChildProperties(ListProperties& UserProperties) const override;
 	LXTexture* GetTextureDisplacement(const LXString& textureName) const;
 	bool GetFloatParameter(const LXString& textureName, float& outValue) const;
+	void GetTextures(set<LXTexture*>& outTextures) const;
 
 public:
 
@@ -758,6 +758,92 @@ LXStringA LXGraphMaterialToHLSLConverter::CreateVertexShaderEntryPoint(int Layou
 {
 	LXStringA code;
 
+	if (LayoutMask & LX_PRIMITIVE_INSTANCEWORLD)
+	{
+		// Dynamic instancing: the vertex is moved to world space with the instance matrices,
+		// then given to the regular entry point. The instances are drawn with an identity CBWorld.
+		const int BaseLayoutMask = LayoutMask & ~LX_PRIMITIVE_INSTANCEWORLD;
+
+		code = CreateVertexShaderEntryPoint(BaseLayoutMask);
+		code.Replace("VS_OUTPUT VS(", "VS_OUTPUT VS_Base(");
+
+		const bool Packed = (BaseLayoutMask & LX_PRIMITIVE_PACKED) != 0;
+
+		LXStringA InputName;
+		LXStringA PackedInputName;
+		LXStringA Transform;
+
+		switch (BaseLayoutMask)
+		{
+		case (int)EPrimitiveLayout::P: InputName = "VS_INPUT_P"; break;
+		case (int)EPrimitiveLayout::PN: InputName = "VS_INPUT_PN"; break;
+		case (int)EPrimitiveLayout::PNT: InputName = "VS_INPUT_PNT"; break;
+		case (int)EPrimitiveLayout::PNABT: InputName = "VS_INPUT_PNABT"; break;
+		case (int)EPrimitiveLayout::PackedPN: InputName = "VS_INPUT_PN"; PackedInputName = "VS_INPUT_PACKED_PN"; break;
+		case (int)EPrimitiveLayout::PackedPNT: InputName = "VS_INPUT_PNT"; PackedInputName = "VS_INPUT_PACKED_PNT"; break;
+		case (int)EPrimitiveLayout::PackedPNABT: InputName = "VS_INPUT_PNABT"; PackedInputName = "VS_INPUT_PACKED_PNABT"; break;
+		default: CHK(0); return code;
+		}
+
+		if (BaseLayoutMask & LX_PRIMITIVE_NORMALS)
+		{
+			Transform += "	input.Normal = normalize(mul((float3x3)Normal, input.Normal));\n";
+		}
+
+		if (BaseLayoutMask & LX_PRIMITIVE_TANGENTS)
+		{
+			Transform += "	input.Tangent = normalize(mul((float3x3)World, input.Tangent));\n";
+		}
+
+		if (BaseLayoutMask & LX_PRIMITIVE_BINORMALS)
+		{
+			Transform += "	input.Binormal = normalize(mul((float3x3)World, input.Binormal));\n";
+		}
+
+		code +=
+			"\n"
+			"//--------------------------------------------------------------------------------------\n"
+			"// Vertex Shader - Instanced - LXConstantBufferData1 per instance \n"
+			"//--------------------------------------------------------------------------------------\n"
+			"struct VS_INPUT_INSTANCEWORLD\n"
+			"{\n"
+			"	float4 World0 : INSTANCEWORLD0;\n"
+			"	float4 World1 : INSTANCEWORLD1;\n"
+			"	float4 World2 : INSTANCEWORLD2;\n"
+			"	float4 World3 : INSTANCEWORLD3;\n"
+			"	float4 Normal0 : INSTANCENORMAL0;\n"
+			"	float4 Normal1 : INSTANCENORMAL1;\n"
+			"	float4 Normal2 : INSTANCENORMAL2;\n"
+			"	float4 Normal3 : INSTANCENORMAL3;\n"
+			"};\n"
+			"\n";
+
+		// Packed: unpacked first, then given to the entry point of the unpacked layout
+		code += "VS_OUTPUT VS(";
+		code += Packed ? PackedInputName + " packed" : InputName + " input";
+		code += ", VS_INPUT_INSTANCEWORLD instance)\n";
+		code +=
+			"{\n"
+			"	// cb1.World is the transposed World matrix and cb1.Normal the inverse: their rows are World and its inverse transpose.\n"
+			"	float4x4 World = float4x4(instance.World0, instance.World1, instance.World2, instance.World3);\n"
+			"	float4x4 Normal = float4x4(instance.Normal0, instance.Normal1, instance.Normal2, instance.Normal3);\n";
+		if (Packed)
+		{
+			code += "	" + InputName + " input = Unpack(packed);\n";
+		}
+		code += "	input.Pos = mul(World, float4(input.Pos, 1.0)).xyz;\n";
+		code += Transform;
+		code += Packed ? "	return VS_Unpacked(input);\n" : "	return VS_Base(input);\n";
+		code += "}\n";
+
+		return code;
+	}
+
+	if (LayoutMask & LX_PRIMITIVE_PACKED)
+	{
+		return CreatePackedVertexShaderEntryPoint(LayoutMask);
+	}
+
 	if (LayoutMask == (int)EPrimitiveLayout::P)
 	{
 		code = 
@@ -876,6 +962,7 @@ LXStringA LXGraphMaterialToHLSLConverter::CreateVertexShaderEntryPoint(int Layou
 		if (LayoutMask & LX_PRIMITIVE_TEXCOORDS) { Layouts += L" LX_PRIMITIVE_TEXCOORDS"; }
 		if (LayoutMask & LX_PRIMITIVE_BINORMALS) { Layouts += L" LX_PRIMITIVE_BINORMALS"; }
 		if (LayoutMask & LX_PRIMITIVE_INSTANCEPOSITIONS) { Layouts += L" LX_PRIMITIVE_INSTANCEPOSITIONS"; }
+		if (LayoutMask & LX_PRIMITIVE_INSTANCEWORLD) { Layouts += L" LX_PRIMITIVE_INSTANCEWORLD"; }
 		LogE(LXShaderManager, Layouts.GetBuffer());
 		CHK(0);
 	}
@@ -883,6 +970,83 @@ LXStringA LXGraphMaterialToHLSLConverter::CreateVertexShaderEntryPoint(int Layou
 	return code;
 }
 
+LXStringA LXGraphMaterialToHLSLConverter::CreatePackedVertexShaderEntryPoint(int LayoutMask)
+{
+	// The vertex is unpacked then given to the entry point of the unpacked layout. The positions stay in [0,1]:
+	// the World matrix brings them to the local bounds (LXPrimitiveD3D11::MatrixUnpack).
+	LXStringA code = CreateVertexShaderEntryPoint(LayoutMask & ~LX_PRIMITIVE_PACKED);
+	code.Replace("VS_OUTPUT VS(", "VS_OUTPUT VS_Unpacked(");
+
+	LXStringA InputName;
+	LXStringA PackedInputName;
+	LXStringA PackedMembers;
+	LXStringA Unpack;
+
+	switch (LayoutMask)
+	{
+	case (int)EPrimitiveLayout::PackedPN:
+		InputName = "VS_INPUT_PN";
+		PackedInputName = "VS_INPUT_PACKED_PN";
+		PackedMembers = "	float2 Normal : NORMAL;\n";
+		Unpack = "	input.Normal = DecodeOctahedron(packed.Normal);\n";
+		break;
+
+	case (int)EPrimitiveLayout::PackedPNT:
+		InputName = "VS_INPUT_PNT";
+		PackedInputName = "VS_INPUT_PACKED_PNT";
+		PackedMembers = 
+			"	float2 Normal : NORMAL;\n"
+			"	float2 TexCoord : TEXCOORD;\n";
+		Unpack =
+			"	input.Normal = DecodeOctahedron(packed.Normal);\n"
+			"	input.TexCoord = packed.TexCoord;\n";
+		break;
+
+	case (int)EPrimitiveLayout::PackedPNABT:
+		InputName = "VS_INPUT_PNABT";
+		PackedInputName = "VS_INPUT_PACKED_PNABT";
+		PackedMembers =
+			"	float4 NormalTangent : NORMAL;\n"
+			"	float2 TexCoord : TEXCOORD;\n";
+		Unpack =
+			"	input.Normal = DecodeOctahedron(packed.NormalTangent.xy);\n"
+			"	input.Tangent = DecodeOctahedron(packed.NormalTangent.zw);\n"
+			"	input.Binormal = cross(input.Normal, input.Tangent) * (packed.Pos.w * 2.0 - 1.0);\n"
+			"	input.TexCoord = packed.TexCoord;\n";
+		break;
+
+	default: 
+		CHK(0); 
+		return code;
+	}
+
+	code +=
+		"\n"
+		"//--------------------------------------------------------------------------------------\n"
+		"// Vertex Shader - Packed: unorm position (w: binormal sign), octahedral normal and tangent\n"
+		"//--------------------------------------------------------------------------------------\n"
+		"float3 DecodeOctahedron(float2 e)\n"
+		"{\n"
+		"	float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+		"	float t = saturate(-n.z);\n"
+		"	n.xy += n.xy >= 0.0 ? -t : t;\n"
+		"	return normalize(n);\n"
+		"}\n"
+		"\n";
+
+	code += "struct " + PackedInputName + "\n{\n	float4 Pos : POSITION;\n" + PackedMembers + "};\n\n";
+
+	code += InputName + " Unpack(" + PackedInputName + " packed)\n{\n";
+	code += "	" + InputName + " input = (" + InputName + ")0;\n";
+	code += "	input.Pos = packed.Pos.xyz;\n";
+	code += Unpack;
+	code += "	return input;\n}\n\n";
+
+	code += "VS_OUTPUT VS(" + PackedInputName + " packed)\n{\n	return VS_Unpacked(Unpack(packed));\n}\n";
+
+	return code;
+}
+
 LXStringA LXGraphMaterialToHLSLConverter::CreatePixelShaderEntryPoint()
 {
 	LXStringA code;
@@ -41,6 +41,7 @@ private:
 	LXStringA ParseNodeConstant(const LXNode* node);
 	
 	LXStringA CreateVertexShaderEntryPoint(int LayoutMask);
+	LXStringA CreatePackedVertexShaderEntryPoint(int LayoutMask);
 	LXStringA CreatePixelShaderEntryPoint();
 
 	bool IsConnectorUsableInContext(const LXConnector* connector);
@@ -20,13 +20,13 @@ LXInputElementDescD3D11Factory::~LXInputElementDescD3D11Factory()
 {
 }
 
-D3D11_INPUT_ELEMENT_DESC SetPosition()
+D3D11_INPUT_ELEMENT_DESC SetPosition(DXGI_FORMAT Format = DXGI_FORMAT_R32G32B32_FLOAT)
 {
 	D3D11_INPUT_ELEMENT_DESC InputElementDesc;
 
 	InputElementDesc.SemanticName = "POSITION";
 	InputElementDesc.SemanticIndex = 0;
-	InputElementDesc.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	InputElementDesc.Format = Format;
 	InputElementDesc.InputSlot = 0;
 	InputElementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	InputElementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
@@ -35,13 +35,13 @@ D3D11_INPUT_ELEMENT_DESC SetPosition()
 	return InputElementDesc;
 }
 
-D3D11_INPUT_ELEMENT_DESC SetNormal()
+D3D11_INPUT_ELEMENT_DESC SetNormal(DXGI_FORMAT Format = DXGI_FORMAT_R32G32B32_FLOAT)
 {
 	D3D11_INPUT_ELEMENT_DESC InputElementDesc;
 
 	InputElementDesc.SemanticName = "NORMAL";
 	InputElementDesc.SemanticIndex = 0;
-	InputElementDesc.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	InputElementDesc.Format = Format;
 	InputElementDesc.InputSlot = 0;
 	InputElementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	InputElementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
@@ -80,13 +80,13 @@ D3D11_INPUT_ELEMENT_DESC SetBinormal()
 	return InputElementDesc;
 }
 
-D3D11_INPUT_ELEMENT_DESC SetTexcoord()
+D3D11_INPUT_ELEMENT_DESC SetTexcoord(DXGI_FORMAT Format = DXGI_FORMAT_R32G32_FLOAT)
 {
 	D3D11_INPUT_ELEMENT_DESC InputElementDesc;
 
 	InputElementDesc.SemanticName = "TEXCOORD";
 	InputElementDesc.SemanticIndex = 0;
-	InputElementDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+	InputElementDesc.Format = Format;
 	InputElementDesc.InputSlot = 0;
 	InputElementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 	InputElementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
@@ -110,6 +110,22 @@ D3D11_INPUT_ELEMENT_DESC SetInstancePosition()
 	return InputElementDesc;
 }
 
+// Matrix row, same layout as LXConstantBufferData1
+D3D11_INPUT_ELEMENT_DESC SetInstanceMatrixRow(const char* SemanticName, UINT Row)
+{
+	D3D11_INPUT_ELEMENT_DESC InputElementDesc;
+
+	InputElementDesc.SemanticName = SemanticName;
+	InputElementDesc.SemanticIndex = Row;
+	InputElementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	InputElementDesc.InputSlot = 1;
+	InputElementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	InputElementDesc.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+	InputElementDesc.InstanceDataStepRate = 1;
+
+	return InputElementDesc;
+}
+
 const LXArrayInputElementDesc& LXInputElementDescD3D11Factory::GetInputElement(int Mask)
 {
 	auto It = MapElements.find(Mask);
@@ -119,6 +135,19 @@ const LXArrayInputElementDesc& LXInputElementDescD3D11Factory::GetInputElement(i
 	LXArrayInputElementDesc& ArrayInputElemenDesc = MapElements[Mask];
 	CHK(ArrayInputElemenDesc.size() == 0);
 
+	// Vertex_Packed*: the tangent is packed with the normal, the binormal is a sign in the position w
+	if (Mask & LX_PRIMITIVE_PACKED)
+	{
+		ArrayInputElemenDesc.push_back(SetPosition(DXGI_FORMAT_R16G16B16A16_UNORM));
+		ArrayInputElemenDesc.push_back(SetNormal((Mask & LX_PRIMITIVE_TANGENTS) ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R16G16_SNORM));
+
+		if (Mask & LX_PRIMITIVE_TEXCOORDS)
+		{
+			ArrayInputElemenDesc.push_back(SetTexcoord(DXGI_FORMAT_R16G16_FLOAT));
+		}
+
+		Mask &= ~(LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TANGENTS | LX_PRIMITIVE_BINORMALS | LX_PRIMITIVE_TEXCOORDS);
+	}
 
 	if (Mask & LX_PRIMITIVE_POSITIONS)
 	{
@@ -150,6 +179,15 @@ const LXArrayInputElementDesc& LXInputElementDescD3D11Factory::GetInputElement(i
 		ArrayInputElemenDesc.push_back(SetInstancePosition());
 	}
 
+	if (Mask & LX_PRIMITIVE_INSTANCEWORLD)
+	{
+		for (UINT Row = 0; Row < 4; Row++)
+			ArrayInputElemenDesc.push_back(SetInstanceMatrixRow("INSTANCEWORLD", Row));
+
+		for (UINT Row = 0; Row < 4; Row++)
+			ArrayInputElemenDesc.push_back(SetInstanceMatrixRow("INSTANCENORMAL", Row));
+	}
+
 	return ArrayInputElemenDesc;
 }
 
@@ -19,7 +19,18 @@ enum class EPrimitiveLayout
 	PN = (LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS),
 	PNT = (LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TEXCOORDS),
 	PNABT = (LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TANGENTS | LX_PRIMITIVE_BINORMALS | LX_PRIMITIVE_TEXCOORDS),
-	PNABTI = (LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TANGENTS | LX_PRIMITIVE_BINORMALS | LX_PRIMITIVE_TEXCOORDS | LX_PRIMITIVE_INSTANCEPOSITIONS)
+	PNABTI = (LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TANGENTS | LX_PRIMITIVE_BINORMALS | LX_PRIMITIVE_TEXCOORDS | LX_PRIMITIVE_INSTANCEPOSITIONS),
+
+	// Packed vertices
+	PackedPN = (PN | LX_PRIMITIVE_PACKED),
+	PackedPNT = (PNT | LX_PRIMITIVE_PACKED),
+	PackedPNABT = (PNABT | LX_PRIMITIVE_PACKED),
+	
+	// Dynamic instancing
+	PW = (P | LX_PRIMITIVE_INSTANCEWORLD),
+	PNW = (PN | LX_PRIMITIVE_INSTANCEWORLD),
+	PNTW = (PNT | LX_PRIMITIVE_INSTANCEWORLD),
+	PNABTW = (PNABT | LX_PRIMITIVE_INSTANCEWORLD)
 };
 
 class LXCORE_API LXInputElementDescD3D11Factory
@@ -71,31 +71,34 @@ void LXMaterialD3D11::Release()
 	ConstantBufferPS.Release();
 }
 
-void LXMaterialD3D11::Render(ERenderPass RenderPass, LXRenderCommandList* RCL)
+void LXMaterialD3D11::PreRender(LXRenderCommandList* RCL)
 {
-	LXRenderer* Renderer = RCL->Renderer;
-
-	// TODO : TMP : Not here: Once in rendering; objects should be valid ! 
 	if (!_bValid)
 	{
 		Create(Material);
 	}
-	
+
 	// ConstantBuffer
 	// if (NeedUpdate
 	//{
 	//RCL->UpdateSubresource4(CBMaterialParemetersVS->D3D11Buffer, &MaterialParameters);
 	//RCL->VSSetConstantBuffers(2, 1, CBMaterialParemetersVS);
 	//}
-	
+
+	if (CBMaterialParemetersPS && ConstantBufferPS.ValueHasChanged)
+	{
+		RCL->UpdateSubresource4(CBMaterialParemetersPS->D3D11Buffer, ConstantBufferPS.GetData());
+		ConstantBufferPS.ValueHasChanged = false;
+	}
+}
+
+void LXMaterialD3D11::Render(ERenderPass RenderPass, LXRenderCommandList* RCL)
+{
+	// Called concurrently by the recording threads: the material is read only here (see PreRender).
+	LXRenderer* Renderer = RCL->Renderer;
+
 	if (CBMaterialParemetersPS)
 	{
-		if (ConstantBufferPS.ValueHasChanged)
-		{
-			// TODO MUTEX
-			RCL->UpdateSubresource4(CBMaterialParemetersPS->D3D11Buffer, ConstantBufferPS.GetData());
-			ConstantBufferPS.ValueHasChanged = false;
-		}
 		RCL->VSSetConstantBuffers((uint)LXConstantBufferSlot::CB_Material_Data, 1, CBMaterialParemetersPS);
 		RCL->PSSetConstantBuffers((uint)LXConstantBufferSlot::CB_Material_Data, 1, CBMaterialParemetersPS);
 	}
@@ -29,6 +29,8 @@ public:
 
 	void Release();
 	//void Invalidate();
+	// Creates the resources and records the constant buffer update, once per frame before the passes.
+	void PreRender(LXRenderCommandList* RCL);
 	void Render(ERenderPass RenderPass, LXRenderCommandList* RCL);
 	void Update(const LXMaterial* Material);
 
@@ -0,0 +1,417 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXMeshSimplifier.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	// The border planes hold the silhouette of the open surfaces
+	const float kBorderWeight = 10.f;
+
+	// Normal deviation cost, relative to the squared edge length
+	const float kNormalWeight = 0.5f;
+
+	uint64 MakeEdgeKey(uint V0, uint V1)
+	{
+		return ((uint64)V0 << 32) | V1;
+	}
+};
+
+void LXMeshSimplifier::TQuadric::AddPlane(const vec3f& Normal, float Distance, float InWeight)
+{
+	a00 += InWeight * Normal.x * Normal.x;
+	a11 += InWeight * Normal.y * Normal.y;
+	a22 += InWeight * Normal.z * Normal.z;
+	a01 += InWeight * Normal.x * Normal.y;
+	a02 += InWeight * Normal.x * Normal.z;
+	a12 += InWeight * Normal.y * Normal.z;
+	b0 += InWeight * Normal.x * Distance;
+	b1 += InWeight * Normal.y * Distance;
+	b2 += InWeight * Normal.z * Distance;
+	c += InWeight * Distance * Distance;
+	Weight += InWeight;
+}
+
+void LXMeshSimplifier::TQuadric::Add(const TQuadric& Quadric)
+{
+	a00 += Quadric.a00; a11 += Quadric.a11; a22 += Quadric.a22;
+	a01 += Quadric.a01; a02 += Quadric.a02; a12 += Quadric.a12;
+	b0 += Quadric.b0; b1 += Quadric.b1; b2 += Quadric.b2;
+	c += Quadric.c;
+	Weight += Quadric.Weight;
+}
+
+float LXMeshSimplifier::TQuadric::GetError(const vec3f& p) const
+{
+	if (Weight <= 0.f)
+		return 0.f;
+
+	const float Error =
+		a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+		2.f * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+		2.f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+	// Mean squared distance to the planes
+	return std::max(0.f, Error / Weight);
+}
+
+LXMeshSimplifier::LXMeshSimplifier(const ArrayVec3f& Positions, const ArrayVec3f& Normals) :_Positions(Positions), _Normals(Normals)
+{
+	const uint VertexCount = (uint)Positions.size();
+
+	// Welds the vertices at the same position: sorted by position, the first one of a run is the reference
+	vector<uint> Order(VertexCount);
+	for (uint i = 0; i < VertexCount; i++)
+		Order[i] = i;
+
+	auto Less = [&Positions](uint a, uint b)
+	{
+		const vec3f& p = Positions[a];
+		const vec3f& q = Positions[b];
+		if (p.x != q.x) return p.x < q.x;
+		if (p.y != q.y) return p.y < q.y;
+		if (p.z != q.z) return p.z < q.z;
+		return a < b;
+	};
+
+	std::sort(Order.begin(), Order.end(), Less);
+
+	_Remap.resize(VertexCount);
+	for (uint i = 0; i < VertexCount; i++)
+	{
+		const uint Vertex = Order[i];
+		const bool Same = i > 0 && Positions[Order[i - 1]].x == Positions[Vertex].x && Positions[Order[i - 1]].y == Positions[Vertex].y && Positions[Order[i - 1]].z == Positions[Vertex].z;
+		_Remap[Vertex] = Same ? _Remap[Order[i - 1]] : Vertex;
+	}
+}
+
+void LXMeshSimplifier::Classify(const ArrayUint& Indices)
+{
+	const uint VertexCount = (uint)_Positions.size();
+
+	_HalfEdges.clear();
+	_HalfEdges.reserve(Indices.size());
+
+	for (uint i = 0; i < (uint)Indices.size(); i += 3)
+	{
+		for (uint j = 0; j < 3; j++)
+		{
+			const uint V0 = _Remap[Indices[i + j]];
+			const uint V1 = _Remap[Indices[i + (j + 1) % 3]];
+			_HalfEdges[MakeEdgeKey(V0, V1)]++;
+		}
+	}
+
+	// Seams: the vertices used at the same position
+	vector<uint> Wedges(VertexCount, UINT_MAX);
+	_Kinds.assign(VertexCount, EVertexKind::Manifold);
+
+	for (uint Index : Indices)
+	{
+		uint& Wedge = Wedges[_Remap[Index]];
+		if (Wedge == UINT_MAX)
+			Wedge = Index;
+		else if (Wedge != Index)
+			_Kinds[_Remap[Index]] = EVertexKind::Locked;
+	}
+
+	// Borders: half-edges without opposite. A manifold border vertex has 2 border edges.
+	vector<uint> BorderEdgeCounts(VertexCount, 0);
+
+	for (const auto& It : _HalfEdges)
+	{
+		const uint V0 = (uint)(It.first >> 32);
+		const uint V1 = (uint)(It.first & 0xFFFFFFFF);
+
+		if (It.second > 1)
+		{
+			_Kinds[V0] = EVertexKind::Locked;
+			_Kinds[V1] = EVertexKind::Locked;
+		}
+		else if (_HalfEdges.find(MakeEdgeKey(V1, V0)) == _HalfEdges.end())
+		{
+			BorderEdgeCounts[V0]++;
+			BorderEdgeCounts[V1]++;
+		}
+	}
+
+	for (uint i = 0; i < VertexCount; i++)
+	{
+		if (BorderEdgeCounts[i] == 0 || _Kinds[i] == EVertexKind::Locked)
+			continue;
+
+		_Kinds[i] = BorderEdgeCounts[i] == 2 ? EVertexKind::Border : EVertexKind::Locked;
+	}
+}
+
+bool LXMeshSimplifier::IsBorderEdge(uint V0, uint V1) const
+{
+	const bool Forward = _HalfEdges.find(MakeEdgeKey(V0, V1)) != _HalfEdges.end();
+	const bool Backward = _HalfEdges.find(MakeEdgeKey(V1, V0)) != _HalfEdges.end();
+	return Forward != Backward;
+}
+
+void LXMeshSimplifier::ComputeQuadrics(const ArrayUint& Indices)
+{
+	_Quadrics.assign(_Positions.size(), TQuadric());
+
+	for (uint i = 0; i < (uint)Indices.size(); i += 3)
+	{
+		const uint V[3] = { _Remap[Indices[i]], _Remap[Indices[i + 1]], _Remap[Indices[i + 2]] };
+		const vec3f& p0 = _Positions[V[0]];
+
+		vec3f Normal = CrossProduct(_Positions[V[1]] - p0, _Positions[V[2]] - p0);
+		const float Length = Normal.Length();
+		if (Length <= 0.f)
+			continue;
+
+		Normal = Normal * (1.f / Length);
+		const float Area = Length * 0.5f;
+
+		TQuadric Quadric;
+		Quadric.AddPlane(Normal, -Dot(Normal, p0), Area);
+
+		for (uint j = 0; j < 3; j++)
+		{
+			_Quadrics[V[j]].Add(Quadric);
+
+			// Plane through the border edge, perpendicular to the triangle
+			const uint V0 = V[j];
+			const uint V1 = V[(j + 1) % 3];
+			if (!IsBorderEdge(V0, V1))
+				continue;
+
+			const vec3f Edge = _Positions[V1] - _Positions[V0];
+			vec3f EdgeNormal = CrossProduct(Edge, Normal);
+			const float EdgeLength = EdgeNormal.Length();
+			if (EdgeLength <= 0.f)
+				continue;
+
+			EdgeNormal = EdgeNormal * (1.f / EdgeLength);
+
+			TQuadric BorderQuadric;
+			BorderQuadric.AddPlane(EdgeNormal, -Dot(EdgeNormal, _Positions[V0]), EdgeLength * EdgeLength * kBorderWeight);
+			_Quadrics[V0].Add(BorderQuadric);
+			_Quadrics[V1].Add(BorderQuadric);
+		}
+	}
+}
+
+void LXMeshSimplifier::BuildAdjacency(const ArrayUint& Indices)
+{
+	const uint VertexCount = (uint)_Positions.size();
+
+	_AdjacencyOffsets.assign(VertexCount + 1, 0);
+	for (uint Index : Indices)
+		_AdjacencyOffsets[_Remap[Index] + 1]++;
+
+	for (uint i = 0; i < VertexCount; i++)
+		_AdjacencyOffsets[i + 1] += _AdjacencyOffsets[i];
+
+	_Adjacency.resize(Indices.size());
+	vector<uint> Cursors(_AdjacencyOffsets.begin(), _AdjacencyOffsets.end() - 1);
+
+	for (uint i = 0; i < (uint)Indices.size(); i++)
+		_Adjacency[Cursors[_Remap[Indices[i]]]++] = i / 3;
+}
+
+bool LXMeshSimplifier::Flips(uint From, const vec3f& Position, uint To, const ArrayUint& Indices) const
+{
+	for (uint i = _AdjacencyOffsets[From]; i < _AdjacencyOffsets[From + 1]; i++)
+	{
+		const uint Triangle = _Adjacency[i] * 3;
+		vec3f p[3];
+		bool Collapsed = false;
+
+		for (uint j = 0; j < 3; j++)
+		{
+			const uint Vertex = _Remap[Indices[Triangle + j]];
+			Collapsed |= Vertex == To;
+			p[j] = _Positions[Vertex];
+		}
+
+		// Removed by the collapse
+		if (Collapsed)
+			continue;
+
+		const vec3f Before = CrossProduct(p[1] - p[0], p[2] - p[0]);
+
+		for (uint j = 0; j < 3; j++)
+		{
+			if (_Remap[Indices[Triangle + j]] == From)
+				p[j] = Position;
+		}
+
+		const vec3f After = CrossProduct(p[1] - p[0], p[2] - p[0]);
+		if (Dot(Before, After) <= 0.f)
+			return true;
+	}
+
+	return false;
+}
+
+void LXMeshSimplifier::RemoveDegenerates(ArrayUint& Indices) const
+{
+	uint Count = 0;
+
+	for (uint i = 0; i < (uint)Indices.size(); i += 3)
+	{
+		const uint V0 = _Remap[Indices[i]];
+		const uint V1 = _Remap[Indices[i + 1]];
+		const uint V2 = _Remap[Indices[i + 2]];
+
+		if (V0 == V1 || V1 == V2 || V2 == V0)
+			continue;
+
+		Indices[Count++] = Indices[i];
+		Indices[Count++] = Indices[i + 1];
+		Indices[Count++] = Indices[i + 2];
+	}
+
+	Indices.resize(Count);
+}
+
+float LXMeshSimplifier::Simplify(const ArrayUint& Indices, uint TargetIndexCount, ArrayUint& OutIndices)
+{
+	CHK(Indices.size() % 3 == 0);
+
+	OutIndices = Indices;
+	RemoveDegenerates(OutIndices);
+
+	Classify(OutIndices);
+	ComputeQuadrics(OutIndices);
+
+	const uint VertexCount = (uint)_Positions.size();
+	const bool HasNormals = _Normals.size() == _Positions.size();
+
+	vector<TCollapse> Collapses;
+	vector<uint8> Touched(VertexCount);
+	vector<uint> Targets(VertexCount);
+	float MaxError = 0.f;
+
+	// Each pass collapses the cheapest edges, at most one per vertex neighborhood
+	while (OutIndices.size() > TargetIndexCount)
+	{
+		BuildAdjacency(OutIndices);
+
+		// Both directions of the edges, the inner edges are seen from one of their triangles
+		Collapses.clear();
+		for (uint i = 0; i < (uint)OutIndices.size(); i++)
+		{
+			const uint From = OutIndices[i];
+			const uint To = OutIndices[i - i % 3 + (i + 1) % 3];
+			const uint V0 = _Remap[From];
+			const uint V1 = _Remap[To];
+
+			// A border edge joins two border or locked vertices
+			const bool MaybeBorder = _Kinds[V0] != EVertexKind::Manifold && _Kinds[V1] != EVertexKind::Manifold;
+			if (V0 > V1 && !(MaybeBorder && IsBorderEdge(V0, V1)))
+				continue;
+
+			for (uint j = 0; j < 2; j++)
+			{
+				const uint Source = j ? To : From;
+				const uint Destination = j ? From : To;
+				const uint SourceVertex = j ? V1 : V0;
+				const uint DestinationVertex = j ? V0 : V1;
+
+				if (_Kinds[SourceVertex] == EVertexKind::Locked)
+					continue;
+
+				if (_Kinds[SourceVertex] == EVertexKind::Border && !(MaybeBorder && IsBorderEdge(SourceVertex, DestinationVertex)))
+					continue;
+
+				float Cost = _Quadrics[SourceVertex].GetError(_Positions[DestinationVertex]);
+				const float Error = Cost;
+
+				if (HasNormals)
+				{
+					const vec3f Edge = _Positions[DestinationVertex] - _Positions[SourceVertex];
+					const float Deviation = 1.f - Dot(_Normals[Source], _Normals[Destination]);
+					Cost += kNormalWeight * Deviation * Dot(Edge, Edge);
+				}
+
+				Collapses.push_back({ Source, Destination, Cost, Error });
+			}
+		}
+
+		if (Collapses.empty())
+			break;
+
+		std::fill(Touched.begin(), Touched.end(), 0);
+		for (uint i = 0; i < VertexCount; i++)
+			Targets[i] = i;
+
+		const uint TriangleGoal = ((uint)OutIndices.size() - TargetIndexCount + 2) / 3;
+		uint RemovedTriangles = 0;
+		uint CollapseCount = 0;
+
+		// The cheapest part only, unless all of them are rejected: the next pass sees the collapsed neighborhoods
+		auto LessCost = [](const TCollapse& a, const TCollapse& b) { return a.Cost < b.Cost; };
+		const uint CandidateCount = std::min((uint)Collapses.size(), std::max(TriangleGoal / 2, (uint)Collapses.size() / 4));
+		std::nth_element(Collapses.begin(), Collapses.begin() + CandidateCount, Collapses.end(), LessCost);
+		std::sort(Collapses.begin(), Collapses.begin() + CandidateCount, LessCost);
+
+		for (uint i = 0; i < (uint)Collapses.size() && RemovedTriangles < TriangleGoal; i++)
+		{
+			if (i == CandidateCount)
+			{
+				if (CollapseCount > 0)
+					break;
+
+				std::sort(Collapses.begin() + CandidateCount, Collapses.end(), LessCost);
+			}
+
+			const TCollapse& Collapse = Collapses[i];
+
+			const uint From = _Remap[Collapse.From];
+			const uint To = _Remap[Collapse.To];
+
+			if (Touched[From] || Touched[To])
+				continue;
+
+			if (Flips(From, _Positions[To], To, OutIndices))
+				continue;
+
+			// The source is the only vertex at its position
+			Targets[Collapse.From] = Collapse.To;
+			_Quadrics[To].Add(_Quadrics[From]);
+			MaxError = std::max(MaxError, Collapse.Error);
+			CollapseCount++;
+
+			// The neighborhood waits the next pass, its adjacency is outdated
+			for (uint a = _AdjacencyOffsets[From]; a < _AdjacencyOffsets[From + 1]; a++)
+			{
+				const uint Triangle = _Adjacency[a] * 3;
+				bool Removed = false;
+
+				for (uint j = 0; j < 3; j++)
+				{
+					const uint Vertex = _Remap[OutIndices[Triangle + j]];
+					Touched[Vertex] = 1;
+					Removed |= Vertex == To;
+				}
+
+				if (Removed)
+					RemovedTriangles++;
+			}
+		}
+
+		if (CollapseCount == 0)
+			break;
+
+		for (uint& Index : OutIndices)
+			Index = Targets[Index];
+
+		RemoveDegenerates(OutIndices);
+	}
+
+	return sqrtf(MaxError);
+}
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXVec3.h"
+
+//
+// Triangle list simplification by edge collapses, ordered by quadric error (Garland-Heckbert).
+// A vertex collapses onto one of its neighbors, so the simplified indices use the input vertices and
+// keep their attributes. The attribute seams (several vertices at the same position) and the
+// non-manifold vertices are locked, the borders only collapse along themselves. The normal
+// deviation is added to the cost, the collapses flipping a triangle are rejected.
+//
+
+class LXMeshSimplifier
+{
+
+public:
+
+	// Normals can be empty
+	LXMeshSimplifier(const ArrayVec3f& Positions, const ArrayVec3f& Normals);
+
+	// Collapses the triangles of Indices down to TargetIndexCount, or less when the locked vertices stop it.
+	// Returns the geometric error: the deviation from the input surface, in the position unit.
+	float Simplify(const ArrayUint& Indices, uint TargetIndexCount, ArrayUint& OutIndices);
+
+private:
+
+	enum class EVertexKind : uint8
+	{
+		Manifold,
+		Border,
+		Locked
+	};
+
+	// Plane squared distances, area weighted: p'Ap + 2b'p + c
+	struct TQuadric
+	{
+		float a00 = 0.f, a11 = 0.f, a22 = 0.f, a01 = 0.f, a02 = 0.f, a12 = 0.f;
+		float b0 = 0.f, b1 = 0.f, b2 = 0.f;
+		float c = 0.f;
+		float Weight = 0.f;
+
+		void AddPlane(const vec3f& Normal, float Distance, float InWeight);
+		void Add(const TQuadric& Quadric);
+		float GetError(const vec3f& Position) const;
+	};
+
+	struct TCollapse
+	{
+		uint From;
+		uint To;
+		float Cost;
+		float Error;
+	};
+
+	void Classify(const ArrayUint& Indices);
+	void ComputeQuadrics(const ArrayUint& Indices);
+	void BuildAdjacency(const ArrayUint& Indices);
+	bool IsBorderEdge(uint V0, uint V1) const;
+	bool Flips(uint From, const vec3f& Position, uint To, const ArrayUint& Indices) const;
+	void RemoveDegenerates(ArrayUint& Indices) const;
+
+private:
+
+	const ArrayVec3f& _Positions;
+	const ArrayVec3f& _Normals;
+
+	// First vertex at the same position
+	vector<uint> _Remap;
+
+	// Per remapped vertex
+	vector<EVertexKind> _Kinds;
+	vector<TQuadric> _Quadrics;
+
+	// Half-edges between remapped vertices, with their count
+	unordered_map<uint64, uint> _HalfEdges;
+
+	// Triangles of the remapped vertices
+	vector<uint> _AdjacencyOffsets;
+	vector<uint> _Adjacency;
+};
@@ -0,0 +1,404 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXOcclusionCulling.h"
+#include "LXFrustum.h"
+#include "LXThreadManager.h"
+#include <immintrin.h>
+#include "LXMemory.h" // --- Must be the last included ---
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define LX_OCCLUSION_SSE 1
+#endif
+
+namespace
+{
+	const uint kTileWidth = 8;
+	const uint kTileHeight = 4;
+	const uint kTileFullMask = 0xFFFFFFFF;
+	const uint kCullBoxesBatch = 256;
+
+	// ZMax1 of an empty working layer: the near plane
+	const float kEmptyLayer = -1.f;
+
+	struct TClipVertex
+	{
+		float X, Y, Z, W;
+	};
+
+	inline TClipVertex Transform(const LXMatrix& Matrix, float x, float y, float z)
+	{
+		const float* m = Matrix.GetPtr();
+		TClipVertex v;
+		v.X = m[0] * x + m[4] * y + m[8] * z + m[12];
+		v.Y = m[1] * x + m[5] * y + m[9] * z + m[13];
+		v.Z = m[2] * x + m[6] * y + m[10] * z + m[14];
+		v.W = m[3] * x + m[7] * y + m[11] * z + m[15];
+		return v;
+	}
+
+	inline uint ClampTile(float Coordinate, uint TileSize, uint TileCount)
+	{
+		const int Tile = (int)floorf(Coordinate / TileSize);
+		return (uint)min(max(Tile, 0), (int)TileCount - 1);
+	}
+};
+
+// Edge functions E(x, y) = A * x + B * y + C, positive inside, and depth plane Z(x, y) = ZA * x + ZB * y + ZC
+struct LXOcclusionCulling::TTriangle
+{
+	float EdgeA[3];
+	float EdgeB[3];
+	float EdgeC[3];
+	float ZA, ZB, ZC;
+	float ZMax;
+	uint MinTileX, MaxTileX;
+	uint MinTileY, MaxTileY;
+};
+
+struct LXOcclusionCulling::TOccluder
+{
+	const vec3f* Positions = nullptr;
+	uint PositionCount = 0;
+	const uint* Indices = nullptr;
+	uint IndexCount = 0;
+	LXMatrix MatrixWVP;
+	vector<TTriangle> Triangles;
+};
+
+LXOcclusionCulling::LXOcclusionCulling(uint Width, uint Height):
+	_Width(Width),
+	_Height(Height),
+	_TilesX(Width / kTileWidth),
+	_TilesY(Height / kTileHeight)
+{
+	CHK(Width % kTileWidth == 0 && Height % kTileHeight == 0);
+
+	const uint TileCount = _TilesX * _TilesY;
+	_ZMax0.resize(TileCount);
+	_ZMax1.resize(TileCount);
+	_Masks.resize(TileCount);
+}
+
+LXOcclusionCulling::~LXOcclusionCulling()
+{
+}
+
+void LXOcclusionCulling::Begin(const LXMatrix& MatrixVP)
+{
+	_MatrixVP = MatrixVP;
+	_OccluderCount = 0;
+	_TriangleCount = 0;
+
+	std::fill(_ZMax0.begin(), _ZMax0.end(), FLT_MAX);
+	std::fill(_ZMax1.begin(), _ZMax1.end(), kEmptyLayer);
+	std::fill(_Masks.begin(), _Masks.end(), 0);
+}
+
+void LXOcclusionCulling::AddOccluder(const vec3f* Positions, uint PositionCount, const uint* Indices, uint IndexCount, const LXMatrix& MatrixWorld)
+{
+	if (_OccluderCount == _Occluders.size())
+		_Occluders.push_back(make_unique<TOccluder>());
+
+	TOccluder* Occluder = _Occluders[_OccluderCount++].get();
+	Occluder->Positions = Positions;
+	Occluder->PositionCount = PositionCount;
+	Occluder->Indices = Indices;
+	Occluder->IndexCount = Indices ? IndexCount : PositionCount;
+	Occluder->MatrixWVP = _MatrixVP * MatrixWorld;
+	Occluder->Triangles.clear();
+}
+
+void LXOcclusionCulling::Rasterize()
+{
+	if (_OccluderCount == 0)
+		return;
+
+	ParallelFor(_OccluderCount, [this](uint i)
+	{
+		SetupTriangles(*_Occluders[i]);
+	});
+
+	for (uint i = 0; i < _OccluderCount; i++)
+	{
+		_TriangleCount += (uint)_Occluders[i]->Triangles.size();
+	}
+
+	// A tile row is written by a single task
+	ParallelFor(_TilesY, [this](uint TileY)
+	{
+		RasterizeTileRow(TileY);
+	});
+}
+
+void LXOcclusionCulling::SetupTriangles(TOccluder& Occluder) const
+{
+	thread_local vector<TClipVertex> Vertices;
+	Vertices.resize(Occluder.PositionCount);
+
+	for (uint i = 0; i < Occluder.PositionCount; i++)
+	{
+		const vec3f& Position = Occluder.Positions[i];
+		Vertices[i] = Transform(Occluder.MatrixWVP, Position.x, Position.y, Position.z);
+	}
+
+	const float HalfWidth = 0.5f * _Width;
+	const float HalfHeight = 0.5f * _Height;
+
+	for (uint i = 0; i + 2 < Occluder.IndexCount; i += 3)
+	{
+		float X[3], Y[3], Z[3];
+		bool Clipped = false;
+
+		for (uint j = 0; j < 3; j++)
+		{
+			const uint Index = Occluder.Indices ? Occluder.Indices[i + j] : i + j;
+			if (Index >= Occluder.PositionCount)
+			{
+				Clipped = true;
+				break;
+			}
+
+			// The triangles crossing the near plane are skipped: fewer occluders is conservative
+			const TClipVertex& v = Vertices[Index];
+			if (v.W <= 0.f || v.Z < -v.W)
+			{
+				Clipped = true;
+				break;
+			}
+
+			const float InvW = 1.f / v.W;
+			X[j] = (v.X * InvW + 1.f) * HalfWidth;
+			Y[j] = (v.Y * InvW + 1.f) * HalfHeight;
+			Z[j] = v.Z * InvW;
+		}
+
+		if (Clipped)
+			continue;
+
+		const float Area = (X[1] - X[0]) * (Y[2] - Y[0]) - (X[2] - X[0]) * (Y[1] - Y[0]);
+		if (fabsf(Area) < 1e-6f)
+			continue;
+
+		const float MinX = min(X[0], min(X[1], X[2]));
+		const float MaxX = max(X[0], max(X[1], X[2]));
+		const float MinY = min(Y[0], min(Y[1], Y[2]));
+		const float MaxY = max(Y[0], max(Y[1], Y[2]));
+
+		if (MaxX < 0.f || MaxY < 0.f || MinX >= _Width || MinY >= _Height)
+			continue;
+
+		TTriangle Triangle;
+
+		// Both windings: the occluders are not assumed closed
+		const float Sign = Area > 0.f ? 1.f : -1.f;
+		for (uint j = 0; j < 3; j++)
+		{
+			const uint k = (j + 1) % 3;
+			Triangle.EdgeA[j] = Sign * (Y[j] - Y[k]);
+			Triangle.EdgeB[j] = Sign * (X[k] - X[j]);
+			Triangle.EdgeC[j] = Sign * (X[j] * Y[k] - X[k] * Y[j]);
+		}
+
+		Triangle.ZA = ((Z[1] - Z[0]) * (Y[2] - Y[0]) - (Z[2] - Z[0]) * (Y[1] - Y[0])) / Area;
+		Triangle.ZB = ((Z[2] - Z[0]) * (X[1] - X[0]) - (Z[1] - Z[0]) * (X[2] - X[0])) / Area;
+		Triangle.ZC = Z[0] - Triangle.ZA * X[0] - Triangle.ZB * Y[0];
+		Triangle.ZMax = max(Z[0], max(Z[1], Z[2]));
+
+		Triangle.MinTileX = ClampTile(MinX, kTileWidth, _TilesX);
+		Triangle.MaxTileX = ClampTile(MaxX, kTileWidth, _TilesX);
+		Triangle.MinTileY = ClampTile(MinY, kTileHeight, _TilesY);
+		Triangle.MaxTileY = ClampTile(MaxY, kTileHeight, _TilesY);
+
+		Occluder.Triangles.push_back(Triangle);
+	}
+}
+
+void LXOcclusionCulling::RasterizeTileRow(uint TileY)
+{
+	// Pixel centers
+	const float RowY = TileY * kTileHeight + 0.5f;
+
+#if LX_OCCLUSION_SSE
+	const __m128 Zero = _mm_setzero_ps();
+	const __m128 OffsetsLo = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 OffsetsHi = _mm_setr_ps(4.5f, 5.5f, 6.5f, 7.5f);
+#endif
+
+	for (uint i = 0; i < _OccluderCount; i++)
+	{
+		for (const TTriangle& Triangle : _Occluders[i]->Triangles)
+		{
+			if (TileY < Triangle.MinTileY || TileY > Triangle.MaxTileY)
+				continue;
+
+			for (uint TileX = Triangle.MinTileX; TileX <= Triangle.MaxTileX; TileX++)
+			{
+				const float TileLeft = (float)(TileX * kTileWidth);
+				uint Mask = kTileFullMask;
+
+#if LX_OCCLUSION_SSE
+				const __m128 XLo = _mm_add_ps(_mm_set1_ps(TileLeft), OffsetsLo);
+				const __m128 XHi = _mm_add_ps(_mm_set1_ps(TileLeft), OffsetsHi);
+
+				for (uint j = 0; j < 3 && Mask; j++)
+				{
+					const __m128 A = _mm_set1_ps(Triangle.EdgeA[j]);
+					const __m128 StepY = _mm_set1_ps(Triangle.EdgeB[j]);
+					__m128 RowC = _mm_set1_ps(Triangle.EdgeB[j] * RowY + Triangle.EdgeC[j]);
+					__m128 EdgeLo = _mm_add_ps(_mm_mul_ps(A, XLo), RowC);
+					__m128 EdgeHi = _mm_add_ps(_mm_mul_ps(A, XHi), RowC);
+
+					uint EdgeMask = 0;
+					for (uint Row = 0; Row < kTileHeight; Row++)
+					{
+						const uint Lo = (uint)_mm_movemask_ps(_mm_cmpge_ps(EdgeLo, Zero));
+						const uint Hi = (uint)_mm_movemask_ps(_mm_cmpge_ps(EdgeHi, Zero));
+						EdgeMask |= (Lo | (Hi << 4)) << (Row * kTileWidth);
+						EdgeLo = _mm_add_ps(EdgeLo, StepY);
+						EdgeHi = _mm_add_ps(EdgeHi, StepY);
+					}
+
+					Mask &= EdgeMask;
+				}
+#else
+				Mask = 0;
+				for (uint Row = 0; Row < kTileHeight; Row++)
+				{
+					for (uint Column = 0; Column < kTileWidth; Column++)
+					{
+						const float x = TileLeft + Column + 0.5f;
+						const float y = RowY + Row;
+						bool Inside = true;
+						for (uint j = 0; j < 3; j++)
+						{
+							Inside &= Triangle.EdgeA[j] * x + Triangle.EdgeB[j] * y + Triangle.EdgeC[j] >= 0.f;
+						}
+						Mask |= (uint)Inside << (Row * kTileWidth + Column);
+					}
+				}
+#endif
+
+				if (Mask)
+				{
+					UpdateTile(TileY * _TilesX + TileX, Triangle, Mask, TileLeft + 0.5f, RowY);
+				}
+			}
+		}
+	}
+}
+
+void LXOcclusionCulling::UpdateTile(uint TileIndex, const TTriangle& Triangle, uint Mask, float TileX, float TileY)
+{
+	// Triangle far depth over the tile samples: the depth plane at the farthest corner
+	const float X = Triangle.ZA > 0.f ? TileX + kTileWidth - 1 : TileX;
+	const float Y = Triangle.ZB > 0.f ? TileY + kTileHeight - 1 : TileY;
+	const float TileZ = min(Triangle.ZMax, Triangle.ZA * X + Triangle.ZB * Y + Triangle.ZC);
+
+	float& ZMax0 = _ZMax0[TileIndex];
+	float& ZMax1 = _ZMax1[TileIndex];
+	uint& TileMask = _Masks[TileIndex];
+
+	// Behind the covered layer
+	if (TileZ >= ZMax0)
+		return;
+
+	// The triangle is nearer than the working layer by more than the layers are apart: restart the layer with it
+	if (ZMax1 - TileZ > ZMax0 - ZMax1)
+	{
+		ZMax1 = kEmptyLayer;
+		TileMask = 0;
+	}
+
+	ZMax1 = max(ZMax1, TileZ);
+	TileMask |= Mask;
+
+	if (TileMask == kTileFullMask)
+	{
+		ZMax0 = ZMax1;
+		ZMax1 = kEmptyLayer;
+		TileMask = 0;
+	}
+}
+
+bool LXOcclusionCulling::IsBoxVisible(const vec3f& Min, const vec3f& Max) const
+{
+	float MinX = FLT_MAX, MinY = FLT_MAX, MinZ = FLT_MAX;
+	float MaxX = -FLT_MAX, MaxY = -FLT_MAX;
+
+	for (uint i = 0; i < 8; i++)
+	{
+		const TClipVertex v = Transform(_MatrixVP, i & 1 ? Max.x : Min.x, i & 2 ? Max.y : Min.y, i & 4 ? Max.z : Min.z);
+
+		// Crossing the near plane
+		if (v.W <= 0.f || v.Z < -v.W)
+			return true;
+
+		const float InvW = 1.f / v.W;
+		const float x = v.X * InvW;
+		const float y = v.Y * InvW;
+		MinX = min(MinX, x); MaxX = max(MaxX, x);
+		MinY = min(MinY, y); MaxY = max(MaxY, y);
+		MinZ = min(MinZ, v.Z * InvW);
+	}
+
+	const uint MinTileX = ClampTile((MinX + 1.f) * 0.5f * _Width, kTileWidth, _TilesX);
+	const uint MaxTileX = ClampTile((MaxX + 1.f) * 0.5f * _Width, kTileWidth, _TilesX);
+	const uint MinTileY = ClampTile((MinY + 1.f) * 0.5f * _Height, kTileHeight, _TilesY);
+	const uint MaxTileY = ClampTile((MaxY + 1.f) * 0.5f * _Height, kTileHeight, _TilesY);
+
+	// Visible when a tile is not covered in front of the box
+	for (uint TileY = MinTileY; TileY <= MaxTileY; TileY++)
+	{
+		const float* ZMax0 = &_ZMax0[TileY * _TilesX];
+		uint TileX = MinTileX;
+
+#if LX_OCCLUSION_SSE
+		const __m128 BoxZ = _mm_set1_ps(MinZ);
+		for (; TileX + 4 <= MaxTileX + 1; TileX += 4)
+		{
+			if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(ZMax0 + TileX), BoxZ)))
+				return true;
+		}
+#endif
+
+		for (; TileX <= MaxTileX; TileX++)
+		{
+			if (ZMax0[TileX] > MinZ)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+uint LXOcclusionCulling::CullBoxes(const TFrustumBoxes& Boxes, vector<uint>& Indices) const
+{
+	const uint Count = (uint)Indices.size();
+	if (Count == 0 || _OccluderCount == 0)
+		return 0;
+
+	vector<uint8> Visibles(Count);
+
+	ParallelFor(Count, kCullBoxesBatch, [this, &Boxes, &Indices, &Visibles](uint i)
+	{
+		const uint Index = Indices[i];
+		Visibles[i] = IsBoxVisible(vec3f(Boxes.MinX[Index], Boxes.MinY[Index], Boxes.MinZ[Index]), vec3f(Boxes.MaxX[Index], Boxes.MaxY[Index], Boxes.MaxZ[Index]));
+	});
+
+	uint VisibleCount = 0;
+	for (uint i = 0; i < Count; i++)
+	{
+		if (Visibles[i])
+			Indices[VisibleCount++] = Indices[i];
+	}
+
+	Indices.resize(VisibleCount);
+	return Count - VisibleCount;
+}
@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXMatrix.h"
+#include "LXVec3.h"
+
+struct TFrustumBoxes;
+
+//
+// CPU occlusion culling with a masked depth buffer (Hasselgren et al., Masked Software Occlusion Culling).
+// The occluder triangles are rasterized in a low resolution buffer of 8x4 pixel tiles, 4 pixels per SSE operation.
+// A tile keeps the far depth of its fully covered pixels (ZMax0) and a working layer merging the partial
+// coverages (ZMax1, Mask) until it covers the tile. The boxes are tested against ZMax0 of the tiles they overlap.
+// Depths are NDC z, greater is farther.
+//
+
+class LXOcclusionCulling
+{
+
+public:
+
+	LXOcclusionCulling(uint Width = 320, uint Height = 192);
+	~LXOcclusionCulling();
+
+	// Clears the buffer and the occluders
+	void Begin(const LXMatrix& MatrixVP);
+
+	// Triangle list, by Indices or by Positions without Indices. The arrays must live until Rasterize.
+	void AddOccluder(const vec3f* Positions, uint PositionCount, const uint* Indices, uint IndexCount, const LXMatrix& MatrixWorld);
+
+	// Rasterizes the occluders on the worker threads, in the order they were added: front to back is the best.
+	void Rasterize();
+
+	// False when the box is hidden by the occluders
+	bool IsBoxVisible(const vec3f& Min, const vec3f& Max) const;
+
+	// Removes the indices of the hidden boxes, in parallel. Returns the removed count.
+	uint CullBoxes(const TFrustumBoxes& Boxes, vector<uint>& Indices) const;
+
+	uint GetWidth() const { return _Width; }
+	uint GetHeight() const { return _Height; }
+	uint GetOccluderCount() const { return _OccluderCount; }
+	uint GetTriangleCount() const { return _TriangleCount; }
+
+private:
+
+	struct TTriangle;
+	struct TOccluder;
+
+	void SetupTriangles(TOccluder& Occluder) const;
+	void RasterizeTileRow(uint TileY);
+	void UpdateTile(uint TileIndex, const TTriangle& Triangle, uint Mask, float TileX, float TileY);
+
+private:
+
+	uint _Width;
+	uint _Height;
+	uint _TilesX;
+	uint _TilesY;
+
+	LXMatrix _MatrixVP;
+	vector<unique_ptr<TOccluder>> _Occluders;	// Kept from a frame to the next, for their triangle arrays
+	uint _OccluderCount = 0;
+	uint _TriangleCount = 0;
+
+	// Per tile
+	vector<float> _ZMax0;
+	vector<float> _ZMax1;
+	vector<uint> _Masks;
+};
@@ -25,6 +25,9 @@
 #include "LXPrimitive.h"
 #include "LXMaterial.h"
 #include "LXStatistic.h"
+#include "LXProject.h"
+#include "LXAssetManager.h"
+#include "LXAssetMesh.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
 LXPickTraverser::LXPickTraverser(void)
@@ -339,6 +342,10 @@ void LXPickTraverser::PickPrimitive(LXActor* pMesh, LXPrimitive* pPrimitive, LXM
 		
 	if (LXActorMesh* ActorMesh = dynamic_cast<LXActorMesh*>(pMesh))
 	{
+		// The arrays are read: loaded again when released
+		if (LXAssetMesh* AssetMesh = ActorMesh->GetAssetMesh())
+			GetCore().GetProject()->GetAssetManager().UseAsset(AssetMesh);
+
 		if (ActorMesh->GetArrayInstancePosition().size() > 0)
 		{
 			for (const vec3f& Position : ActorMesh->GetArrayInstancePosition())
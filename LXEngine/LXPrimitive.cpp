@@ -16,11 +16,84 @@
 #include "LXMath.h"
 #include "LXAssetManager.h"
 #include "LXAssetMesh.h"
+#include "LXConsoleManager.h"
 #include "LXMaterial.h"
+#include "LXMeshSimplifier.h"
 #include "LXPrimitiveFactory.h"
 #include "LXStatistic.h"
+#include "LXVertexCacheOptimizer.h"
+#include <DirectXPackedVector.h>
 #include "LXMemory.h" // --- Must be the last included ---
 
+namespace
+{
+	// LOD chain generation
+	const uint kLODMaxCount = 6;
+	const uint kLODMinTriangles = 256;
+	const float kLODMinReduction = 0.75f;	// Stalled above this triangle ratio
+
+	// Index optimization
+	const uint kVertexCacheSize = 16;		// Reported ACMR/ATVR
+	const float kOverdrawThreshold = 1.05f;	// Cluster ACMR tolerance
+
+	LXConsoleCommandT<bool> CSet_OptimizeOverdraw(L"Engine.ini", L"Import", L"OptimizeOverdraw", L"false");
+
+	uint16 PackUnorm16(float Value)
+	{
+		return (uint16)(Clamp(Value, 0.f, 1.f) * 65535.f + 0.5f);
+	}
+
+	int16 PackSnorm16(float Value)
+	{
+		return (int16)roundf(Clamp(Value, -1.f, 1.f) * 32767.f);
+	}
+
+	// Octahedral mapping of a unit vector in [-1,1]^2, the lower hemisphere folded on the corners
+	void PackOctahedron(const vec3f& v, int16* Out)
+	{
+		const float L1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+		float x = L1 > 0.f ? v.x / L1 : 0.f;
+		float y = L1 > 0.f ? v.y / L1 : 0.f;
+
+		if (v.z < 0.f)
+		{
+			const float FoldedX = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+			const float FoldedY = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+			x = FoldedX;
+			y = FoldedY;
+		}
+
+		Out[0] = PackSnorm16(x);
+		Out[1] = PackSnorm16(y);
+	}
+
+	void PackPosition(const vec3f& Position, const vec3f& Offset, float InvScale, float BinormalSign, uint16* Out)
+	{
+		Out[0] = PackUnorm16((Position.x - Offset.x) * InvScale);
+		Out[1] = PackUnorm16((Position.y - Offset.y) * InvScale);
+		Out[2] = PackUnorm16((Position.z - Offset.z) * InvScale);
+		Out[3] = BinormalSign < 0.f ? 0 : 65535;
+	}
+
+	void PackTexCoord(const vec2f& TexCoord, uint16* Out)
+	{
+		Out[0] = DirectX::PackedVector::XMConvertFloatToHalf(TexCoord.x);
+		Out[1] = DirectX::PackedVector::XMConvertFloatToHalf(TexCoord.y);
+	}
+
+	template<class T>
+	void RemapVertices(vector<T>& Array, const ArrayUint& Remap)
+	{
+		if (Array.size() != Remap.size())
+			return;
+
+		vector<T> Remapped(Array.size());
+		for (size_t i = 0; i < Array.size(); i++)
+			Remapped[Remap[i]] = Array[i];
+		Array.swap(Remapped);
+	}
+};
+
 int LXPrimitive::m_snPrimitives = 0;
 int LXPrimitive::m_snPoints = 0;
 
@@ -50,6 +123,9 @@ LXPrimitive::LXPrimitive(const LXPrimitive& primitive) :
 	m_arrayBiNormals = primitive.m_arrayBiNormals;
 	m_arrayTexCoords = primitive.m_arrayTexCoords;
 	m_arrayTexCoords3f = primitive.m_arrayTexCoords3f;
+	m_arrayLODs = primitive.m_arrayLODs;
+	m_bOptimized = primitive.m_bOptimized;
+	m_bLODsGenerated = primitive.m_bLODsGenerated;
 	_Topology = primitive._Topology;
 	m_pMaterial = primitive.m_pMaterial;
 	DefineProperties();
@@ -76,9 +152,62 @@ void LXPrimitive::Empty()
 	m_arrayBiNormals.clear();
 	m_arrayTexCoords.clear();
 	m_arrayTexCoords3f.clear();
+	m_arrayLODs.clear();
+	m_bOptimized = false;
+	m_bLODsGenerated = false;
 	m_bValid = false;
 }
 
+uint64 LXPrimitive::GetMemorySize() const
+{
+	uint64 Size = m_arrayIndices.capacity() * sizeof(uint);
+	Size += m_arrayPositions.capacity() * sizeof(vec3f);
+	Size += m_arrayPositions4f.capacity() * sizeof(vec4f);
+	Size += m_arrayNormals.capacity() * sizeof(vec3f);
+	Size += m_arrayTangents.capacity() * sizeof(vec3f);
+	Size += m_arrayBiNormals.capacity() * sizeof(vec3f);
+	Size += m_arrayTexCoords.capacity() * sizeof(vec2f);
+	Size += m_arrayTexCoords3f.capacity() * sizeof(vec3f);
+	
+	for (const TPrimitiveLOD& LOD : m_arrayLODs)
+		Size += LOD.Indices.capacity() * sizeof(uint);
+
+	return Size;
+}
+
+void LXPrimitive::ReleaseArrays()
+{
+	// Computed while the positions are there
+	GetBBoxLocal();
+
+	// Swapped: clear keeps the capacity
+	ArrayUint().swap(m_arrayIndices);
+	ArrayVec3f().swap(m_arrayPositions);
+	ArrayVec4f().swap(m_arrayPositions4f);
+	ArrayVec3f().swap(m_arrayNormals);
+	ArrayVec3f().swap(m_arrayTangents);
+	ArrayVec3f().swap(m_arrayBiNormals);
+	ArrayVec2f().swap(m_arrayTexCoords);
+	ArrayVec3f().swap(m_arrayTexCoords3f);
+	ArrayPrimitiveLODs().swap(m_arrayLODs);
+}
+
+void LXPrimitive::SwapGeometry(TPrimitiveGeometry& Geometry)
+{
+	std::swap(_Topology, Geometry.Topology);
+	m_arrayIndices.swap(Geometry.Indices);
+	m_arrayPositions.swap(Geometry.Positions);
+	m_arrayPositions4f.swap(Geometry.Positions4f);
+	m_arrayNormals.swap(Geometry.Normals);
+	m_arrayTangents.swap(Geometry.Tangents);
+	m_arrayBiNormals.swap(Geometry.BiNormals);
+	m_arrayTexCoords.swap(Geometry.TexCoords);
+	m_arrayTexCoords3f.swap(Geometry.TexCoords3f);
+	m_arrayLODs.swap(Geometry.LODs);
+	std::swap(m_bOptimized, Geometry.Optimized);
+	std::swap(m_bLODsGenerated, Geometry.LODsGenerated);
+}
+
 /*virtual*/
 void LXPrimitive::DefineProperties( ) 
 {
@@ -179,6 +308,9 @@ bool LXPrimitive::Save( const TSaveContext& saveContext )
 	LXAssetMesh* AssetMesh = dynamic_cast<LXAssetMesh*>(saveContext.Owner);
 	CHK(AssetMesh);
 	LXFile* pGeometryFile = AssetMesh->GetGeometryFile();
+
+	if (!m_bOptimized)
+		OptimizeIndices();
 	
 	if (pGeometryFile == nullptr)
 		return false;
@@ -287,9 +419,127 @@ bool LXPrimitive::Save( const TSaveContext& saveContext )
 		pGeometryFile->Write((void*)&(m_arrayBiNormals[0]), fileTag.nCount);
 	}
 
+	// LODs
+	for (const TPrimitiveLOD& LOD : m_arrayLODs)
+	{
+		TFileTag fileTag;
+		fileTag.nId = -1;
+		fileTag.eDataTarget = LX_LODINDICES;
+		fileTag.eDataType = LX_VEC3UI;
+		fileTag.eMode = LX_MODE_UNDEFINED;
+		fileTag.nCount = (uint)(sizeof(float) + sizeof(uint) * LOD.Indices.size());
+		pGeometryFile->Write((void*)&fileTag, sizeof(TFileTag));
+		pGeometryFile->Write((void*)&LOD.Error, sizeof(float));
+		pGeometryFile->Write((void*)&(LOD.Indices[0]), fileTag.nCount - sizeof(float));
+	}
+
 	return true;
 }
 
+void LXPrimitive::GenerateLODs()
+{
+	TPrimitiveGeometry Geometry;
+	SwapGeometry(Geometry);
+	Geometry.GenerateLODs();
+	SwapGeometry(Geometry);
+}
+
+void LXPrimitive::OptimizeIndices()
+{
+	TPrimitiveGeometry Geometry;
+	SwapGeometry(Geometry);
+	Geometry.OptimizeIndices();
+	SwapGeometry(Geometry);
+
+	m_bValid = false;
+}
+
+void TPrimitiveGeometry::GenerateLODs()
+{
+	LODs.clear();
+	LODsGenerated = true;
+
+	const uint TriangleCount = (uint)Indices.size() / 3;
+	if (Topology != LX_TRIANGLES || Positions.empty() || TriangleCount < kLODMinTriangles * 2)
+		return;
+
+	LXBBox BBox;
+	for (const vec3f& Position : Positions)
+		BBox.Add(Position);
+
+	const float Diagonal = BBox.GetSize().Length();
+	if (Diagonal <= 0.f)
+		return;
+
+	LXMeshSimplifier MeshSimplifier(Positions, Normals);
+	LODs.reserve(kLODMaxCount);
+
+	float Error = 0.f;
+
+	while (LODs.size() < kLODMaxCount)
+	{
+		const ArrayUint& Source = LODs.empty() ? Indices : LODs.back().Indices;
+		const uint SourceCount = (uint)Source.size();
+		if (SourceCount / 3 < kLODMinTriangles * 2)
+			break;
+
+		TPrimitiveLOD LOD;
+
+		// Simplified from the previous LOD, the errors add up
+		Error += MeshSimplifier.Simplify(Source, SourceCount / 6 * 3, LOD.Indices);
+
+		if (LOD.Indices.empty() || LOD.Indices.size() > SourceCount * kLODMinReduction)
+			break;
+
+		LOD.Error = Error / Diagonal;
+		LODs.push_back(move(LOD));
+	}
+}
+
+void TPrimitiveGeometry::OptimizeIndices()
+{
+	const uint VertexCount = GetVertices();
+	if (Topology != LX_TRIANGLES || Indices.empty() || VertexCount == 0)
+		return;
+
+	const TVertexCacheStats Before = LXVertexCacheOptimizer::AnalyzeVertexCache(Indices, VertexCount, kVertexCacheSize);
+
+	LXVertexCacheOptimizer::OptimizeVertexCache(Indices, VertexCount);
+
+	if (CSet_OptimizeOverdraw.GetValue() && Positions.size() == VertexCount)
+		LXVertexCacheOptimizer::OptimizeOverdraw(Indices, Positions, kOverdrawThreshold);
+
+	for (TPrimitiveLOD& LOD : LODs)
+		LXVertexCacheOptimizer::OptimizeVertexCache(LOD.Indices, VertexCount);
+
+	// The LODs use a subset of the LOD 0 vertices
+	ArrayUint Remap;
+	LXVertexCacheOptimizer::OptimizeVertexFetch(Indices, VertexCount, Remap);
+
+	for (uint& Index : Indices)
+		Index = Remap[Index];
+
+	for (TPrimitiveLOD& LOD : LODs)
+	{
+		for (uint& Index : LOD.Indices)
+			Index = Remap[Index];
+	}
+
+	RemapVertices(Positions, Remap);
+	RemapVertices(Positions4f, Remap);
+	RemapVertices(Normals, Remap);
+	RemapVertices(Tangents, Remap);
+	RemapVertices(BiNormals, Remap);
+	RemapVertices(TexCoords, Remap);
+	RemapVertices(TexCoords3f, Remap);
+
+	const TVertexCacheStats After = LXVertexCacheOptimizer::AnalyzeVertexCache(Indices, VertexCount, kVertexCacheSize);
+
+	LogI(Primitive, L"Optimized %u triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", (uint)Indices.size() / 3, Before.ACMR, After.ACMR, Before.ATVR, After.ATVR);
+
+	Optimized = true;
+}
+
 void LXPrimitive::ComputeBBoxLocal()
 {
 	m_bboxLocal.Reset();
@@ -934,6 +1184,11 @@ bool LXPrimitive::Merge(const LXPrimitive& v)
 		
 	MergeIndices(m_arrayIndices, pSource->m_arrayIndices);
 
+	// Outdated, to generate again
+	m_arrayLODs.clear();
+	m_bOptimized = false;
+	m_bLODsGenerated = false;
+
 	m_arrayPositions += pSource->m_arrayPositions;
 	m_arrayNormals += pSource->m_arrayNormals;
 	m_arrayTangents += pSource->m_arrayTangents;
@@ -1082,6 +1337,15 @@ int LXPrimitive::GetMask() const
 	return Mask;
 }
 
+void LXPrimitive::GetPackedPositionTransform(vec3f& OutOffset, float& OutScale)
+{
+	const LXBBox& BBox = GetBBoxLocal();
+
+	// A cube keeps the World scale uniform, so the normals need no correction
+	OutOffset = BBox.GetMin();
+	OutScale = max(max(BBox.GetSizeX(), BBox.GetSizeY()), max(BBox.GetSizeZ(), 1e-4f));
+}
+
 void* LXPrimitive::CreateInterleavedVertexArray(const int Mask, const int VertexCount, int *OutVertexStructSize)
 {
 	void* VertexStruct = nullptr;
@@ -1175,6 +1439,66 @@ void* LXPrimitive::CreateInterleavedVertexArray(const int Mask, const int Vertex
 			CHK(0);
 		}
 		break;
+
+		//
+		// Packed
+		//
+
+		case LX_PRIMITIVE_PACKED | LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS:
+		{
+			vec3f Offset;
+			float Scale;
+			GetPackedPositionTransform(Offset, Scale);
+
+			Vertex_PackedPN* Vertices = new Vertex_PackedPN[VertexCount];
+			VertexStructSize = sizeof(Vertex_PackedPN);
+			for (int i = 0; i < VertexCount; i++)
+			{
+				PackPosition(m_arrayPositions[i], Offset, 1.f / Scale, 1.f, Vertices[i].position);
+				PackOctahedron(m_arrayNormals[i], Vertices[i].normal);
+			}
+			VertexStruct = Vertices;
+		}
+		break;
+
+		case LX_PRIMITIVE_PACKED | LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TEXCOORDS:
+		{
+			vec3f Offset;
+			float Scale;
+			GetPackedPositionTransform(Offset, Scale);
+
+			Vertex_PackedPNT* Vertices = new Vertex_PackedPNT[VertexCount];
+			VertexStructSize = sizeof(Vertex_PackedPNT);
+			for (int i = 0; i < VertexCount; i++)
+			{
+				PackPosition(m_arrayPositions[i], Offset, 1.f / Scale, 1.f, Vertices[i].position);
+				PackOctahedron(m_arrayNormals[i], Vertices[i].normal);
+				PackTexCoord(m_arrayTexCoords[i], Vertices[i].texCoord);
+			}
+			VertexStruct = Vertices;
+		}
+		break;
+
+		case LX_PRIMITIVE_PACKED | LX_PRIMITIVE_POSITIONS | LX_PRIMITIVE_NORMALS | LX_PRIMITIVE_TANGENTS | LX_PRIMITIVE_BINORMALS | LX_PRIMITIVE_TEXCOORDS:
+		{
+			vec3f Offset;
+			float Scale;
+			GetPackedPositionTransform(Offset, Scale);
+
+			Vertex_PackedPNABT* Vertices = new Vertex_PackedPNABT[VertexCount];
+			VertexStructSize = sizeof(Vertex_PackedPNABT);
+			for (int i = 0; i < VertexCount; i++)
+			{
+				// The binormal is rebuilt as Sign * Cross(Normal, Tangent)
+				const float BinormalSign = Dot(CrossProduct(m_arrayNormals[i], m_arrayTangents[i]), m_arrayBiNormals[i]);
+				PackPosition(m_arrayPositions[i], Offset, 1.f / Scale, BinormalSign, Vertices[i].position);
+				PackOctahedron(m_arrayNormals[i], Vertices[i].normalTangent);
+				PackOctahedron(m_arrayTangents[i], Vertices[i].normalTangent + 2);
+				PackTexCoord(m_arrayTexCoords[i], Vertices[i].texCoord);
+			}
+			VertexStruct = Vertices;
+		}
+		break;
 		
 		default:CHK(0); 
 	}
@@ -20,6 +20,13 @@
 #define TANGENT3F vec3f tangent;
 #define BINORMAL3F vec3f binormal;
 
+// Packed: 16-bit unorm position in the bounds cube (w: binormal sign), 16-bit snorm octahedral normal
+// and tangent, half float texcoords
+#define POSITION4UN16 uint16 position[4];
+#define NORMAL2SN16 int16 normal[2];
+#define NORMALTANGENT4SN16 int16 normalTangent[4];
+#define TEXCOORD2H uint16 texCoord[2];
+
 #define DEFINE_VERTEX_STRUCT(suffix, ARGS)   struct Vertex_##suffix{ ARGS };
 
 DEFINE_VERTEX_STRUCT(P, POSITION3F)
@@ -30,6 +37,9 @@ DEFINE_VERTEX_STRUCT(PNA, POSITION3F NORMAL3F TANGENT3F)
 DEFINE_VERTEX_STRUCT(PNAB, POSITION3F NORMAL3F TANGENT3F BINORMAL3F)
 DEFINE_VERTEX_STRUCT(PNAT, POSITION3F NORMAL3F TANGENT3F TEXCOORD2F)
 DEFINE_VERTEX_STRUCT(PNABT, POSITION3F NORMAL3F TANGENT3F BINORMAL3F TEXCOORD2F)
+DEFINE_VERTEX_STRUCT(PackedPN, POSITION4UN16 NORMAL2SN16)
+DEFINE_VERTEX_STRUCT(PackedPNT, POSITION4UN16 NORMAL2SN16 TEXCOORD2H)
+DEFINE_VERTEX_STRUCT(PackedPNABT, POSITION4UN16 NORMALTANGENT4SN16 TEXCOORD2H)
 
 #define LX_PRIMITIVE_INDICES	LX_BIT(0)
 #define LX_PRIMITIVE_POSITIONS	LX_BIT(1)
@@ -38,6 +48,8 @@ DEFINE_VERTEX_STRUCT(PNABT, POSITION3F NORMAL3F TANGENT3F BINORMAL3F TEXCOORD2F)
 #define LX_PRIMITIVE_TEXCOORDS	LX_BIT(4)
 #define LX_PRIMITIVE_BINORMALS	LX_BIT(5)
 #define LX_PRIMITIVE_INSTANCEPOSITIONS LX_BIT(6)
+#define LX_PRIMITIVE_INSTANCEWORLD LX_BIT(7) // Per instance World and Normal matrices (Dynamic instancing)
+#define LX_PRIMITIVE_PACKED		LX_BIT(8) // Vertex_Packed* layout, with the same attribute bits
 
 enum LXDataType /* DataModel : The new items must be added to the end */
 {
@@ -59,6 +71,7 @@ enum LXDataTarget /* DataModel : The new items must be added to the end */
 	LX_NORMALS,
 	LX_TANGENTS,
 	LX_BINORMALS,
+	LX_LODINDICES,	// Error (float) then the indices of a LOD
 };
 
 enum LXPrimitiveTopology /* DataModel : The new items must be added to the end */
@@ -85,6 +98,41 @@ struct TFileTag
 	uint					nCount;
 };
 
+// Simplified version of a primitive: indices in the vertices of the primitive
+struct TPrimitiveLOD
+{
+	ArrayUint Indices;
+	float Error = 0.f;	// Geometric deviation, relative to the local bounds diagonal
+};
+
+typedef vector<TPrimitiveLOD> ArrayPrimitiveLODs;
+
+// Arrays of a primitive, without the smart object: read and processed on any thread (LXAssetMesh::LoadData),
+// then swapped in an LXPrimitive created on the Main thread.
+struct TPrimitiveGeometry
+{
+	LXPrimitiveTopology Topology = LX_TRIANGLES;
+	ArrayUint Indices;
+	ArrayVec3f Positions;
+	ArrayVec4f Positions4f;
+	ArrayVec3f Normals;
+	ArrayVec3f Tangents;
+	ArrayVec3f BiNormals;
+	ArrayVec2f TexCoords;
+	ArrayVec3f TexCoords3f;
+	ArrayPrimitiveLODs LODs;
+	bool Optimized = false;
+	bool LODsGenerated = false;
+
+	uint GetVertices() const { return Positions.size() ? (uint)Positions.size() : (uint)Positions4f.size(); }
+
+	// See LXPrimitive
+	void GenerateLODs();
+	void OptimizeIndices();
+};
+
+typedef map<int, TPrimitiveGeometry> MapPrimitiveGeometries;
+
 class LXCORE_API LXPrimitive : public LXSmartObject
 {
 
@@ -128,6 +176,15 @@ public:
 	void				Empty				( );
 	void				Invalidate() { m_bValid = false; }
 
+	// CPU arrays, released once uploaded and restored from a reloaded copy (LXAssetMesh memory budget).
+	// The local bounds are kept.
+	uint64				GetMemorySize		( ) const;
+	void				ReleaseArrays		( );
+
+	// Swaps the arrays, the topology and the flags: fills the primitive with a geometry loaded on another thread,
+	// or restores its released arrays.
+	void				SwapGeometry		( TPrimitiveGeometry& Geometry );
+
 	// Overridden from LXSmartObject
 	void DefineProperties() ;
 
@@ -180,6 +237,23 @@ public:
 
 	void*				CreateInterleavedVertexArray(const int Mask, const int VertexCount, int *OutVertexStructSize);
 
+	// The packed positions are in [0,1] over the cube of the local bounds: Local = Offset + Packed * Scale
+	void				GetPackedPositionTransform(vec3f& OutOffset, float& OutScale);
+
+	// LOD chain, from the finest to the coarsest, LOD 0 being m_arrayIndices.
+	// Generated for the indexed triangle lists, by halves, until the simplification stalls.
+	void				GenerateLODs		( );
+	bool				IsLODsGenerated		( ) const { return m_bLODsGenerated; }	// Even when no LOD was kept
+	void				SetLODsGenerated	( ) { m_bLODsGenerated = true; }		// Loaded with its LOD chain
+	const ArrayPrimitiveLODs& GetLODs		( ) const { return m_arrayLODs; }
+	ArrayPrimitiveLODs&	GetLODs				( ) { return m_arrayLODs; }
+
+	// Reorders the triangles of each LOD for the vertex cache, then the vertices by first use.
+	// Done once, at import and before the save.
+	void				OptimizeIndices		( );
+	bool				IsOptimized			( ) const { return m_bOptimized; }
+	void				SetOptimized		( ) { m_bOptimized = true; }	// Loaded optimized
+
 private:
 
 	template<class T, class U>
@@ -210,12 +284,15 @@ public :
 	ArrayVec3f		m_arrayBiNormals;
 	ArrayVec2f		m_arrayTexCoords;
 	ArrayVec3f		m_arrayTexCoords3f;
+	ArrayPrimitiveLODs m_arrayLODs;
 
 	// Misc
 	LXPrimitiveTopology	_Topology;
 	LXMaterial*		m_pMaterial;
 	int				m_nId;
 	bool			m_bValid;
+	bool			m_bOptimized = false;
+	bool			m_bLODsGenerated = false;
 	LXBBox			m_bboxLocal;
 	static int		m_snPrimitives;
 	static int		m_snPoints;
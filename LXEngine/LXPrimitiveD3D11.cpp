@@ -8,13 +8,22 @@
 
 #include "stdafx.h"
 #include "LXPrimitiveD3D11.h"
+#include "LXGeometryPoolD3D11.h"
 #include "LXPrimitive.h"
+#include "LXRenderBackend.h"
 #include "LXRenderCommandList.h"
 #include "LXShaderD3D11.h"
 #include "LXStatistic.h"
 #include "LXInputElementDescD3D11Factory.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
+namespace
+{
+	// LOD selection
+	const float kLODPixelError = 1.f;
+	const float kLODHysteresis = 0.25f;
+};
+
 LXPrimitiveD3D11::LXPrimitiveD3D11()
 {
 	LX_COUNTSCOPEINC(LXPrimitiveD3D11)
@@ -24,16 +33,24 @@ LXPrimitiveD3D11::~LXPrimitiveD3D11()
 {
 	LX_COUNTSCOPEDEC(LXPrimitiveD3D11)
 	CHK(IsRenderThread())
-	LX_SAFE_RELEASE(VertexBuffer);
-	LX_SAFE_RELEASE(IndexBuffer);
+
+	if (GeometryPool)
+	{
+		GeometryPool->Remove(this);
+	}
+	else
+	{
+		LX_SAFE_RELEASE(VertexBuffer);
+		LX_SAFE_RELEASE(IndexBuffer);
+	}
+
 	LX_SAFE_RELEASE(InstanceBuffer);
 }
 
-void LXPrimitiveD3D11::Render(LXRenderCommandList* RCL)
+void LXPrimitiveD3D11::Render(LXRenderCommandList* RCL, uint LOD)
 {
-	LX_PERFOSCOPE(LXPrimitiveD3D11_Render)
-
 	CHK(VertexCount);
+	CHK(LOD < GetLODCount());
 
 	// InputAssembly & Draw
 	
@@ -44,18 +61,25 @@ void LXPrimitiveD3D11::Render(LXRenderCommandList* RCL)
 	{
 		RCL->IASetIndexBuffer(this);
 
+		const UINT StartIndex = StartIndexLocation + (LODs.empty() ? 0 : LODs[LOD].StartIndex);
+		const UINT LODIndexCount = LODs.empty() ? IndexCount : LODs[LOD].IndexCount;
+
 		if (InstanceCount > 0)
 		{
-			RCL->DrawIndexedInstanced(IndexCount, InstanceCount, 0, 0);
+			RCL->DrawIndexedInstanced(LODIndexCount, InstanceCount, StartIndex, BaseVertexLocation);
+		}
+		else if (StartIndex > 0 || BaseVertexLocation > 0)
+		{
+			RCL->DrawIndexedInstanced(LODIndexCount, 1, StartIndex, BaseVertexLocation);
 		}
 		else
 		{
-			RCL->DrawIndexed(IndexCount);
+			RCL->DrawIndexed(LODIndexCount);
 		}
 		
 		// Statistics
 		RCL->DrawCallCount++;
-		RCL->TriangleCount += IndexCount / 3;
+		RCL->TriangleCount += LODIndexCount / 3;
 	}
 	else
 	{
@@ -74,15 +98,74 @@ void LXPrimitiveD3D11::Render(LXRenderCommandList* RCL)
 	}
 }
 
-bool LXPrimitiveD3D11::Create(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition/* = nullptr*/)
+void LXPrimitiveD3D11::RenderInstanced(LXRenderCommandList* RCL, ID3D11Buffer* InInstanceBuffer, UINT InstanceStride, UINT InInstanceCount, UINT StartInstance, uint LOD)
+{
+	CHK(IndexCount > 0);
+	CHK(layoutMask & LX_PRIMITIVE_INSTANCEWORLD);
+	CHK(LOD < GetLODCount());
+
+	const UINT StartIndex = StartIndexLocation + (LODs.empty() ? 0 : LODs[LOD].StartIndex);
+	const UINT LODIndexCount = LODs.empty() ? IndexCount : LODs[LOD].IndexCount;
+
+	// InputAssembly & Draw
+
+	RCL->IASetPrimitiveTopology(PrimitiveTopology);
+	RCL->IASetVertexBuffer(this);
+	RCL->IASetInstanceBuffer(InInstanceBuffer, InstanceStride);
+	RCL->IASetIndexBuffer(this);
+	RCL->DrawIndexedInstanced2(LODIndexCount, InInstanceCount, StartIndex, BaseVertexLocation, StartInstance);
+
+	// Statistics
+	RCL->DrawCallCount++;
+	RCL->TriangleCount += LODIndexCount / 3 * InInstanceCount;
+}
+
+uint LXPrimitiveD3D11::SelectLOD(float ScreenSize, uint CurrentLOD) const
+{
+	for (uint i = (uint)LODs.size(); i-- > 1;)
+	{
+		const float Threshold = kLODPixelError * (i == CurrentLOD ? 1.f + kLODHysteresis : i > CurrentLOD ? 1.f - kLODHysteresis : 1.f);
+		if (LODs[i].Error * ScreenSize <= Threshold)
+			return i;
+	}
+
+	return 0;
+}
+
+bool LXPrimitiveD3D11::Create(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition/* = nullptr*/, bool Packed/* = false*/, LXGeometryPoolD3D11* Pool/* = nullptr*/)
 {
 	CHK(Primitive);
 	CHK(!VertexBuffer);
 	CHK(!IndexBuffer);
+	CHK(!GeometryPool);
 
 	// --- Create a temporary interleaved vertex buffer ---
 	int mask = Primitive->GetMask();
 	VertexCount = Primitive->GetVertices();
+
+	// Packed layouts, without the static InstancePositions
+	if (Packed && !(ArrayInstancePosition && ArrayInstancePosition->size() > 0))
+	{
+		switch (mask & ~LX_PRIMITIVE_INDICES)
+		{
+		case (int)EPrimitiveLayout::PN:
+		case (int)EPrimitiveLayout::PNT:
+		case (int)EPrimitiveLayout::PNABT:
+		{
+			vec3f Offset;
+			float Scale;
+			Primitive->GetPackedPositionTransform(Offset, Scale);
+
+			MatrixUnpack.SetScale(Scale, Scale, Scale);
+			MatrixUnpack.SetTranslation(Offset);
+			mask |= LX_PRIMITIVE_PACKED;
+		}
+		break;
+
+		default: break;
+		}
+	}
+
 	int VertexStructSize = 0;
 	void* Vertices = Primitive->CreateInterleavedVertexArray(mask, VertexCount, &VertexStructSize);
 	if (Vertices == nullptr)
@@ -117,11 +200,6 @@ bool LXPrimitiveD3D11::Create(LXPrimitive* Primitive, const ArrayVec3f* ArrayIns
 	default: CHK(0);
 	}
 		
-	// --- Create the D3D11 vertex buffer
-	CreateVertexBuffer(Vertices, VertexStructSize, VertexCount);
-	delete Vertices;
-
-
 	// --- Create the D3D11 instance buffer
 	if (ArrayInstancePosition)
 	{
@@ -132,24 +210,97 @@ bool LXPrimitiveD3D11::Create(LXPrimitive* Primitive, const ArrayVec3f* ArrayIns
 	
 		
 	// --- Create the D3D11 Index buffer ---
+#ifdef INDEXTYPE_USHORT
+	unsigned short* Indices = nullptr;
+#else
+	UINT* Indices = nullptr;
+#endif
+	UINT BufferIndexCount = 0;
+
 	if (Primitive->GetArrayIndices().size() > 0)
 	{
 		IndexCount = (UINT)Primitive->GetArrayIndices().size();
+
+		// The LODs follow LOD 0 in the index buffer
+		const ArrayPrimitiveLODs& PrimitiveLODs = Primitive->GetLODs();
+		BufferIndexCount = IndexCount;
+
+		if (PrimitiveLODs.size() > 0)
+		{
+			LODs.push_back({ 0, IndexCount, 0.f });
+			for (const TPrimitiveLOD& LOD : PrimitiveLODs)
+			{
+				LODs.push_back({ BufferIndexCount, (UINT)LOD.Indices.size(), LOD.Error });
+				BufferIndexCount += (UINT)LOD.Indices.size();
+			}
+		}
 		
 #ifdef INDEXTYPE_USHORT
 		CHK(IndexCount <= UINT16_MAX);
-		unsigned short* Indices = new unsigned short[IndexCount];
+		Indices = new unsigned short[BufferIndexCount];
 #else
-		UINT* Indices = new UINT[IndexCount];
+		Indices = new UINT[BufferIndexCount];
 #endif
 
 		for(unsigned int i = 0; i < IndexCount;i++)
 		{
 			Indices[i] = Primitive->GetArrayIndices()[i];
 		}
+
+		for (uint i = 0; i < (uint)PrimitiveLODs.size(); i++)
+		{
+			std::copy(PrimitiveLODs[i].Indices.begin(), PrimitiveLODs[i].Indices.end(), Indices + LODs[i + 1].StartIndex);
+		}
+	}
+
+	// --- Create the D3D11 vertex and index buffers, or sub-allocate them in the pool megabuffers
+	const bool Pooled = Pool && Indices && !ArrayInstancePosition && Pool->Add(this, Vertices, VertexCount, VertexStride, Indices, BufferIndexCount);
+
+	if (!Pooled)
+	{
+		CreateVertexBuffer(Vertices, VertexStructSize, VertexCount);
 		
-		CreateIndexBuffer(Indices, IndexCount);
-		delete Indices;
+		if (Indices)
+			CreateIndexBuffer(Indices, BufferIndexCount);
+	}
+
+	delete Vertices;
+	delete Indices;
+	return true;
+}
+
+bool LXPrimitiveD3D11::CreateInstanced(const LXPrimitiveD3D11* Primitive)
+{
+	CHK(Primitive);
+	CHK(!VertexBuffer);
+	CHK(!IndexBuffer);
+
+	if (Primitive->IndexCount == 0 || Primitive->InstanceCount > 0)
+		return false;
+
+	IndexCount = Primitive->IndexCount;
+	LODs = Primitive->LODs;
+	VertexCount = Primitive->VertexCount;
+	VertexStride = Primitive->VertexStride;
+	VertexBufferOffset = Primitive->VertexBufferOffset;
+	PrimitiveTopology = Primitive->PrimitiveTopology;
+
+	// The instance buffer is bound by RenderInstanced
+	layoutMask = Primitive->layoutMask | LX_PRIMITIVE_INSTANCEWORLD;
+	MatrixUnpack = Primitive->MatrixUnpack;
+	Layout2 = const_cast<LXArrayInputElementDesc*>(&GetInputElementDescD3D11Factory().GetInputElement(layoutMask));
+
+	// Shared buffers
+	if (Primitive->GeometryPool)
+	{
+		Primitive->GeometryPool->AddShared(this, Primitive);
+	}
+	else
+	{
+		VertexBuffer = Primitive->VertexBuffer;
+		VertexBuffer->AddRef();
+		IndexBuffer = Primitive->IndexBuffer;
+		IndexBuffer->AddRef();
 	}
 
 	return true;
@@ -187,6 +338,9 @@ bool LXPrimitiveD3D11::CreateIndexBuffer(unsigned short* Indices,  UINT InIndexC
 bool LXPrimitiveD3D11::CreateIndexBuffer(UINT* Indices, UINT InIndexCount)
 #endif
 {
+	if (LXRenderBackend::IsNullDevice())
+		return true;
+
 	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
 
@@ -216,6 +370,9 @@ bool LXPrimitiveD3D11::CreateIndexBuffer(UINT* Indices, UINT InIndexCount)
 
 bool LXPrimitiveD3D11::CreateVertexBuffer(void* Vertices, UINT VertexStructSize, UINT InVertexCount)
 {
+	if (LXRenderBackend::IsNullDevice())
+		return true;
+
 	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
 	
@@ -240,6 +397,9 @@ bool LXPrimitiveD3D11::CreateVertexBuffer(void* Vertices, UINT VertexStructSize,
 
 bool LXPrimitiveD3D11::CreateInstanceBuffer(const ArrayVec3f& ArrayInstancePosition)
 {
+	if (LXRenderBackend::IsNullDevice())
+		return true;
+
 	D3D11_BUFFER_DESC bd = { 0 };
 
 	bd.Usage = D3D11_USAGE_DEFAULT;
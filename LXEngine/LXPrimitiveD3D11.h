@@ -12,15 +12,25 @@
 #include "LXVec3.h"
 #include "LXDirectX11.h"
 #include "LXInputElementDescD3D11Factory.h"
+#include "LXMatrix.h"
 #include <directxmath.h>
 using namespace DirectX;
 
 struct ID3D11Buffer;
+class LXGeometryPoolD3D11;
 class LXPrimitive;
 class LXRenderCommandList;
 
 //#define INDEXTYPE_USHORT
 
+// LOD range in the index buffer
+struct TPrimitiveD3D11LOD
+{
+	UINT StartIndex;
+	UINT IndexCount;
+	float Error;	// Relative to the bounds diagonal
+};
+
 class LXPrimitiveD3D11 : public LXObject
 {
 
@@ -29,16 +39,31 @@ public:
 	LXPrimitiveD3D11();
 	virtual ~LXPrimitiveD3D11();
 
-	void Render(LXRenderCommandList* RCL);
+	void Render(LXRenderCommandList* RCL, uint LOD = 0);
+
+	// Dynamic instancing: InstanceCount instances, from StartInstance in the InstanceBuffer.
+	void RenderInstanced(LXRenderCommandList* RCL, ID3D11Buffer* InstanceBuffer, UINT InstanceStride, UINT InInstanceCount, UINT StartInstance, uint LOD = 0);
+
+	// Coarsest LOD whose error, projected on a bounds diagonal of ScreenSize pixels, stays under the pixel threshold.
+	// The current LOD is kept within a hysteresis band, the thresholds of the coarser ones are lowered.
+	uint SelectLOD(float ScreenSize, uint CurrentLOD) const;
+	uint GetLODCount() const { return LODs.empty() ? 1 : (uint)LODs.size(); }
 
 	///
 	/// Create the buffers
 	/// \param ArrayInstancePosition an optional per instance array of position
+	/// \param Packed use the Vertex_Packed* layout when the attributes allow it
+	/// \param Pool sub-allocates the vertices and indices in its megabuffers, when the primitive is indexed and not instanced
 	
-	bool Create(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition = nullptr);
+	bool Create(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition = nullptr, bool Packed = false, LXGeometryPoolD3D11* Pool = nullptr);
 	bool CreateSSTriangle();
 	bool CreateLine(const vec3f& v0, const vec3f& v1);
 
+	///
+	/// Shares the buffers of an indexed primitive, with a layout completed by the per instance matrices (LX_PRIMITIVE_INSTANCEWORLD).
+	
+	bool CreateInstanced(const LXPrimitiveD3D11* Primitive);
+
 private:
 
 #ifdef INDEXTYPE_USHORT
@@ -65,8 +90,22 @@ public:
 	LXArrayInputElementDesc* Layout2 = nullptr;
 	int layoutMask = 0;
 
+	// Packed positions to local space, to apply before the World matrix. Identity when not packed.
+	LXMatrix MatrixUnpack;
+
 	UINT InstanceCount = 0;
 	UINT InstanceBufferStride = 0;
 	UINT InstanceBufferOffset = 0;
+
+	// LOD 0 first, empty without LOD chain. The index buffer contains the LODs one after the other.
+	vector<TPrimitiveD3D11LOD> LODs;
+
+	// Sub-allocated in the GeometryPool megabuffers, which own the Vertex and Index buffers.
+	// The locations are updated by the pool when it moves the allocations.
+	LXGeometryPoolD3D11* GeometryPool = nullptr;
+	uint VertexAllocation = 0;
+	uint IndexAllocation = 0;
+	INT BaseVertexLocation = 0;
+	UINT StartIndexLocation = 0;
 };
 
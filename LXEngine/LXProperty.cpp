@@ -655,7 +655,7 @@ void LXPropertyT<LXAssetPtr>::GetValueFromXML2(const TLoadContext& LoadContext)
 		if (Project)
 		{
 			LXAssetManager& mm = Project->GetAssetManager();
-			value = mm.GetAsset(strFilename);
+			value = mm.GetAssetAsync(strFilename, EAssetPriority::Nearby);
 			CHK(value);
 		}
 	}
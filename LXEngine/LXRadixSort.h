@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+//
+// Stable LSD radix sort of items on their "uint64 Key" member, 8 bits per pass.
+// The passes where all the keys share the same digit are skipped (unused bits of the keys).
+// Temp is a scratch buffer of Count items. The result is in Items.
+//
+
+template<typename T>
+void LXRadixSort64(T* Items, T* Temp, uint Count)
+{
+	const uint kDigits = 8;
+	const uint kBuckets = 256;
+
+	if (Count < 2)
+		return;
+
+	// All the histograms in a single read
+	uint Histograms[kDigits][kBuckets] = {};
+
+	for (uint i = 0; i < Count; i++)
+	{
+		const uint64 Key = Items[i].Key;
+		for (uint Digit = 0; Digit < kDigits; Digit++)
+		{
+			Histograms[Digit][(Key >> (Digit * 8)) & 0xFF]++;
+		}
+	}
+
+	T* Src = Items;
+	T* Dst = Temp;
+
+	for (uint Digit = 0; Digit < kDigits; Digit++)
+	{
+		uint* Histogram = Histograms[Digit];
+		const uint Shift = Digit * 8;
+
+		if (Histogram[(Src[0].Key >> Shift) & 0xFF] == Count)
+			continue;
+
+		// Bucket offsets
+		uint Offset = 0;
+		for (uint Bucket = 0; Bucket < kBuckets; Bucket++)
+		{
+			const uint BucketCount = Histogram[Bucket];
+			Histogram[Bucket] = Offset;
+			Offset += BucketCount;
+		}
+
+		for (uint i = 0; i < Count; i++)
+		{
+			Dst[Histogram[(Src[i].Key >> Shift) & 0xFF]++] = Src[i];
+		}
+
+		std::swap(Src, Dst);
+	}
+
+	if (Src != Items)
+	{
+		std::copy(Src, Src + Count, Items);
+	}
+}
@@ -13,6 +13,10 @@
 #include "LXFrustum.h"
 #include "LXPrimitive.h"
 #include "LXPrimitiveInstance.h"
+#include "LXCore.h"
+#include "LXProject.h"
+#include "LXAssetManager.h"
+#include "LXAssetMesh.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
 LXRectangularSelectionTraverser::LXRectangularSelectionTraverser()
@@ -71,6 +75,10 @@ void LXRectangularSelectionTraverser::OnPrimitive(LXActorMesh* pMesh, LXWorldPri
 {
 	LXPrimitive* pPrimitive = WorldPrimitive->PrimitiveInstance->Primitive.get();
 
+	// The arrays are read: loaded again when released
+	if (LXAssetMesh* AssetMesh = pMesh->GetAssetMesh())
+		GetCore().GetProject()->GetAssetManager().UseAsset(AssetMesh);
+
 	ArrayVec3f& arrayPosition = pPrimitive->GetArrayPositions();
 
 	for (uint i=0; i<arrayPosition.size(); i++)
@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXRenderBackend.h"
+#include "LXConsoleManager.h"
+#include "LXRenderBackendD3D11.h"
+#include "LXRenderBackendNull.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	LXConsoleCommandT<bool> CSet_NullBackend(L"Engine.ini", L"Renderer", L"NullBackend", L"false");
+};
+
+LXRenderBackend* LXRenderBackend::GetDefault()
+{
+	static LXRenderBackendD3D11 RenderBackendD3D11;
+	static LXRenderBackendNull RenderBackendNull;
+
+	if (IsNullDevice())
+		return &RenderBackendNull;
+	else
+		return &RenderBackendD3D11;
+}
+
+bool LXRenderBackend::IsNullDevice()
+{
+	// The device is created or not at the renderer init, the setting cannot change afterwards
+	static const bool NullDevice = CSet_NullBackend.GetValue();
+	return NullDevice;
+}
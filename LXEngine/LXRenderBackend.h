@@ -0,0 +1,41 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+class LXRenderCommandList;
+struct LXRenderCommand;
+
+//
+// Executes the recorded LXRenderCommands.
+// The D3D11 backend calls the device, the Null backend only validates the command stream,
+// so the recording can be measured without a GPU (Renderer.NullBackend in Engine.ini).
+//
+
+class LXRenderBackend
+{
+
+public:
+
+	virtual ~LXRenderBackend() {}
+
+	// Backend used by the new LXRenderCommandLists
+	static LXRenderBackend* GetDefault();
+
+	// Renderer.NullBackend, read once at startup: no device is created and the
+	// D3D11 resources are created without their device objects.
+	static bool IsNullDevice();
+
+	virtual const wchar_t* GetName() const = 0;
+
+	// Executes the commands of the list, child lists included.
+	virtual void Execute(LXRenderCommandList* RCL) = 0;
+
+	// Executes a single command, when recorded in DirectMode.
+	virtual void ExecuteCommand(LXRenderCommandList* RCL, const LXRenderCommand* Command) = 0;
+};
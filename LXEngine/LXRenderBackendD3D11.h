@@ -0,0 +1,25 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXRenderBackend.h"
+
+//
+// Executes the commands on the current ID3D11DeviceContext (LXRenderCommand_XXX::Execute).
+//
+
+class LXRenderBackendD3D11 : public LXRenderBackend
+{
+
+public:
+
+	const wchar_t* GetName() const override { return L"D3D11"; }
+	void Execute(LXRenderCommandList* RCL) override;
+	void ExecuteCommand(LXRenderCommandList* RCL, const LXRenderCommand* Command) override;
+};
@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXRenderBackendNull.h"
+#include "LXLogger.h"
+#include "LXPrimitiveD3D11.h"
+#include "LXRenderCommandList.h"
+#include "LXShaderD3D11.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+void LXRenderBackendNull::Execute(LXRenderCommandList* RCL)
+{
+	RCL->Commands.ForEach([this, RCL](const LXRenderCommand* Command)
+	{
+		ExecuteCommand(RCL, Command);
+	});
+}
+
+void LXRenderBackendNull::ExecuteCommand(LXRenderCommandList* RCL, const LXRenderCommand* Command)
+{
+	switch (Command->Type)
+	{
+	case ERenderCommand::VSSetShader:
+		_VertexShader = static_cast<const LXRenderCommand_VSSetShader*>(Command)->VertexShader;
+		break;
+
+	case ERenderCommand::PSSetShader:
+		_PixelShader = static_cast<const LXRenderCommand_PSSetShader*>(Command)->PixelShader;
+		break;
+
+	case ERenderCommand::IASetInputLayout:
+		_InputLayout = static_cast<const LXRenderCommand_IASetInputLayout*>(Command)->VertexShader;
+		break;
+
+	case ERenderCommand::IASetVertexBuffer:
+		_VertexBuffer = static_cast<const LXRenderCommand_IASetVertexBuffer*>(Command)->Primitive;
+		break;
+
+	case ERenderCommand::IASetIndexBuffer:
+		_IndexBuffer = static_cast<const LXRenderCommand_IASetIndexBuffer*>(Command)->Primitive;
+		break;
+
+	case ERenderCommand::IASetPrimitiveTopology:
+		_PrimitiveTopology = static_cast<const LXRenderCommand_IASetPrimitiveTopology*>(Command)->PrimitiveTopology;
+		break;
+
+	case ERenderCommand::Draw:
+	{
+		const LXRenderCommand_Draw* Draw = static_cast<const LXRenderCommand_Draw*>(Command);
+		ValidateDraw(false);
+		CountPrimitives(Draw->VertexCount);
+		break;
+	}
+
+	case ERenderCommand::DrawInstanced:
+	{
+		const LXRenderCommand_DrawInstanced* Draw = static_cast<const LXRenderCommand_DrawInstanced*>(Command);
+		ValidateDraw(false);
+		CountPrimitives((uint64)Draw->VertexCount * Draw->InstanceCount);
+		break;
+	}
+
+	case ERenderCommand::DrawIndexed:
+	{
+		const LXRenderCommand_DrawIndexed* Draw = static_cast<const LXRenderCommand_DrawIndexed*>(Command);
+		ValidateDraw(true);
+		CountPrimitives(Draw->IndexCount);
+		break;
+	}
+
+	case ERenderCommand::DrawIndexedInstanced:
+	{
+		const LXRenderCommand_DrawIndexedInstanced* Draw = static_cast<const LXRenderCommand_DrawIndexedInstanced*>(Command);
+		ValidateDraw(true);
+		CountPrimitives((uint64)Draw->IndexCountPerInstance * Draw->InstanceCount);
+		break;
+	}
+
+	case ERenderCommand::DrawIndexedInstanced2:
+	{
+		const LXRenderCommand_DrawIndexedInstanced2* Draw = static_cast<const LXRenderCommand_DrawIndexedInstanced2*>(Command);
+		ValidateDraw(true);
+		CountPrimitives((uint64)Draw->IndexCountPerInstance * Draw->InstanceCount);
+		break;
+	}
+
+	case ERenderCommand::ExecuteCommandList:
+		Execute(static_cast<const LXRenderCommand_ExecuteCommandList*>(Command)->CommandList);
+		break;
+
+	default:
+		// No device: the other commands have no visible effect.
+		break;
+	}
+}
+
+void LXRenderBackendNull::ResetStats()
+{
+	_DrawCallCount = 0;
+	_TriangleCount = 0;
+	_ErrorCount = 0;
+}
+
+void LXRenderBackendNull::ValidateDraw(bool Indexed)
+{
+	_DrawCallCount++;
+
+	const wchar_t* Error = nullptr;
+
+	if (!_VertexShader || _VertexShader->GetState() != EShaderD3D11State::Ok)
+		Error = L"no valid VertexShader";
+	else if (!_PixelShader || _PixelShader->GetState() != EShaderD3D11State::Ok)
+		Error = L"no valid PixelShader";
+	else if (_InputLayout != _VertexShader)
+		Error = L"InputLayout does not match the VertexShader";
+	else if (!_VertexBuffer)
+		Error = L"no VertexBuffer";
+	else if (Indexed && !_IndexBuffer)
+		Error = L"no IndexBuffer";
+
+	if (Error)
+	{
+		// Logged once per stats period
+		if (_ErrorCount == 0)
+		{
+			LogE(RenderBackendNull, L"Invalid draw call %u: %s.", _DrawCallCount, Error);
+		}
+		_ErrorCount++;
+	}
+}
+
+void LXRenderBackendNull::CountPrimitives(uint64 VertexCount)
+{
+	switch (_PrimitiveTopology)
+	{
+	case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST: _TriangleCount += VertexCount / 3; break;
+	case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP: _TriangleCount += VertexCount > 2 ? VertexCount - 2 : 0; break;
+	case D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST: _TriangleCount += VertexCount / 3; break;
+	default: break;
+	}
+}
@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXRenderBackend.h"
+
+class LXPrimitiveD3D11;
+class LXShaderD3D11;
+
+//
+// Executes the commands without any device.
+// Tracks the bindings to validate the draw calls (same rules as LX_CHECK_BINDED_OBJECT),
+// and counts the executed draw calls and triangles.
+//
+
+class LXRenderBackendNull : public LXRenderBackend
+{
+
+public:
+
+	const wchar_t* GetName() const override { return L"Null"; }
+	void Execute(LXRenderCommandList* RCL) override;
+	void ExecuteCommand(LXRenderCommandList* RCL, const LXRenderCommand* Command) override;
+
+	// Stats, since the last ResetStats() call
+	void ResetStats();
+	uint GetDrawCallCount() const { return _DrawCallCount; }
+	uint64 GetTriangleCount() const { return _TriangleCount; }
+	uint GetErrorCount() const { return _ErrorCount; }
+
+private:
+
+	void ValidateDraw(bool Indexed);
+	void CountPrimitives(uint64 VertexCount);
+
+private:
+
+	// Bindings
+	const LXShaderD3D11* _VertexShader = nullptr;
+	const LXShaderD3D11* _PixelShader = nullptr;
+	const LXShaderD3D11* _InputLayout = nullptr;
+	const LXPrimitiveD3D11* _VertexBuffer = nullptr;
+	const LXPrimitiveD3D11* _IndexBuffer = nullptr;
+	uint _PrimitiveTopology = 0;
+
+	// Stats
+	uint _DrawCallCount = 0;
+	uint64 _TriangleCount = 0;
+	uint _ErrorCount = 0;
+};
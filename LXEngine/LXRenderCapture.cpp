@@ -0,0 +1,567 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXRenderCapture.h"
+#include "LXConstantBufferD3D11.h"
+#include "LXDirectX11.h"
+#include "LXFile.h"
+#include "LXLogger.h"
+#include "LXRenderBackendNull.h"
+#include "LXRenderCommandList.h"
+#include "LXShaderD3D11.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	const uint kCaptureMagic = 'LXRC';
+	const uint kCaptureVersion = 3;	// 2: DrawIndexedInstanced2 StartIndexLocation, 3: DrawIndexedInstanced2 BaseVertexLocation
+
+	struct TCaptureHeader
+	{
+		uint Magic;
+		uint Version;
+		uint CommandTypeCount; // ERenderCommand::Last, the command identifiers must match
+		uint CommandCount;
+		uint ObjectCount;
+		uint StringCount;
+		uint PayloadCount;
+		uint ListCount;
+	};
+
+	// Size of the data copied by the UpdateSubresource commands
+	UINT GetUpdatedSize(const LXRenderCommand* Command)
+	{
+		ID3D11Buffer* D3D11Buffer = nullptr;
+
+		switch (Command->Type)
+		{
+		case ERenderCommand::UpdateSubresource2: D3D11Buffer = static_cast<const LXRenderCommand_UpdateSubresource2*>(Command)->D3D11Buffer; break;
+		case ERenderCommand::UpdateSubresource3: D3D11Buffer = static_cast<const LXRenderCommand_UpdateSubresource3*>(Command)->ConstantBuffer->D3D11Buffer; break;
+		case ERenderCommand::UpdateSubresource4: D3D11Buffer = static_cast<const LXRenderCommand_UpdateSubresource4*>(Command)->D3D11Buffer; break;
+		default: CHK(0); return 0;
+		}
+
+		// Null device: the buffers have no size, the payloads are empty
+		if (!D3D11Buffer)
+			return 0;
+
+		D3D11_BUFFER_DESC Desc;
+		D3D11Buffer->GetDesc(&Desc);
+		return Desc.ByteWidth;
+	}
+
+	bool WriteBlock(LXFile& File, const vector<uint8>& Block)
+	{
+		uint Size = (uint)Block.size();
+		return File.Write(&Size, sizeof(uint)) && (Size == 0 || File.Write((void*)Block.data(), Size));
+	}
+
+	// Reads Size bytes from the Remaining bytes of the file
+	bool ReadFileBytes(LXFile& File, void* Data, uint64 Size, uint64& Remaining)
+	{
+		if (Size > Remaining)
+			return false;
+
+		Remaining -= Size;
+		return Size == 0 || File.Read(Data, (size_t)Size) == 1;
+	}
+
+	bool ReadBlock(LXFile& File, vector<uint8>& Block, uint64& Remaining)
+	{
+		uint Size = 0;
+		if (!ReadFileBytes(File, &Size, sizeof(uint), Remaining) || Size > Remaining)
+			return false;
+
+		Block.resize(Size);
+		return ReadFileBytes(File, Block.data(), Size, Remaining);
+	}
+};
+
+LXRenderCapture::LXRenderCapture()
+{
+	Clear();
+}
+
+LXRenderCapture::~LXRenderCapture()
+{
+	ClearReplay();
+}
+
+void LXRenderCapture::Clear()
+{
+	ClearReplay();
+
+	_Objects.clear();
+	_Strings.clear();
+	_Payloads.clear();
+	_Lists.clear();
+	_CommandCount = 0;
+
+	// nullptr identity
+	_Objects.push_back(EObject::Opaque);
+}
+
+void LXRenderCapture::ClearReplay()
+{
+	for (LXRenderCommandList* RCL : _ReplayLists)
+	{
+		delete RCL;
+	}
+
+	for (LXShaderD3D11* Shader : _PlaceholderShaders)
+	{
+		delete Shader;
+	}
+
+	_ReplayLists.clear();
+	_PlaceholderShaders.clear();
+	_Placeholders.clear();
+	_PlaceholderMemory.clear();
+}
+
+size_t LXRenderCapture::GetPayloadSize() const
+{
+	size_t Size = 0;
+	for (const vector<uint8>& Payload : _Payloads)
+	{
+		Size += Payload.size();
+	}
+	return Size;
+}
+
+//------------------------------------------------------------------------------------------------------
+// Capture
+//------------------------------------------------------------------------------------------------------
+
+void LXRenderCapture::Capture(const LXRenderCommandList* RCL)
+{
+	Clear();
+
+	_CapturedLists.push_back(RCL);
+
+	// Child lists are appended while their parent is written
+	for (uint i = 0; i < _CapturedLists.size(); i++)
+	{
+		_Lists.push_back(vector<uint8>());
+		WriteList(_CapturedLists[i], _Lists.back());
+	}
+
+	_ObjectIndices.clear();
+	_StringIndices.clear();
+	_PayloadIndices.clear();
+	_CapturedLists.clear();
+	_Stream = nullptr;
+	_Command = nullptr;
+}
+
+void LXRenderCapture::WriteList(const LXRenderCommandList* RCL, vector<uint8>& Stream)
+{
+	_Stream = &Stream;
+
+	RCL->Commands.ForEach([this](const LXRenderCommand* Command)
+	{
+		_Command = Command;
+		_CommandCount++;
+		Write(Command->Type);
+
+		switch (Command->Type)
+		{
+#define LX_RENDERCOMMAND0(name) case ERenderCommand::name: break;
+#define LX_RENDERCOMMAND1(name, type0, var0) case ERenderCommand::name: { const LXRenderCommand_##name* C = static_cast<const LXRenderCommand_##name*>(Command); Write(C->var0); break; }
+#define LX_RENDERCOMMAND2(name, type0, var0, type1, var1) case ERenderCommand::name: { const LXRenderCommand_##name* C = static_cast<const LXRenderCommand_##name*>(Command); Write(C->var0); Write(C->var1); break; }
+#define LX_RENDERCOMMAND3(name, type0, var0, type1, var1, type2, var2) case ERenderCommand::name: { const LXRenderCommand_##name* C = static_cast<const LXRenderCommand_##name*>(Command); Write(C->var0); Write(C->var1); Write(C->var2); break; }
+#define LX_RENDERCOMMAND4(name, type0, var0, type1, var1, type2, var2, type3, var3) case ERenderCommand::name: { const LXRenderCommand_##name* C = static_cast<const LXRenderCommand_##name*>(Command); Write(C->var0); Write(C->var1); Write(C->var2); Write(C->var3); break; }
+#define LX_RENDERCOMMAND5(name, type0, var0, type1, var1, type2, var2, type3, var3, type4, var4) case ERenderCommand::name: { const LXRenderCommand_##name* C = static_cast<const LXRenderCommand_##name*>(Command); Write(C->var0); Write(C->var1); Write(C->var2); Write(C->var3); Write(C->var4); break; }
+#include "LXRenderCommands.h"
+		default: CHK(0);
+		}
+	});
+}
+
+uint LXRenderCapture::AddObject(const void* Object, EObject Type)
+{
+	if (!Object)
+		return 0;
+
+	auto It = _ObjectIndices.find(Object);
+	if (It != _ObjectIndices.end())
+		return It->second;
+
+	uint Index = (uint)_Objects.size();
+	_Objects.push_back(Type);
+	_ObjectIndices[Object] = Index;
+	return Index;
+}
+
+void LXRenderCapture::Write(LXShaderD3D11* Shader)
+{
+	Write(AddObject(Shader, Shader && Shader->IsValid() ? EObject::Shader : EObject::InvalidShader));
+}
+
+void LXRenderCapture::Write(const wchar_t* Name)
+{
+	uint Index = UINT_MAX;
+
+	if (Name)
+	{
+		auto It = _StringIndices.find(Name);
+		if (It != _StringIndices.end())
+		{
+			Index = It->second;
+		}
+		else
+		{
+			Index = (uint)_Strings.size();
+			_Strings.push_back(Name);
+			_StringIndices[Name] = Index;
+		}
+	}
+
+	Write(Index);
+}
+
+void LXRenderCapture::Write(void* Data)
+{
+	// The data is read by the device at execution: as long as the frame is not executed,
+	// the same pointer always gives the same content.
+	uint Index = UINT_MAX;
+
+	if (Data)
+	{
+		auto It = _PayloadIndices.find(Data);
+		if (It != _PayloadIndices.end())
+		{
+			Index = It->second;
+		}
+		else
+		{
+			const uint8* Bytes = (const uint8*)Data;
+			Index = (uint)_Payloads.size();
+			_Payloads.push_back(vector<uint8>(Bytes, Bytes + GetUpdatedSize(_Command)));
+			_PayloadIndices[Data] = Index;
+		}
+	}
+
+	Write(Index);
+}
+
+void LXRenderCapture::Write(LXRenderCommandList* RCL)
+{
+	// A child list is executed once, by its parent
+	uint Index = (uint)_CapturedLists.size();
+	_CapturedLists.push_back(RCL);
+	Write(Index);
+}
+
+//------------------------------------------------------------------------------------------------------
+// File
+//------------------------------------------------------------------------------------------------------
+
+bool LXRenderCapture::Save(const wchar_t* Filename) const
+{
+	LXFile File;
+	if (!File.Open(Filename, L"wb"))
+	{
+		LogE(RenderCapture, L"Unable to create %s", Filename);
+		return false;
+	}
+
+	TCaptureHeader Header;
+	Header.Magic = kCaptureMagic;
+	Header.Version = kCaptureVersion;
+	Header.CommandTypeCount = (uint)ERenderCommand::Last;
+	Header.CommandCount = _CommandCount;
+	Header.ObjectCount = (uint)_Objects.size();
+	Header.StringCount = (uint)_Strings.size();
+	Header.PayloadCount = (uint)_Payloads.size();
+	Header.ListCount = (uint)_Lists.size();
+
+	bool Result = File.Write(&Header, sizeof(TCaptureHeader));
+	Result &= File.Write((void*)_Objects.data(), _Objects.size() * sizeof(EObject));
+
+	for (const wstring& String : _Strings)
+	{
+		uint Length = (uint)String.size();
+		Result &= File.Write(&Length, sizeof(uint));
+		Result &= Length == 0 || File.Write((void*)String.data(), Length * sizeof(wchar_t));
+	}
+
+	for (const vector<uint8>& Payload : _Payloads)
+	{
+		Result &= WriteBlock(File, Payload);
+	}
+
+	for (const vector<uint8>& List : _Lists)
+	{
+		Result &= WriteBlock(File, List);
+	}
+
+	File.Close();
+
+	if (!Result)
+	{
+		LogE(RenderCapture, L"Failed to write %s", Filename);
+	}
+
+	return Result;
+}
+
+bool LXRenderCapture::Load(const wchar_t* Filename)
+{
+	Clear();
+
+	LXFile File;
+	if (!File.Open(Filename, L"rb"))
+	{
+		LogE(RenderCapture, L"Unable to open %s", Filename);
+		return false;
+	}
+
+	File.Seek(SEEK_END);
+	uint64 Remaining = File.Tell();
+	File.Rewind();
+
+	TCaptureHeader Header;
+	if (!ReadFileBytes(File, &Header, sizeof(TCaptureHeader), Remaining) || Header.Magic != kCaptureMagic || Header.ObjectCount == 0)
+	{
+		LogE(RenderCapture, L"%s is not a render capture", Filename);
+		return false;
+	}
+
+	if (Header.Version != kCaptureVersion || Header.CommandTypeCount != (uint)ERenderCommand::Last)
+	{
+		LogE(RenderCapture, L"%s was captured with another version of the render commands", Filename);
+		return false;
+	}
+
+	// The counts are bounded by the file size before any allocation: an object takes one byte, a string, a payload or a list at least its size.
+	const uint64 MinSize = (uint64)Header.ObjectCount * sizeof(EObject) + ((uint64)Header.StringCount + Header.PayloadCount + Header.ListCount) * sizeof(uint);
+	if (MinSize > Remaining)
+	{
+		LogE(RenderCapture, L"%s is truncated", Filename);
+		return false;
+	}
+
+	_CommandCount = Header.CommandCount;
+	_Objects.resize(Header.ObjectCount);
+	_Strings.resize(Header.StringCount);
+	_Payloads.resize(Header.PayloadCount);
+	_Lists.resize(Header.ListCount);
+
+	bool Result = ReadFileBytes(File, _Objects.data(), _Objects.size() * sizeof(EObject), Remaining);
+
+	for (wstring& String : _Strings)
+	{
+		uint Length = 0;
+		Result = Result && ReadFileBytes(File, &Length, sizeof(uint), Remaining) && (uint64)Length * sizeof(wchar_t) <= Remaining;
+		if (!Result)
+			break;
+
+		String.resize(Length);
+		Result = ReadFileBytes(File, &String[0], (uint64)Length * sizeof(wchar_t), Remaining);
+	}
+
+	for (vector<uint8>& Payload : _Payloads)
+	{
+		Result = Result && ReadBlock(File, Payload, Remaining);
+	}
+
+	for (vector<uint8>& List : _Lists)
+	{
+		Result = Result && ReadBlock(File, List, Remaining);
+	}
+
+	File.Close();
+
+	if (!Result || _Lists.empty())
+	{
+		LogE(RenderCapture, L"%s is truncated", Filename);
+		Clear();
+		return false;
+	}
+
+	for (EObject Object : _Objects)
+	{
+		if (Object > EObject::InvalidShader)
+		{
+			LogE(RenderCapture, L"%s contains an unknown object type", Filename);
+			Clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------------
+// Replay
+//------------------------------------------------------------------------------------------------------
+
+LXRenderCommandList* LXRenderCapture::Replay(LXRenderBackend* Backend)
+{
+	CHK(!_Lists.empty());
+	ClearReplay();
+
+	// Placeholders: distinct addresses for the opaque objects, compiled or not shaders for the validation
+	_PlaceholderMemory.resize(_Objects.size());
+	_Placeholders.resize(_Objects.size(), nullptr);
+
+	for (uint i = 1; i < _Objects.size(); i++)
+	{
+		switch (_Objects[i])
+		{
+		case EObject::Shader:
+		case EObject::InvalidShader:
+		{
+			LXShaderD3D11* Shader = new LXShaderD3D11();
+			Shader->State = _Objects[i] == EObject::Shader ? EShaderD3D11State::Ok : EShaderD3D11State::CompilationError;
+			_PlaceholderShaders.push_back(Shader);
+			_Placeholders[i] = Shader;
+			break;
+		}
+		default:
+			_Placeholders[i] = &_PlaceholderMemory[i];
+			break;
+		}
+	}
+
+	if (!dynamic_cast<LXRenderBackendNull*>(Backend))
+	{
+		LogW(RenderCapture, L"Replay on the %s backend: only the Null backend supports the placeholders", Backend->GetName());
+	}
+
+	for (uint i = 0; i < _Lists.size(); i++)
+	{
+		LXRenderCommandList* RCL = new LXRenderCommandList();
+		RCL->Backend = Backend;
+		RCL->DirectMode = false;
+		_ReplayLists.push_back(RCL);
+	}
+
+	for (uint i = 0; i < _Lists.size(); i++)
+	{
+		if (!ReadList(i))
+		{
+			LogE(RenderCapture, L"Invalid command stream in list %u", i);
+			ClearReplay();
+			return nullptr;
+		}
+	}
+
+	return _ReplayLists[0];
+}
+
+bool LXRenderCapture::ReadList(uint ListIndex)
+{
+	// The records are pushed as captured: no state filtering, no recording side effect.
+	const vector<uint8>& Stream = _Lists[ListIndex];
+	LXRenderCommandList* RCL = _ReplayLists[ListIndex];
+
+	_ReadPtr = Stream.data();
+	_ReadEnd = _ReadPtr + Stream.size();
+	_ReadListIndex = ListIndex;
+	_ReadError = false;
+
+	while (_ReadPtr < _ReadEnd && !_ReadError)
+	{
+		ERenderCommand Type;
+		Read(Type);
+
+		switch (Type)
+		{
+#define LX_RENDERCOMMAND0(name) case ERenderCommand::name: { RCL->Commands.Push<LXRenderCommand_##name>(); break; }
+#define LX_RENDERCOMMAND1(name, type0, var0) case ERenderCommand::name: { LXRenderCommand_##name* C = RCL->Commands.Push<LXRenderCommand_##name>(); Read(C->var0); break; }
+#define LX_RENDERCOMMAND2(name, type0, var0, type1, var1) case ERenderCommand::name: { LXRenderCommand_##name* C = RCL->Commands.Push<LXRenderCommand_##name>(); Read(C->var0); Read(C->var1); break; }
+#define LX_RENDERCOMMAND3(name, type0, var0, type1, var1, type2, var2) case ERenderCommand::name: { LXRenderCommand_##name* C = RCL->Commands.Push<LXRenderCommand_##name>(); Read(C->var0); Read(C->var1); Read(C->var2); break; }
+#define LX_RENDERCOMMAND4(name, type0, var0, type1, var1, type2, var2, type3, var3) case ERenderCommand::name: { LXRenderCommand_##name* C = RCL->Commands.Push<LXRenderCommand_##name>(); Read(C->var0); Read(C->var1); Read(C->var2); Read(C->var3); break; }
+#define LX_RENDERCOMMAND5(name, type0, var0, type1, var1, type2, var2, type3, var3, type4, var4) case ERenderCommand::name: { LXRenderCommand_##name* C = RCL->Commands.Push<LXRenderCommand_##name>(); Read(C->var0); Read(C->var1); Read(C->var2); Read(C->var3); Read(C->var4); break; }
+#include "LXRenderCommands.h"
+		default: _ReadError = true; break;
+		}
+	}
+
+	_ReadPtr = nullptr;
+	_ReadEnd = nullptr;
+	return !_ReadError;
+}
+
+void LXRenderCapture::ReadBytes(void* Data, size_t Size)
+{
+	if (Size > (size_t)(_ReadEnd - _ReadPtr))
+	{
+		memset(Data, 0, Size);
+		_ReadPtr = _ReadEnd;
+		_ReadError = true;
+		return;
+	}
+
+	memcpy(Data, _ReadPtr, Size);
+	_ReadPtr += Size;
+}
+
+void* LXRenderCapture::ReadObject()
+{
+	uint Index;
+	Read(Index);
+	if (Index >= _Placeholders.size())
+	{
+		_ReadError = true;
+		return nullptr;
+	}
+	return _Placeholders[Index];
+}
+
+void* LXRenderCapture::ReadPayload()
+{
+	uint Index;
+	Read(Index);
+	if (Index == UINT_MAX)
+		return nullptr;
+
+	if (Index >= _Payloads.size())
+	{
+		_ReadError = true;
+		return nullptr;
+	}
+	return _Payloads[Index].data();
+}
+
+void LXRenderCapture::Read(const wchar_t*& Name)
+{
+	uint Index;
+	Read(Index);
+	if (Index == UINT_MAX)
+	{
+		Name = nullptr;
+		return;
+	}
+
+	if (Index >= _Strings.size())
+	{
+		_ReadError = true;
+		Name = nullptr;
+		return;
+	}
+	Name = _Strings[Index].c_str();
+}
+
+void LXRenderCapture::Read(LXRenderCommandList*& RCL)
+{
+	uint Index;
+	Read(Index);
+
+	// A child list is captured after its parent: an earlier list, or the list itself, would be executed recursively
+	if (Index <= _ReadListIndex || Index >= _ReplayLists.size())
+	{
+		_ReadError = true;
+		RCL = nullptr;
+		return;
+	}
+	RCL = _ReplayLists[Index];
+}
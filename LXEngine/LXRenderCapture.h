@@ -0,0 +1,112 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXObject.h"
+
+class LXConstantBufferData;
+class LXRenderBackend;
+class LXRenderCommandList;
+class LXShaderD3D11;
+struct LXRenderCommand;
+
+//
+// Binary capture of a frame LXRenderCommandList, child lists included.
+// Objects referenced by the commands are stored as identities (an index), the constant buffer
+// payloads (LXConstantBufferData, cb1...) and the event names by value.
+// On replay, the objects are replaced by placeholders: the lists can be executed by the Null backend
+// to compare the execution cost of identical workloads without a project.
+//
+
+class LXRenderCapture : public LXObject
+{
+
+public:
+
+	LXRenderCapture();
+	virtual ~LXRenderCapture();
+
+	// Serializes the recorded commands. To be called before RCL->Execute(), the payloads are read now.
+	void Capture(const LXRenderCommandList* RCL);
+
+	bool Save(const wchar_t* Filename) const;
+	bool Load(const wchar_t* Filename);
+
+	// Rebuilds the command lists from the capture, to be executed by Backend. The placeholders are not
+	// device objects: only the Null backend is supported. The returned root list is owned by the capture,
+	// nullptr if the command streams are invalid.
+	LXRenderCommandList* Replay(LXRenderBackend* Backend);
+
+	uint GetCommandCount() const { return _CommandCount; }
+	uint GetObjectCount() const { return (uint)_Objects.size(); }
+	size_t GetPayloadSize() const;
+
+private:
+
+	enum class EObject : uint8
+	{
+		Opaque,			// Only the identity is known
+		Shader,			// LXShaderD3D11, valid
+		InvalidShader	// LXShaderD3D11, not compiled
+	};
+
+	void Clear();
+	void ClearReplay();
+
+	// Capture
+	void WriteList(const LXRenderCommandList* RCL, vector<uint8>& Stream);
+	void WriteBytes(const void* Data, size_t Size) { const uint8* Bytes = (const uint8*)Data; _Stream->insert(_Stream->end(), Bytes, Bytes + Size); }
+	template<typename T> void Write(const T& Value) { WriteBytes(&Value, sizeof(T)); }
+	template<typename T> void Write(T* Object) { Write(AddObject(Object, EObject::Opaque)); }
+	void Write(LXShaderD3D11* Shader);
+	void Write(const wchar_t* Name);
+	void Write(LXConstantBufferData* Data) { Write((void*)Data); }
+	void Write(void* Data);
+	void Write(LXRenderCommandList* RCL);
+	uint AddObject(const void* Object, EObject Type);
+
+	// Replay
+	bool ReadList(uint ListIndex);
+	void ReadBytes(void* Data, size_t Size);
+	template<typename T> void Read(T& Value) { ReadBytes(&Value, sizeof(T)); }
+	template<typename T> void Read(T*& Object) { Object = (T*)ReadObject(); }
+	void Read(const wchar_t*& Name);
+	void Read(LXConstantBufferData*& Data) { Data = (LXConstantBufferData*)ReadPayload(); }
+	void Read(void*& Data) { Data = ReadPayload(); }
+	void Read(LXRenderCommandList*& RCL);
+	void* ReadObject();
+	void* ReadPayload();
+
+private:
+
+	// Captured data, indices are the identities. Object 0 is nullptr.
+	vector<EObject> _Objects;
+	vector<wstring> _Strings;
+	vector<vector<uint8>> _Payloads;
+	vector<vector<uint8>> _Lists;
+	uint _CommandCount = 0;
+
+	// Capture state
+	map<const void*, uint> _ObjectIndices;
+	map<const void*, uint> _StringIndices;
+	map<const void*, uint> _PayloadIndices;
+	vector<const LXRenderCommandList*> _CapturedLists;
+	vector<uint8>* _Stream = nullptr;
+	const LXRenderCommand* _Command = nullptr;
+
+	// Replay state
+	vector<void*> _Placeholders;
+	vector<LXShaderD3D11*> _PlaceholderShaders;
+	vector<uint8> _PlaceholderMemory;
+	vector<LXRenderCommandList*> _ReplayLists;
+	const uint8* _ReadPtr = nullptr;
+	const uint8* _ReadEnd = nullptr;
+	uint _ReadListIndex = 0;
+	bool _ReadError = false;
+};
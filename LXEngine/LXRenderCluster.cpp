@@ -11,6 +11,7 @@
 #include "LXActorCamera.h"
 #include "LXActorLight.h"
 #include "LXActorMesh.h"
+#include "LXConsoleManager.h"
 #include "LXConstantBufferD3D11.h"
 #include "LXCore.h"
 #include "LXDirectX11.h"
@@ -19,6 +20,7 @@
 #include "LXMaterialD3D11.h"
 #include "LXPrimitiveD3D11.h"
 #include "LXPrimitiveInstance.h"
+#include "LXRadixSort.h"
 #include "LXRenderClusterManager.h"
 #include "LXRenderCommandList.h"
 #include "LXRenderer.h"
@@ -28,6 +30,27 @@
 #include "LXWorldTransformation.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
+namespace
+{
+	LXConsoleCommandT<bool> CSet_SortRenderClusters(L"Engine.ini", L"Renderer", L"SortRenderClusters", L"true");
+
+	// Sort key layout
+	const uint kSortKeyDepthBits = 16;
+	const uint kSortKeyPrimitiveBits = 16;
+	const uint kSortKeyMaterialBits = 14;
+	const uint kSortKeyShaderProgramBits = 14;
+
+	const uint kSortKeyPrimitiveShift = kSortKeyDepthBits;
+	const uint kSortKeyMaterialShift = kSortKeyPrimitiveShift + kSortKeyPrimitiveBits;
+	const uint kSortKeyShaderProgramShift = kSortKeyMaterialShift + kSortKeyMaterialBits;
+	const uint kSortKeyPassShift = kSortKeyShaderProgramShift + kSortKeyShaderProgramBits;
+
+	static_assert(kSortKeyPassShift + 4 == 64 && (int)ERenderPass::Last <= 16, "RenderCluster sort key layout");
+
+	// Identifiers beyond the field size only weaken the grouping
+	inline uint64 SortKeyField(uint Value, uint Bits, uint Shift) { return ((uint64)Value & ((1ull << Bits) - 1)) << Shift; }
+};
+
 LXRenderCluster::LXRenderCluster(LXRenderClusterManager* RenderClusterManager, LXActor* InActor, const LXMatrix& MatrixWCS)
 {
 	LX_COUNTSCOPEINC(LXRenderCluster)
@@ -44,8 +67,6 @@ LXRenderCluster::LXRenderCluster(LXRenderClusterManager* RenderClusterManager, L
 	//
 	//
 
-	LXConstantBufferData1 cb1;
-
 	cb1.World = Transpose(MatrixWCS);
 	cb1.Normal = Inverse(MatrixWCS/*cb1.World*/);
 
@@ -53,8 +74,11 @@ LXRenderCluster::LXRenderCluster(LXRenderClusterManager* RenderClusterManager, L
 	CBWorld->CreateConstantBuffer(&cb1, sizeof(LXConstantBufferData1));
 
 	// TODO : Au lieu d'un UpdateSubresource, passer la valeur dans CreateConstantBuffer. Type void*. Dfaut  null.
-	ID3D11DeviceContext* D3D11DeviceContext = LXDirectX11::GetCurrentDeviceContext();
-	D3D11DeviceContext->UpdateSubresource(CBWorld->D3D11Buffer, 0, nullptr, &cb1, 0, 0);
+	if (CBWorld->D3D11Buffer)
+	{
+		ID3D11DeviceContext* D3D11DeviceContext = LXDirectX11::GetCurrentDeviceContext();
+		D3D11DeviceContext->UpdateSubresource(CBWorld->D3D11Buffer, 0, nullptr, &cb1, 0, 0);
+	}
 }
 
 LXRenderCluster::~LXRenderCluster()
@@ -75,12 +99,19 @@ void LXRenderCluster::SetPrimitive(shared_ptr<LXPrimitiveD3D11>& InPrimitiveD3D1
 {
 	CHK(Primitive == nullptr)
 	Primitive = InPrimitiveD3D11;
+
+	// The packed positions are brought to local space by the World matrix
+	cb1.World = Transpose(Matrix * Primitive->MatrixUnpack);
 }
 
 void LXRenderCluster::SetMatrix(const LXMatrix& InMatrix)
 {
 	 Matrix = InMatrix;
 	 ValidConstantBufferMatrix = false;
+
+	 // Computed here, not in Render: a cluster can be recorded by several threads at once.
+	 cb1.World = Transpose(Primitive ? Matrix * Primitive->MatrixUnpack : Matrix);
+	 cb1.Normal = Inverse(Matrix);
 }
 
 void LXRenderCluster::SetBBoxWorld(const LXBBox& Box)
@@ -95,15 +126,9 @@ bool LXRenderCluster::IsTransparent() const
 
 void LXRenderCluster::Render(ERenderPass RenderPass, LXRenderCommandList* RCL)
 {
-	LXShaderProgramD3D11* ShaderProgram = &ShaderPrograms[(int)RenderPass];
-
 	if (1/*!ValidConstantBufferMatrix*/ && CBWorld)
 	{
-		//LXConstantBufferData1 cb1;
-		cb1.World = Transpose(Matrix);
-		cb1.Normal = Inverse(Matrix);
 		RCL->UpdateSubresource4(CBWorld->D3D11Buffer, &cb1);
-		ValidConstantBufferMatrix = true;
 	}
 
 	if (ConstantBufferDataSpotLight)
@@ -111,13 +136,62 @@ void LXRenderCluster::Render(ERenderPass RenderPass, LXRenderCommandList* RCL)
 		UpdateLightParameters(Actor);
 	}
 
+	if (BindShaderProgram(ShaderPrograms[(int)RenderPass], CBWorld, RCL))
+	{
+		// Material (Shader resources)
+		if (Material)
+			Material->Render(RenderPass, RCL);
+
+		Primitive->Render(RCL, LOD);
+	}
+}
+
+bool LXRenderCluster::CanBeInstanced() const
+{
+	if ((Flags & ERenderClusterType::Light) || (Flags & ERenderClusterType::Auxiliary))
+		return false;
+
+	// Indexed primitives without the static InstancePositions, in a layout with an instanced vertex shader entry point.
+	if (!Primitive || Primitive->IndexCount == 0 || Primitive->InstanceCount > 0)
+		return false;
+
+	switch (Primitive->layoutMask)
+	{
+	case (int)EPrimitiveLayout::P:
+	case (int)EPrimitiveLayout::PN:
+	case (int)EPrimitiveLayout::PNT:
+	case (int)EPrimitiveLayout::PNABT:
+	case (int)EPrimitiveLayout::PackedPN:
+	case (int)EPrimitiveLayout::PackedPNT:
+	case (int)EPrimitiveLayout::PackedPNABT: return true;
+	default: return false;
+	}
+}
+
+void LXRenderCluster::RenderInstanced(ERenderPass RenderPass, LXRenderCommandList* RCL, ID3D11Buffer* InstanceBuffer, uint InstanceCount, uint StartInstance)
+{
+	CHK(InstancedPrimitive && CBWorldIdentity);
+
+	// The World matrices are in the instance buffer
+	if (BindShaderProgram(InstancedShaderPrograms[(int)RenderPass], CBWorldIdentity, RCL))
+	{
+		// Material (Shader resources)
+		if (Material)
+			Material->Render(RenderPass, RCL);
+
+		InstancedPrimitive->RenderInstanced(RCL, InstanceBuffer, sizeof(LXConstantBufferData1), InstanceCount, StartInstance, LOD);
+	}
+}
+
+bool LXRenderCluster::BindShaderProgram(const LXShaderProgramD3D11& ShaderProgram, LXConstantBufferD3D11* ConstantBufferWorld, LXRenderCommandList* RCL)
+{
 	bool bHasShader = false;
 
 	// Vertex Shader
-	if (ShaderProgram->VertexShader)
+	if (ShaderProgram.VertexShader)
 	{
-		RCL->IASetInputLayout(ShaderProgram->VertexShader.get());
-		RCL->VSSetShader(ShaderProgram->VertexShader.get());
+		RCL->IASetInputLayout(ShaderProgram.VertexShader.get());
+		RCL->VSSetShader(ShaderProgram.VertexShader.get());
 		bHasShader = true;
 	
 		if (RCL->CBViewProjection)
@@ -125,49 +199,42 @@ void LXRenderCluster::Render(ERenderPass RenderPass, LXRenderCommandList* RCL)
 			RCL->VSSetConstantBuffers(0, 1, RCL->CBViewProjection);
 		}
 
-		if (CBWorld)
+		if (ConstantBufferWorld)
 		{
-			RCL->VSSetConstantBuffers(1, 1, CBWorld);
-			RCL->PSSetConstantBuffers(1, 1, CBWorld);
+			RCL->VSSetConstantBuffers(1, 1, ConstantBufferWorld);
+			RCL->PSSetConstantBuffers(1, 1, ConstantBufferWorld);
 		}
 	}
 
 	// Hull Shader
-	if (ShaderProgram->HullShader)
+	if (ShaderProgram.HullShader)
 	{
-		RCL->HSSetShader(ShaderProgram->HullShader.get());
+		RCL->HSSetShader(ShaderProgram.HullShader.get());
 		bHasShader = true;
 	}
 
 	// Domain Shader
-	if (ShaderProgram->DomainShader)
+	if (ShaderProgram.DomainShader)
 	{
-		RCL->DSSetShader(ShaderProgram->DomainShader.get());
+		RCL->DSSetShader(ShaderProgram.DomainShader.get());
 		bHasShader = true;
 	}
 
 	// Geometry Shader
-	if (ShaderProgram->GeometryShader)
+	if (ShaderProgram.GeometryShader)
 	{
-		RCL->GSSetShader(ShaderProgram->GeometryShader.get());
+		RCL->GSSetShader(ShaderProgram.GeometryShader.get());
 		bHasShader = true;
 	}
 	
 	// Pixel Shader	TODO why tested ?
-	if (ShaderProgram->PixelShader)
+	if (ShaderProgram.PixelShader)
 	{
-		RCL->PSSetShader(ShaderProgram->PixelShader.get());
+		RCL->PSSetShader(ShaderProgram.PixelShader.get());
 		bHasShader = true;
 	}
 
-	if (bHasShader)
-	{
-		// Material (Shader resources)
-		if (Material)
-			Material->Render(RenderPass, RCL);
-
-		Primitive->Render(RCL);
-	}
+	return bHasShader;
 }
 
 void LXRenderCluster::SetLightParameters(LXActor* Actor)
@@ -234,19 +301,16 @@ void LXRenderCluster::UpdateLightParameters()
 
 	ConstantBufferDataSpotLight->LightDirection = vec4f(Matrix.GetVz(), 0.0) * -1.f;
 	
-	// ShadowMapCoords updated during RenderPassShadow
+	// ShadowMapCoords updated by the shadow atlas of the pipeline
 	//ConstantBufferDataSpotLight->ShadowMapCoords;
 
-	if (ActorLight->GetType() != ELightType::Spot)
-	{
-		ConstantBufferDataSpotLight->CastShadow = false;
-	}
-	
 	// Misc.
 	ConstantBufferDataSpotLight->Color = ActorLight->GetColor();
 	ConstantBufferDataSpotLight->LightIntensity = ActorLight->GetIntensity();
 	ConstantBufferDataSpotLight->Angle = LX_DEGTORAD(ActorLight->GetSpotAngle()) * 0.5f;
-	ConstantBufferDataSpotLight->CastShadow = ActorLight->GetCastShadow();
+
+	// Spot shadows only, and no shadow without a tile in the shadow atlas
+	ConstantBufferDataSpotLight->CastShadow = ActorLight->GetType() == ELightType::Spot && ActorLight->GetCastShadow() && ConstantBufferDataSpotLight->ShadowMapCoords.z > 0.f;
 }
 
 ELightType LXRenderCluster::GetLightType() const
@@ -263,4 +327,80 @@ void LXRenderCluster::ReleaseShaders()
 		LXShaderProgramD3D11& shaderProgram = ShaderPrograms[i];
 		shaderProgram.Release();
 	}
-}
\ No newline at end of file
+
+	ReleaseInstancing();
+}
+
+void LXRenderCluster::ReleaseInstancing()
+{
+	InstancedPrimitive.reset();
+
+	for (int i = 0; i < (int)ERenderPass::Last; i++)
+	{
+		InstancedShaderPrograms[i].Release();
+	}
+}
+//------------------------------------------------------------------------------------------------------
+// Sort
+//------------------------------------------------------------------------------------------------------
+
+uint64 MakeRenderClusterStateKey(ERenderPass RenderPass, uint ShaderProgramId, uint MaterialId, uint PrimitiveId)
+{
+	return SortKeyField((uint)RenderPass, 4, kSortKeyPassShift) |
+		SortKeyField(ShaderProgramId, kSortKeyShaderProgramBits, kSortKeyShaderProgramShift) |
+		SortKeyField(MaterialId, kSortKeyMaterialBits, kSortKeyMaterialShift) |
+		SortKeyField(PrimitiveId, kSortKeyPrimitiveBits, kSortKeyPrimitiveShift);
+}
+
+uint64 MakeRenderClusterDepthKey(float SquaredDistance)
+{
+	// Positive floats compare as their bits: keeping the exponent and 7 mantissa bits
+	// gives a logarithmic quantization, without near and far planes.
+	uint Bits;
+	memcpy(&Bits, &SquaredDistance, sizeof(float));
+	return SquaredDistance > 0.f ? Bits >> (32 - kSortKeyDepthBits) : 0;
+}
+
+void SortRenderClusters(vector<TRenderClusterSortItem>& Items)
+{
+	// Scratch buffer per thread: the passes sort their lists while recording
+	thread_local vector<TRenderClusterSortItem> Temp;
+	Temp.resize(Items.size());
+
+	LXRadixSort64(Items.data(), Temp.data(), (uint)Items.size());
+}
+
+void SortRenderClusters(const LXRenderClusterStore& RenderClusterStore, const vector<uint>& Indices, ERenderPass RenderPass, const vec3f& ViewPosition, vector<LXRenderCluster*>& RenderClusters)
+{
+	RenderClusters.resize(Indices.size());
+
+	if (!CSet_SortRenderClusters.GetValue())
+	{
+		for (size_t i = 0; i < Indices.size(); i++)
+		{
+			RenderClusters[i] = RenderClusterStore.GetRenderCluster(Indices[i]);
+		}
+		return;
+	}
+
+	// Keys and bounds are read from the store arrays, the clusters are only dereferenced for the output
+	thread_local vector<TRenderClusterSortItem> Items;
+	Items.resize(Indices.size());
+
+	const uint64* SortKeys = RenderClusterStore.GetSortKeys(RenderPass);
+
+	for (size_t i = 0; i < Indices.size(); i++)
+	{
+		const uint Index = Indices[i];
+		const vec3f Delta = RenderClusterStore.GetCenter(Index) - ViewPosition;
+		const float SquaredDistance = Delta.x * Delta.x + Delta.y * Delta.y + Delta.z * Delta.z;
+		Items[i] = { SortKeys[Index] | MakeRenderClusterDepthKey(SquaredDistance), RenderClusterStore.GetRenderCluster(Index) };
+	}
+
+	SortRenderClusters(Items);
+
+	for (size_t i = 0; i < Indices.size(); i++)
+	{
+		RenderClusters[i] = Items[i].RenderCluster;
+	}
+}
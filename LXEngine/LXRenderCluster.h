@@ -13,6 +13,7 @@
 #include "LXConstantBufferD3D11.h"
 #include "LXShaderProgramD3D11.h"
 #include "LXRenderPass.h"
+#include "LXRenderClusterStore.h"
 #include "LXFlags.h"
 
 class LXActor;
@@ -25,6 +26,7 @@ class LXPrimitiveInstance;
 class LXRenderClusterManager;
 class LXRenderCommandList;
 class LXShaderD3D11;
+struct ID3D11Buffer;
 enum class ELightType;
 
 enum class ERenderClusterType
@@ -47,6 +49,7 @@ public:
 	~LXRenderCluster();
 
 	void ReleaseShaders();
+	void ReleaseInstancing();
 
 	bool SetMaterial(shared_ptr<LXMaterialD3D11>& InMaterial);
 	void SetPrimitive(shared_ptr<LXPrimitiveD3D11>& InPrimitiveD3D11);
@@ -58,6 +61,11 @@ public:
 	
 	void Render(ERenderPass RenderPass, LXRenderCommandList* RCL);
 
+	// Dynamic instancing
+	// Draws InstanceCount clusters sharing this Primitive and Material, their cb1 are in the InstanceBuffer from StartInstance.
+	bool CanBeInstanced() const;
+	void RenderInstanced(ERenderPass RenderPass, LXRenderCommandList* RCL, ID3D11Buffer* InstanceBuffer, uint InstanceCount, uint StartInstance);
+
 	// Cluster Specialization according the type
 	void SetLightParameters(LXActor* Actor);
 	void UpdateLightParameters(LXActor* Actor);
@@ -87,29 +95,48 @@ public:
 	bool ValidConstantBufferMatrix = false;
 	
 	bool CastShadow = false;
+	bool Occluder = false;
+
+	// Primitive LOD, selected from the screen size when visible
+	uint LOD = 0;
+
+	// Hot data in the LXRenderClusterStore (bounds, flags, sort keys)
+	TRenderClusterHandle Handle;
+
+	// LXRenderClusterManager frame of the last addition, move or change
+	uint64 ChangeFrame = 0;
 
 	LXFlagsRenderCluster Flags = ERenderClusterType::Surface;
+
+	// Dynamic instancing, set by the LXRenderClusterManager when other clusters share the Primitive and the Material.
+	shared_ptr<LXPrimitiveD3D11> InstancedPrimitive;
+	LXShaderProgramD3D11 InstancedShaderPrograms[(int)ERenderPass::Last];
+	LXConstantBufferD3D11* CBWorldIdentity = nullptr;
+
+private:
+
+	bool BindShaderProgram(const LXShaderProgramD3D11& ShaderProgram, LXConstantBufferD3D11* ConstantBufferWorld, LXRenderCommandList* RCL);
 };
 
-static bool SortRenderCluster(const LXRenderCluster& RC0, const LXRenderCluster& RC1)
+//
+// Sort keys, from the most significant bits: Pass | ShaderProgram | Material | Primitive | View depth.
+// The state part is stored per pass in the LXRenderClusterStore, the depth part is added for each view.
+//
+
+struct TRenderClusterSortItem
 {
-// 	VertexShader
-// 	PixelShader
-// 	HullShader
-// 	DomainShader
-// 	MaterialRenderProxy
-// 	VertexFactory
-// 	SceneTextureMode
-// 	bAllowGlobalFog
-// 	bEnableSkyLight
-// 	bEnableReceiveDecalOutput
-
-	CHK(0);
-
-// 	if (RC0.ShaderProgram->VertexShader != RC1.ShaderProgram->VertexShader) return false;
-// 	if (RC0.ShaderProgram->PixelShader != RC1.ShaderProgram->PixelShader) return false;
-// 	if (RC0.Material != RC1.Material) return false;
-// 	if (RC0.Primitive != RC1.Primitive) return false;
-
-	return true;
-};
\ No newline at end of file
+	uint64 Key;
+	LXRenderCluster* RenderCluster;
+};
+
+uint64 MakeRenderClusterStateKey(ERenderPass RenderPass, uint ShaderProgramId, uint MaterialId, uint PrimitiveId);
+
+// Quantized squared distance, increasing with the distance.
+uint64 MakeRenderClusterDepthKey(float SquaredDistance);
+
+// Sorts the store clusters at Indices by state, front to back from ViewPosition within a state bucket (Renderer.SortRenderClusters).
+// The result replaces the content of RenderClusters.
+void SortRenderClusters(const LXRenderClusterStore& RenderClusterStore, const vector<uint>& Indices, ERenderPass RenderPass, const vec3f& ViewPosition, vector<LXRenderCluster*>& RenderClusters);
+
+// Same, on prepared items (keys with the depth part).
+void SortRenderClusters(vector<TRenderClusterSortItem>& Items);
@@ -9,8 +9,11 @@
 #include "stdafx.h"
 #include "LXActor.h"
 #include "LXActorMesh.h"
+#include "LXConsoleManager.h"
 #include "LXController.h"
 #include "LXCore.h"
+#include "LXFrustum.h"
+#include "LXGeometryPoolD3D11.h"
 #include "LXLogger.h"
 #include "LXMaterial.h"
 #include "LXMaterialD3D11.h"
@@ -22,30 +25,60 @@
 #include "LXRenderClusterManager.h"
 #include "LXRenderer.h"
 #include "LXShaderManager.h"
+#include "LXThreadManager.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
+namespace
+{
+	LXConsoleCommandT<bool> CSet_BVHCulling(L"Engine.ini", L"Renderer", L"BVHCulling", L"true");
+	LXConsoleCommandT<bool> CSet_PackedVertices(L"Engine.ini", L"Renderer", L"PackedVertices", L"true");
+	LXConsoleCommandT<bool> CSet_GeometryPool(L"Engine.ini", L"Renderer", L"GeometryPool", L"true");
+
+	// Refit SAH cost over build SAH cost starting a background rebuild
+	const float kBVHRebuildRatio = 1.5f;
+};
+
 LXRenderClusterManager::LXRenderClusterManager()
 {
+	_GeometryPool = make_unique<LXGeometryPoolD3D11>();
 }
 
 LXRenderClusterManager::~LXRenderClusterManager()
 {
 	Empty();
+	LX_SAFE_DELETE(_CBWorldIdentity);
 }
 
 void LXRenderClusterManager::Empty()
 {
-	for (LXRenderCluster* RenderCluster : ListRenderClusters)
+	for (LXRenderCluster* RenderCluster : RenderClusterStore.GetRenderClusters())
 	{
 		delete RenderCluster;
 	}
 
-	ListRenderClusters.clear();
+	RenderClusterStore.Clear();
+	_RenderClusterBVH.Clear();
+	_LightIndices.clear();
+	_MovedIndices.clear();
+	_BVHDirty = false;
+	_PendingChangedBounds.clear();
+	_PendingChangedAll = true;
+
+	if (_BVHRebuild)
+	{
+		GetThreadManager()->Wait(_BVHRebuildCounter);
+		_BVHRebuild.reset();
+	}
+
 	ActorRenderCluster.clear();
 	PrimitiveInstanceRenderClusters.clear();
 	MaterialRenderClusters.clear();
 	MapPrimitiveD3D11.clear();
+	MapInstancedPrimitiveD3D11.clear();
 	MapMaterialD3D11.clear();
+	_ShaderProgramSortIds.clear();
+	_MaterialSortIds.clear();
+	_PrimitiveSortIds.clear();
 }
 
 void LXRenderClusterManager::DeleteUnusedMaterials()
@@ -65,6 +98,23 @@ void LXRenderClusterManager::DeleteUnusedMaterials()
 
 void LXRenderClusterManager::Tick()
 {
+	UpdateInstancing();
+	UpdateBVH();
+	PublishChanges();
+
+	for (auto It = MapInstancedPrimitiveD3D11.begin(); It != MapInstancedPrimitiveD3D11.end();)
+	{
+		// Delete the instanced PrimitiveD3D11 when referenced by the map only
+		if (It->second.use_count() == 1)
+		{
+			It = MapInstancedPrimitiveD3D11.erase(It);
+		}
+		else
+		{
+			It++;
+		}
+	}
+
 	auto it = MapPrimitiveD3D11.begin();
 	while (it != MapPrimitiveD3D11.end())
 	{
@@ -81,6 +131,9 @@ void LXRenderClusterManager::Tick()
 		}
 	}
 
+	_GeometryPool->Defragment();
+	_GeometryPool->UpdateStats();
+
 	DeleteUnusedMaterials();
 }
 
@@ -128,8 +181,11 @@ void LXRenderClusterManager::AddActor(LXActor* Actor)
 				{	
 					// Surface
 					RenderCluster->CastShadow = ActorMesh->GetCastShadows();
+					RenderCluster->Occluder = ActorMesh->GetOccluder();
 				}
 
+				UpdateStoreFlags(RenderCluster);
+
 				// Create and add primitive bounds
 				if (0)
 				{
@@ -213,7 +269,7 @@ void LXRenderClusterManager::UpdateActor(LXActor* Actor)
 void LXRenderClusterManager::RemoveActor(LXActor* Actor)
 {
 	list<LXRenderCluster*> ListRenderClusterToRemove;
-	for (LXRenderCluster* RenderCluster : ListRenderClusters)
+	for (LXRenderCluster* RenderCluster : RenderClusterStore.GetRenderClusters())
 	{
 		if (RenderCluster->Actor == Actor)
 		{
@@ -242,8 +298,11 @@ void LXRenderClusterManager::RemoveRenderCluster(LXRenderCluster* RenderCluster)
 {
 	CHK(RenderCluster);
 	
-	// Main list
-	ListRenderClusters.remove(RenderCluster);
+	AddChange(RenderCluster);
+
+	// Main store
+	RenderClusterStore.Remove(RenderCluster->Handle);
+	RenderCluster->Handle = TRenderClusterHandle();
 	
 	// Helper maps
 	/*
@@ -257,6 +316,9 @@ void LXRenderClusterManager::RemoveRenderCluster(LXRenderCluster* RenderCluster)
 	MaterialRenderClusters[Material].remove(RenderCluster);
 	
 	PrimitiveInstanceRenderClusters.erase(RenderCluster->PrimitiveInstance);
+
+	_InstancingDirty = true;
+	_BVHDirty = true;
 }
 
 void LXRenderClusterManager::UpdateMatrix(const LXRendererUpdateMatrix& RendererUpdateMatrix)
@@ -269,8 +331,12 @@ void LXRenderClusterManager::UpdateMatrix(const LXRendererUpdateMatrix& Renderer
 	if (It != PrimitiveInstanceRenderClusters.end())
 	{
 		LXRenderCluster* RenderCluster = It->second;
+		AddChange(RenderCluster);
 		RenderCluster->SetMatrix(RendererUpdateMatrix.Matrix);
 		RenderCluster->SetBBoxWorld(RendererUpdateMatrix.BBox);
+		RenderClusterStore.SetBBox(RenderCluster->Handle, RendererUpdateMatrix.BBox);
+		_MovedIndices.push_back(RenderClusterStore.GetIndex(RenderCluster->Handle));
+		AddChange(RenderCluster);
 	}
 }
 
@@ -279,6 +345,17 @@ void LXRenderClusterManager::UpdateMaterial(const LXMaterial* Material)
 	if (LXMaterialD3D11* MaterialD3D11 = GetMaterial(Material))
 	{
 		MaterialD3D11->Update(Material);
+
+		// The transparency may have changed
+		auto It = MaterialRenderClusters.find(Material);
+		if (It != MaterialRenderClusters.end())
+		{
+			for (LXRenderCluster* RenderCluster : It->second)
+			{
+				UpdateStoreFlags(RenderCluster);
+				AddChange(RenderCluster);
+			}
+		}
 	}
 }
 
@@ -302,9 +379,10 @@ shared_ptr<LXMaterialD3D11>& LXRenderClusterManager::GetMaterialD3D11(const LXMa
 	}		
 }
 
-shared_ptr<LXPrimitiveD3D11>& LXRenderClusterManager::GetPrimitiveD3D11(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition/* = nullptr*/)
+shared_ptr<LXPrimitiveD3D11>& LXRenderClusterManager::GetPrimitiveD3D11(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition/* = nullptr*/, bool Packed/* = false*/)
 {
-	auto It = MapPrimitiveD3D11.find(pair<LXPrimitive*, uint>(Primitive, ArrayInstancePosition ? (uint)ArrayInstancePosition->size() : 0));
+	const auto Key = make_tuple(Primitive, ArrayInstancePosition ? (uint)ArrayInstancePosition->size() : 0, Packed);
+	auto It = MapPrimitiveD3D11.find(Key);
 
 	if (It != MapPrimitiveD3D11.end())
 	{
@@ -312,9 +390,8 @@ shared_ptr<LXPrimitiveD3D11>& LXRenderClusterManager::GetPrimitiveD3D11(LXPrimit
 	}
 	else
 	{
-		const auto Key = pair<LXPrimitive*, uint>(Primitive, ArrayInstancePosition ? (uint)ArrayInstancePosition->size() : 0);
 		MapPrimitiveD3D11[Key] = make_shared<LXPrimitiveD3D11>();
-		MapPrimitiveD3D11[Key]->Create(Primitive, ArrayInstancePosition);
+		MapPrimitiveD3D11[Key]->Create(Primitive, ArrayInstancePosition, Packed, CSet_GeometryPool.GetValue() ? _GeometryPool.get() : nullptr);
 		return MapPrimitiveD3D11[Key];
 	}
 }
@@ -343,10 +420,336 @@ bool LXRenderClusterManager::GetMaterialAndShadersD3D11(LXRenderCluster* renderC
 	}
 
 	renderCluster->SetMaterial(MaterialD3D11);
+	UpdateSortKeys(renderCluster);
+	UpdateStoreFlags(renderCluster);
+	_InstancingDirty = true;
 
 	return true;
 }
 
+void LXRenderClusterManager::UpdateSortKeys(LXRenderCluster* RenderCluster)
+{
+	// Not in the store yet, done when added
+	if (!RenderClusterStore.IsValid(RenderCluster->Handle))
+		return;
+
+	// Identifiers are never released: a reused address only shares the bucket of a deleted object.
+	auto GetSortId = [](auto& SortIds, const auto& Key)
+	{
+		auto It = SortIds.find(Key);
+		if (It != SortIds.end())
+			return It->second;
+
+		const uint Id = (uint)SortIds.size();
+		SortIds[Key] = Id;
+		return Id;
+	};
+
+	const uint MaterialId = GetSortId(_MaterialSortIds, (const void*)RenderCluster->Material.get());
+	const uint PrimitiveId = GetSortId(_PrimitiveSortIds, (const void*)RenderCluster->Primitive.get());
+
+	for (int i = 0; i < (int)ERenderPass::Last; i++)
+	{
+		const LXShaderProgramD3D11& ShaderProgram = RenderCluster->ShaderPrograms[i];
+		const TShaderProgramKey ShaderProgramKey(ShaderProgram.VertexShader.get(), ShaderProgram.HullShader.get(), ShaderProgram.DomainShader.get(), ShaderProgram.GeometryShader.get(), ShaderProgram.PixelShader.get());
+		const uint ShaderProgramId = GetSortId(_ShaderProgramSortIds, ShaderProgramKey);
+		RenderClusterStore.SetSortKey(RenderCluster->Handle, (ERenderPass)i, MakeRenderClusterStateKey((ERenderPass)i, ShaderProgramId, MaterialId, PrimitiveId));
+	}
+}
+
+void LXRenderClusterManager::UpdateStoreFlags(LXRenderCluster* RenderCluster)
+{
+	if (!RenderClusterStore.IsValid(RenderCluster->Handle))
+		return;
+
+	uint Flags = (int)RenderCluster->Flags;
+
+	if (RenderCluster->CastShadow)
+		Flags |= kRenderClusterCastShadow;
+
+	if (RenderCluster->Material && RenderCluster->IsTransparent())
+		Flags |= kRenderClusterTransparent;
+
+	if (RenderCluster->Occluder)
+		Flags |= kRenderClusterOccluder;
+
+	// The lights are kept out of the BVH
+	const uint Index = RenderClusterStore.GetIndex(RenderCluster->Handle);
+	if ((RenderClusterStore.GetFlags()[Index] ^ Flags) & (uint)ERenderClusterType::Light)
+		_BVHDirty = true;
+
+	if (RenderClusterStore.GetFlags()[Index] != Flags)
+		AddChange(RenderCluster);
+
+	RenderClusterStore.SetFlags(RenderCluster->Handle, Flags);
+}
+
+void LXRenderClusterManager::UpdateBVH()
+{
+	if (_BVHRebuild && _BVHRebuildCounter.IsDone())
+		EndBVHRebuild();
+
+	// Also when Renderer.BVHCulling changes
+	if (!_BVHDirty && _BVHValid == CSet_BVHCulling.GetValue())
+	{
+		RefitBVH();
+		return;
+	}
+
+	_BVHDirty = false;
+	_BVHValid = CSet_BVHCulling.GetValue();
+	_MovedIndices.clear();
+
+	// The store indices changed
+	if (_BVHRebuild)
+		_BVHRebuild->Discarded = true;
+
+	vector<uint> Items;
+	GetBVHItems(Items);
+
+	if (_BVHValid && !Items.empty())
+	{
+		_RenderClusterBVH.Build(RenderClusterStore.GetFrustumBoxes(), Items);
+	}
+	else
+	{
+		_RenderClusterBVH.Clear();
+	}
+}
+
+void LXRenderClusterManager::GetBVHItems(vector<uint>& Items)
+{
+	_LightIndices.clear();
+
+	const uint* Flags = RenderClusterStore.GetFlags();
+	for (uint i = 0; i < RenderClusterStore.GetCount(); i++)
+	{
+		if (Flags[i] & (uint)ERenderClusterType::Light)
+			_LightIndices.push_back(i);
+		else
+			Items.push_back(i);
+	}
+}
+
+void LXRenderClusterManager::RefitBVH()
+{
+	if (_MovedIndices.empty())
+		return;
+
+	if (_RenderClusterBVH.IsEmpty())
+	{
+		_MovedIndices.clear();
+		return;
+	}
+
+	const TFrustumBoxes Boxes = RenderClusterStore.GetFrustumBoxes();
+	const uint* Flags = RenderClusterStore.GetFlags();
+
+	for (uint Index : _MovedIndices)
+	{
+		if (Flags[Index] & (uint)ERenderClusterType::Light)
+			continue;
+
+		_RenderClusterBVH.UpdateItem(Index, vec3f(Boxes.MinX[Index], Boxes.MinY[Index], Boxes.MinZ[Index]), vec3f(Boxes.MaxX[Index], Boxes.MaxY[Index], Boxes.MaxZ[Index]));
+	}
+
+	_RenderClusterBVH.Refit();
+
+	if (_BVHRebuild)
+	{
+		_BVHRebuild->MovedIndices.insert(_BVHRebuild->MovedIndices.end(), _MovedIndices.begin(), _MovedIndices.end());
+	}
+	else if (_RenderClusterBVH.GetCost() > _RenderClusterBVH.GetBuildCost() * kBVHRebuildRatio)
+	{
+		StartBVHRebuild();
+	}
+
+	_MovedIndices.clear();
+}
+
+void LXRenderClusterManager::StartBVHRebuild()
+{
+	CHK(!_BVHRebuild);
+	_BVHRebuild = make_unique<TBVHRebuild>();
+	TBVHRebuild* Rebuild = _BVHRebuild.get();
+
+	// The worker reads a copy of the boxes: the store keeps changing
+	const TFrustumBoxes Boxes = RenderClusterStore.GetFrustumBoxes();
+	const float* Sources[6] = { Boxes.MinX, Boxes.MinY, Boxes.MinZ, Boxes.MaxX, Boxes.MaxY, Boxes.MaxZ };
+
+	for (uint i = 0; i < 6; i++)
+	{
+		Rebuild->Boxes[i].assign(Sources[i], Sources[i] + Boxes.Count);
+	}
+
+	Rebuild->Items.reserve(Boxes.Count - _LightIndices.size());
+	const uint* Flags = RenderClusterStore.GetFlags();
+	for (uint i = 0; i < Boxes.Count; i++)
+	{
+		if (!(Flags[i] & (uint)ERenderClusterType::Light))
+			Rebuild->Items.push_back(i);
+	}
+
+	GetThreadManager()->RunBackground([Rebuild]()
+	{
+		TFrustumBoxes Boxes;
+		Boxes.MinX = Rebuild->Boxes[0].data();
+		Boxes.MinY = Rebuild->Boxes[1].data();
+		Boxes.MinZ = Rebuild->Boxes[2].data();
+		Boxes.MaxX = Rebuild->Boxes[3].data();
+		Boxes.MaxY = Rebuild->Boxes[4].data();
+		Boxes.MaxZ = Rebuild->Boxes[5].data();
+		Boxes.Count = (uint)Rebuild->Boxes[0].size();
+		Rebuild->BVH.Build(Boxes, Rebuild->Items);
+	}, &_BVHRebuildCounter);
+}
+
+void LXRenderClusterManager::EndBVHRebuild()
+{
+	unique_ptr<TBVHRebuild> Rebuild = std::move(_BVHRebuild);
+
+	if (Rebuild->Discarded || !_BVHValid)
+		return;
+
+	_RenderClusterBVH = std::move(Rebuild->BVH);
+
+	// Catch up with the moves since the copy
+	_MovedIndices.insert(_MovedIndices.end(), Rebuild->MovedIndices.begin(), Rebuild->MovedIndices.end());
+}
+
+void LXRenderClusterManager::AddChange(LXRenderCluster* RenderCluster)
+{
+	// Published by the next Tick
+	RenderCluster->ChangeFrame = _Frame + 1;
+	_PendingChangedBounds.push_back(RenderCluster->BBoxWorld);
+}
+
+void LXRenderClusterManager::PublishChanges()
+{
+	_Frame++;
+	_ChangedBounds.swap(_PendingChangedBounds);
+	_PendingChangedBounds.clear();
+	_ChangedAll = _PendingChangedAll;
+	_PendingChangedAll = false;
+}
+
+void LXRenderClusterManager::CullRenderClusters(const LXFrustum& Frustum, vector<uint>& Indices) const
+{
+	if (_BVHValid && !_BVHDirty)
+	{
+		_RenderClusterBVH.QueryFrustum(Frustum, Indices);
+	}
+	else
+	{
+		const TFrustumBoxes Boxes = RenderClusterStore.GetFrustumBoxes();
+		const uint First = (uint)Indices.size();
+		Indices.resize(First + Boxes.Count);
+		Indices.resize(First + Frustum.CullBoxes(Boxes, Indices.data() + First));
+	}
+}
+
+bool LXRenderClusterManager::GetBounds(vec3f& Min, vec3f& Max) const
+{
+	if (_BVHValid && !_BVHDirty)
+		return _RenderClusterBVH.GetBounds(Min, Max);
+
+	const TFrustumBoxes Boxes = RenderClusterStore.GetFrustumBoxes();
+	if (Boxes.Count == 0)
+		return false;
+
+	Min = vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+	Max = vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (uint i = 0; i < Boxes.Count; i++)
+	{
+		Min.x = std::min(Min.x, Boxes.MinX[i]);
+		Min.y = std::min(Min.y, Boxes.MinY[i]);
+		Min.z = std::min(Min.z, Boxes.MinZ[i]);
+		Max.x = std::max(Max.x, Boxes.MaxX[i]);
+		Max.y = std::max(Max.y, Boxes.MaxY[i]);
+		Max.z = std::max(Max.z, Boxes.MaxZ[i]);
+	}
+
+	return true;
+}
+
+void LXRenderClusterManager::UpdateInstancing()
+{
+	if (!_InstancingDirty)
+		return;
+
+	_InstancingDirty = false;
+
+	if (!_CBWorldIdentity)
+	{
+		LXConstantBufferData1 Identity;
+		_CBWorldIdentity = new LXConstantBufferD3D11();
+		_CBWorldIdentity->CreateConstantBuffer(&Identity, sizeof(LXConstantBufferData1));
+	}
+
+	// Clusters sharing the Primitive and the Material, so the shaders
+	map<pair<const LXPrimitiveD3D11*, const LXMaterialD3D11*>, vector<LXRenderCluster*>> Groups;
+
+	for (LXRenderCluster* RenderCluster : RenderClusterStore.GetRenderClusters())
+	{
+		if (RenderCluster->CanBeInstanced())
+		{
+			Groups[make_pair(RenderCluster->Primitive.get(), RenderCluster->Material.get())].push_back(RenderCluster);
+		}
+		else
+		{
+			RenderCluster->ReleaseInstancing();
+		}
+	}
+
+	for (auto& It : Groups)
+	{
+		vector<LXRenderCluster*>& RenderClusters = It.second;
+
+		if (RenderClusters.size() < 2)
+		{
+			RenderClusters[0]->ReleaseInstancing();
+			continue;
+		}
+
+		// Instanced variants, shared by the group
+		LXRenderCluster* First = RenderClusters[0];
+
+		shared_ptr<LXPrimitiveD3D11>& InstancedPrimitive = MapInstancedPrimitiveD3D11[First->Primitive.get()];
+		if (!InstancedPrimitive)
+		{
+			InstancedPrimitive = make_shared<LXPrimitiveD3D11>();
+			InstancedPrimitive->CreateInstanced(First->Primitive.get());
+		}
+
+		LXShaderProgramD3D11 ShaderPrograms[(int)ERenderPass::Last];
+		for (int i = 0; i < (int)ERenderPass::Last; i++)
+		{
+			// A pass without valid shaders is not instanced
+			if (!GetShadersD3D11((ERenderPass)i, InstancedPrimitive.get(), First->Material.get(), &ShaderPrograms[i]))
+			{
+				ShaderPrograms[i].Release();
+			}
+		}
+
+		for (LXRenderCluster* RenderCluster : RenderClusters)
+		{
+			RenderCluster->InstancedPrimitive = InstancedPrimitive;
+			RenderCluster->CBWorldIdentity = _CBWorldIdentity;
+
+			for (int i = 0; i < (int)ERenderPass::Last; i++)
+			{
+				LXShaderProgramD3D11* RenderClusterShaderProgram = &RenderCluster->InstancedShaderPrograms[i];
+				RenderClusterShaderProgram->VertexShader = ShaderPrograms[i].VertexShader;
+				RenderClusterShaderProgram->HullShader = ShaderPrograms[i].HullShader;
+				RenderClusterShaderProgram->DomainShader = ShaderPrograms[i].DomainShader;
+				RenderClusterShaderProgram->GeometryShader = ShaderPrograms[i].GeometryShader;
+				RenderClusterShaderProgram->PixelShader = ShaderPrograms[i].PixelShader;
+			}
+		}
+	}
+}
+
 void LXRenderClusterManager::RebuildMaterial(const LXMaterial* material)
 {
 	// Release cluster Shaders
@@ -401,6 +804,14 @@ bool LXRenderClusterManager::GetShadersD3D11(ERenderPass renderPass, const LXPri
 	}
 }
 	
+void LXRenderClusterManager::PreRenderMaterials(LXRenderCommandList* RCL)
+{
+	for (auto& It : MapMaterialD3D11)
+	{
+		It.second->PreRender(RCL);
+	}
+}
+
 LXMaterialD3D11* LXRenderClusterManager::GetMaterial(const LXMaterial* Material)
 {
 	auto It = MapMaterialD3D11.find(Material);
@@ -425,15 +836,18 @@ LXRenderCluster* LXRenderClusterManager::CreateRenderCluster(LXActorMesh* Actor,
 	// PrimitiveInstance 
 	RenderCluster->PrimitiveInstance = PrimitiveInstance;
 
-	// Create or Retrieve the PrimitiiveD3D11 according the Primitive
-	shared_ptr<LXPrimitiveD3D11>& PrimitiveD3D11 = GetPrimitiveD3D11(Primitive, (Actor->GetInsanceCount()) > 0 ? &Actor->GetArrayInstancePosition() : nullptr);
-	RenderCluster->SetPrimitive(PrimitiveD3D11);
-
 	if (Material == nullptr)
 	{
 		Material = GetCore().GetDefaultMaterial();
 		CHK(Material);
 	}
+
+	// Packed vertices, unless displaced: the displacement would be in the packed position unit
+	const bool Packed = CSet_PackedVertices.GetValue() && !GetMaterialD3D11(Material)->HasDisplacement();
+
+	// Create or Retrieve the PrimitiiveD3D11 according the Primitive
+	shared_ptr<LXPrimitiveD3D11>& PrimitiveD3D11 = GetPrimitiveD3D11(Primitive, (Actor->GetInsanceCount()) > 0 ? &Actor->GetArrayInstancePosition() : nullptr, Packed);
+	RenderCluster->SetPrimitive(PrimitiveD3D11);
 	
 	if (GetMaterialAndShadersD3D11(RenderCluster, Material, PrimitiveD3D11.get()) == false)
 	{
@@ -446,7 +860,12 @@ LXRenderCluster* LXRenderClusterManager::CreateRenderCluster(LXActorMesh* Actor,
 		}
 	}
 
-	ListRenderClusters.push_back(RenderCluster);
+	RenderCluster->Handle = RenderClusterStore.Add(RenderCluster, BBoxWorld, 0);
+	UpdateSortKeys(RenderCluster);
+	UpdateStoreFlags(RenderCluster);
+	AddChange(RenderCluster);
+	_BVHDirty = true;
+
 	ActorRenderCluster[Actor].push_back(RenderCluster);
 	MaterialRenderClusters[Material].push_back(RenderCluster);
 
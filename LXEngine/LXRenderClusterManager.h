@@ -8,10 +8,18 @@
 
 #pragma 
 
+#include "LXBBox.h"
+#include "LXRenderClusterStore.h"
 #include "LXRenderPass.h"
+#include "LXSpacePartitioning.h"
+#include "LXThreadManager.h"
+#include <tuple>
 
 class LXActor;
 class LXActorMesh;
+class LXConstantBufferD3D11;
+class LXFrustum;
+class LXGeometryPoolD3D11;
 class LXMaterial;
 class LXMaterialD3D11;
 class LXPrimitive;
@@ -47,6 +55,23 @@ public:
 	void UpdateMaterial(const LXMaterial* Material);
 	void RebuildMaterial(const LXMaterial* Material);
 	LXMaterialD3D11* GetMaterial(const LXMaterial* Material);
+	void PreRenderMaterials(LXRenderCommandList* RCL);
+
+	// Culling, valid after Tick
+	// Appends the indices in the RenderClusterStore of the clusters visible in the Frustum (Renderer.BVHCulling: BVH or flat test).
+	// The lights are not culled and may be omitted, see GetLightIndices.
+	void CullRenderClusters(const LXFrustum& Frustum, vector<uint>& Indices) const;
+	const vector<uint>& GetLightIndices() const { return _LightIndices; }
+
+	// World bounds of the clusters, false when empty
+	bool GetBounds(vec3f& Min, vec3f& Max) const;
+
+	// Changes, for the caches of the passes
+	// Incremented by Tick, which publishes the world bounds of the clusters added, removed, moved (before and after) or changed since the previous Tick.
+	// With IsChangedAll, every cluster has to be considered changed.
+	uint64 GetFrame() const { return _Frame; }
+	const vector<LXBBox>& GetChangedBounds() const { return _ChangedBounds; }
+	bool IsChangedAll() const { return _ChangedAll; }
 
 	// Misc
 	const map<LXActor*, list<LXRenderCluster*>>& GetActors() { return ActorRenderCluster; }
@@ -55,19 +80,30 @@ private:
 
 	void DeleteUnusedMaterials();
 	shared_ptr<LXMaterialD3D11>& GetMaterialD3D11(const LXMaterial* Material);
-	shared_ptr<LXPrimitiveD3D11>& GetPrimitiveD3D11(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition = nullptr);
+	shared_ptr<LXPrimitiveD3D11>& GetPrimitiveD3D11(LXPrimitive* Primitive, const ArrayVec3f* ArrayInstancePosition = nullptr, bool Packed = false);
 	bool GetMaterialAndShadersD3D11(LXRenderCluster* renderCluster, const LXMaterial* Material, const LXPrimitiveD3D11* PrimitiveD3D11);
 	bool GetShadersD3D11(ERenderPass renderPass, const LXPrimitiveD3D11* primitiveD3D11, const LXMaterialD3D11* materialD3D11, LXShaderProgramD3D11* shaderProgram);
+	void UpdateSortKeys(LXRenderCluster* RenderCluster);
+	void UpdateStoreFlags(LXRenderCluster* RenderCluster);
+	void UpdateInstancing();
+	void UpdateBVH();
+	void AddChange(LXRenderCluster* RenderCluster);
+	void PublishChanges();
+	void RefitBVH();
+	void StartBVHRebuild();
+	void EndBVHRebuild();
+	void GetBVHItems(vector<uint>& Items);
 	LXRenderCluster* CreateRenderCluster(LXActorMesh* Actor, LXPrimitiveInstance* PrimitiveInstance, const LXMatrix& MatrixWCS, const LXBBox& BBoxWorld, LXPrimitive* Primitive, LXMaterial* Material);
 
-	// Remove the RenderCluster from the Rendering (ListRendersClusters)
+	// Remove the RenderCluster from the Rendering (RenderClusterStore)
 	// Plus the additional helper maps
 	// The RenderCluster is not deleted.
 	void RemoveRenderCluster(LXRenderCluster* RenderCluster);
 
 public:
 
-	list<LXRenderCluster*> ListRenderClusters;
+	// Rendered clusters, packed for the culling and the sort
+	LXRenderClusterStore RenderClusterStore;
 		
 private:
 
@@ -83,7 +119,59 @@ private:
 	// D3D11 Shared Resources
 	//
 
+	unique_ptr<LXGeometryPoolD3D11> _GeometryPool;	// Before the primitives, which return their allocations when deleted
 	map<const LXMaterial*, shared_ptr<LXMaterialD3D11>> MapMaterialD3D11;
-	map<pair<LXPrimitive*, uint>, shared_ptr<LXPrimitiveD3D11>> MapPrimitiveD3D11;
+	map<tuple<LXPrimitive*, uint, bool>, shared_ptr<LXPrimitiveD3D11>> MapPrimitiveD3D11;	// Primitive, InstancePosition count, Packed
+
+	//
+	// Dynamic instancing
+	//
+
+	map<const LXPrimitiveD3D11*, shared_ptr<LXPrimitiveD3D11>> MapInstancedPrimitiveD3D11;
+	LXConstantBufferD3D11* _CBWorldIdentity = nullptr;
+	bool _InstancingDirty = false;
+
+	//
+	// Culling, rebuilt when clusters are added or removed, refit when they move.
+	// The BVH does not contain the lights.
+	//
+
+	LXBVH _RenderClusterBVH;
+	vector<uint> _LightIndices;
+	vector<uint> _MovedIndices;
+	bool _BVHDirty = false;
+	bool _BVHValid = false;
+
+	// Built on a worker when the refits degraded the BVH, then swapped at a later Tick
+	struct TBVHRebuild
+	{
+		LXBVH BVH;
+		vector<float> Boxes[6];
+		vector<uint> Items;
+		vector<uint> MovedIndices;	// Moved during the build, refit after the swap
+		bool Discarded = false;		// Clusters added or removed during the build
+	};
+
+	unique_ptr<TBVHRebuild> _BVHRebuild;
+	LXTaskCounter _BVHRebuildCounter;
+
+	//
+	// Changes, published by Tick
+	//
+
+	uint64 _Frame = 0;
+	vector<LXBBox> _ChangedBounds;
+	vector<LXBBox> _PendingChangedBounds;
+	bool _ChangedAll = true;
+	bool _PendingChangedAll = false;
+
+	//
+	// Dense identifiers used by the RenderCluster sort keys
+	//
+
+	typedef std::tuple<const void*, const void*, const void*, const void*, const void*> TShaderProgramKey;
+	map<TShaderProgramKey, uint> _ShaderProgramSortIds;
+	map<const void*, uint> _MaterialSortIds;
+	map<const void*, uint> _PrimitiveSortIds;
 };
 
@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXRenderClusterStore.h"
+#include "LXBBox.h"
+#include "LXFrustum.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+TRenderClusterHandle LXRenderClusterStore::Add(LXRenderCluster* RenderCluster, const LXBBox& BBox, uint Flags)
+{
+	CHK(RenderCluster);
+
+	TRenderClusterHandle Handle;
+
+	if (_FreeSlots.empty())
+	{
+		Handle.Slot = (uint)_SlotIndices.size();
+		_SlotIndices.push_back(0);
+		_SlotGenerations.push_back(0);
+	}
+	else
+	{
+		Handle.Slot = _FreeSlots.back();
+		_FreeSlots.pop_back();
+	}
+
+	Handle.Generation = _SlotGenerations[Handle.Slot];
+	_SlotIndices[Handle.Slot] = GetCount();
+
+	_MinX.push_back(0.f);
+	_MinY.push_back(0.f);
+	_MinZ.push_back(0.f);
+	_MaxX.push_back(0.f);
+	_MaxY.push_back(0.f);
+	_MaxZ.push_back(0.f);
+	_Flags.push_back(Flags);
+
+	for (vector<uint64>& SortKeys : _SortKeys)
+	{
+		SortKeys.push_back(0);
+	}
+
+	_RenderClusters.push_back(RenderCluster);
+	_Slots.push_back(Handle.Slot);
+
+	SetBBox(Handle, BBox);
+	return Handle;
+}
+
+void LXRenderClusterStore::Remove(TRenderClusterHandle Handle)
+{
+	const uint Index = GetIndex(Handle);
+	const uint Last = GetCount() - 1;
+
+	// The last cluster fills the hole
+	if (Index != Last)
+	{
+		_MinX[Index] = _MinX[Last];
+		_MinY[Index] = _MinY[Last];
+		_MinZ[Index] = _MinZ[Last];
+		_MaxX[Index] = _MaxX[Last];
+		_MaxY[Index] = _MaxY[Last];
+		_MaxZ[Index] = _MaxZ[Last];
+		_Flags[Index] = _Flags[Last];
+
+		for (vector<uint64>& SortKeys : _SortKeys)
+		{
+			SortKeys[Index] = SortKeys[Last];
+		}
+
+		_RenderClusters[Index] = _RenderClusters[Last];
+		_Slots[Index] = _Slots[Last];
+		_SlotIndices[_Slots[Index]] = Index;
+	}
+
+	_MinX.pop_back();
+	_MinY.pop_back();
+	_MinZ.pop_back();
+	_MaxX.pop_back();
+	_MaxY.pop_back();
+	_MaxZ.pop_back();
+	_Flags.pop_back();
+
+	for (vector<uint64>& SortKeys : _SortKeys)
+	{
+		SortKeys.pop_back();
+	}
+
+	_RenderClusters.pop_back();
+	_Slots.pop_back();
+
+	// Invalidates the outstanding handles
+	_SlotGenerations[Handle.Slot]++;
+	_FreeSlots.push_back(Handle.Slot);
+}
+
+void LXRenderClusterStore::Clear()
+{
+	_MinX.clear();
+	_MinY.clear();
+	_MinZ.clear();
+	_MaxX.clear();
+	_MaxY.clear();
+	_MaxZ.clear();
+	_Flags.clear();
+
+	for (vector<uint64>& SortKeys : _SortKeys)
+	{
+		SortKeys.clear();
+	}
+
+	_RenderClusters.clear();
+	_Slots.clear();
+
+	// Generations are kept: the handles of the cleared clusters stay invalid
+	_FreeSlots.clear();
+	for (uint Slot = 0; Slot < (uint)_SlotIndices.size(); Slot++)
+	{
+		_SlotGenerations[Slot]++;
+		_FreeSlots.push_back(Slot);
+	}
+}
+
+bool LXRenderClusterStore::IsValid(TRenderClusterHandle Handle) const
+{
+	return Handle.Slot < _SlotGenerations.size() && _SlotGenerations[Handle.Slot] == Handle.Generation && _SlotIndices[Handle.Slot] < GetCount() && _Slots[_SlotIndices[Handle.Slot]] == Handle.Slot;
+}
+
+uint LXRenderClusterStore::GetIndex(TRenderClusterHandle Handle) const
+{
+	CHK(IsValid(Handle));
+	return _SlotIndices[Handle.Slot];
+}
+
+void LXRenderClusterStore::SetBBox(TRenderClusterHandle Handle, const LXBBox& BBox)
+{
+	const uint Index = GetIndex(Handle);
+	const vec3f& Min = BBox.GetMin();
+	const vec3f& Max = BBox.GetMax();
+
+	_MinX[Index] = Min.x;
+	_MinY[Index] = Min.y;
+	_MinZ[Index] = Min.z;
+	_MaxX[Index] = Max.x;
+	_MaxY[Index] = Max.y;
+	_MaxZ[Index] = Max.z;
+}
+
+TFrustumBoxes LXRenderClusterStore::GetFrustumBoxes() const
+{
+	TFrustumBoxes Boxes;
+	Boxes.MinX = _MinX.data();
+	Boxes.MinY = _MinY.data();
+	Boxes.MinZ = _MinZ.data();
+	Boxes.MaxX = _MaxX.data();
+	Boxes.MaxY = _MaxY.data();
+	Boxes.MaxZ = _MaxZ.data();
+	Boxes.Count = GetCount();
+	return Boxes;
+}
+
+void LXRenderClusterStore::SetFlags(TRenderClusterHandle Handle, uint Flags)
+{
+	_Flags[GetIndex(Handle)] = Flags;
+}
+
+void LXRenderClusterStore::SetSortKey(TRenderClusterHandle Handle, ERenderPass RenderPass, uint64 SortKey)
+{
+	_SortKeys[(int)RenderPass][GetIndex(Handle)] = SortKey;
+}
@@ -0,0 +1,90 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXRenderPass.h"
+
+class LXBBox;
+class LXRenderCluster;
+struct TFrustumBoxes;
+
+//
+// Stable reference to a RenderCluster in the LXRenderClusterStore.
+// A handle of a removed cluster is invalid, even when its slot is reused.
+//
+
+struct TRenderClusterHandle
+{
+	static const uint kInvalidSlot = 0xFFFFFFFF;
+
+	uint Slot = kInvalidSlot;
+	uint Generation = 0;
+};
+
+// Store flags: the ERenderClusterType bits, completed by
+const uint kRenderClusterCastShadow = LX_BIT(8);
+const uint kRenderClusterTransparent = LX_BIT(9);
+const uint kRenderClusterOccluder = LX_BIT(10);
+
+//
+// Packed storage of the RenderCluster data read by the culling and the sort, in structure of arrays.
+// The arrays are dense, [0, GetCount()): a removal moves the last cluster in the hole, so an index
+// is only valid until the next removal. The LXRenderCluster objects hold the cold data.
+//
+
+class LXRenderClusterStore
+{
+
+public:
+
+	TRenderClusterHandle Add(LXRenderCluster* RenderCluster, const LXBBox& BBox, uint Flags);
+	void Remove(TRenderClusterHandle Handle);
+	void Clear();
+
+	bool IsValid(TRenderClusterHandle Handle) const;
+	uint GetIndex(TRenderClusterHandle Handle) const;
+
+	void SetBBox(TRenderClusterHandle Handle, const LXBBox& BBox);
+	void SetFlags(TRenderClusterHandle Handle, uint Flags);
+	void SetSortKey(TRenderClusterHandle Handle, ERenderPass RenderPass, uint64 SortKey);
+
+	// Dense arrays
+	uint GetCount() const { return (uint)_RenderClusters.size(); }
+	LXRenderCluster* GetRenderCluster(uint Index) const { return _RenderClusters[Index]; }
+	const vector<LXRenderCluster*>& GetRenderClusters() const { return _RenderClusters; }
+
+	const float* GetMinX() const { return _MinX.data(); }
+	const float* GetMinY() const { return _MinY.data(); }
+	const float* GetMinZ() const { return _MinZ.data(); }
+	const float* GetMaxX() const { return _MaxX.data(); }
+	const float* GetMaxY() const { return _MaxY.data(); }
+	const float* GetMaxZ() const { return _MaxZ.data(); }
+	const uint* GetFlags() const { return _Flags.data(); }
+	const uint64* GetSortKeys(ERenderPass RenderPass) const { return _SortKeys[(int)RenderPass].data(); }
+	TFrustumBoxes GetFrustumBoxes() const;
+
+	vec3f GetCenter(uint Index) const { return vec3f((_MinX[Index] + _MaxX[Index]) * 0.5f, (_MinY[Index] + _MaxY[Index]) * 0.5f, (_MinZ[Index] + _MaxZ[Index]) * 0.5f); }
+
+private:
+
+	// Hot data
+	vector<float> _MinX, _MinY, _MinZ;
+	vector<float> _MaxX, _MaxY, _MaxZ;
+	vector<uint> _Flags;
+	vector<uint64> _SortKeys[(int)ERenderPass::Last];
+
+	// Cold data and owner slot of each index
+	vector<LXRenderCluster*> _RenderClusters;
+	vector<uint> _Slots;
+
+	// Slot to index indirection
+	vector<uint> _SlotIndices;
+	vector<uint> _SlotGenerations;
+	vector<uint> _FreeSlots;
+};
@@ -1,19 +0,0 @@
-//------------------------------------------------------------------------------------------------------
-//
-// This is a part of Seetron Engine
-//
-// Copyright (c) 2018 Nicolas Arques. All rights reserved.
-//
-//------------------------------------------------------------------------------------------------------
-
-#include "stdafx.h"
-#include "LXRenderCommand.h"
-
-LXRenderCommand::LXRenderCommand()
-{
-}
-
-
-LXRenderCommand::~LXRenderCommand()
-{
-}
@@ -8,14 +8,16 @@
 
 #pragma once
 
-class LXRenderCommand
-{
-
-public:
+// Defined in LXRenderCommandList.h from the LXRenderCommands.h table.
+enum class ERenderCommand : uint16;
 
-	LXRenderCommand();
-	virtual ~LXRenderCommand();
+//
+// Header of every record stored in a LXRenderCommandBuffer.
+// Commands are plain data: they are never destroyed, the buffer is simply rewound.
+//
 
-	virtual void Execute(class LXRenderCommandList*) = 0;
+struct LXRenderCommand
+{
+	ERenderCommand Type;
+	uint16 Size; // Record size in bytes, header included
 };
-
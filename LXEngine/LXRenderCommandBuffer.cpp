@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXRenderCommandBuffer.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+LXRenderCommandBuffer::LXRenderCommandBuffer(uint InBlockSize):_BlockSize(InBlockSize)
+{
+	CHK(_BlockSize % kAlignment == 0);
+	_Blocks.push_back({ new uint8[_BlockSize], 0 });
+}
+
+LXRenderCommandBuffer::~LXRenderCommandBuffer()
+{
+	for (TBlock& Block : _Blocks)
+	{
+		delete[] Block.Data;
+	}
+}
+
+void LXRenderCommandBuffer::Reset()
+{
+	// Following blocks are rewound by NextBlock() when reached.
+	_CurrentBlock = 0;
+	_Blocks[0].Used = 0;
+	_Count = 0;
+}
+
+size_t LXRenderCommandBuffer::GetUsedSize() const
+{
+	size_t Size = 0;
+	for (uint i = 0; i <= _CurrentBlock; i++)
+	{
+		Size += _Blocks[i].Used;
+	}
+	return Size;
+}
+
+LXRenderCommandBuffer::TBlock* LXRenderCommandBuffer::NextBlock()
+{
+	_CurrentBlock++;
+
+	if (_CurrentBlock == _Blocks.size())
+	{
+		_Blocks.push_back({ new uint8[_BlockSize], 0 });
+	}
+
+	TBlock* Block = &_Blocks[_CurrentBlock];
+	Block->Used = 0;
+	return Block;
+}
@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXRenderCommand.h"
+#include <type_traits>
+
+//
+// Linear (bump) allocator holding the LXRenderCommand records of a frame.
+// Records are packed in fixed size blocks. Blocks are never released by Reset(),
+// so once the buffer has grown to the frame size, recording does not allocate anymore.
+//
+
+class LXRenderCommandBuffer
+{
+
+public:
+
+	static const uint kAlignment = 8;
+	static const uint kDefaultBlockSize = 64 * 1024;
+
+	LXRenderCommandBuffer(uint InBlockSize = kDefaultBlockSize);
+	~LXRenderCommandBuffer();
+
+	// Allocates the record at the end of the buffer.
+	template<typename T>
+	T* Push()
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "LXRenderCommand records are never destroyed.");
+		static_assert(alignof(T) <= kAlignment, "LXRenderCommand record alignment is not supported.");
+
+		const uint Size = (sizeof(T) + kAlignment - 1) & ~(kAlignment - 1);
+		T* Command = new (Allocate(Size)) T();
+		Command->Type = T::Id;
+		Command->Size = (uint16)Size;
+		return Command;
+	}
+
+	// Rewinds the buffer in O(1). The blocks are kept for the next frame.
+	void Reset();
+
+	// Calls Func(const LXRenderCommand*) on every record, in the push order.
+	template<typename F>
+	void ForEach(F Func) const
+	{
+		for (uint i = 0; i <= _CurrentBlock; i++)
+		{
+			const uint8* Data = _Blocks[i].Data;
+			const uint8* End = Data + _Blocks[i].Used;
+
+			while (Data < End)
+			{
+				const LXRenderCommand* Command = reinterpret_cast<const LXRenderCommand*>(Data);
+				Func(Command);
+				Data += Command->Size;
+			}
+		}
+	}
+
+	uint GetCount() const { return _Count; }
+	size_t GetUsedSize() const;
+	size_t GetCapacity() const { return _Blocks.size() * _BlockSize; }
+
+private:
+
+	void* Allocate(uint Size)
+	{
+		TBlock* Block = &_Blocks[_CurrentBlock];
+
+		if (Block->Used + Size > _BlockSize)
+		{
+			Block = NextBlock();
+		}
+
+		void* Memory = Block->Data + Block->Used;
+		Block->Used += Size;
+		_Count++;
+		return Memory;
+	}
+
+	struct TBlock
+	{
+		uint8* Data;
+		uint Used;
+	};
+
+	TBlock* NextBlock();
+
+private:
+
+	vector<TBlock> _Blocks;
+	uint _BlockSize;
+	uint _CurrentBlock = 0;
+	uint _Count = 0;
+};
@@ -1,20 +0,0 @@
-//------------------------------------------------------------------------------------------------------
-//
-// This is a part of Seetron Engine
-//
-// Copyright (c) 2018 Nicolas Arques. All rights reserved.
-//
-//------------------------------------------------------------------------------------------------------
-
-#include "stdafx.h"
-#include "LXRenderCommandDX11.h"
-
-LXRenderCommandDX11::LXRenderCommandDX11()
-{
-
-}
-
-LXRenderCommandDX11::~LXRenderCommandDX11()
-{
-
-}
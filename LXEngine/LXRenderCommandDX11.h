@@ -1,20 +0,0 @@
-//------------------------------------------------------------------------------------------------------
-//
-// This is a part of Seetron Engine
-//
-// Copyright (c) 2018 Nicolas Arques. All rights reserved.
-//
-//------------------------------------------------------------------------------------------------------
-
-#include "LXRenderCommand.h"
-
-class LXRenderCommandDX11 : public LXRenderCommand
-{
-
-public:
-
-	LXRenderCommandDX11();
-	virtual ~LXRenderCommandDX11();
-
-};
-
@@ -9,7 +9,9 @@
 #pragma once
 
 #include "LXObject.h"
-#include "LXRenderCommandDX11.h"
+#include "LXRenderBackend.h"
+#include "LXRenderCommandBuffer.h"
+#include "LXRenderStateCache.h"
 #include "LXMatrix.h"
 
 // Check if the needed objects for the current operation are correctly binded.
@@ -17,8 +19,8 @@
 #define LX_CHECK_BINDED_OBJECT 1
 
 class LXRenderer;
+class LXRenderCommandList;
 class LXShaderManager;
-class LXRenderCommand;
 class LXTextureD3D11;
 class LXDepthStencilViewD3D11;
 class LXShaderD3D11;
@@ -37,35 +39,29 @@ struct ID3D11Resource;
 struct D3D11_MAPPED_SUBRESOURCE;
 struct ID3D11BlendState;
 
-#define CLASSRENDERCOMMAND0(name) class LXRenderCommand_##name : public LXRenderCommandDX11 { public : LXRenderCommand_##name(){} void Execute(LXRenderCommandList*) override; };
-#define CLASSRENDERCOMMAND1(name, type0, var0) class LXRenderCommand_##name : public LXRenderCommandDX11 { public : LXRenderCommand_##name(type0 In0):var0(In0){} void Execute(LXRenderCommandList*) override; type0 var0; };
-#define CLASSRENDERCOMMAND2(name, type0, var0, type1, var1)	class LXRenderCommand_##name : public LXRenderCommandDX11 {	public : LXRenderCommand_##name(type0 In0, type1 In1):var0(In0), var1(In1){} void Execute(LXRenderCommandList*) override; type0 var0; type1 var1; };
-#define CLASSRENDERCOMMAND3(name, type0, var0, type1, var1, type2, var2) class LXRenderCommand_##name : public LXRenderCommandDX11 { public : LXRenderCommand_##name(type0 In0, type1 In1, type2 In2):var0(In0), var1(In1), var2(In2){} void Execute(LXRenderCommandList*) override; type0 var0; type1 var1; type2 var2; };
-#define CLASSRENDERCOMMAND4(name, type0, var0, type1, var1, type2, var2, type3, var3) class LXRenderCommand_##name : public LXRenderCommandDX11 { public : LXRenderCommand_##name(type0 In0, type1 In1, type2 In2, type3 In3):var0(In0), var1(In1), var2(In2), var3(In3){} void Execute(LXRenderCommandList*) override; type0 var0; type1 var1; type2 var2; type3 var3; };
-
-#define CMD0_CLASS(name) \
-CLASSRENDERCOMMAND0(name) \
-void name() { Commands.push_back(new LXRenderCommand_##name()); if(DirectMode) Commands.back()->Execute(this); } 
-
-#define CMD1_CLASS(name, type0, var0) \
-CLASSRENDERCOMMAND1(name, type0, var0) \
-void name(type0 var0) { Commands.push_back(new LXRenderCommand_##name(var0)); if(DirectMode) Commands.back()->Execute(this);} 
-
-#define CMD1_CLASS_CR(name, type0, var0) \
-CLASSRENDERCOMMAND1(name, type0, var0) \
-void name(type0 var0) { Commands.push_back(new LXRenderCommand_##name(var0)); Current##var0 = var0; if(DirectMode) Commands.back()->Execute(this); } 
+//
+// Command identifiers
+//
 
-#define CMD2_CLASS(name, type0, var0, type1, var1) \
-CLASSRENDERCOMMAND2(name, type0, var0, type1, var1) \
-void name(type0 var0, type1 var1) { Commands.push_back(new LXRenderCommand_##name(var0, var1)); if(DirectMode) Commands.back()->Execute(this); } 
+enum class ERenderCommand : uint16
+{
+#define LX_RENDERCOMMAND(name) name,
+#include "LXRenderCommands.h"
+	Last
+};
 
-#define CMD3_CLASS(name, type0, var0, type1, var1, type2, var2) \
-CLASSRENDERCOMMAND3(name, type0, var0, type1, var1, type2, var2) \
-void name(type0 var0, type1 var1, type2 var2) { Commands.push_back(new LXRenderCommand_##name(var0, var1, var2)); if(DirectMode) Commands.back()->Execute(this);}
+//
+// Command records: plain data packed in the LXRenderCommandBuffer, executed by the LXRenderBackend.
+// Execute() is the D3D11 implementation (LXRenderBackendD3D11.cpp).
+//
 
-#define CMD4_CLASS(name, type0, var0, type1, var1, type2, var2, type3, var3) \
-CLASSRENDERCOMMAND4(name, type0, var0, type1, var1, type2, var2, type3, var3) \
-void name(type0 var0, type1 var1, type2 var2, type3 var3) { Commands.push_back(new LXRenderCommand_##name(var0, var1, var2, var3)); if(DirectMode) Commands.back()->Execute(this);}																									
+#define LX_RENDERCOMMAND0(name) struct LXRenderCommand_##name : public LXRenderCommand { static const ERenderCommand Id = ERenderCommand::name; void Execute(LXRenderCommandList*) const; };
+#define LX_RENDERCOMMAND1(name, type0, var0) struct LXRenderCommand_##name : public LXRenderCommand { static const ERenderCommand Id = ERenderCommand::name; void Execute(LXRenderCommandList*) const; type0 var0; };
+#define LX_RENDERCOMMAND2(name, type0, var0, type1, var1) struct LXRenderCommand_##name : public LXRenderCommand { static const ERenderCommand Id = ERenderCommand::name; void Execute(LXRenderCommandList*) const; type0 var0; type1 var1; };
+#define LX_RENDERCOMMAND3(name, type0, var0, type1, var1, type2, var2) struct LXRenderCommand_##name : public LXRenderCommand { static const ERenderCommand Id = ERenderCommand::name; void Execute(LXRenderCommandList*) const; type0 var0; type1 var1; type2 var2; };
+#define LX_RENDERCOMMAND4(name, type0, var0, type1, var1, type2, var2, type3, var3) struct LXRenderCommand_##name : public LXRenderCommand { static const ERenderCommand Id = ERenderCommand::name; void Execute(LXRenderCommandList*) const; type0 var0; type1 var1; type2 var2; type3 var3; };
+#define LX_RENDERCOMMAND5(name, type0, var0, type1, var1, type2, var2, type3, var3, type4, var4) struct LXRenderCommand_##name : public LXRenderCommand { static const ERenderCommand Id = ERenderCommand::name; void Execute(LXRenderCommandList*) const; type0 var0; type1 var1; type2 var2; type3 var3; type4 var4; };
+#include "LXRenderCommands.h"
 
 class LXRenderCommandList :	public LXObject
 {
@@ -78,68 +74,37 @@ public:
 	void Empty();
 	void Execute();
 
-	//
-	// ID3DUserDefinedAnnotation Interface
-	//
-
-	CMD1_CLASS(BeginEvent, const wchar_t*, Name)
-	CMD0_CLASS(EndEvent)
-	
-	//
-	// Standard commands (Direct3D API functions)
-	//
+	// Returns a list executed at the current position of this one.
+	// The child list can be recorded later, from another thread, but before Execute().
+	LXRenderCommandList* CreateChild();
 
-	CMD1_CLASS_CR(VSSetShader, LXShaderD3D11*, VertexShader)
-	CMD1_CLASS(HSSetShader, LXShaderD3D11*, HullShader)
-	CMD1_CLASS(DSSetShader, LXShaderD3D11*, DomainShader)
-	CMD1_CLASS(GSSetShader, LXShaderD3D11*, GeometryShader)
-	CMD1_CLASS(PSSetShader, LXShaderD3D11*, PixelShader)
-	CMD2_CLASS(Draw, UINT, VertexCount, UINT, StartVertexLocation)
-	CMD4_CLASS(DrawInstanced, UINT, VertexCount, UINT, InstanceCount, UINT, StartVertexLocation, UINT, StartInstanceLocation)
-	CMD1_CLASS(DrawIndexed, UINT, IndexCount)
-	CMD4_CLASS(DrawIndexedInstanced, UINT, IndexCountPerInstance, UINT, InstanceCount, UINT, StartIndexLocation, INT,  BaseVertexLocation)
-	CMD2_CLASS(RSSetViewports, UINT, Width, UINT, Height)
-	CMD4_CLASS(RSSetViewports2, float, TopLeftX, float, TopLeftY, float, Width, float, Height)
-	CMD3_CLASS(VSSetShaderResources, UINT, StartSlot, UINT, NumViews, LXTextureD3D11*, Texture)
-	CMD3_CLASS(PSSetShaderResources, UINT, StartSlot, UINT, NumViews, const LXTextureD3D11*, Texture)
-	CMD3_CLASS(PSSetShaderResources2, UINT, StartSlot, UINT, NumViews, ID3D11ShaderResourceView*, Texture)
-	CMD3_CLASS(PSSetSamplers, UINT, StartSlot, UINT, NumSamplers, const LXTextureD3D11*, Texture)
-	CMD3_CLASS(VSSetSamplers, UINT, StartSlot, UINT, NumSamplers, const LXTextureD3D11*, Texture)
-	CMD1_CLASS(IASetPrimitiveTopology, UINT, PrimitiveTopology)
-	CMD1_CLASS(IASetVertexBuffer, LXPrimitiveD3D11*, Primitive)
-	CMD1_CLASS(IASetIndexBuffer, LXPrimitiveD3D11*, Primitive)
-	CMD2_CLASS(UpdateSubresource, ID3D11Buffer*, D3D11Buffer, LXPrimitiveD3D11*, Primitive)
-	CMD2_CLASS(UpdateSubresource2, ID3D11Buffer*, D3D11Buffer, LXConstantBufferData*, ConstantBufferData)
-	CMD2_CLASS(UpdateSubresource3, LXConstantBufferD3D11*, ConstantBuffer, LXConstantBufferData*, ConstantBufferData)
-	CMD2_CLASS(UpdateSubresource4, ID3D11Buffer*, D3D11Buffer, void*, ConstantBufferData)
-	CMD3_CLASS(VSSetConstantBuffers, UINT, StartSlot, UINT, NumBuffers, LXConstantBufferD3D11*, ConstantBuffer)
-	CMD3_CLASS(PSSetConstantBuffers, UINT, StartSlot, UINT, NumBuffers, const LXConstantBufferD3D11*, ConstantBuffer)
-	CMD1_CLASS(ClearDepthStencilView, LXDepthStencilViewD3D11*, DepthStencilView)
-	CMD1_CLASS(ClearRenderTargetView, LXRenderTargetViewD3D11*, RenderTargetView)
-	CMD2_CLASS(ClearRenderTargetView2, LXRenderTargetViewD3D11*, RenderTargetView, vec4f, Color)
-	CMD1_CLASS(IASetInputLayout, LXShaderD3D11*, VertexShader)
-	CMD1_CLASS(OMSetRenderTargets, ID3D11RenderTargetView*, RenderTarget)
-	CMD2_CLASS(OMSetRenderTargets2, LXRenderTargetViewD3D11*, RenderTargetView, LXDepthStencilViewD3D11*, DepthStencilView)
-	CMD3_CLASS(OMSetRenderTargets3, UINT, NumViews, ID3D11RenderTargetView**, RenderTargetViews, ID3D11DepthStencilView*, DepthStencilView)
-	CMD1_CLASS(OMSetBlendState, ID3D11BlendState*, D3D11BlendState);
-	CMD1_CLASS(RSSetState, ID3D11RasterizerState*, RasterizerState)
-	CMD2_CLASS(Map, ID3D11Resource*, Resource, D3D11_MAPPED_SUBRESOURCE*, MappedResource)
-	CMD1_CLASS(Unmap, ID3D11Resource*, Resource)
-	CMD2_CLASS(CopyResource, ID3D11Resource*, DstResource, ID3D11Resource*, SrcResource)
-	CMD1_CLASS(GenerateMips, ID3D11ShaderResourceView*, pShaderResourceView)
+	// Stats, child lists included
+	UINT GetDrawCallCount() const;
+	UINT GetTriangleCount() const;
+	UINT GetCommandCount() const;
+	UINT GetFilteredCommandCount() const;
 
 	//
-	// Standard commands (IDXGISwapChain Interface)
+	// Recording methods, one per command (see LXRenderCommands.h)
 	//
 
-	CMD0_CLASS(Present)
-		
-	//
-	// Advanced commands (multiple commands)
-	//
+#define LX_RENDERCOMMAND0(name) void name() { LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND1(name, type0, var0) void name(type0 var0) { LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND1_S(name, type0, var0) void name(type0 var0) { if (StateFiltering && _StateCache.name(var0)) { FilteredCommandCount++; return; } LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND1_CR(name, type0, var0) void name(type0 var0) { Current##var0 = var0; if (StateFiltering && _StateCache.name(var0)) { FilteredCommandCount++; return; } LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND2(name, type0, var0, type1, var1) void name(type0 var0, type1 var1) { LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; Command->var1 = var1; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND2_S(name, type0, var0, type1, var1) void name(type0 var0, type1 var1) { if (StateFiltering && _StateCache.name(var0, var1)) { FilteredCommandCount++; return; } LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; Command->var1 = var1; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND3(name, type0, var0, type1, var1, type2, var2) void name(type0 var0, type1 var1, type2 var2) { LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; Command->var1 = var1; Command->var2 = var2; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND3_S(name, type0, var0, type1, var1, type2, var2) void name(type0 var0, type1 var1, type2 var2) { if (StateFiltering && _StateCache.name(var0, var1, var2)) { FilteredCommandCount++; return; } LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; Command->var1 = var1; Command->var2 = var2; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND4(name, type0, var0, type1, var1, type2, var2, type3, var3) void name(type0 var0, type1 var1, type2 var2, type3 var3) { LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; Command->var1 = var1; Command->var2 = var2; Command->var3 = var3; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#define LX_RENDERCOMMAND5(name, type0, var0, type1, var1, type2, var2, type3, var3, type4, var4) void name(type0 var0, type1 var1, type2 var2, type3 var3, type4 var4) { LXRenderCommand_##name* Command = Commands.Push<LXRenderCommand_##name>(); Command->var0 = var0; Command->var1 = var1; Command->var2 = var2; Command->var3 = var3; Command->var4 = var4; if (DirectMode) Backend->ExecuteCommand(this, Command); }
+#include "LXRenderCommands.h"
+
+private:
 
-	CMD2_CLASS(CopyResourceToBitmap, LXBitmap*, DstBitmap, ID3D11Resource*, SrcResource)
+	friend struct LXRenderCommand_ExecuteCommandList;
 
+	void ExecuteCommands();
 
 public:
 
@@ -148,26 +113,43 @@ public:
 
 	// Frame ConstantBuffers
 	LXConstantBufferD3D11* CBViewProjection = nullptr;
-	std::vector<LXRenderCommand*> Commands;
+	LXRenderCommandBuffer Commands;
 
 	//Stats
-	UINT DrawCallCount;
-	UINT TriangleCount;
+	UINT DrawCallCount = 0;
+	UINT TriangleCount = 0;
+	UINT FilteredCommandCount = 0; // Redundant binding commands, dropped at record time
 
 	//Refs
 	LXRenderer* Renderer;
 	LXShaderManager* ShaderManager;
+	LXRenderBackend* Backend;
 
 	//Debug purpose. Default value is false. 
 	//Set true to immediately call the command.
 	bool DirectMode = false;
 
+	// Allows the passes to record their commands in child lists on worker threads.
+	// Ignored in DirectMode.
+	bool ParallelRecording = true;
+
+	// Drops the commands binding an object already bound.
+	bool StateFiltering = true;
+
 #if LX_CHECK_BINDED_OBJECT
 
 	LXShaderD3D11* _VertexShader = nullptr;
 	LXShaderD3D11* _PixelShader = nullptr;
 
 #endif
-	
+
+private:
+
+	// Child lists, reused from frame to frame
+	vector<LXRenderCommandList*> _Children;
+	uint _ChildCount = 0;
+
+	// Bindings at the current record position
+	LXRenderStateCache _StateCache;
 };
 
@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+// No #pragma once: this table is included several times by LXRenderCommandList.h/.cpp
+// to generate the command identifiers, the records, the recording methods and the dispatcher.
+// The includer defines LX_RENDERCOMMAND(name) when the arguments are not needed,
+// or LX_RENDERCOMMAND0..5 (and optionally LX_RENDERCOMMAND1_CR) otherwise.
+
+#ifdef LX_RENDERCOMMAND
+#define LX_RENDERCOMMAND0(name) LX_RENDERCOMMAND(name)
+#define LX_RENDERCOMMAND1(name, type0, var0) LX_RENDERCOMMAND(name)
+#define LX_RENDERCOMMAND2(name, type0, var0, type1, var1) LX_RENDERCOMMAND(name)
+#define LX_RENDERCOMMAND3(name, type0, var0, type1, var1, type2, var2) LX_RENDERCOMMAND(name)
+#define LX_RENDERCOMMAND4(name, type0, var0, type1, var1, type2, var2, type3, var3) LX_RENDERCOMMAND(name)
+#define LX_RENDERCOMMAND5(name, type0, var0, type1, var1, type2, var2, type3, var3, type4, var4) LX_RENDERCOMMAND(name)
+#endif
+
+// "S" commands change a device binding: they are filtered by the LXRenderStateCache at record time.
+#ifndef LX_RENDERCOMMAND1_S
+#define LX_RENDERCOMMAND1_S LX_RENDERCOMMAND1
+#endif
+#ifndef LX_RENDERCOMMAND2_S
+#define LX_RENDERCOMMAND2_S LX_RENDERCOMMAND2
+#endif
+#ifndef LX_RENDERCOMMAND3_S
+#define LX_RENDERCOMMAND3_S LX_RENDERCOMMAND3
+#endif
+
+// "CR" commands are "S" commands also storing the argument in the LXRenderCommandList::Current<var0> member.
+#ifndef LX_RENDERCOMMAND1_CR
+#define LX_RENDERCOMMAND1_CR LX_RENDERCOMMAND1_S
+#endif
+
+//
+// ID3DUserDefinedAnnotation Interface
+//
+
+LX_RENDERCOMMAND1(BeginEvent, const wchar_t*, Name)
+LX_RENDERCOMMAND0(EndEvent)
+
+//
+// Standard commands (Direct3D API functions)
+//
+
+LX_RENDERCOMMAND1_CR(VSSetShader, LXShaderD3D11*, VertexShader)
+LX_RENDERCOMMAND1_S(HSSetShader, LXShaderD3D11*, HullShader)
+LX_RENDERCOMMAND1_S(DSSetShader, LXShaderD3D11*, DomainShader)
+LX_RENDERCOMMAND1_S(GSSetShader, LXShaderD3D11*, GeometryShader)
+LX_RENDERCOMMAND1_S(PSSetShader, LXShaderD3D11*, PixelShader)
+LX_RENDERCOMMAND2(Draw, UINT, VertexCount, UINT, StartVertexLocation)
+LX_RENDERCOMMAND4(DrawInstanced, UINT, VertexCount, UINT, InstanceCount, UINT, StartVertexLocation, UINT, StartInstanceLocation)
+LX_RENDERCOMMAND1(DrawIndexed, UINT, IndexCount)
+LX_RENDERCOMMAND4(DrawIndexedInstanced, UINT, IndexCountPerInstance, UINT, InstanceCount, UINT, StartIndexLocation, INT, BaseVertexLocation)
+LX_RENDERCOMMAND5(DrawIndexedInstanced2, UINT, IndexCountPerInstance, UINT, InstanceCount, UINT, StartIndexLocation, INT, BaseVertexLocation, UINT, StartInstanceLocation)
+LX_RENDERCOMMAND2(RSSetViewports, UINT, Width, UINT, Height)
+LX_RENDERCOMMAND4(RSSetViewports2, float, TopLeftX, float, TopLeftY, float, Width, float, Height)
+LX_RENDERCOMMAND3_S(VSSetShaderResources, UINT, StartSlot, UINT, NumViews, LXTextureD3D11*, Texture)
+LX_RENDERCOMMAND3_S(PSSetShaderResources, UINT, StartSlot, UINT, NumViews, const LXTextureD3D11*, Texture)
+LX_RENDERCOMMAND3_S(PSSetShaderResources2, UINT, StartSlot, UINT, NumViews, ID3D11ShaderResourceView*, Texture)
+LX_RENDERCOMMAND3_S(PSSetSamplers, UINT, StartSlot, UINT, NumSamplers, const LXTextureD3D11*, Texture)
+LX_RENDERCOMMAND3_S(VSSetSamplers, UINT, StartSlot, UINT, NumSamplers, const LXTextureD3D11*, Texture)
+LX_RENDERCOMMAND1_S(IASetPrimitiveTopology, UINT, PrimitiveTopology)
+LX_RENDERCOMMAND1_S(IASetVertexBuffer, LXPrimitiveD3D11*, Primitive)
+LX_RENDERCOMMAND1_S(IASetIndexBuffer, LXPrimitiveD3D11*, Primitive)
+LX_RENDERCOMMAND2(IASetInstanceBuffer, ID3D11Buffer*, InstanceBuffer, UINT, InstanceStride)
+LX_RENDERCOMMAND2(UpdateSubresource, ID3D11Buffer*, D3D11Buffer, LXPrimitiveD3D11*, Primitive)
+LX_RENDERCOMMAND2(UpdateSubresource2, ID3D11Buffer*, D3D11Buffer, LXConstantBufferData*, ConstantBufferData)
+LX_RENDERCOMMAND2(UpdateSubresource3, LXConstantBufferD3D11*, ConstantBuffer, LXConstantBufferData*, ConstantBufferData)
+LX_RENDERCOMMAND2(UpdateSubresource4, ID3D11Buffer*, D3D11Buffer, void*, ConstantBufferData)
+LX_RENDERCOMMAND3_S(VSSetConstantBuffers, UINT, StartSlot, UINT, NumBuffers, LXConstantBufferD3D11*, ConstantBuffer)
+LX_RENDERCOMMAND3_S(PSSetConstantBuffers, UINT, StartSlot, UINT, NumBuffers, const LXConstantBufferD3D11*, ConstantBuffer)
+LX_RENDERCOMMAND1(ClearDepthStencilView, LXDepthStencilViewD3D11*, DepthStencilView)
+LX_RENDERCOMMAND1(ClearRenderTargetView, LXRenderTargetViewD3D11*, RenderTargetView)
+LX_RENDERCOMMAND2(ClearRenderTargetView2, LXRenderTargetViewD3D11*, RenderTargetView, vec4f, Color)
+LX_RENDERCOMMAND1_S(IASetInputLayout, LXShaderD3D11*, VertexShader)
+LX_RENDERCOMMAND1_S(OMSetRenderTargets, ID3D11RenderTargetView*, RenderTarget)
+LX_RENDERCOMMAND2_S(OMSetRenderTargets2, LXRenderTargetViewD3D11*, RenderTargetView, LXDepthStencilViewD3D11*, DepthStencilView)
+LX_RENDERCOMMAND3_S(OMSetRenderTargets3, UINT, NumViews, ID3D11RenderTargetView**, RenderTargetViews, ID3D11DepthStencilView*, DepthStencilView)
+LX_RENDERCOMMAND1_S(OMSetBlendState, ID3D11BlendState*, D3D11BlendState)
+LX_RENDERCOMMAND1_S(RSSetState, ID3D11RasterizerState*, RasterizerState)
+LX_RENDERCOMMAND2(Map, ID3D11Resource*, Resource, D3D11_MAPPED_SUBRESOURCE*, MappedResource)
+LX_RENDERCOMMAND1(Unmap, ID3D11Resource*, Resource)
+LX_RENDERCOMMAND2(CopyResource, ID3D11Resource*, DstResource, ID3D11Resource*, SrcResource)
+LX_RENDERCOMMAND1(GenerateMips, ID3D11ShaderResourceView*, pShaderResourceView)
+
+//
+// Standard commands (IDXGISwapChain Interface)
+//
+
+LX_RENDERCOMMAND0(Present)
+
+//
+// Advanced commands (multiple commands)
+//
+
+LX_RENDERCOMMAND2(CopyResourceToBitmap, LXBitmap*, DstBitmap, ID3D11Resource*, SrcResource)
+LX_RENDERCOMMAND1(ExecuteCommandList, LXRenderCommandList*, CommandList)
+
+#undef LX_RENDERCOMMAND
+#undef LX_RENDERCOMMAND0
+#undef LX_RENDERCOMMAND1
+#undef LX_RENDERCOMMAND1_CR
+#undef LX_RENDERCOMMAND1_S
+#undef LX_RENDERCOMMAND2_S
+#undef LX_RENDERCOMMAND3_S
+#undef LX_RENDERCOMMAND2
+#undef LX_RENDERCOMMAND3
+#undef LX_RENDERCOMMAND4
+#undef LX_RENDERCOMMAND5
@@ -8,14 +8,202 @@
 
 #include "stdafx.h"
 #include "LXRenderPass.h"
+#include "LXConsoleManager.h"
+#include "LXConstantBufferD3D11.h"
+#include "LXDirectX11.h"
+#include "LXRenderBackend.h"
+#include "LXRenderCluster.h"
+#include "LXRenderCommandList.h"
 #include "LXRenderer.h"
+#include "LXThreadManager.h"
+#include <thread>
 #include "LXMemory.h"
 
+namespace
+{
+	// Below this count per child list, the recording is faster than the list setup.
+	const uint kMinClustersPerCommandList = 256;
+
+	LXConsoleCommandT<bool> CSet_DynamicInstancing(L"Engine.ini", L"Renderer", L"DynamicInstancing", L"true");
+};
+
+// Consecutive clusters, drawn with a single instanced draw call when Count > 1
+struct TRenderClusterBatch
+{
+	uint First;
+	uint Count;
+	uint StartInstance;
+};
+
+struct TRenderClusterInstanceBuffer
+{
+	ID3D11Buffer* D3D11Buffer = nullptr;
+	vector<LXConstantBufferData1> Instances; // Buffer size: UpdateSubresource copies the whole buffer
+};
+
 LXRenderPass::LXRenderPass(LXRenderer* InRenderer):Renderer(InRenderer)
 {
 }
 
 LXRenderPass::~LXRenderPass()
 {
+	for (TRenderClusterInstanceBuffer* InstanceBuffer : _InstanceBuffers)
+	{
+		LX_SAFE_RELEASE(InstanceBuffer->D3D11Buffer);
+		delete InstanceBuffer;
+	}
+}
+
+void LXRenderPass::RenderClusters(LXRenderCommandList* RCL, const vector<LXRenderCluster*>& RenderClusters, ERenderPass RenderPass)
+{
+	vector<TRenderClusterBatch> Batches;
+	ID3D11Buffer* InstanceBuffer = BuildBatches(RCL, RenderClusters, RenderPass, Batches);
+
+	auto RenderBatch = [&](const TRenderClusterBatch& Batch, LXRenderCommandList* CommandList)
+	{
+		LXRenderCluster* RenderCluster = RenderClusters[Batch.First];
+
+		if (Batch.Count == 1)
+			RenderCluster->Render(RenderPass, CommandList);
+		else
+			RenderCluster->RenderInstanced(RenderPass, CommandList, InstanceBuffer, Batch.Count, Batch.StartInstance);
+	};
+
+	const uint Count = (uint)Batches.size();
+	const uint MaxCommandLists = max(1u, std::thread::hardware_concurrency()) * 2;
+	const uint CommandListCount = min(MaxCommandLists, Count / kMinClustersPerCommandList);
+
+	if (RCL->DirectMode || !RCL->ParallelRecording || CommandListCount < 2)
+	{
+		for (const TRenderClusterBatch& Batch : Batches)
+		{
+			RenderBatch(Batch, RCL);
+		}
+		return;
+	}
+
+	// Child lists are created, so stitched, in the cluster order.
+	vector<LXRenderCommandList*> CommandLists(CommandListCount);
+	for (uint i = 0; i < CommandListCount; i++)
+	{
+		CommandLists[i] = RCL->CreateChild();
+	}
+
+	ParallelFor(CommandListCount, [&](uint i)
+	{
+		const uint Begin = (uint)((uint64)Count * i / CommandListCount);
+		const uint End = (uint)((uint64)Count * (i + 1) / CommandListCount);
+
+		for (uint j = Begin; j < End; j++)
+		{
+			RenderBatch(Batches[j], CommandLists[i]);
+		}
+	});
+}
+
+ID3D11Buffer* LXRenderPass::BuildBatches(LXRenderCommandList* RCL, const vector<LXRenderCluster*>& RenderClusters, ERenderPass RenderPass, vector<TRenderClusterBatch>& Batches)
+{
+	const uint Count = (uint)RenderClusters.size();
+	const bool DynamicInstancing = CSet_DynamicInstancing.GetValue();
+	uint InstanceCount = 0;
+
+	Batches.reserve(Count);
+
+	for (uint i = 0; i < Count;)
+	{
+		const LXRenderCluster* RenderCluster = RenderClusters[i];
+		uint End = i + 1;
+
+		// The sort keys make the clusters sharing the Primitive and the Material consecutive, a batch has a single LOD.
+		if (DynamicInstancing && RenderCluster->InstancedPrimitive && RenderCluster->InstancedShaderPrograms[(int)RenderPass].VertexShader)
+		{
+			while (End < Count && RenderClusters[End]->InstancedPrimitive == RenderCluster->InstancedPrimitive && RenderClusters[End]->Material == RenderCluster->Material && RenderClusters[End]->LOD == RenderCluster->LOD)
+			{
+				End++;
+			}
+		}
+
+		const uint BatchCount = End - i;
+		Batches.push_back({ i, BatchCount, InstanceCount });
+		
+		if (BatchCount > 1)
+			InstanceCount += BatchCount;
+
+		i = End;
+	}
+
+	if (InstanceCount == 0)
+		return nullptr;
+
+	TRenderClusterInstanceBuffer* InstanceBuffer = GetInstanceBuffer(InstanceCount);
+
+	if (!InstanceBuffer)
+	{
+		// One draw per cluster
+		Batches.clear();
+		for (uint i = 0; i < Count; i++)
+		{
+			Batches.push_back({ i, 1, 0 });
+		}
+		return nullptr;
+	}
+
+	for (const TRenderClusterBatch& Batch : Batches)
+	{
+		if (Batch.Count == 1)
+			continue;
+
+		for (uint i = 0; i < Batch.Count; i++)
+		{
+			InstanceBuffer->Instances[Batch.StartInstance + i] = RenderClusters[Batch.First + i]->cb1;
+		}
+	}
+
+	// Recorded before the child lists, so executed before the draw calls
+	RCL->UpdateSubresource4(InstanceBuffer->D3D11Buffer, InstanceBuffer->Instances.data());
+
+	return InstanceBuffer->D3D11Buffer;
+}
+
+TRenderClusterInstanceBuffer* LXRenderPass::GetInstanceBuffer(uint InstanceCount)
+{
+	if (_UsedInstanceBuffers == _InstanceBuffers.size())
+	{
+		_InstanceBuffers.push_back(new TRenderClusterInstanceBuffer());
+	}
+
+	TRenderClusterInstanceBuffer* InstanceBuffer = _InstanceBuffers[_UsedInstanceBuffers];
+
+	if (InstanceBuffer->Instances.size() < InstanceCount)
+	{
+		// The previous buffer was used by the previous frame only
+		LX_SAFE_RELEASE(InstanceBuffer->D3D11Buffer);
+		InstanceBuffer->Instances.clear();
+
+		const uint Capacity = max(256u, InstanceCount + InstanceCount / 2);
+
+		D3D11_BUFFER_DESC bd;
+		ZeroMemory(&bd, sizeof(bd));
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.ByteWidth = Capacity * sizeof(LXConstantBufferData1);
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = 0;
+
+		// Without device, only the CPU copy of the instances is filled
+		if (!LXRenderBackend::IsNullDevice())
+		{
+			HRESULT hr = LXDirectX11::GetCurrentDevice()->CreateBuffer(&bd, nullptr, &InstanceBuffer->D3D11Buffer);
+			if (FAILED(hr))
+			{
+				LXDirectX11::LogError(hr);
+				return nullptr;
+			}
+		}
+
+		InstanceBuffer->Instances.resize(Capacity);
+	}
+
+	_UsedInstanceBuffers++;
+	return InstanceBuffer;
 }
 
@@ -20,6 +20,9 @@ class LXDepthStencilViewD3D11;
 class LXRenderTargetViewD3D11;
 class LXPrimitiveD3D11;
 class LXRenderer;
+struct ID3D11Buffer;
+struct TRenderClusterBatch;
+struct TRenderClusterInstanceBuffer;
 
 enum class ERenderPass
 {
@@ -32,25 +35,45 @@ enum class ERenderPass
 
 class LXRenderPass : public LXObject
 {
+
+	friend class LXRenderPipeline;
 	
 public:
 
 	LXRenderPass(LXRenderer* InRenderer);
 	virtual ~LXRenderPass();
 
+	// Called on the render thread, in the pass order, before any pass records its commands.
+	// Render() can be called from a worker thread: the shared data must be written here.
+	virtual void PreRender(LXRenderCommandList* RenderCommandList) { };
 	virtual void Render(LXRenderCommandList* RenderCommandList) = 0;
 	virtual bool IsValid() const { return true; }
 	virtual void RebuildShaders() { };
 	virtual void Resize(uint Width, uint Height)=0;
 	virtual const LXTextureD3D11* GetOutputTexture() const { CHK(0); return nullptr; }
 	virtual const bool GetOutputTextures(vector<const LXTextureD3D11*>& outTextures) { CHK(0); return false; }
+	
+	// Valid pass rendered before this one in the current frame
+	const LXRenderPass* GetPreviousRenderPass() const { return _PreviousRenderPass; }
 		
 protected:
 
+	// Renders the clusters, split in child command lists recorded in parallel when the list is large enough.
+	// The consecutive clusters sharing the Primitive and the Material are drawn with a single instanced draw call (Renderer.DynamicInstancing).
+	void RenderClusters(LXRenderCommandList* RCL, const vector<LXRenderCluster*>& RenderClusters, ERenderPass RenderPass);
+
 	// Ref.
 	LXRenderer* Renderer;
+	const LXRenderPass* _PreviousRenderPass = nullptr;
 
 private:
 
+	// Returns the instance buffer filled with the cb1 of the instanced batches, nullptr if none.
+	ID3D11Buffer* BuildBatches(LXRenderCommandList* RCL, const vector<LXRenderCluster*>& RenderClusters, ERenderPass RenderPass, vector<TRenderClusterBatch>& Batches);
+	TRenderClusterInstanceBuffer* GetInstanceBuffer(uint InstanceCount);
+
+	// One instance buffer per RenderClusters call in the frame, recycled by the LXRenderPipeline.
+	vector<TRenderClusterInstanceBuffer*> _InstanceBuffers;
+	uint _UsedInstanceBuffers = 0;
 };
 
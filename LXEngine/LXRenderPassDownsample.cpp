@@ -108,9 +108,6 @@ void LXRenderPassDownsample::DeleteBuffers()
 void LXRenderPassDownsample::Render(LXRenderCommandList* r)
 {
 	r->BeginEvent(L"Downsample");
-
-	LXRenderPipelineDeferred* RenderPipelineDeferred = dynamic_cast<LXRenderPipelineDeferred*>(Renderer->GetRenderPipeline());
-	CHK(RenderPipelineDeferred);
 	
 	for (int i=0; i<maxDownSample; i++)
 	{
@@ -128,7 +125,7 @@ void LXRenderPassDownsample::Render(LXRenderCommandList* r)
 		const LXTextureD3D11* Texture;
 		if (i == 0)
 		{
-			Texture = RenderPipelineDeferred->GetPreviousRenderPass()->GetOutputTexture();
+			Texture = GetPreviousRenderPass()->GetOutputTexture();
 		}
 		else
 		{
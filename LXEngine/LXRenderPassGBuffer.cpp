@@ -100,10 +100,7 @@ void LXRenderPassGBuffer::Render(LXRenderCommandList* RCL)
 	RCL->CBViewProjection = RenderPipelineDeferred->_CBViewProjection;
 	RCL->UpdateSubresource4(RenderPipelineDeferred->_CBViewProjection->D3D11Buffer, &RenderPipelineDeferred->_CBViewProjectionData);
 
-	for (LXRenderCluster* RenderCluster : *_ListRenderClusterOpaques)
-	{
-		RenderCluster->Render(ERenderPass::GBuffer, RCL);
-	}
+	RenderClusters(RCL, *_ListRenderClusterOpaques, ERenderPass::GBuffer);
 	
 	//
 	// Reset some shaders and resources 
@@ -9,7 +9,10 @@
 #include "stdafx.h"
 #include "LXRenderPassLighting.h"
 #include "LXActorLight.h"
+#include "LXActorCamera.h"
 #include "LXActorSceneCapture.h"
+#include "LXClusteredLights.h"
+#include "LXConsoleManager.h"
 #include "LXConstantBufferD3D11.h"
 #include "LXDirectX11.h"
 #include "LXPrimitiveD3D11.h"
@@ -27,6 +30,8 @@
 #include "LXSettings.h"
 #include "LXShaderD3D11.h"
 #include "LXShaderManager.h"
+#include "LXStatManager.h"
+#include "LXStructuredBufferD3D11.h"
 #include "LXTextureD3D11.h"
 #include "LXViewport.h"
 #include "LXWorldTransformation.h"
@@ -39,6 +44,14 @@ namespace
 	const wchar_t kDirectionalShaderFilename[] = L"LightingDirectional.hlsl";
 	const wchar_t kPointShaderFilename[] = L"LightingPoint.hlsl";
 	const wchar_t kComposeShaderFilename[] = L"LightingCompose.hlsl";
+	const wchar_t kClusteredShaderFilename[] = L"LightingClustered.hlsl";
+
+	// Shader resource slots of the clustered lighting buffers
+	const uint kClusteredLightsSlot = 8;
+	const uint kClusterRangesSlot = 9;
+	const uint kLightIndicesSlot = 10;
+
+	LXConsoleCommandT<bool> CSet_ClusteredLighting(L"Engine.ini", L"Renderer", L"ClusteredLighting", L"true");
 };
 
 LXRenderPassLighting::LXRenderPassLighting(LXRenderer* InRenderer) :LXRenderPass(InRenderer)
@@ -51,6 +64,14 @@ LXRenderPassLighting::LXRenderPassLighting(LXRenderer* InRenderer) :LXRenderPass
 	_shaderProgramDirectionalLight = make_unique<LXShaderProgramBasic>();
 	_shaderProgramPointLight = make_unique<LXShaderProgramBasic>();
 	_shaderProgramComposeLight = make_unique<LXShaderProgramBasic>();
+	_shaderProgramClusteredLight = make_unique<LXShaderProgramBasic>();
+
+	_ClusteredLights = make_unique<LXClusteredLights>();
+	_BufferClusteredLights = make_unique<LXStructuredBufferD3D11>(sizeof(TClusteredLight), (uint)_ClusteredLights->GetLights().size());
+	_BufferClusterRanges = make_unique<LXStructuredBufferD3D11>(sizeof(TClusterRange), (uint)_ClusteredLights->GetClusterRanges().size());
+	_BufferLightIndices = make_unique<LXStructuredBufferD3D11>(sizeof(uint), (uint)_ClusteredLights->GetLightIndices().size());
+	_CBClusteredLightsData = make_unique<LXConstantBufferDataClusteredLights>();
+	_CBClusteredLights = make_unique<LXConstantBufferD3D11>(_CBClusteredLightsData.get(), sizeof(LXConstantBufferDataClusteredLights));
 
 	ConstantBufferDataIBL = new LXConstantBufferDataIBL();
 	ConstantBufferIBL = new LXConstantBufferD3D11(ConstantBufferDataIBL, sizeof(LXConstantBufferDataIBL));
@@ -88,6 +109,7 @@ void LXRenderPassLighting::RebuildShaders()
 	_shaderProgramDirectionalLight->CreateShaders(GetSettings().GetShadersFolder() + kDirectionalShaderFilename, &Layout[0], (uint)Layout.size());
 	_shaderProgramPointLight->CreateShaders(GetSettings().GetShadersFolder() + kPointShaderFilename, &Layout[0], (uint)Layout.size());
 	_shaderProgramComposeLight->CreateShaders(GetSettings().GetShadersFolder() + kComposeShaderFilename, &Layout[0], (uint)Layout.size());
+	_shaderProgramClusteredLight->CreateShaders(GetSettings().GetShadersFolder() + kClusteredShaderFilename, &Layout[0], (uint)Layout.size());
 }
 
 void LXRenderPassLighting::DeleteBuffers()
@@ -116,6 +138,81 @@ const LXTextureD3D11* LXRenderPassLighting::GetOutputTexture() const
 	return RenderTargetCompose->TextureD3D11; 
 }
 
+void LXRenderPassLighting::PreRender(LXRenderCommandList* r)
+{
+	if (!Renderer->GetProject())
+		return;
+
+	// TextureIBL is also read by the materials during the GBuffer pass
+	const LXActorSceneCapture* SceneCapture = GetCore().GetProject()->GetSceneCapture();
+	if (!TextureIBL && SceneCapture && SceneCapture->GetTexture())
+	{
+		const LXTexture* Texture = SceneCapture->GetTexture();
+		TextureIBL = LXTextureD3D11::CreateFromTexture(const_cast<LXTexture*>(Texture));
+	}
+
+	// Optional: without the clustered shader, the lights are rendered one by one
+	_Clustered = CSet_ClusteredLighting.GetValue() && _shaderProgramClusteredLight->IsValid();
+
+	if (_Clustered)
+	{
+		LXRenderPipelineDeferred* RenderPipelineDeferred = dynamic_cast<LXRenderPipelineDeferred*>(Renderer->GetRenderPipeline());
+		CHK(RenderPipelineDeferred);
+		BinLights(RenderPipelineDeferred);
+	}
+}
+
+void LXRenderPassLighting::BinLights(const LXRenderPipelineDeferred* RenderPipelineDeferred)
+{
+	// The clusters are sliced along a perspective view
+	const LXActorCamera* Camera = Renderer->GetProject()->GetCamera();
+	if (!Camera || Camera->IsOrtho())
+	{
+		_Clustered = false;
+		return;
+	}
+
+	_ClusteredLights->Begin(Renderer->GetMatrixView(), Renderer->GetMatrixProjection(), Camera->GetNear(), Camera->GetFar());
+
+	// The shadowed spot lights keep their own pass, with the shadow map
+	for (LXRenderCluster* RenderCluster : *_ListRenderClusterLights)
+	{
+		LXActorLight* ActorLight = dynamic_cast<LXActorLight*>(RenderCluster->Actor);
+		CHK(ActorLight);
+
+		RenderCluster->UpdateLightParameters();
+		const LXConstantBufferDataSpotLight* Data = RenderCluster->ConstantBufferDataSpotLight;
+
+		// Stops at MaxLights, the remaining lights are not rendered
+		bool Added = true;
+		if (ActorLight->GetType() == ELightType::Spot && !Data->CastShadow)
+		{
+			Added = _ClusteredLights->AddSpotLight(ActorLight->GetMatrixWCS().GetOrigin(), ActorLight->GetMatrixWCS().GetVz() * -1.f, ActorLight->GetRange(), ActorLight->GetSpotAngle(), Data->Color, Data->LightIntensity);
+		}
+		else if (ActorLight->GetType() == ELightType::Omnidirectional)
+		{
+			Added = _ClusteredLights->AddOmniLight(ActorLight->GetMatrixWCS().GetOrigin(), ActorLight->GetRange(), Data->Color, Data->LightIntensity);
+		}
+
+		if (!Added)
+			break;
+	}
+
+	_ClusteredLights->Build();
+
+	_CBClusteredLightsData->ClusterCountX = kClusterCountX;
+	_CBClusteredLightsData->ClusterCountY = kClusterCountY;
+	_CBClusteredLightsData->ClusterCountZ = kClusterCountZ;
+	_CBClusteredLightsData->LightCount = _ClusteredLights->GetLightCount();
+	_CBClusteredLightsData->SliceScale = _ClusteredLights->GetSliceScale();
+	_CBClusteredLightsData->SliceBias = _ClusteredLights->GetSliceBias();
+	_CBClusteredLightsData->TileSize = vec2f((float)Renderer->Width / kClusterCountX, (float)Renderer->Height / kClusterCountY);
+
+	GetStatManager()->SetFrameCounter(L"Lighting.ClusteredLights", _ClusteredLights->GetLightCount());
+	GetStatManager()->SetFrameCounter(L"Lighting.ClusterIndices", _ClusteredLights->GetIndexCount());
+	GetStatManager()->SetFrameCounter(L"Lighting.ClusterOverflow", _ClusteredLights->GetOverflowCount());
+}
+
 void LXRenderPassLighting::Render(LXRenderCommandList* r)
 {
 	if (!Renderer->GetProject())
@@ -143,7 +240,11 @@ void LXRenderPassLighting::Render(LXRenderCommandList* r)
 	RenderIBL(r, RenderPipelineDeferred);
 	RenderSpotLight(r, RenderPipelineDeferred);
 	RenderDirectionalLight(r, RenderPipelineDeferred);
-	RenderPointLight(r, RenderPipelineDeferred);
+	
+	if (_Clustered)
+		RenderClusteredLights(r, RenderPipelineDeferred);
+	else
+		RenderPointLight(r, RenderPipelineDeferred);
 
 	r->OMSetBlendState(Renderer->GetBlendStateOpaque());
 	
@@ -206,11 +307,6 @@ void LXRenderPassLighting::RenderIBL(LXRenderCommandList* r, const LXRenderPipel
 	LXTextureD3D11* Depth = RenderPassGBuffer->TextureDepth;
 	LXTextureD3D11* Normal = RenderPassGBuffer->TextureNormal;
 	LXTextureD3D11* Specular = RenderPassGBuffer->TextureSpecular;
-	if (!TextureIBL && SceneCapture && SceneCapture->GetTexture())
-	{
-		const LXTexture* Texture = SceneCapture->GetTexture();
-		TextureIBL = LXTextureD3D11::CreateFromTexture(const_cast<LXTexture*>(Texture));
-	}
 
 	r->PSSetShaderResources(0, 1, (LXTextureD3D11*)Depth);
 	r->PSSetShaderResources(2, 1, (LXTextureD3D11*)Normal);
@@ -234,6 +330,50 @@ void LXRenderPassLighting::RenderIBL(LXRenderCommandList* r, const LXRenderPipel
 
 }
 
+void LXRenderPassLighting::RenderClusteredLights(LXRenderCommandList* r, const LXRenderPipelineDeferred* RenderPipelineDeferred)
+{
+	if (_ClusteredLights->GetLightCount() == 0)
+		return;
+
+	r->BeginEvent(L"Clustered");
+
+	_shaderProgramClusteredLight->Render(r);
+	r->PSSetConstantBuffers(0, 1, RenderPipelineDeferred->_CBViewProjection);
+	r->PSSetConstantBuffers(1, 1, _CBClusteredLights.get());
+
+	// Whole buffers, the shader reads the ranges and the light count only
+	r->UpdateSubresource4(_CBClusteredLights->D3D11Buffer, _CBClusteredLightsData.get());
+	r->UpdateSubresource4(_BufferClusteredLights->D3D11Buffer, (void*)_ClusteredLights->GetLights().data());
+	r->UpdateSubresource4(_BufferClusterRanges->D3D11Buffer, (void*)_ClusteredLights->GetClusterRanges().data());
+	r->UpdateSubresource4(_BufferLightIndices->D3D11Buffer, (void*)_ClusteredLights->GetLightIndices().data());
+
+	LXTextureD3D11* Depth = RenderPassGBuffer->TextureDepth;
+	LXTextureD3D11* Normal = RenderPassGBuffer->TextureNormal;
+	LXTextureD3D11* Specular = RenderPassGBuffer->TextureSpecular;
+
+	r->PSSetShaderResources(0, 1, (LXTextureD3D11*)Depth);
+	r->PSSetShaderResources(2, 1, (LXTextureD3D11*)Normal);
+	r->PSSetShaderResources(3, 1, (LXTextureD3D11*)Specular);
+	r->PSSetShaderResources2(kClusteredLightsSlot, 1, _BufferClusteredLights->D3D11ShaderResourceView);
+	r->PSSetShaderResources2(kClusterRangesSlot, 1, _BufferClusterRanges->D3D11ShaderResourceView);
+	r->PSSetShaderResources2(kLightIndicesSlot, 1, _BufferLightIndices->D3D11ShaderResourceView);
+
+	r->PSSetSamplers(0, 1, (LXTextureD3D11*)Depth);
+	r->PSSetSamplers(2, 1, (LXTextureD3D11*)Normal);
+	r->PSSetSamplers(3, 1, (LXTextureD3D11*)Specular);
+
+	Renderer->GetSSTriangle()->Render(r);
+
+	r->PSSetShaderResources(0, 1, nullptr); // Depth
+	r->PSSetShaderResources(2, 1, nullptr); // Normal
+	r->PSSetShaderResources(3, 1, nullptr); // Specular
+	r->PSSetShaderResources2(kClusteredLightsSlot, 1, nullptr);
+	r->PSSetShaderResources2(kClusterRangesSlot, 1, nullptr);
+	r->PSSetShaderResources2(kLightIndicesSlot, 1, nullptr);
+
+	r->EndEvent();
+}
+
 void LXRenderPassLighting::RenderSpotLight(LXRenderCommandList* r, const LXRenderPipelineDeferred* RenderPipelineDeferred)
 {
 	r->BeginEvent(L"Spots");
@@ -261,6 +401,11 @@ void LXRenderPassLighting::RenderSpotLight(LXRenderCommandList* r, const LXRende
 		if (SpotLight->GetLightType() == ELightType::Spot)
 		{
 			SpotLight->UpdateLightParameters();
+
+			// Rendered by the clustered pass
+			if (_Clustered && !SpotLight->ConstantBufferDataSpotLight->CastShadow)
+				continue;
+
 			r->UpdateSubresource4(RenderPassShadow->ConstantBufferSpotLight->D3D11Buffer, SpotLight->ConstantBufferDataSpotLight);
 			Renderer->GetSSTriangle()->Render(r);
 		}
@@ -17,7 +17,10 @@ class LXRenderPassSSAO;
 class LXRenderPipelineDeferred;
 class LXRenderTarget;
 class LXShaderProgramBasic;
+class LXClusteredLights;
+class LXStructuredBufferD3D11;
 struct LXConstantBufferDataIBL;
+struct LXConstantBufferDataClusteredLights;
 
 class LXRenderPassLighting : public LXRenderPass
 {
@@ -27,6 +30,7 @@ public:
 	LXRenderPassLighting(LXRenderer* InRenderer);
 	virtual ~LXRenderPassLighting();
 	void RebuildShaders() override;
+	void PreRender(LXRenderCommandList* RenderCommandList) override;
 	void Render(LXRenderCommandList* RenderCommandList) override;
 	void Resize(uint Width, uint Height) override;
 	bool IsValid() const override;
@@ -38,7 +42,10 @@ private:
 	void CreateBuffers(uint Width, uint Height);
 	void DeleteBuffers();
 
+	void BinLights(const LXRenderPipelineDeferred* RenderPipelineDeferred);
+
 	void RenderIBL(LXRenderCommandList* r, const LXRenderPipelineDeferred* RenderPipelineDeferred);
+	void RenderClusteredLights(LXRenderCommandList* r, const LXRenderPipelineDeferred* RenderPipelineDeferred);
 	void RenderSpotLight(LXRenderCommandList* RenderCommandList, const LXRenderPipelineDeferred* RenderPipelineDeferred);
 	void RenderDirectionalLight(LXRenderCommandList* RenderCommandList, const LXRenderPipelineDeferred* RenderPipelineDeferred);
 	void RenderPointLight(LXRenderCommandList* RenderCommandList, const LXRenderPipelineDeferred* RenderPipelineDeferred);
@@ -71,5 +78,15 @@ private:
 	unique_ptr<LXShaderProgramBasic> _shaderProgramDirectionalLight;
 	unique_ptr<LXShaderProgramBasic> _shaderProgramPointLight;
 	unique_ptr<LXShaderProgramBasic> _shaderProgramComposeLight;
+	unique_ptr<LXShaderProgramBasic> _shaderProgramClusteredLight;
+
+	// Clustered lighting: the spot lights without shadow and the point lights, in a single pass
+	unique_ptr<LXClusteredLights> _ClusteredLights;
+	unique_ptr<LXStructuredBufferD3D11> _BufferClusteredLights;
+	unique_ptr<LXStructuredBufferD3D11> _BufferClusterRanges;
+	unique_ptr<LXStructuredBufferD3D11> _BufferLightIndices;
+	unique_ptr<LXConstantBufferD3D11> _CBClusteredLights;
+	unique_ptr<LXConstantBufferDataClusteredLights> _CBClusteredLightsData;
+	bool _Clustered = false;
 };
 
@@ -14,6 +14,7 @@
 #include "LXCore.h"
 #include "LXFrustum.h"
 #include "LXActorLight.h"
+#include "LXConsoleManager.h"
 #include "LXProject.h"
 #include "LXRenderCluster.h"
 #include "LXRenderClusterManager.h"
@@ -24,6 +25,7 @@
 #include "LXRenderTargetViewD3D11.h"
 #include "LXRenderer.h"
 #include "LXScene.h"
+#include "LXStatManager.h"
 #include "LXTextureD3D11.h"
 #include "LXViewport.h"
 #include "LXWorldTransformation.h"
@@ -31,16 +33,21 @@
 
 namespace
 {
-	const uint kShadowMapWidth = 512;
-	const uint kShadowMapHeight = 512;
 	const uint kAtlasShadowMapWidth = 2048;
 	const uint kAtlasShadowMapHeight = 2048;
+
+	// Frames without change before a caster moves to the static atlas
+	const uint64 kStaticCasterFrames = 30;
+
+	LXConsoleCommandT<bool> CSet_ShadowCache(L"Engine.ini", L"Renderer", L"ShadowCache", L"true");
 };
 
 LXRenderPassShadow::LXRenderPassShadow(LXRenderer* InRenderer):LXRenderPass(InRenderer)
 {
 	TextureDepth = make_unique<LXTextureD3D11>(kAtlasShadowMapWidth, kAtlasShadowMapHeight, DXGI_FORMAT_R24G8_TYPELESS);
 	DepthStencilView = make_unique<LXDepthStencilViewD3D11>(TextureDepth.get());
+	TextureDepthStatic = make_unique<LXTextureD3D11>(kAtlasShadowMapWidth, kAtlasShadowMapHeight, DXGI_FORMAT_R24G8_TYPELESS);
+	DepthStencilViewStatic = make_unique<LXDepthStencilViewD3D11>(TextureDepthStatic.get());
 	LXConstantBufferDataSpotLight ConstantBufferDataSpotLight;
 	ConstantBufferSpotLight = make_unique<LXConstantBufferD3D11>(&ConstantBufferDataSpotLight, static_cast<int>(sizeof(LXConstantBufferDataSpotLight)));
 	LXRenderPipeline* RenderPipeline = Renderer->GetRenderPipeline();
@@ -51,20 +58,18 @@ LXRenderPassShadow::~LXRenderPassShadow()
 {
 }
 
-void LXRenderPassShadow::Render(LXRenderCommandList* RCL)
+void LXRenderPassShadow::PreRender(LXRenderCommandList* RCL)
 {
+	_ShadowViews.clear();
+
 	if (!GetProject())
 		return;
 
 	LXRenderPipelineDeferred* RenderPipelineDeferred = dynamic_cast<LXRenderPipelineDeferred*>(Renderer->GetRenderPipeline());
 	CHK(RenderPipelineDeferred);
 
-	RCL->BeginEvent(L"Shadows");
-
-	RCL->OMSetRenderTargets2(nullptr, DepthStencilView.get());
-	RCL->ClearDepthStencilView(DepthStencilView.get());
-
-	for (const LXRenderCluster* RenderClusterLight : RenderPipelineDeferred->_ListRenderClusterLights)
+	// The light views are read by the Lighting pass: computed here, not during the recording.
+	for (LXRenderCluster* RenderClusterLight : RenderPipelineDeferred->_ListRenderClusterLights)
 	{
 		CHK(RenderClusterLight->Flags & ERenderClusterType::Light);
 
@@ -78,9 +83,6 @@ void LXRenderPassShadow::Render(LXRenderCommandList* RCL)
 			continue;
 		}
 
-		float x = RenderClusterLight->ConstantBufferDataSpotLight->ShadowMapCoords.x;
-		float y = RenderClusterLight->ConstantBufferDataSpotLight->ShadowMapCoords.y;
-		
 		// Light to Camera
 		LXActorLight* Light = dynamic_cast<LXActorLight*>(RenderClusterLight->Actor);
 		CHK(Light);
@@ -97,50 +99,208 @@ void LXRenderPassShadow::Render(LXRenderCommandList* RCL)
 		// Camera to WorlTransformation
 		LXWorldTransformation WorldTransformation;
 		WorldTransformation.FromCamera(&Camera, -1, -1);
-		LXMatrix MatrixVP = WorldTransformation.GetMatrixVP();
 
-		LXFrustum Frustum;
-		Frustum.Update(MatrixVP);
+		RenderClusterLight->LightView->View = Transpose(WorldTransformation.GetMatrixView());
+		RenderClusterLight->LightView->Projection = Transpose(WorldTransformation.GetMatrixProjection());
+		RenderClusterLight->LightView->ViewProjectionInv = Transpose(WorldTransformation.GetMatrixVPInv());
+		RenderClusterLight->LightView->ProjectionInv = Transpose(WorldTransformation.GetMatrixProjectionInv());
+		RenderClusterLight->LightView->ViewInv = Transpose(WorldTransformation.GetMatrixViewInv());
+		RenderClusterLight->LightView->CameraPosition = vec4f(Camera.GetPosition(), 0.0f);
+		RenderClusterLight->LightView->RendererSize = vec2f((float)Renderer->Width, (float)Renderer->Height);
+
+		_ShadowViews.push_back({ RenderClusterLight, WorldTransformation.GetMatrixVP(), Camera.GetPosition() });
+	}
+}
+
+void LXRenderPassShadow::Render(LXRenderCommandList* RCL)
+{
+	if (!GetProject())
+		return;
 
-		list<LXRenderCluster*> ListRenderClusterOpaques;
+	const bool UseCache = CSet_ShadowCache.GetValue();
+	bool StaticDirty = !_StaticValid || !UseCache;
+	bool AnyDynamic = false;
+	uint UpdateCount = 0;
+
+	// The caches of the lights still casting shadows
+	map<const LXRenderCluster*, TShadowCache> ShadowCaches;
+
+	for (const TShadowView& ShadowView : _ShadowViews)
+	{
+		TShadowCache& ShadowCache = ShadowCaches[ShadowView.RenderClusterLight];
 
-		for (LXRenderCluster* RenderCluster : Renderer->RenderClusterManager->ListRenderClusters)
+		auto It = _ShadowCaches.find(ShadowView.RenderClusterLight);
+		if (It != _ShadowCaches.end())
+			ShadowCache = std::move(It->second);
+
+		StaticDirty |= UpdateShadowCache(ShadowView, ShadowCache);
+		UpdateCount += ShadowCache.ListFrame == ShadowCache.Frame;
+		AnyDynamic |= !ShadowCache.DynamicCasters.empty();
+	}
+
+	_ShadowCaches.swap(ShadowCaches);
+
+	RCL->BeginEvent(L"Shadows");
+
+	if (!UseCache)
+	{
+		RCL->OMSetRenderTargets2(nullptr, DepthStencilView.get());
+		RCL->ClearDepthStencilView(DepthStencilView.get());
+
+		for (const TShadowView& ShadowView : _ShadowViews)
+		{
+			const TShadowCache& ShadowCache = _ShadowCaches[ShadowView.RenderClusterLight];
+			RenderShadowView(RCL, ShadowView, ShadowCache.StaticCasters);
+			RenderShadowView(RCL, ShadowView, ShadowCache.DynamicCasters);
+		}
+
+		_StaticValid = false;
+	}
+	else
+	{
+		if (StaticDirty)
+		{
+			RCL->OMSetRenderTargets2(nullptr, DepthStencilViewStatic.get());
+			RCL->ClearDepthStencilView(DepthStencilViewStatic.get());
+
+			for (const TShadowView& ShadowView : _ShadowViews)
+			{
+				RenderShadowView(RCL, ShadowView, _ShadowCaches[ShadowView.RenderClusterLight].StaticCasters);
+			}
+
+			_StaticValid = true;
+		}
+
+		// Unchanged atlas when it holds the static casters only
+		if (StaticDirty || AnyDynamic || _DynamicRendered)
 		{
-			if (Frustum.IsBoxIn(RenderCluster->BBoxWorld.GetMin(), RenderCluster->BBoxWorld.GetMax()))
+			RCL->OMSetRenderTargets2(nullptr, nullptr);
+			RCL->CopyResource(TextureDepth->D3D11Texture2D, TextureDepthStatic->D3D11Texture2D);
+
+			if (AnyDynamic)
 			{
-				if (!RenderCluster->IsTransparent() && RenderCluster->CastShadow)
+				RCL->OMSetRenderTargets2(nullptr, DepthStencilView.get());
+
+				for (const TShadowView& ShadowView : _ShadowViews)
 				{
-					ListRenderClusterOpaques.push_back(RenderCluster);
+					RenderShadowView(RCL, ShadowView, _ShadowCaches[ShadowView.RenderClusterLight].DynamicCasters);
 				}
 			}
+
+			_DynamicRendered = AnyDynamic;
 		}
+	}
 
-		RCL->RSSetViewports2(x, y, (float)kShadowMapWidth, (float)kShadowMapHeight);
-		
-		RenderClusterLight->LightView->View = Transpose(WorldTransformation.GetMatrixView());
-		RenderClusterLight->LightView->Projection = Transpose(WorldTransformation.GetMatrixProjection());
-		RenderClusterLight->LightView->ViewProjectionInv = Transpose(WorldTransformation.GetMatrixVPInv());
-		RenderClusterLight->LightView->ProjectionInv = Transpose(WorldTransformation.GetMatrixProjectionInv());
-		RenderClusterLight->LightView->ViewInv = Transpose(WorldTransformation.GetMatrixViewInv());
-		RenderClusterLight->LightView->CameraPosition = vec4f(Camera.GetPosition(), 0.0f);
-		RenderClusterLight->LightView->RendererSize = vec2f((float)Renderer->Width, (float)Renderer->Height);
-			
-		RCL->CBViewProjection = RenderPipelineDeferred->_CBViewProjection;
-		RCL->UpdateSubresource4(RenderPipelineDeferred->_CBViewProjection->D3D11Buffer, RenderClusterLight->LightView);
-		
-		for (LXRenderCluster* RenderCluster : ListRenderClusterOpaques)
+	RCL->EndEvent();
+
+	GetStatManager()->SetFrameCounter(L"Shadows.CasterListUpdates", UpdateCount);
+	GetStatManager()->SetFrameCounter(L"Shadows.StaticRendered", UseCache && StaticDirty ? 1 : 0);
+}
+
+bool LXRenderPassShadow::UpdateShadowCache(const TShadowView& ShadowView, TShadowCache& ShadowCache)
+{
+	const LXRenderClusterManager* RenderClusterManager = Renderer->RenderClusterManager;
+	const LXRenderCluster* RenderClusterLight = ShadowView.RenderClusterLight;
+	const vec4f& ShadowMapCoords = RenderClusterLight->ConstantBufferDataSpotLight->ShadowMapCoords;
+	const uint64 Frame = RenderClusterManager->GetFrame();
+
+	LXFrustum Frustum;
+	Frustum.Update(ShadowView.MatrixVP);
+
+	bool Valid = ShadowCache.Frame + 1 == Frame && !RenderClusterManager->IsChangedAll();
+	Valid = Valid && ShadowCache.LightHandle.Slot == RenderClusterLight->Handle.Slot && ShadowCache.LightHandle.Generation == RenderClusterLight->Handle.Generation;
+	Valid = Valid && ShadowCache.MatrixVP == ShadowView.MatrixVP && ShadowCache.ShadowMapCoords == ShadowMapCoords;
+
+	// A caster in the frustum changed
+	if (Valid)
+	{
+		for (const LXBBox& BBox : RenderClusterManager->GetChangedBounds())
 		{
-			RenderCluster->Render(ERenderPass::Shadow, RCL);
+			if (BBox.IsValid() && Frustum.IsBoxIn(BBox.GetMin(), BBox.GetMax()))
+			{
+				Valid = false;
+				break;
+			}
 		}
+	}
 
-		RCL->VSSetShader(nullptr);
-		RCL->HSSetShader(nullptr);
-		RCL->DSSetShader(nullptr);
-		RCL->GSSetShader(nullptr);
-		RCL->PSSetShader(nullptr);
+	// Kept as is, dynamic casters included
+	if (Valid && Frame < ShadowCache.StaticFrame)
+	{
+		ShadowCache.Frame = Frame;
+		return false;
 	}
 
-	RCL->EndEvent();
+	const bool StaticValid = Valid;
+
+	ShadowCache.LightHandle = RenderClusterLight->Handle;
+	ShadowCache.MatrixVP = ShadowView.MatrixVP;
+	ShadowCache.ShadowMapCoords = ShadowMapCoords;
+	ShadowCache.Frame = Frame;
+	ShadowCache.ListFrame = Frame;
+	ShadowCache.StaticFrame = UINT64_MAX;
+
+	// Casters, by the spatial query
+	vector<uint> IndicesVisible;
+	vector<uint> IndicesStatic;
+	vector<uint> IndicesDynamic;
+
+	const LXRenderClusterStore& RenderClusterStore = RenderClusterManager->RenderClusterStore;
+	const uint* Flags = RenderClusterStore.GetFlags();
+
+	RenderClusterManager->CullRenderClusters(Frustum, IndicesVisible);
+
+	for (uint Index : IndicesVisible)
+	{
+		if ((Flags[Index] & (kRenderClusterCastShadow | kRenderClusterTransparent)) != kRenderClusterCastShadow)
+			continue;
+
+		const uint64 StaticFrame = RenderClusterStore.GetRenderCluster(Index)->ChangeFrame + kStaticCasterFrames;
+		if (StaticFrame <= Frame)
+		{
+			IndicesStatic.push_back(Index);
+		}
+		else
+		{
+			IndicesDynamic.push_back(Index);
+			ShadowCache.StaticFrame = min(ShadowCache.StaticFrame, StaticFrame);
+		}
+	}
+
+	vector<LXRenderCluster*> StaticCasters;
+	SortRenderClusters(RenderClusterStore, IndicesStatic, ERenderPass::Shadow, ShadowView.Position, StaticCasters);
+	SortRenderClusters(RenderClusterStore, IndicesDynamic, ERenderPass::Shadow, ShadowView.Position, ShadowCache.DynamicCasters);
+
+	// Sorted lists: the same clusters give the same list
+	const bool StaticChanged = !StaticValid || StaticCasters != ShadowCache.StaticCasters;
+	ShadowCache.StaticCasters.swap(StaticCasters);
+	return StaticChanged;
+}
+
+void LXRenderPassShadow::RenderShadowView(LXRenderCommandList* RCL, const TShadowView& ShadowView, const vector<LXRenderCluster*>& Casters)
+{
+	if (Casters.empty())
+		return;
+
+	LXRenderPipelineDeferred* RenderPipelineDeferred = dynamic_cast<LXRenderPipelineDeferred*>(Renderer->GetRenderPipeline());
+	CHK(RenderPipelineDeferred);
+
+	const LXRenderCluster* RenderClusterLight = ShadowView.RenderClusterLight;
+	const vec4f& ShadowMapCoords = RenderClusterLight->ConstantBufferDataSpotLight->ShadowMapCoords;
+
+	// Tile assigned by the shadow atlas of the pipeline
+	RCL->RSSetViewports2(ShadowMapCoords.x, ShadowMapCoords.y, ShadowMapCoords.z, ShadowMapCoords.w);
+
+	RCL->CBViewProjection = RenderPipelineDeferred->_CBViewProjection;
+	RCL->UpdateSubresource4(RenderPipelineDeferred->_CBViewProjection->D3D11Buffer, RenderClusterLight->LightView);
+
+	RenderClusters(RCL, Casters, ERenderPass::Shadow);
+
+	RCL->VSSetShader(nullptr);
+	RCL->HSSetShader(nullptr);
+	RCL->DSSetShader(nullptr);
+	RCL->GSSetShader(nullptr);
+	RCL->PSSetShader(nullptr);
 }
 
 void LXRenderPassShadow::Resize(uint Width, uint Height)
@@ -10,6 +10,8 @@
 
 #include "LXRenderPass.h"
 #include "LXConstantBufferD3D11.h"
+#include "LXMatrix.h"
+#include "LXRenderClusterStore.h"
 
 class LXRenderPassShadow : 	public LXRenderPass
 {
@@ -18,12 +20,53 @@ public:
 
 	LXRenderPassShadow(LXRenderer* InRenderer);
 	virtual ~LXRenderPassShadow();
+	void PreRender(LXRenderCommandList* RCL) override;
 	void Render(LXRenderCommandList* RCL) override;
 	void Resize(uint Width, uint Height) override;
 	
+private:
+
+	struct TShadowView
+	{
+		LXRenderCluster* RenderClusterLight;
+		LXMatrix MatrixVP;
+		vec3f Position;
+	};
+
+	// Casters of a light, kept while the light and the clusters in its frustum do not change.
+	// The static casters, unchanged for some frames, are rendered in TextureDepthStatic.
+	struct TShadowCache
+	{
+		TRenderClusterHandle LightHandle;
+		LXMatrix MatrixVP;
+		vec4f ShadowMapCoords;
+		uint64 Frame = 0;
+		uint64 ListFrame = 0;		// Casters computed
+		uint64 StaticFrame = 0;		// A dynamic caster becomes static
+		vector<LXRenderCluster*> StaticCasters;
+		vector<LXRenderCluster*> DynamicCasters;
+	};
+
+	// Returns true when the static casters changed
+	bool UpdateShadowCache(const TShadowView& ShadowView, TShadowCache& ShadowCache);
+	void RenderShadowView(LXRenderCommandList* RCL, const TShadowView& ShadowView, const vector<LXRenderCluster*>& Casters);
+
+	// Shadow casting lights of the frame, computed by PreRender
+	vector<TShadowView> _ShadowViews;
+
+	map<const LXRenderCluster*, TShadowCache> _ShadowCaches;
+	bool _StaticValid = false;
+	bool _DynamicRendered = false;	// TextureDepth differs from TextureDepthStatic
+
+public:
+	
 	unique_ptr<LXTextureD3D11> TextureDepth;
 	unique_ptr<LXDepthStencilViewD3D11> DepthStencilView;
 
+	// Static casters, copied in TextureDepth before the dynamic ones
+	unique_ptr<LXTextureD3D11> TextureDepthStatic;
+	unique_ptr<LXDepthStencilViewD3D11> DepthStencilViewStatic;
+
 	// SpotLight
 	unique_ptr<LXConstantBufferD3D11> ConstantBufferSpotLight;
 };
@@ -28,6 +28,9 @@ LXConsoleCommandT<bool> CCShowFPS(L"View.ShowFPS", &ShowFPS);
 LXRenderPassUI::LXRenderPassUI(LXRenderer* InRenderer):LXRenderPass(InRenderer)
 {
 	const LXDirectX11* DirectX11 = Renderer->GetDirectX11();
+	if (!DirectX11)
+		return;
+
 #if LX_D2D1
 	DirectX11->_D2D1DeviceContext->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Red), &pRedBrush);
 	DirectX11->_D2D1DeviceContext->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &pWhiteBrush);
@@ -128,6 +131,19 @@ void LXRenderPassUI::DrawStats()
 		PositionY += LineHeight;
 	}
 
+	// Frame Counters
+	for (auto& Counter : GetStatManager()->GetFrameCounters())
+	{
+		float Top = (float)PositionY;
+		float Bottom = Top + (float)LineHeight;
+		LXString Str = LXString::Format(L"%s : %u\n",
+			Counter.first.c_str(),
+			Counter.second);
+
+		DirectX11->_D2D1DeviceContext->DrawText(Str.GetBuffer(), Str.GetLength(), DirectX11->_DWriteTextFormat, D2D1::RectF(0.0f, Top, 600, Bottom), pWhiteBrush);
+		PositionY += LineHeight;
+	}
+
 #endif
 
 	GetStatManager()->Reset();
@@ -180,6 +196,10 @@ void LXRenderPassUI::Render(LXRenderCommandList*)
 	const LXRenderPass* RenderPass = Renderer->GetRenderPipeline()->GetPreviousRenderPass();
 	const LXDirectX11* DirectX11 = Renderer->GetDirectX11();
 
+	// Drawn directly with D2D, nothing to draw without device
+	if (!DirectX11)
+		return;
+
 #if LX_D2D1
 	ID2D1DeviceContext* dc = DirectX11->_D2D1DeviceContext;
 #endif
@@ -10,6 +10,8 @@
 #include "LXRenderPass.h"
 #include "LXRenderPipeline.h"
 #include "LXConsoleManager.h"
+#include "LXRenderCommandList.h"
+#include "LXThreadManager.h"
 
 LXRenderPipeline::LXRenderPipeline()
 {
@@ -23,12 +25,18 @@ void LXRenderPipeline::Render(LXRenderCommandList* RenderCommandList)
 {
 	bool ValidRenderPasses = true;
 
+	vector<LXRenderPass*> RenderPasses;
+	LXRenderPass* PreviousRenderPass = nullptr;
+
 	for (LXRenderPass* RenderPass : _RenderPasses)
 	{
 		if (RenderPass->IsValid())
 		{
-			RenderPass->Render(RenderCommandList);
-			_PreviousRenderPass = RenderPass;
+			RenderPass->_PreviousRenderPass = PreviousRenderPass;
+			RenderPass->_UsedInstanceBuffers = 0;
+			RenderPass->PreRender(RenderCommandList);
+			RenderPasses.push_back(RenderPass);
+			PreviousRenderPass = RenderPass;
 		}
 		else
 		{
@@ -39,6 +47,29 @@ void LXRenderPipeline::Render(LXRenderCommandList* RenderCommandList)
 		}
 	}
 
+	if (RenderCommandList->ParallelRecording && !RenderCommandList->DirectMode)
+	{
+		// One child list per pass, executed in the pass order whatever the recording order.
+		vector<LXRenderCommandList*> CommandLists(RenderPasses.size());
+		for (size_t i = 0; i < RenderPasses.size(); i++)
+		{
+			CommandLists[i] = RenderCommandList->CreateChild();
+		}
+
+		ParallelFor((uint)RenderPasses.size(), [&](uint i)
+		{
+			RenderPasses[i]->Render(CommandLists[i]);
+		});
+	}
+	else
+	{
+		for (LXRenderPass* RenderPass : RenderPasses)
+		{
+			RenderPass->Render(RenderCommandList);
+			_PreviousRenderPass = RenderPass;
+		}
+	}
+
 	_PreviousRenderPass = nullptr;
 }
 
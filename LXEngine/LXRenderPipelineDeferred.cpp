@@ -10,7 +10,15 @@
 #include "LXRenderPipelineDeferred.h"
 #include "LXAssetManager.h"
 #include "LXActorCamera.h"
+#include "LXActorLight.h"
+#include "LXActorMesh.h"
+#include "LXAssetMesh.h"
+#include "LXConsoleManager.h"
 #include "LXFrustum.h"
+#include "LXOcclusionCulling.h"
+#include "LXPrimitive.h"
+#include "LXPrimitiveD3D11.h"
+#include "LXPrimitiveInstance.h"
 #include "LXProject.h"
 #include "LXRenderCluster.h"
 #include "LXRenderClusterManager.h"
@@ -27,6 +35,8 @@
 #include "LXRenderPassToneMapping.h"
 #include "LXRenderPassTransparency.h"
 #include "LXRenderPassUI.h"
+#include "LXShadowAtlas.h"
+#include "LXStatManager.h"
 #include "LXTextureManager.h"
 #include "LXViewport.h"
 #include "LXMemory.h" // --- Must be the last included ---
@@ -34,6 +44,74 @@
 #include "LXActorSceneCapture.h"
 #include "LXViewState.h"
 
+namespace
+{
+	LXConsoleCommandT<bool> CSet_OcclusionCulling(L"Engine.ini", L"Renderer", L"OcclusionCulling", L"true");
+	LXConsoleCommandT<bool> CSet_MeshLOD(L"Engine.ini", L"Renderer", L"MeshLOD", L"true");
+
+	// Off until the lighting shaders read the tile size from ShadowMapCoords.zw: they assume kShadowTileFixedSize
+	LXConsoleCommandT<bool> CSet_ShadowVariableTiles(L"Engine.ini", L"Renderer", L"ShadowVariableTiles", L"false");
+
+	const uint kShadowAtlasSize = 2048;
+	const uint kShadowTileFixedSize = 512;
+	const uint kShadowTileMinSize = 128;
+	const uint kShadowTileMaxSize = 1024;
+
+	// Screen area fraction of the spot light cone, up to the farthest corner of the scene bounds
+	float GetSpotLightCoverage(LXActorLight* Light, const vec3f& BoundsMin, const vec3f& BoundsMax, const LXMatrix& MatrixVP)
+	{
+		const LXMatrix& MatrixWCS = Light->GetMatrixWCS();
+		const vec3f Apex = MatrixWCS.GetOrigin();
+		vec3f Direction = MatrixWCS.GetVz() * -1.f;
+		vec3f Right = MatrixWCS.GetVx();
+		vec3f Up = MatrixWCS.GetVy();
+		Direction.Normalize();
+		Right.Normalize();
+		Up.Normalize();
+
+		float Reach = 0.f;
+		for (uint i = 0; i < 8; i++)
+		{
+			const vec3f Corner(i & 1 ? BoundsMax.x : BoundsMin.x, i & 2 ? BoundsMax.y : BoundsMin.y, i & 4 ? BoundsMax.z : BoundsMin.z);
+			Reach = std::max(Reach, Apex.Distance(Corner));
+		}
+
+		// Pyramid around the cone
+		const float Radius = Reach * tanf(LX_DEGTORAD(Light->GetSpotAngle()) * 0.5f);
+		const vec3f Center = Apex + Direction * Reach;
+		const vec3f Points[5] = { Apex, Center + (Right + Up) * Radius, Center + (Right - Up) * Radius, Center - (Right + Up) * Radius, Center - (Right - Up) * Radius };
+
+		const float* m = MatrixVP.GetPtr();
+		float MinX = FLT_MAX, MinY = FLT_MAX, MaxX = -FLT_MAX, MaxY = -FLT_MAX;
+
+		for (const vec3f& Point : Points)
+		{
+			const float w = m[3] * Point.x + m[7] * Point.y + m[11] * Point.z + m[15];
+
+			// Crossing the camera plane: assumed covering the screen
+			if (w <= 0.f)
+				return 1.f;
+
+			const float x = (m[0] * Point.x + m[4] * Point.y + m[8] * Point.z + m[12]) / w;
+			const float y = (m[1] * Point.x + m[5] * Point.y + m[9] * Point.z + m[13]) / w;
+			MinX = std::min(MinX, x);
+			MinY = std::min(MinY, y);
+			MaxX = std::max(MaxX, x);
+			MaxY = std::max(MaxY, y);
+		}
+
+		MinX = std::max(MinX, -1.f);
+		MinY = std::max(MinY, -1.f);
+		MaxX = std::min(MaxX, 1.f);
+		MaxY = std::min(MaxY, 1.f);
+
+		if (MaxX <= MinX || MaxY <= MinY)
+			return 0.f;
+
+		return (MaxX - MinX) * (MaxY - MinY) * 0.25f;
+	}
+};
+
 LXRenderPipelineDeferred::LXRenderPipelineDeferred(LXRenderer* Renderer):_Renderer(Renderer)
 {
 	_Renderer->_RenderPipeline = this;
@@ -56,6 +134,7 @@ LXRenderPipelineDeferred::LXRenderPipelineDeferred(LXRenderer* Renderer):_Render
 	RenderPassUI = new LXRenderPassUI(Renderer);
 	RenderPassSSAO = new LXRenderPassSSAO(Renderer);
 	_renderPassDOF = make_unique<LXRenderPassDepthOfField>(Renderer);
+	_OcclusionCulling = make_unique<LXOcclusionCulling>();
 	   
 	_RenderPasses.push_back(RenderPassDynamicTexture);
 	_RenderPasses.push_back(RenderPassShadow);
@@ -148,39 +227,64 @@ void LXRenderPipelineDeferred::BuildRenderClusterLists()
 	LXFrustum Frustum;
 	Frustum.Update(MatrixVP);
 
-	for (LXRenderCluster* RenderCluster : _Renderer->RenderClusterManager->ListRenderClusters)
+	// Culling on the store data, the clusters are dereferenced for the lights and the transparents only
+	const LXRenderClusterManager* RenderClusterManager = _Renderer->RenderClusterManager;
+	const LXRenderClusterStore& RenderClusterStore = RenderClusterManager->RenderClusterStore;
+	const uint* Flags = RenderClusterStore.GetFlags();
+
+	// Lights are always visible
+	for (uint i : RenderClusterManager->GetLightIndices())
 	{
-		const bool IsLight = RenderCluster->Flags & ERenderClusterType::Light;
+		LXRenderCluster* RenderCluster = RenderClusterStore.GetRenderCluster(i);
+		_ListRenderClusterLights.push_back(RenderCluster);
+
+		// For the Editor UI or Debug 
+		//_ListRenderClusterAuxiliary.push_back(RenderCluster);
+	}
+
+	UpdateShadowAtlas(MatrixVP, Camera->GetPosition());
 
-		if (IsLight || Frustum.IsBoxIn(RenderCluster->BBoxWorld.GetMin(), RenderCluster->BBoxWorld.GetMax()))
+	_IndicesVisible.clear();
+	_IndicesOpaques.clear();
+	_IndicesAuxiliary.clear();
+
+	RenderClusterManager->CullRenderClusters(Frustum, _IndicesVisible);
+
+	//
+	// Occlusion Culling
+	//
+
+	if (CSet_OcclusionCulling.GetValue())
+	{
+		CullOccludedRenderClusters(MatrixVP, Camera->GetPosition());
+	}
+
+	for (uint i : _IndicesVisible)
+	{
+		if (Flags[i] & (uint)ERenderClusterType::Light)
 		{
-			if (IsLight)
-			{
-				_ListRenderClusterLights.push_back(RenderCluster);
-				if (RenderCluster->ConstantBufferDataSpotLight->CastShadow)
-				{
-					// Define the Shadow map position in the shadowAtlas
-					GetTextureCoordinatesInAtlas(RenderCluster, RenderCluster->ConstantBufferDataSpotLight->ShadowMapCoords);
-				}
-
-				// For the Editor UI or Debug 
-				//_ListRenderClusterAuxiliary.push_back(RenderCluster);
-			}
-			else if (RenderCluster->Flags & ERenderClusterType::Auxiliary)
-			{
-				_ListRenderClusterAuxiliary.push_back(RenderCluster);
-			}
-			else if (RenderCluster->IsTransparent())
-			{
-				_ListRenderClusterTransparents.push_back(RenderCluster);
-			}
-			else
-			{
-				_ListRenderClusterOpaques.push_back(RenderCluster);
-			}
+			continue;
+		}
+		else if (Flags[i] & (uint)ERenderClusterType::Auxiliary)
+		{
+			_IndicesAuxiliary.push_back(i);
+		}
+		else if (Flags[i] & kRenderClusterTransparent)
+		{
+			_ListRenderClusterTransparents.push_back(RenderClusterStore.GetRenderCluster(i));
+		}
+		else
+		{
+			_IndicesOpaques.push_back(i);
 		}
 	}
 
+	// Sorted by state, front to back
+	SortRenderClusters(RenderClusterStore, _IndicesOpaques, ERenderPass::GBuffer, Camera->GetPosition(), _ListRenderClusterOpaques);
+	SortRenderClusters(RenderClusterStore, _IndicesAuxiliary, ERenderPass::GBuffer, Camera->GetPosition(), _ListRenderClusterAuxiliary);
+
+	SelectLODs(Camera, WorldTransformation->GetMatrixProjection());
+
 	//
 	// Prepare ConstantBuffer Data
 	// 
@@ -199,6 +303,126 @@ void LXRenderPipelineDeferred::BuildRenderClusterLists()
 	}
 }
 
+void LXRenderPipelineDeferred::SelectLODs(const LXActorCamera* Camera, const LXMatrix& MatrixProjection)
+{
+	const bool MeshLOD = CSet_MeshLOD.GetValue();
+	const vec3f ViewPosition = Camera->GetPosition();
+
+	// Pixels per world unit at distance 1, or at any distance with an orthographic camera
+	const float PixelScale = MatrixProjection.GetPtr()[5] * _Renderer->Height * 0.5f;
+
+	uint ReducedCount = 0;
+
+	auto Select = [&](LXRenderCluster* RenderCluster)
+	{
+		const LXPrimitiveD3D11* Primitive = RenderCluster->Primitive.get();
+		if (!Primitive || Primitive->LODs.empty() || !MeshLOD)
+		{
+			RenderCluster->LOD = 0;
+			return;
+		}
+
+		const float Diagonal = RenderCluster->BBoxWorld.GetSize().Length();
+		const float Distance = RenderCluster->BBoxWorld.GetCenter().Distance(ViewPosition);
+
+		// From inside the bounds, the full resolution
+		if (!Camera->IsOrtho() && Distance <= Diagonal * 0.5f)
+		{
+			RenderCluster->LOD = 0;
+			return;
+		}
+
+		const float ScreenSize = Camera->IsOrtho() ? Diagonal * PixelScale : Diagonal * PixelScale / Distance;
+		RenderCluster->LOD = Primitive->SelectLOD(ScreenSize, RenderCluster->LOD);
+
+		if (RenderCluster->LOD > 0)
+			ReducedCount++;
+	};
+
+	for (LXRenderCluster* RenderCluster : _ListRenderClusterOpaques)
+		Select(RenderCluster);
+
+	for (LXRenderCluster* RenderCluster : _ListRenderClusterTransparents)
+		Select(RenderCluster);
+
+	GetStatManager()->SetFrameCounter(L"LOD.ReducedClusters", ReducedCount);
+}
+
+void LXRenderPipelineDeferred::CullOccludedRenderClusters(const LXMatrix& MatrixVP, const vec3f& ViewPosition)
+{
+	const LXRenderClusterStore& RenderClusterStore = _Renderer->RenderClusterManager->RenderClusterStore;
+	const uint* Flags = RenderClusterStore.GetFlags();
+
+	// Visible opaque occluders, front to back
+	_IndicesOccluders.clear();
+	for (uint i : _IndicesVisible)
+	{
+		if ((Flags[i] & (kRenderClusterOccluder | kRenderClusterTransparent)) == kRenderClusterOccluder)
+			_IndicesOccluders.push_back(i);
+	}
+
+	std::sort(_IndicesOccluders.begin(), _IndicesOccluders.end(), [&RenderClusterStore, &ViewPosition](uint a, uint b)
+	{
+		return RenderClusterStore.GetCenter(a).Distance(ViewPosition) < RenderClusterStore.GetCenter(b).Distance(ViewPosition);
+	});
+
+	_OcclusionCulling->Begin(MatrixVP);
+
+	// The rasterized occluders, not tested: a plane facing the camera is at the depth it wrote
+	vector<uint> Rasterized;
+	Rasterized.reserve(_IndicesOccluders.size());
+
+	for (uint i : _IndicesOccluders)
+	{
+		LXRenderCluster* RenderCluster = RenderClusterStore.GetRenderCluster(i);
+		LXPrimitive* Primitive = RenderCluster->PrimitiveInstance ? RenderCluster->PrimitiveInstance->Primitive.get() : nullptr;
+
+		if (!Primitive || Primitive->GetTopology() != LX_TRIANGLES)
+			continue;
+
+		const ArrayVec3f& Positions = Primitive->GetArrayPositions();
+		const ArrayUint& Indices = Primitive->GetArrayIndices();
+
+		// The arrays are read every frame: kept resident by the memory budget while the occluder is visible,
+		// or loaded again at the next sync point when released before it became visible.
+		if (LXActorMesh* ActorMesh = dynamic_cast<LXActorMesh*>(RenderCluster->Actor))
+		{
+			if (LXAssetMesh* AssetMesh = ActorMesh->GetAssetMesh())
+			{
+				if (AssetMesh->State == LXAsset::EResourceState::LXResourceState_Unloaded)
+					GetProject()->GetAssetManager().RequestUse(AssetMesh);
+				else
+					AssetMesh->MarkUsed();
+			}
+		}
+
+		if (Positions.empty())
+			continue;
+
+		_OcclusionCulling->AddOccluder(Positions.data(), (uint)Positions.size(), Indices.empty() ? nullptr : Indices.data(), (uint)Indices.size(), RenderCluster->Matrix);
+		Rasterized.push_back(i);
+	}
+
+	_OcclusionCulling->Rasterize();
+
+	std::sort(Rasterized.begin(), Rasterized.end());
+	auto FirstRasterized = std::partition(_IndicesVisible.begin(), _IndicesVisible.end(), [&Rasterized](uint i)
+	{
+		return !std::binary_search(Rasterized.begin(), Rasterized.end(), i);
+	});
+	_IndicesVisible.erase(FirstRasterized, _IndicesVisible.end());
+
+	const uint TestedCount = (uint)_IndicesVisible.size();
+	const uint CulledCount = _OcclusionCulling->CullBoxes(RenderClusterStore.GetFrustumBoxes(), _IndicesVisible);
+
+	_IndicesVisible.insert(_IndicesVisible.end(), Rasterized.begin(), Rasterized.end());
+
+	GetStatManager()->SetFrameCounter(L"OcclusionCulling.Occluders", _OcclusionCulling->GetOccluderCount());
+	GetStatManager()->SetFrameCounter(L"OcclusionCulling.Triangles", _OcclusionCulling->GetTriangleCount());
+	GetStatManager()->SetFrameCounter(L"OcclusionCulling.Tested", _OcclusionCulling->GetOccluderCount() ? TestedCount : 0);
+	GetStatManager()->SetFrameCounter(L"OcclusionCulling.Culled", CulledCount);
+}
+
 void LXRenderPipelineDeferred::Render(LXRenderCommandList* RenderCommandList)
 {
 	// Creates and sorts the RenderCluster lists
@@ -218,6 +442,12 @@ void LXRenderPipelineDeferred::Render(LXRenderCommandList* RenderCommandList)
 
 	// Update shared constant buffers
 	RenderCommandList->UpdateSubresource4(RenderPassTransparent->CBImageBaseLighting->D3D11Buffer, &RenderPassTransparent->CBImageBaseLightingData);
+
+	// Materials are shared by the passes, recorded in parallel
+	_Renderer->RenderClusterManager->PreRenderMaterials(RenderCommandList);
+
+	// Inherited by the pass command lists
+	RenderCommandList->CBViewProjection = _CBViewProjection;
 			
 	__super::Render(RenderCommandList);
 }
@@ -271,31 +501,50 @@ const LXTextureD3D11* LXRenderPipelineDeferred::GetOutput() const
 	return Texture;
 }
 
-void LXRenderPipelineDeferred::GetTextureCoordinatesInAtlas(LXRenderCluster* RenderCluster, vec4f& outTextureCoordinates)
+void LXRenderPipelineDeferred::UpdateShadowAtlas(const LXMatrix& MatrixVP, const vec3f& ViewPosition)
 {
-	static map < LXActor*, uint> mapActors;
-	static bool IndexStatus[16] = { true };
-	int static indices = 0;
-	int index;
+	// Created again, all the tiles lost, when the setting changes
+	const bool VariableTiles = CSet_ShadowVariableTiles.GetValue();
+	if (!_ShadowAtlas || VariableTiles != _ShadowAtlasVariableTiles)
+	{
+		if (VariableTiles)
+			_ShadowAtlas = make_unique<LXShadowAtlas>(kShadowAtlasSize, kShadowTileMinSize, kShadowTileMaxSize);
+		else
+			_ShadowAtlas = make_unique<LXShadowAtlas>(kShadowAtlasSize, kShadowTileFixedSize, kShadowTileFixedSize);
+
+		_ShadowAtlasVariableTiles = VariableTiles;
+	}
+
+	vec3f BoundsMin, BoundsMax;
+	const bool HasBounds = _Renderer->RenderClusterManager->GetBounds(BoundsMin, BoundsMax);
+
+	vector<LXRenderCluster*> ShadowLights;
 
-	if (mapActors.find(RenderCluster->Actor) == mapActors.end())
+	for (LXRenderCluster* RenderCluster : _ListRenderClusterLights)
 	{
-		index = indices;
-		mapActors[RenderCluster->Actor] = index;
-		indices++;
+		LXActorLight* ActorLight = dynamic_cast<LXActorLight*>(RenderCluster->Actor);
+		CHK(ActorLight);
+
+		if (!ActorLight->GetCastShadow() || ActorLight->GetType() != ELightType::Spot)
+			continue;
+
+		const float Coverage = HasBounds ? GetSpotLightCoverage(ActorLight, BoundsMin, BoundsMax, MatrixVP) : 1.f;
+		_ShadowAtlas->Request(RenderCluster, Coverage, ActorLight->GetMatrixWCS().GetOrigin().Distance(ViewPosition));
+		ShadowLights.push_back(RenderCluster);
 	}
-	else 
+
+	_ShadowAtlas->Update();
+
+	// Shadow map position and size in the atlas, no shadow without tile
+	for (LXRenderCluster* RenderCluster : ShadowLights)
 	{
-		index = mapActors[RenderCluster->Actor];
+		const TShadowAtlasTile& Tile = _ShadowAtlas->GetTile(RenderCluster);
+		RenderCluster->ConstantBufferDataSpotLight->ShadowMapCoords = vec4f((float)Tile.X, (float)Tile.Y, (float)Tile.Size, (float)Tile.Size);
+		RenderCluster->ConstantBufferDataSpotLight->CastShadow = Tile.Size > 0;
 	}
-		
-	const float kShadowMapWidth = 512.f;
-	const float kShadowMapHeight = 512.f;
-	const float AtlasWidth = 2048.f;
-	const float AtlasHeight = 2048.f;
-	float y = (float)(index / 4);
-	float x = index - (y * 4);
-	outTextureCoordinates.x = x * kShadowMapWidth;
-	outTextureCoordinates.y = y * kShadowMapHeight;
+
+	GetStatManager()->SetFrameCounter(L"Shadows.AtlasTiles", _ShadowAtlas->GetTileCount());
+	GetStatManager()->SetFrameCounter(L"Shadows.AtlasEvictions", _ShadowAtlas->GetEvictionCount());
+	GetStatManager()->SetFrameCounter(L"Shadows.AtlasResizes", _ShadowAtlas->GetResizeCount());
 }
 
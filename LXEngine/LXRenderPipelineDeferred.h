@@ -27,6 +27,9 @@ class LXRenderPassToneMapping;
 class LXRenderPassTransparency;
 class LXRenderPassUI;
 class LXRenderPassDepthOfField;
+class LXActorCamera;
+class LXOcclusionCulling;
+class LXShadowAtlas;
 
 enum class LXTextureSlot
 {
@@ -78,13 +81,19 @@ public:
 	// Misc
 	const LXConstantBufferD3D11* GetCBViewProjection() const { return _CBViewProjection; }
 	const LXTextureD3D11* GetOutput() const override;
-	void GetTextureCoordinatesInAtlas(LXRenderCluster* RenderCluster, vec4f& outTextureCoordinates);
 	const LXTextureD3D11* GetTextureNoise4x4() const { return _TextureNoise4x4; }
-	const list<LXRenderCluster*>& GetRenderClusterAuxiliary() const { return _ListRenderClusterAuxiliary; }
+	const vector<LXRenderCluster*>& GetRenderClusterAuxiliary() const { return _ListRenderClusterAuxiliary; }
 
 private:
 
 	void BuildRenderClusterLists();
+	void CullOccludedRenderClusters(const LXMatrix& MatrixVP, const vec3f& ViewPosition);
+
+	// Picks the LOD of the visible clusters from their projected bounds
+	void SelectLODs(const LXActorCamera* Camera, const LXMatrix& MatrixProjection);
+
+	// Assigns the shadow map tiles of the spot lights
+	void UpdateShadowAtlas(const LXMatrix& MatrixVP, const vec3f& ViewPosition);
 	
 private:
 
@@ -109,10 +118,23 @@ private:
 	LXConstantBufferData0 _CBViewProjectionData;
 
 	// Visible clusters in the main view frustum
-	list<LXRenderCluster*> _ListRenderClusterOpaques;
+	vector<LXRenderCluster*> _ListRenderClusterOpaques;
 	list<LXRenderCluster*> _ListRenderClusterTransparents;
-	list<LXRenderCluster*> _ListRenderClusterAuxiliary;
+	vector<LXRenderCluster*> _ListRenderClusterAuxiliary;
 	list<LXRenderCluster*> _ListRenderClusterLights;
+
+	// Culling output, indices in the RenderClusterStore before the sort
+	vector<uint> _IndicesVisible;
+	vector<uint> _IndicesOpaques;
+	vector<uint> _IndicesAuxiliary;
+	vector<uint> _IndicesOccluders;
+
+	// Software occlusion culling, between the frustum culling and the list building
+	unique_ptr<LXOcclusionCulling> _OcclusionCulling;
+
+	// Shadow map tiles of the lights, sized by their screen coverage with Renderer.ShadowVariableTiles
+	unique_ptr<LXShadowAtlas> _ShadowAtlas;
+	bool _ShadowAtlasVariableTiles = false;
 	
 	// Global textures
 	LXTextureD3D11* _TextureD3D11IBL = nullptr;
@@ -0,0 +1,32 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXRenderStateCache.h"
+#include "LXPrimitiveD3D11.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+bool LXRenderStateCache::IASetVertexBuffer(const LXPrimitiveD3D11* Primitive)
+{
+	// As bound by the IASetVertexBuffer command
+	const TVertexBuffers VertexBuffers = { Primitive->VertexBuffer, Primitive->VertexStride, Primitive->VertexBufferOffset, Primitive->InstanceBuffer };
+
+	if (_VertexBuffers.VertexBuffer == VertexBuffers.VertexBuffer &&
+		_VertexBuffers.VertexStride == VertexBuffers.VertexStride &&
+		_VertexBuffers.VertexBufferOffset == VertexBuffers.VertexBufferOffset &&
+		_VertexBuffers.InstanceBuffer == VertexBuffers.InstanceBuffer)
+		return true;
+
+	_VertexBuffers = VertexBuffers;
+	return false;
+}
+
+bool LXRenderStateCache::IASetIndexBuffer(const LXPrimitiveD3D11* Primitive)
+{
+	return Set(_IndexBuffer, Primitive->IndexBuffer);
+}
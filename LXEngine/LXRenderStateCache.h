@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+struct ID3D11BlendState;
+struct ID3D11DepthStencilView;
+struct ID3D11RasterizerState;
+struct ID3D11RenderTargetView;
+struct ID3D11ShaderResourceView;
+class LXConstantBufferD3D11;
+class LXDepthStencilViewD3D11;
+class LXPrimitiveD3D11;
+class LXRenderTargetViewD3D11;
+class LXShaderD3D11;
+class LXTextureD3D11;
+
+//
+// Shadow copy of the device bindings, as they will be when the recorded commands are executed.
+// Each function is named after the LXRenderCommandList command it filters, and returns true
+// when the command does not change the bindings, so it can be dropped at record time.
+//
+
+class LXRenderStateCache
+{
+
+public:
+
+	// Slots above are not cached (commands are always recorded).
+	static const UINT kSlotCount = 16;
+
+	LXRenderStateCache() { Invalidate(); }
+
+	// Forgets everything: the next binding commands are recorded.
+	void Invalidate()
+	{
+		_VertexShader = _HullShader = _DomainShader = _GeometryShader = _PixelShader = Unknown();
+		_InputLayout = _PrimitiveTopology = _IndexBuffer = Unknown();
+		_VertexBuffers = { Unknown(), 0, 0, Unknown() };
+		_BlendState = _RasterizerState = Unknown();
+
+		InvalidateSlots(_VSConstantBuffers);
+		InvalidateSlots(_PSConstantBuffers);
+		InvalidateSlots(_VSSamplers);
+		InvalidateSlots(_PSSamplers);
+		InvalidateShaderResources();
+	}
+
+	// Shaders
+	bool VSSetShader(const LXShaderD3D11* VertexShader) { return Set(_VertexShader, VertexShader); }
+	bool HSSetShader(const LXShaderD3D11* HullShader) { return Set(_HullShader, HullShader); }
+	bool DSSetShader(const LXShaderD3D11* DomainShader) { return Set(_DomainShader, DomainShader); }
+	bool GSSetShader(const LXShaderD3D11* GeometryShader) { return Set(_GeometryShader, GeometryShader); }
+	bool PSSetShader(const LXShaderD3D11* PixelShader) { return Set(_PixelShader, PixelShader); }
+
+	// Input Assembler
+	bool IASetInputLayout(const LXShaderD3D11* VertexShader) { return Set(_InputLayout, VertexShader); }
+	bool IASetPrimitiveTopology(UINT PrimitiveTopology) { return Set(_PrimitiveTopology, (const void*)(uintptr_t)PrimitiveTopology); }
+	// Compare the buffers bound for the primitive: the ones of the LXGeometryPoolD3D11 megabuffers are filtered
+	bool IASetVertexBuffer(const LXPrimitiveD3D11* Primitive);
+	bool IASetIndexBuffer(const LXPrimitiveD3D11* Primitive);
+
+	// Slots
+	bool VSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, const LXConstantBufferD3D11* ConstantBuffer) { return SetSlots(_VSConstantBuffers, StartSlot, NumBuffers, ConstantBuffer); }
+	bool PSSetConstantBuffers(UINT StartSlot, UINT NumBuffers, const LXConstantBufferD3D11* ConstantBuffer) { return SetSlots(_PSConstantBuffers, StartSlot, NumBuffers, ConstantBuffer); }
+	bool VSSetShaderResources(UINT StartSlot, UINT NumViews, const LXTextureD3D11* Texture) { return SetSlots(_VSShaderResources, StartSlot, NumViews, Texture); }
+	bool PSSetShaderResources(UINT StartSlot, UINT NumViews, const LXTextureD3D11* Texture) { return SetSlots(_PSShaderResources, StartSlot, NumViews, Texture); }
+	bool PSSetShaderResources2(UINT StartSlot, UINT NumViews, const ID3D11ShaderResourceView* Texture) { return SetSlots(_PSShaderResources, StartSlot, NumViews, Texture); }
+	bool VSSetSamplers(UINT StartSlot, UINT NumSamplers, const LXTextureD3D11* Texture) { return SetSlots(_VSSamplers, StartSlot, NumSamplers, Texture); }
+	bool PSSetSamplers(UINT StartSlot, UINT NumSamplers, const LXTextureD3D11* Texture) { return SetSlots(_PSSamplers, StartSlot, NumSamplers, Texture); }
+
+	// Output Merger & Rasterizer
+	bool OMSetBlendState(const ID3D11BlendState* D3D11BlendState) { return Set(_BlendState, D3D11BlendState); }
+	bool RSSetState(const ID3D11RasterizerState* RasterizerState) { return Set(_RasterizerState, RasterizerState); }
+
+	// The runtime unbinds the shader resources bound as outputs: never dropped, they reset the resource slots.
+	bool OMSetRenderTargets(ID3D11RenderTargetView*) { InvalidateShaderResources(); return false; }
+	bool OMSetRenderTargets2(LXRenderTargetViewD3D11*, LXDepthStencilViewD3D11*) { InvalidateShaderResources(); return false; }
+	bool OMSetRenderTargets3(UINT, ID3D11RenderTargetView**, ID3D11DepthStencilView*) { InvalidateShaderResources(); return false; }
+
+private:
+
+	// Never a valid object, nullptr being a valid binding
+	static const void* Unknown() { return reinterpret_cast<const void*>(~(uintptr_t)0); }
+
+	static bool Set(const void*& State, const void* Value)
+	{
+		if (State == Value)
+			return true;
+
+		State = Value;
+		return false;
+	}
+
+	static bool SetSlots(const void** States, UINT StartSlot, UINT Count, const void* Value)
+	{
+		if (Count == 1 && StartSlot < kSlotCount)
+			return Set(States[StartSlot], Value);
+
+		// Not tracked, the covered slots are unknown now
+		for (UINT i = StartSlot; i < StartSlot + Count && i < kSlotCount; i++)
+		{
+			States[i] = Unknown();
+		}
+
+		return false;
+	}
+
+	static void InvalidateSlots(const void** States)
+	{
+		for (UINT i = 0; i < kSlotCount; i++)
+		{
+			States[i] = Unknown();
+		}
+	}
+
+	void InvalidateShaderResources()
+	{
+		InvalidateSlots(_VSShaderResources);
+		InvalidateSlots(_PSShaderResources);
+	}
+
+private:
+
+	const void* _VertexShader;
+	const void* _HullShader;
+	const void* _DomainShader;
+	const void* _GeometryShader;
+	const void* _PixelShader;
+
+	const void* _InputLayout;
+	const void* _PrimitiveTopology;
+	const void* _IndexBuffer;
+
+	struct TVertexBuffers
+	{
+		const void* VertexBuffer;
+		UINT VertexStride;
+		UINT VertexBufferOffset;
+		const void* InstanceBuffer;
+	};
+
+	TVertexBuffers _VertexBuffers;
+
+	const void* _BlendState;
+	const void* _RasterizerState;
+
+	const void* _VSConstantBuffers[kSlotCount];
+	const void* _PSConstantBuffers[kSlotCount];
+	const void* _VSShaderResources[kSlotCount];
+	const void* _PSShaderResources[kSlotCount];
+	const void* _VSSamplers[kSlotCount];
+	const void* _PSSamplers[kSlotCount];
+};
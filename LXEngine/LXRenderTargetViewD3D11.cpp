@@ -10,6 +10,7 @@
 #include "LXRenderTargetViewD3D11.h"
 #include "LXTextureD3D11.h"
 #include "LXDirectX11.h"
+#include "LXRenderBackend.h"
 #include "LXStatistic.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
@@ -27,6 +28,9 @@ LXRenderTargetViewD3D11::LXRenderTargetViewD3D11(LXTextureD3D11* Texture)
 	renderTargetViewDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
 	renderTargetViewDesc.Texture2D.MipSlice = 0;
 
+	if (LXRenderBackend::IsNullDevice())
+		return;
+
 	LXDirectX11* DirectX11 = LXDirectX11::GetCurrentDirectX11();
 	HRESULT hr = DirectX11->_D3D11Device->CreateRenderTargetView(Texture->D3D11Texture2D, &renderTargetViewDesc, &D3D11RenderTargetView);
 	if (FAILED(hr))
@@ -55,6 +59,9 @@ LXDepthStencilViewD3D11::LXDepthStencilViewD3D11(LXTextureD3D11* Texture)
 	DepthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 	DepthStencilViewDesc.Texture2D.MipSlice = 0;
 
+	if (LXRenderBackend::IsNullDevice())
+		return;
+
 	LXDirectX11* DirectX11 = LXDirectX11::GetCurrentDirectX11();
 	HRESULT hr = DirectX11->_D3D11Device->CreateDepthStencilView(Texture->D3D11Texture2D, &DepthStencilViewDesc, &D3D11DepthStencilView);
 	if (FAILED(hr))
@@ -16,7 +16,10 @@
 #include "LXPrimitiveD3D11.h"
 #include "LXProject.h"
 #include "LXRenderClusterManager.h"
+#include "LXRenderCapture.h"
 #include "LXRenderCommandList.h"
+#include "LXRenderBackend.h"
+#include "LXRenderBackendNull.h"
 #include "LXRenderPipelineDeferred.h"
 #include "LXRenderer.h"
 #include "LXScene.h"
@@ -45,6 +48,17 @@ LXConsoleCommandT<bool> CCResetShaders(L"ResetShaders", &gResetShaders);
 bool gToogleDrawImmediate = false;
 LXConsoleCommandT<bool> CCToogleDrawImmediate(L"ToggleDrawImmediate", &gToogleDrawImmediate);
 
+// Request for capturing the next frame commands (replayed by Benchmark.Replay)
+bool gCaptureFrame = false;
+LXString gCaptureFilename;
+LXConsoleCommand1S CCCaptureFrame(L"CaptureFrame", [](const LXString& Filename)
+{
+	gCaptureFilename = Filename;
+	if (gCaptureFilename.IsEmpty())
+		gCaptureFilename = L"Frame.lxcapture";
+	gCaptureFrame = true;
+});
+
 // Binded on variable and set from an INI file.
 //LXConsoleCommandT<bool> CSet_NoOverwriteConstantBuffer(L"Engine.ini", L"D3D111", L"NoOverwriteConstantBuffer", L"false", &NoOverwriteConstantBuffer);
 
@@ -114,10 +128,32 @@ void LXRenderer::Init()
 	// Create objects
 	//
 
-	DirectX11 = new LXDirectX11(_hWND);
-
 	RenderCommandList = new LXRenderCommandList();
-		
+
+	// Without device, the commands are only validated by the Null backend
+	if (!LXRenderBackend::IsNullDevice())
+	{
+		DirectX11 = new LXDirectX11(_hWND);
+		CreateDeviceStates();
+	}
+
+	// Misc
+	ShaderManager = new LXShaderManager();
+	ShaderManager->CreateDefaultShaders();
+	TextureManager = new LXTextureManager();
+	RenderClusterManager = new LXRenderClusterManager();
+	RenderCommandList->Renderer = this;
+	RenderCommandList->ShaderManager = ShaderManager;
+	
+	// ScreenSpace Triangle
+	SSTriangle = new LXPrimitiveD3D11();
+	SSTriangle->CreateSSTriangle();
+	
+	_RenderPipeline = new LXRenderPipelineDeferred(this);
+}
+
+void LXRenderer::CreateDeviceStates()
+{
 	//
 	// Rasterizers
 	//
@@ -168,20 +204,6 @@ void LXRenderer::Init()
 	BlendStateAdd.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
 	BlendStateAdd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
 	hr = DirectX11->GetCurrentDevice()->CreateBlendState(&BlendStateAdd, &D3D11BlendStateAdd);
-
-	// Misc
-	ShaderManager = new LXShaderManager();
-	ShaderManager->CreateDefaultShaders();
-	TextureManager = new LXTextureManager();
-	RenderClusterManager = new LXRenderClusterManager();
-	RenderCommandList->Renderer = this;
-	RenderCommandList->ShaderManager = ShaderManager;
-	
-	// ScreenSpace Triangle
-	SSTriangle = new LXPrimitiveD3D11();
-	SSTriangle->CreateSSTriangle();
-	
-	_RenderPipeline = new LXRenderPipelineDeferred(this);
 }
 
 void LXRenderer::Run()
@@ -349,7 +371,10 @@ void LXRenderer::Render()
 		CHK(Width > 0);
 		CHK(Height > 0);
 
-		DirectX11->Resize(Width, Height);
+		if (DirectX11)
+		{
+			DirectX11->Resize(Width, Height);
+		}
 						
 		_RenderPipeline->Resize(Width, Height);
 	}
@@ -388,7 +413,7 @@ void LXRenderer::Render()
 		RenderCommandList->RSSetViewports(Viewport->GetWidth(), Viewport->GetHeight());
 
 		// Bind the back buffer 
-		RenderCommandList->OMSetRenderTargets(DirectX11->_D3D11RenderTargetView); // Hack
+		RenderCommandList->OMSetRenderTargets(DirectX11 ? DirectX11->_D3D11RenderTargetView : nullptr); // Hack
 
 		// Render a triangle : GBuffer TextureColor
 		RenderCommandList->IASetInputLayout(ShaderManager->VSDrawToBackBuffer);
@@ -403,23 +428,55 @@ void LXRenderer::Render()
 		RenderCommandList->EndEvent();
 	}
 			
+	if (gCaptureFrame)
+	{
+		LXRenderCapture RenderCapture;
+		RenderCapture.Capture(RenderCommandList);
+		if (RenderCapture.Save(gCaptureFilename))
+		{
+			LogI(Renderer, L"Captured %u commands (%u objects, %.2f KB payloads) in %s", RenderCapture.GetCommandCount(), RenderCapture.GetObjectCount(), RenderCapture.GetPayloadSize() / 1024., gCaptureFilename.GetBuffer());
+		}
+		gCaptureFrame = false;
+	}
+
 	// Execute the command list
-	LXTimeD3D11 TimeGPU;
 	double ElapsedGPU = 0.;
-	RenderCommandList->Execute();
-	ElapsedGPU = TimeGPU.Update();
+	if (DirectX11)
+	{
+		LXTimeD3D11 TimeGPU;
+		RenderCommandList->Execute();
+		ElapsedGPU = TimeGPU.Update();
+	}
+	else
+	{
+		RenderCommandList->Execute();
+	}
 
 	// Execute RenderCommandList time on GPU
 	LX_COUNT(L"GPU (Execute commands): %.2f MS", ElapsedGPU);
 
 	// DrawCalls
-	LX_COUNT(L"DrawCalls : %f", RenderCommandList->DrawCallCount);
+	LX_COUNT(L"DrawCalls : %f", RenderCommandList->GetDrawCallCount());
 
 	// Triangles
-	LX_COUNT(L"Triangles : %f", RenderCommandList->TriangleCount);
+	LX_COUNT(L"Triangles : %f", RenderCommandList->GetTriangleCount());
+
+	// Commands
+	GetStatManager()->SetFrameCounter(L"RenderCommands.Issued", RenderCommandList->GetCommandCount());
+	GetStatManager()->SetFrameCounter(L"RenderCommands.Filtered", RenderCommandList->GetFilteredCommandCount());
+
+	// Commands executed without device
+	LXRenderBackendNull* RenderBackendNull = dynamic_cast<LXRenderBackendNull*>(RenderCommandList->Backend);
+	if (RenderBackendNull)
+	{
+		GetStatManager()->SetFrameCounter(L"NullBackend.DrawCalls", RenderBackendNull->GetDrawCallCount());
+		GetStatManager()->SetFrameCounter(L"NullBackend.Triangles", (uint)RenderBackendNull->GetTriangleCount());
+		GetStatManager()->SetFrameCounter(L"NullBackend.Errors", RenderBackendNull->GetErrorCount());
+		RenderBackendNull->ResetStats();
+	}
 
 	// RenderClusters
-	LX_COUNT(L"RenderClusters : %f", (int)RenderClusterManager->ListRenderClusters.size());
+	LX_COUNT(L"RenderClusters : %f", (int)RenderClusterManager->RenderClusterStore.GetCount());
 
 	// VertexShaders
 	LX_COUNT(L"VertexShaders : %f", (int)ShaderManager->VertexShaders.size());
@@ -438,7 +495,11 @@ void LXRenderer::Render()
 	
 	_RenderPipeline->PostRender();
 
-	DirectX11->Present();
+	// Nothing rendered, do not wait for the VSync
+	if (!RenderBackendNull && DirectX11)
+	{
+		DirectX11->Present();
+	}
 }
 
 void LXRenderer::UpdateStates()
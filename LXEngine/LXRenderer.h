@@ -90,6 +90,7 @@ private:
 	static int RenderFunc(void* pData);
 	void Run();
 	void Init();
+	void CreateDeviceStates();
 	void Render();
 	void DeleteObjects();
 	void Empty();
@@ -12,6 +12,7 @@
 #include "LXDirectX11.h"
 #include "LXLogger.h"
 #include "LXPrimitiveD3D11.h"
+#include "LXRenderBackend.h"
 #include "LXRenderer.h"
 #include "LXShaderManager.h"
 #include "LXStatistic.h"
@@ -215,6 +216,18 @@ HRESULT LXShaderD3D11::CompileShaderFromFile(const wchar_t* Filename, const char
 	return S_OK;
 }
 
+bool LXShaderD3D11::CreateWithoutDevice(const wchar_t* Filename)
+{
+	if (_filename.empty())
+	{
+		_filename = Filename;
+	}
+
+	// Neither compiled nor created: the Null backend only checks the bindings
+	State = EShaderD3D11State::Ok;
+	return true;
+}
+
 bool LXShaderD3D11::CreateVertexShader(const wchar_t* Filename, const D3D11_INPUT_ELEMENT_DESC* Layout, UINT NumElements)
 {
 	LX_SAFE_RELEASE(D3D11VertexShader);
@@ -224,6 +237,9 @@ bool LXShaderD3D11::CreateVertexShader(const wchar_t* Filename, const D3D11_INPU
 	_numElements = NumElements;
 	Type = EShaderType::VertexShader;
 
+	if (LXRenderBackend::IsNullDevice())
+		return CreateWithoutDevice(Filename);
+
 	ID3DBlob* pVSBlob = nullptr;
 	HRESULT hr = CompileShaderFromFile(Filename, "VS", VSSHADER_VERSION, &pVSBlob);
 	if (FAILED(hr))
@@ -265,6 +281,9 @@ bool LXShaderD3D11::CreateHullShader(const wchar_t* Filename)
 
 	Type = EShaderType::HullShader;
 
+	if (LXRenderBackend::IsNullDevice())
+		return CreateWithoutDevice(Filename);
+
 	// Compile the pixel shader
 	ID3DBlob* pHSBlob = nullptr;
 	HRESULT hr = CompileShaderFromFile(Filename, "HS", HSSHADER_VERSION, &pHSBlob);
@@ -293,6 +312,9 @@ bool LXShaderD3D11::CreateDomainShader(const wchar_t* Filename)
 
 	Type = EShaderType::DomainShader;
 
+	if (LXRenderBackend::IsNullDevice())
+		return CreateWithoutDevice(Filename);
+
 	// Compile the domain shader
 	ID3DBlob* pDSBlob = nullptr;
 	HRESULT hr = CompileShaderFromFile(Filename, "DS", DSSHADER_VERSION, &pDSBlob);
@@ -321,6 +343,9 @@ bool LXShaderD3D11::CreateGeometryShader(const wchar_t* Filename)
 
 	Type = EShaderType::GeometryShader;
 
+	if (LXRenderBackend::IsNullDevice())
+		return CreateWithoutDevice(Filename);
+
 	// Compile the shader
 	ID3DBlob* pGSBlob = nullptr;
 	HRESULT hr = CompileShaderFromFile(Filename, "GS", GSSHADER_VERSION, &pGSBlob);
@@ -350,6 +375,9 @@ bool LXShaderD3D11::CreatePixelShader(const wchar_t* Filename, const char* entry
 	_entryPoint = entryPoint;
 	Type = EShaderType::PixelShader;
 
+	if (LXRenderBackend::IsNullDevice())
+		return CreateWithoutDevice(Filename);
+
 	// Compile the shader
 	ID3DBlob* pPSBlob = nullptr;
 	HRESULT hr = CompileShaderFromFile(Filename, entryPoint/*"PS"*/, PSSHADER_VERSION, &pPSBlob);
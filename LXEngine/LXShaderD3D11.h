@@ -55,6 +55,9 @@ public:
 
 private:
 
+	friend class LXRenderCapture; // Replay placeholders
+
+	bool CreateWithoutDevice(const wchar_t* filename);
 	HRESULT CompileShaderFromFile(const wchar_t* filename, const char* szEntryPoint, const char* szShaderModel, ID3DBlob** ppBlobOut);
 
 public:
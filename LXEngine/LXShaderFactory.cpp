@@ -193,6 +193,10 @@ LXString LXShaderFactory::GetLayoutName(int LayoutMask)
 	case (int)EPrimitiveLayout::PNT: return L"_PNT"; break;
 	case (int)EPrimitiveLayout::PNABT: return L"_PNABT"; break;
 	case (int)EPrimitiveLayout::PNABTI: return L"_PNABTI"; break;
+	case (int)EPrimitiveLayout::PW: return L"_PW"; break;
+	case (int)EPrimitiveLayout::PNW: return L"_PNW"; break;
+	case (int)EPrimitiveLayout::PNTW: return L"_PNTW"; break;
+	case (int)EPrimitiveLayout::PNABTW: return L"_PNABTW"; break;
 	default: CHK(0); return L""; break;
 	}
 }
@@ -0,0 +1,395 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXShadowAtlas.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	// Consecutive frames requesting the same new size before a resize
+	const uint kResizeFrames = 15;
+
+	bool IsPowerOfTwo(uint Value)
+	{
+		return Value && !(Value & (Value - 1));
+	}
+};
+
+//------------------------------------------------------------------------------------------------------
+// LXShadowAtlasPacker
+//------------------------------------------------------------------------------------------------------
+
+LXShadowAtlasPacker::LXShadowAtlasPacker(uint AtlasSize, uint MinTileSize):
+	_AtlasSize(AtlasSize),
+	_MinTileSize(MinTileSize)
+{
+	CHK(IsPowerOfTwo(AtlasSize) && IsPowerOfTwo(MinTileSize) && MinTileSize <= AtlasSize);
+
+	const uint LevelCount = GetLevel(MinTileSize) + 1;
+	_Levels.resize(LevelCount);
+	for (uint Level = 0; Level < LevelCount; Level++)
+	{
+		const size_t NodeCount = (size_t)1 << (2 * Level);
+		_Levels[Level].Nodes.resize(NodeCount);
+		_Levels[Level].FreePositions.resize(NodeCount);
+	}
+
+	Clear();
+}
+
+uint LXShadowAtlasPacker::RoundSize(uint Size) const
+{
+	uint Rounded = _MinTileSize;
+	while (Rounded < Size && Rounded < _AtlasSize)
+	{
+		Rounded <<= 1;
+	}
+	return Rounded;
+}
+
+uint LXShadowAtlasPacker::GetLevel(uint Size) const
+{
+	uint Level = 0;
+	for (uint NodeSize = _AtlasSize; NodeSize > Size; NodeSize >>= 1)
+	{
+		Level++;
+	}
+	return Level;
+}
+
+void LXShadowAtlasPacker::AddFreeNode(uint Level, uint Index)
+{
+	TLevel& NodeLevel = _Levels[Level];
+	NodeLevel.Nodes[Index] = ENode::Free;
+	NodeLevel.FreePositions[Index] = (uint)NodeLevel.FreeNodes.size();
+	NodeLevel.FreeNodes.push_back(Index);
+}
+
+void LXShadowAtlasPacker::RemoveFreeNode(uint Level, uint Index)
+{
+	TLevel& NodeLevel = _Levels[Level];
+	const uint Position = NodeLevel.FreePositions[Index];
+	const uint Last = NodeLevel.FreeNodes.back();
+	NodeLevel.FreeNodes[Position] = Last;
+	NodeLevel.FreePositions[Last] = Position;
+	NodeLevel.FreeNodes.pop_back();
+}
+
+bool LXShadowAtlasPacker::Allocate(uint Size, TShadowAtlasTile& Tile)
+{
+	Size = RoundSize(Size);
+	const uint TileLevel = GetLevel(Size);
+
+	// The smallest free node, to keep the large ones for the large tiles
+	for (int FreeLevel = (int)TileLevel; FreeLevel >= 0; FreeLevel--)
+	{
+		if (_Levels[FreeLevel].FreeNodes.empty())
+			continue;
+
+		uint Index = _Levels[FreeLevel].FreeNodes.back();
+		RemoveFreeNode(FreeLevel, Index);
+
+		uint X = Index & ((1u << FreeLevel) - 1);
+		uint Y = Index >> FreeLevel;
+
+		// Split down to the tile level, the first child is taken
+		for (uint Level = (uint)FreeLevel; Level < TileLevel; Level++)
+		{
+			_Levels[Level].Nodes[(Y << Level) + X] = ENode::Split;
+			X *= 2;
+			Y *= 2;
+
+			const uint ChildLevel = Level + 1;
+			AddFreeNode(ChildLevel, (Y << ChildLevel) + X + 1);
+			AddFreeNode(ChildLevel, ((Y + 1) << ChildLevel) + X);
+			AddFreeNode(ChildLevel, ((Y + 1) << ChildLevel) + X + 1);
+		}
+
+		_Levels[TileLevel].Nodes[(Y << TileLevel) + X] = ENode::Used;
+
+		Tile.X = X * Size;
+		Tile.Y = Y * Size;
+		Tile.Size = Size;
+		_UsedArea += (uint64)Size * Size;
+		return true;
+	}
+
+	return false;
+}
+
+void LXShadowAtlasPacker::Free(const TShadowAtlasTile& Tile)
+{
+	CHK(IsPowerOfTwo(Tile.Size) && Tile.Size >= _MinTileSize);
+
+	uint Level = GetLevel(Tile.Size);
+	uint X = Tile.X / Tile.Size;
+	uint Y = Tile.Y / Tile.Size;
+
+	CHK(_Levels[Level].Nodes[(Y << Level) + X] == ENode::Used);
+	_UsedArea -= (uint64)Tile.Size * Tile.Size;
+
+	// Merge the free siblings
+	while (Level > 0)
+	{
+		const uint FirstX = X & ~1u;
+		const uint FirstY = Y & ~1u;
+		const uint Siblings[4] = { (FirstY << Level) + FirstX, (FirstY << Level) + FirstX + 1, ((FirstY + 1) << Level) + FirstX, ((FirstY + 1) << Level) + FirstX + 1 };
+		const uint Index = (Y << Level) + X;
+
+		bool Merge = true;
+		for (uint Sibling : Siblings)
+		{
+			Merge = Merge && (Sibling == Index || _Levels[Level].Nodes[Sibling] == ENode::Free);
+		}
+
+		if (!Merge)
+			break;
+
+		for (uint Sibling : Siblings)
+		{
+			if (Sibling != Index)
+				RemoveFreeNode(Level, Sibling);
+		}
+
+		Level--;
+		X /= 2;
+		Y /= 2;
+	}
+
+	AddFreeNode(Level, (Y << Level) + X);
+}
+
+void LXShadowAtlasPacker::Clear()
+{
+	for (TLevel& NodeLevel : _Levels)
+	{
+		std::fill(NodeLevel.Nodes.begin(), NodeLevel.Nodes.end(), ENode::Free);
+		NodeLevel.FreeNodes.clear();
+	}
+
+	AddFreeNode(0, 0);
+	_UsedArea = 0;
+}
+
+//------------------------------------------------------------------------------------------------------
+// LXShadowAtlas
+//------------------------------------------------------------------------------------------------------
+
+LXShadowAtlas::LXShadowAtlas(uint AtlasSize, uint MinTileSize, uint MaxTileSize):
+	_Packer(AtlasSize, MinTileSize),
+	_MaxTileSize(_Packer.RoundSize(MaxTileSize))
+{
+}
+
+void LXShadowAtlas::Request(const void* Key, float Coverage, float Distance)
+{
+	_Requests.push_back({ Key, Coverage, Distance });
+}
+
+uint LXShadowAtlas::GetDesiredSize(float Coverage) const
+{
+	// The tile side follows the screen side covered by the light
+	const float Side = sqrtf(std::min(std::max(Coverage, 0.f), 1.f));
+	return std::min(_MaxTileSize, _Packer.RoundSize((uint)(Side * _MaxTileSize)));
+}
+
+uint LXShadowAtlas::GetTileCount() const
+{
+	uint Count = 0;
+	for (const auto& It : _Entries)
+	{
+		Count += It.second.Tile.Size > 0;
+	}
+	return Count;
+}
+
+const TShadowAtlasTile& LXShadowAtlas::GetTile(const void* Key) const
+{
+	static const TShadowAtlasTile NoTile;
+
+	auto It = _Entries.find(Key);
+	if (It == _Entries.end() || It->second.Frame != _Frame)
+		return NoTile;
+
+	return It->second.Tile;
+}
+
+bool LXShadowAtlas::Evict(const TEntry& Requester, bool EvictRequested)
+{
+	TEntry* Victim = nullptr;
+
+	// Least recently requested first
+	while (!Victim && _VictimLRU < (uint)_Unrequested.size())
+	{
+		TEntry* Entry = _Unrequested[_VictimLRU++];
+		if (Entry->Tile.Size > 0)
+			Victim = Entry;
+	}
+
+	// Then the lowest priority. The ranks after the requester have not been served yet: the cursor only goes down.
+	while (!Victim && EvictRequested && _VictimRank > Requester.Rank + 1)
+	{
+		TEntry* Entry = _Ranked[--_VictimRank];
+		if (Entry->Tile.Size > 0)
+			Victim = Entry;
+	}
+
+	if (!Victim)
+		return false;
+
+	_Packer.Free(Victim->Tile);
+	Victim->Tile = TShadowAtlasTile();
+	_EvictionCount++;
+	return true;
+}
+
+bool LXShadowAtlas::AllocateTile(TEntry& Entry, uint Size, bool EvictRequested)
+{
+	TShadowAtlasTile Tile;
+
+	while (!_Packer.Allocate(Size, Tile))
+	{
+		if (!Evict(Entry, EvictRequested))
+			return false;
+	}
+
+	if (Entry.Tile.Size > 0)
+		_Packer.Free(Entry.Tile);
+
+	Entry.Tile = Tile;
+	return true;
+}
+
+void LXShadowAtlas::Update()
+{
+	_Frame++;
+	_EvictionCount = 0;
+	_ResizeCount = 0;
+
+	std::sort(_Requests.begin(), _Requests.end(), [](const TRequest& a, const TRequest& b)
+	{
+		if (a.Coverage != b.Coverage)
+			return a.Coverage > b.Coverage;
+		return a.Distance < b.Distance;
+	});
+
+	// The requested entries, by priority
+	_Ranked.clear();
+	_DesiredSizes.clear();
+
+	for (const TRequest& Request : _Requests)
+	{
+		TEntry& Entry = _Entries[Request.Key];
+		if (Entry.Frame == _Frame)
+			continue;	// Duplicated key
+
+		Entry.Frame = _Frame;
+		Entry.Rank = (uint)_Ranked.size();
+		_Ranked.push_back(&Entry);
+		_DesiredSizes.push_back(GetDesiredSize(Request.Coverage));
+	}
+
+	// The eviction candidates
+	_Unrequested.clear();
+	for (auto& It : _Entries)
+	{
+		if (It.second.Frame != _Frame && It.second.Tile.Size > 0)
+			_Unrequested.push_back(&It.second);
+	}
+
+	std::sort(_Unrequested.begin(), _Unrequested.end(), [](const TEntry* a, const TEntry* b) { return a->Frame < b->Frame; });
+	_VictimLRU = 0;
+	_VictimRank = (uint)_Ranked.size();
+
+	// Over budget, the sizes are scaled down to share the atlas
+	uint64 DesiredArea = 0;
+	for (uint Size : _DesiredSizes)
+	{
+		DesiredArea += (uint64)Size * Size;
+	}
+
+	const uint64 AtlasArea = (uint64)_Packer.GetAtlasSize() * _Packer.GetAtlasSize();
+	if (DesiredArea > AtlasArea)
+	{
+		const float Scale = sqrtf((float)AtlasArea / (float)DesiredArea);
+		for (uint& DesiredSize : _DesiredSizes)
+		{
+			const uint ScaledSize = (uint)(DesiredSize * Scale);
+			DesiredSize = _Packer.RoundSize(ScaledSize);
+			if (DesiredSize > ScaledSize && DesiredSize > _Packer.GetMinTileSize())
+				DesiredSize >>= 1;
+		}
+	}
+
+	for (uint i = 0; i < (uint)_Ranked.size(); i++)
+	{
+		TEntry& Entry = *_Ranked[i];
+		const uint DesiredSize = _DesiredSizes[i];
+
+		if (Entry.Tile.Size > 0)
+		{
+			if (DesiredSize == Entry.Tile.Size)
+			{
+				Entry.PendingFrames = 0;
+				continue;
+			}
+
+			if (DesiredSize != Entry.PendingSize)
+			{
+				Entry.PendingSize = DesiredSize;
+				Entry.PendingFrames = 0;
+			}
+
+			if (++Entry.PendingFrames < kResizeFrames)
+				continue;
+
+			Entry.PendingFrames = 0;
+			_ResizeCount++;
+
+			if (DesiredSize < Entry.Tile.Size)
+			{
+				// Always fits in the freed tile
+				_Packer.Free(Entry.Tile);
+				Entry.Tile = TShadowAtlasTile();
+				AllocateTile(Entry, DesiredSize, false);
+			}
+			else if (!AllocateTile(Entry, DesiredSize, false))
+			{
+				// A failed grow keeps the current tile
+				_ResizeCount--;
+			}
+			continue;
+		}
+
+		// New tile, smaller sizes when the atlas is full
+		bool Allocated = false;
+		for (uint Size = DesiredSize; Size >= _Packer.GetMinTileSize() && !Allocated; Size >>= 1)
+		{
+			Allocated = AllocateTile(Entry, Size, false);
+		}
+
+		if (!Allocated)
+		{
+			AllocateTile(Entry, _Packer.GetMinTileSize(), true);
+		}
+
+		Entry.PendingFrames = 0;
+	}
+
+	// Entries without tile and not requested are forgotten
+	for (auto It = _Entries.begin(); It != _Entries.end();)
+	{
+		if (It->second.Tile.Size == 0 && It->second.Frame != _Frame)
+			It = _Entries.erase(It);
+		else
+			++It;
+	}
+
+	_Requests.clear();
+}
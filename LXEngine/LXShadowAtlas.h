@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+struct TShadowAtlasTile
+{
+	uint X = 0;
+	uint Y = 0;
+	uint Size = 0;	// 0: no tile
+};
+
+//
+// Square power of two tiles in a square atlas, packed with a quadtree: a free node is split in 4 to
+// allocate a smaller tile, 4 free siblings are merged back. The smallest free node is split first,
+// found in the free lists of the levels.
+//
+
+class LXShadowAtlasPacker
+{
+
+public:
+
+	LXShadowAtlasPacker(uint AtlasSize, uint MinTileSize);
+
+	// Size is rounded up to a power of two, in [MinTileSize, AtlasSize]
+	bool Allocate(uint Size, TShadowAtlasTile& Tile);
+	void Free(const TShadowAtlasTile& Tile);
+	void Clear();
+
+	uint RoundSize(uint Size) const;
+	uint GetAtlasSize() const { return _AtlasSize; }
+	uint GetMinTileSize() const { return _MinTileSize; }
+	uint64 GetUsedArea() const { return _UsedArea; }
+
+private:
+
+	enum class ENode : uint8
+	{
+		Free,
+		Split,
+		Used
+	};
+
+	uint GetLevel(uint Size) const;
+	void AddFreeNode(uint Level, uint Index);
+	void RemoveFreeNode(uint Level, uint Index);
+
+private:
+
+	// Level L has 2^L x 2^L nodes, index (Y << L) + X. The nodes under a Free or Used node are unused.
+	struct TLevel
+	{
+		vector<ENode> Nodes;
+		vector<uint> FreeNodes;		// Free nodes under a Split node, the candidates of Allocate
+		vector<uint> FreePositions;	// Per node, position in FreeNodes
+	};
+
+	uint _AtlasSize;
+	uint _MinTileSize;
+	uint64 _UsedArea = 0;
+	vector<TLevel> _Levels;
+};
+
+//
+// Shadow atlas tiles of the lights, requested each frame. The tile size follows the screen coverage
+// of the light, the lights are served by decreasing coverage then increasing distance.
+// Hysteresis: a tile is resized once the new size has been requested for kResizeFrames frames in a row.
+// The tiles of the lights not requested stay allocated, for a light coming back, and are evicted the
+// least recently used first. When the atlas is still full, the tiles fall back to smaller sizes, then the
+// lights of lower priority lose their tile.
+//
+
+class LXShadowAtlas
+{
+
+public:
+
+	LXShadowAtlas(uint AtlasSize, uint MinTileSize, uint MaxTileSize);
+
+	// Coverage: screen area fraction covered by the light, in [0, 1]
+	void Request(const void* Key, float Coverage, float Distance);
+
+	// Assigns the tiles of the requests, then clears them
+	void Update();
+
+	// Tile of a light requested before the last Update, Size is 0 when it did not fit
+	const TShadowAtlasTile& GetTile(const void* Key) const;
+
+	uint GetDesiredSize(float Coverage) const;
+	uint GetTileCount() const;
+	uint GetEvictionCount() const { return _EvictionCount; }
+	uint GetResizeCount() const { return _ResizeCount; }
+	const LXShadowAtlasPacker& GetPacker() const { return _Packer; }
+
+private:
+
+	struct TEntry
+	{
+		TShadowAtlasTile Tile;
+		uint64 Frame = 0;			// Last request
+		uint Rank = 0;				// Priority order of the last request
+		uint PendingSize = 0;
+		uint PendingFrames = 0;
+	};
+
+	struct TRequest
+	{
+		const void* Key;
+		float Coverage;
+		float Distance;
+	};
+
+	// Evicts the tiles of the other lights when needed: the ones not requested, and with EvictRequested, the lower priority ones.
+	bool AllocateTile(TEntry& Entry, uint Size, bool EvictRequested);
+	bool Evict(const TEntry& Requester, bool EvictRequested);
+
+private:
+
+	LXShadowAtlasPacker _Packer;
+	uint _MaxTileSize;
+	uint64 _Frame = 0;
+
+	map<const void*, TEntry> _Entries;
+	vector<TRequest> _Requests;
+
+	// Update
+	vector<TEntry*> _Ranked;			// Requested, by priority
+	vector<uint> _DesiredSizes;			// Per ranked entry
+	vector<TEntry*> _Unrequested;		// With a tile, least recently requested first
+	uint _VictimLRU = 0;				// Next in _Unrequested
+	uint _VictimRank = 0;				// Last rank not evicted yet
+
+	// Last Update
+	uint _EvictionCount = 0;
+	uint _ResizeCount = 0;
+};
@@ -8,8 +8,492 @@
 
 #include "stdafx.h"
 #include "LXSpacePartitioning.h"
-#include "LXTraverserCallBack.h"
 #include "LXCore.h"
+#include "LXFrustum.h"
+#include "LXTraverserCallBack.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	// SAH build
+	const uint kBVHBins = 16;
+	const uint kBVHLeafItems = 4;		// Always a leaf at or below
+	const uint kBVHMaxLeafItems = 16;	// Never a leaf above, split at the median when the SAH finds no split
+	const float kBVHTraversalCost = 1.f;	// Relative to a box test
+	const uint kBVHInvalid = 0xFFFFFFFF;
+
+	struct TBounds
+	{
+		vec3f Min = vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+		vec3f Max = vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		void Add(const vec3f& v0, const vec3f& v1)
+		{
+			Min.x = min(Min.x, v0.x); Min.y = min(Min.y, v0.y); Min.z = min(Min.z, v0.z);
+			Max.x = max(Max.x, v1.x); Max.y = max(Max.y, v1.y); Max.z = max(Max.z, v1.z);
+		}
+
+		float GetArea() const
+		{
+			const vec3f Size = Max - Min;
+			return Size.x < 0.f ? 0.f : 2.f * (Size.x * Size.y + Size.y * Size.z + Size.z * Size.x);
+		}
+	};
+
+	inline float GetAxis(const vec3f& v, uint Axis) { return Axis == 0 ? v.x : (Axis == 1 ? v.y : v.z); }
+
+	inline bool BoxOverlap(const vec3f& Min0, const vec3f& Max0, const vec3f& Min1, const vec3f& Max1)
+	{
+		return Min0.x <= Max1.x && Max0.x >= Min1.x && Min0.y <= Max1.y && Max0.y >= Min1.y && Min0.z <= Max1.z && Max0.z >= Min1.z;
+	}
+};
+
+//------------------------------------------------------------------------------------------------------
+// LXBVH
+//------------------------------------------------------------------------------------------------------
+
+struct LXBVH::TBuildContext
+{
+	vector<TItemBox> Boxes;
+	vector<vec3f> Centroids;
+	vector<uint> Items;
+};
+
+void LXBVH::Build(const TFrustumBoxes& Boxes, const vector<uint>& Items)
+{
+	Clear();
+
+	TBuildContext Context;
+	Context.Items = Items;
+
+	if (Context.Items.empty())
+	{
+		Context.Items.resize(Boxes.Count);
+		for (uint i = 0; i < Boxes.Count; i++)
+		{
+			Context.Items[i] = i;
+		}
+	}
+
+	const uint Count = (uint)Context.Items.size();
+	if (Count == 0)
+		return;
+
+	Context.Boxes.resize(Count);
+	Context.Centroids.resize(Count);
+
+	for (uint i = 0; i < Count; i++)
+	{
+		const uint Item = Context.Items[i];
+		TItemBox& Box = Context.Boxes[i];
+		Box.Min = vec3f(Boxes.MinX[Item], Boxes.MinY[Item], Boxes.MinZ[Item]);
+		Box.Max = vec3f(Boxes.MaxX[Item], Boxes.MaxY[Item], Boxes.MaxZ[Item]);
+		Context.Centroids[i] = (Box.Min + Box.Max) * 0.5f;
+	}
+
+	// The build partitions positions in the context arrays
+	_Items.resize(Count);
+	for (uint i = 0; i < Count; i++)
+	{
+		_Items[i] = i;
+	}
+
+	_Nodes.reserve(2 * Count / kBVHLeafItems + 1);
+	BuildNode(Context, 0, Count);
+
+	// Positions to items, boxes in the leaf order
+	_ItemBoxes.resize(Count);
+	for (uint i = 0; i < Count; i++)
+	{
+		const uint Position = _Items[i];
+		_ItemBoxes[i] = Context.Boxes[Position];
+		_Items[i] = Context.Items[Position];
+	}
+
+	// Refit links
+	const uint NodeCount = (uint)_Nodes.size();
+	_Parents.assign(NodeCount, kBVHInvalid);
+	_ItemLeaves.resize(Count);
+	_RefitFlags.assign(NodeCount, 0);
+
+	for (uint i = 0; i < NodeCount; i++)
+	{
+		const TBVHNode& Node = _Nodes[i];
+		if (Node.Count > 0)
+		{
+			for (uint j = Node.RightOrFirst; j < Node.RightOrFirst + Node.Count; j++)
+			{
+				_ItemLeaves[j] = i;
+			}
+		}
+		else
+		{
+			_Parents[i + 1] = i;
+			_Parents[Node.RightOrFirst] = i;
+		}
+	}
+
+	_ItemPositions.assign(*std::max_element(_Items.begin(), _Items.end()) + 1, kBVHInvalid);
+	for (uint i = 0; i < Count; i++)
+	{
+		_ItemPositions[_Items[i]] = i;
+	}
+
+	_BuildCost = GetCost();
+}
+
+void LXBVH::Clear()
+{
+	_Nodes.clear();
+	_Items.clear();
+	_ItemBoxes.clear();
+	_BuildCost = 0.f;
+	_Parents.clear();
+	_ItemLeaves.clear();
+	_ItemPositions.clear();
+	_RefitFlags.clear();
+	_RefitNodes.clear();
+}
+
+void LXBVH::UpdateItem(uint Item, const vec3f& Min, const vec3f& Max)
+{
+	CHK(Item < _ItemPositions.size() && _ItemPositions[Item] != kBVHInvalid);
+	const uint Position = _ItemPositions[Item];
+
+	_ItemBoxes[Position].Min = Min;
+	_ItemBoxes[Position].Max = Max;
+
+	// The leaf and its ancestors, up to an already marked one
+	for (uint NodeIndex = _ItemLeaves[Position]; NodeIndex != kBVHInvalid && !_RefitFlags[NodeIndex]; NodeIndex = _Parents[NodeIndex])
+	{
+		_RefitFlags[NodeIndex] = 1;
+		_RefitNodes.push_back(NodeIndex);
+	}
+}
+
+void LXBVH::Refit()
+{
+	// Depth first order: the children have greater indices than their parent, so are refit before it
+	std::sort(_RefitNodes.begin(), _RefitNodes.end(), [](uint a, uint b) { return a > b; });
+
+	for (uint NodeIndex : _RefitNodes)
+	{
+		TBVHNode& Node = _Nodes[NodeIndex];
+		TBounds Bounds;
+
+		if (Node.Count > 0)
+		{
+			for (uint i = Node.RightOrFirst; i < Node.RightOrFirst + Node.Count; i++)
+			{
+				Bounds.Add(_ItemBoxes[i].Min, _ItemBoxes[i].Max);
+			}
+		}
+		else
+		{
+			Bounds.Add(_Nodes[NodeIndex + 1].Min, _Nodes[NodeIndex + 1].Max);
+			Bounds.Add(_Nodes[Node.RightOrFirst].Min, _Nodes[Node.RightOrFirst].Max);
+		}
+
+		Node.Min = Bounds.Min;
+		Node.Max = Bounds.Max;
+		_RefitFlags[NodeIndex] = 0;
+	}
+
+	_RefitNodes.clear();
+}
+
+bool LXBVH::GetBounds(vec3f& Min, vec3f& Max) const
+{
+	if (_Nodes.empty())
+		return false;
+
+	Min = _Nodes[0].Min;
+	Max = _Nodes[0].Max;
+	return true;
+}
+
+float LXBVH::GetCost() const
+{
+	if (_Nodes.empty())
+		return 0.f;
+
+	auto GetArea = [](const TBVHNode& Node)
+	{
+		TBounds Bounds;
+		Bounds.Add(Node.Min, Node.Max);
+		return Bounds.GetArea();
+	};
+
+	double Cost = 0.;
+	for (const TBVHNode& Node : _Nodes)
+	{
+		Cost += GetArea(Node) * (Node.Count > 0 ? Node.Count : kBVHTraversalCost);
+	}
+
+	const float RootArea = GetArea(_Nodes[0]);
+	return RootArea > 0.f ? (float)(Cost / RootArea) : 0.f;
+}
+
+uint LXBVH::BuildNode(TBuildContext& Context, uint First, uint Count)
+{
+	const uint NodeIndex = (uint)_Nodes.size();
+	_Nodes.emplace_back();
+
+	TBounds Bounds, CentroidBounds;
+	for (uint i = First; i < First + Count; i++)
+	{
+		const uint Position = _Items[i];
+		Bounds.Add(Context.Boxes[Position].Min, Context.Boxes[Position].Max);
+		CentroidBounds.Add(Context.Centroids[Position], Context.Centroids[Position]);
+	}
+
+	_Nodes[NodeIndex].Min = Bounds.Min;
+	_Nodes[NodeIndex].Max = Bounds.Max;
+
+	auto MakeLeaf = [this, NodeIndex, First, Count]()
+	{
+		_Nodes[NodeIndex].RightOrFirst = First;
+		_Nodes[NodeIndex].Count = Count;
+		return NodeIndex;
+	};
+
+	if (Count <= kBVHLeafItems)
+		return MakeLeaf();
+
+	// Binned SAH on the 3 axes
+	float BestCost = FLT_MAX;
+	uint BestAxis = 0;
+	uint BestSplit = 0;
+
+	for (uint Axis = 0; Axis < 3; Axis++)
+	{
+		const float AxisMin = GetAxis(CentroidBounds.Min, Axis);
+		const float Extent = GetAxis(CentroidBounds.Max, Axis) - AxisMin;
+		if (Extent <= 0.f)
+			continue;
+
+		const float Scale = kBVHBins / Extent;
+		TBounds BinBounds[kBVHBins];
+		uint BinCounts[kBVHBins] = {};
+
+		for (uint i = First; i < First + Count; i++)
+		{
+			const uint Position = _Items[i];
+			const uint Bin = min(kBVHBins - 1, (uint)((GetAxis(Context.Centroids[Position], Axis) - AxisMin) * Scale));
+			BinBounds[Bin].Add(Context.Boxes[Position].Min, Context.Boxes[Position].Max);
+			BinCounts[Bin]++;
+		}
+
+		// Right side costs, then sweep from the left
+		float RightCosts[kBVHBins];
+		TBounds RightBounds;
+		uint RightCount = 0;
+		for (uint Bin = kBVHBins - 1; Bin > 0; Bin--)
+		{
+			RightBounds.Add(BinBounds[Bin].Min, BinBounds[Bin].Max);
+			RightCount += BinCounts[Bin];
+			RightCosts[Bin] = RightCount ? RightBounds.GetArea() * RightCount : FLT_MAX;
+		}
+
+		TBounds LeftBounds;
+		uint LeftCount = 0;
+		for (uint Split = 1; Split < kBVHBins; Split++)
+		{
+			LeftBounds.Add(BinBounds[Split - 1].Min, BinBounds[Split - 1].Max);
+			LeftCount += BinCounts[Split - 1];
+
+			if (LeftCount == 0 || RightCosts[Split] == FLT_MAX)
+				continue;
+
+			const float Cost = LeftBounds.GetArea() * LeftCount + RightCosts[Split];
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestAxis = Axis;
+				BestSplit = Split;
+			}
+		}
+	}
+
+	const float Area = Bounds.GetArea();
+	const bool FoundSplit = BestCost < FLT_MAX && kBVHTraversalCost * Area + BestCost < Area * Count;
+
+	if (!FoundSplit && Count <= kBVHMaxLeafItems)
+		return MakeLeaf();
+
+	uint LeftCount = 0;
+	uint* Items = _Items.data() + First;
+
+	if (FoundSplit)
+	{
+		const float AxisMin = GetAxis(CentroidBounds.Min, BestAxis);
+		const float Scale = kBVHBins / (GetAxis(CentroidBounds.Max, BestAxis) - AxisMin);
+
+		uint* Middle = std::partition(Items, Items + Count, [&Context, BestAxis, BestSplit, AxisMin, Scale](uint Position)
+		{
+			return min(kBVHBins - 1, (uint)((GetAxis(Context.Centroids[Position], BestAxis) - AxisMin) * Scale)) < BestSplit;
+		});
+		LeftCount = (uint)(Middle - Items);
+	}
+	else
+	{
+		// Median on the largest centroid extent, or any half for identical centroids
+		const vec3f Extent = CentroidBounds.Max - CentroidBounds.Min;
+		const uint Axis = Extent.x >= Extent.y && Extent.x >= Extent.z ? 0 : (Extent.y >= Extent.z ? 1 : 2);
+		LeftCount = Count / 2;
+		std::nth_element(Items, Items + LeftCount, Items + Count, [&Context, Axis](uint a, uint b)
+		{
+			return GetAxis(Context.Centroids[a], Axis) < GetAxis(Context.Centroids[b], Axis);
+		});
+	}
+
+	CHK(LeftCount > 0 && LeftCount < Count);
+
+	BuildNode(Context, First, LeftCount);
+	const uint RightIndex = BuildNode(Context, First + LeftCount, Count - LeftCount);
+
+	_Nodes[NodeIndex].RightOrFirst = RightIndex;
+	_Nodes[NodeIndex].Count = 0;
+	return NodeIndex;
+}
+
+void LXBVH::AddSubtree(uint NodeIndex, vector<uint>& Items) const
+{
+	// The subtree items are between its leftmost and rightmost leaves
+	uint Leftmost = NodeIndex;
+	while (_Nodes[Leftmost].Count == 0)
+	{
+		Leftmost++;
+	}
+
+	uint Rightmost = NodeIndex;
+	while (_Nodes[Rightmost].Count == 0)
+	{
+		Rightmost = _Nodes[Rightmost].RightOrFirst;
+	}
+
+	const uint First = _Nodes[Leftmost].RightOrFirst;
+	const uint Last = _Nodes[Rightmost].RightOrFirst + _Nodes[Rightmost].Count;
+	Items.insert(Items.end(), _Items.begin() + First, _Items.begin() + Last);
+}
+
+template<typename T>
+void LXBVH::Query(const T& Test, vector<uint>& Items) const
+{
+	if (_Nodes.empty())
+		return;
+
+	// Per thread: the passes query in parallel
+	thread_local vector<uint> Stack;
+	Stack.clear();
+	Stack.push_back(0);
+
+	while (!Stack.empty())
+	{
+		const TBVHNode& Node = _Nodes[Stack.back()];
+		const uint NodeIndex = Stack.back();
+		Stack.pop_back();
+
+		if (!Test(Node.Min, Node.Max))
+			continue;
+
+		if (Node.Count > 0)
+		{
+			for (uint i = Node.RightOrFirst; i < Node.RightOrFirst + Node.Count; i++)
+			{
+				if (Test(_ItemBoxes[i].Min, _ItemBoxes[i].Max))
+					Items.push_back(_Items[i]);
+			}
+		}
+		else
+		{
+			Stack.push_back(Node.RightOrFirst);
+			Stack.push_back(NodeIndex + 1);
+		}
+	}
+}
+
+void LXBVH::QueryFrustum(const LXFrustum& Frustum, vector<uint>& Items) const
+{
+	if (_Nodes.empty())
+		return;
+
+	thread_local vector<uint> Stack;
+	Stack.clear();
+	Stack.push_back(0);
+
+	while (!Stack.empty())
+	{
+		const uint NodeIndex = Stack.back();
+		const TBVHNode& Node = _Nodes[NodeIndex];
+		Stack.pop_back();
+
+		const EFrustumTestResult Result = Frustum.ClassifyBox(Node.Min, Node.Max);
+
+		if (Result == EFrustumTestResult::Outside)
+			continue;
+
+		if (Result == EFrustumTestResult::Inside)
+		{
+			AddSubtree(NodeIndex, Items);
+		}
+		else if (Node.Count > 0)
+		{
+			for (uint i = Node.RightOrFirst; i < Node.RightOrFirst + Node.Count; i++)
+			{
+				if (Frustum.IsBoxIn(_ItemBoxes[i].Min, _ItemBoxes[i].Max))
+					Items.push_back(_Items[i]);
+			}
+		}
+		else
+		{
+			Stack.push_back(Node.RightOrFirst);
+			Stack.push_back(NodeIndex + 1);
+		}
+	}
+}
+
+void LXBVH::QueryRay(const vec3f& Origin, const vec3f& Direction, float MaxDistance, vector<uint>& Items) const
+{
+	// Slab test, the infinite inverses of the axis-aligned directions give the expected intervals
+	const vec3f InvDirection(1.f / Direction.x, 1.f / Direction.y, 1.f / Direction.z);
+
+	Query([&Origin, &InvDirection, MaxDistance](const vec3f& Min, const vec3f& Max)
+	{
+		const float x0 = (Min.x - Origin.x) * InvDirection.x, x1 = (Max.x - Origin.x) * InvDirection.x;
+		const float y0 = (Min.y - Origin.y) * InvDirection.y, y1 = (Max.y - Origin.y) * InvDirection.y;
+		const float z0 = (Min.z - Origin.z) * InvDirection.z, z1 = (Max.z - Origin.z) * InvDirection.z;
+		const float Near = max(max(min(x0, x1), min(y0, y1)), max(min(z0, z1), 0.f));
+		const float Far = min(min(max(x0, x1), max(y0, y1)), min(max(z0, z1), MaxDistance));
+		return Near <= Far;
+	}, Items);
+}
+
+void LXBVH::QueryBox(const vec3f& BoxMin, const vec3f& BoxMax, vector<uint>& Items) const
+{
+	Query([&BoxMin, &BoxMax](const vec3f& Min, const vec3f& Max)
+	{
+		return BoxOverlap(Min, Max, BoxMin, BoxMax);
+	}, Items);
+}
+
+void LXBVH::QuerySphere(const vec3f& Center, float Radius, vector<uint>& Items) const
+{
+	const float SquaredRadius = Radius * Radius;
+
+	Query([&Center, SquaredRadius](const vec3f& Min, const vec3f& Max)
+	{
+		// Squared distance from the center to the box
+		const float dx = max(max(Min.x - Center.x, Center.x - Max.x), 0.f);
+		const float dy = max(max(Min.y - Center.y, Center.y - Max.y), 0.f);
+		const float dz = max(max(Min.z - Center.z, Center.z - Max.z), 0.f);
+		return dx * dx + dy * dy + dz * dz <= SquaredRadius;
+	}, Items);
+}
+
+//------------------------------------------------------------------------------------------------------
+// LXSpacePartitioning
+//------------------------------------------------------------------------------------------------------
 
 LXSpacePartitioning::LXSpacePartitioning()
 {
@@ -8,6 +8,93 @@
 
 #pragma once
 
+#include "LXVec3.h"
+
+class LXFrustum;
+struct TFrustumBoxes;
+
+//
+// Bounding Volume Hierarchy over boxes, built top-down with the Surface Area Heuristic.
+// The nodes are stored depth first: the left child follows its parent, so a traversal mostly reads forward.
+// The items of a subtree are contiguous, with their boxes copied in the leaf order.
+// Queries append the items (indices of the built boxes) to the output, in no particular order.
+// Moved items are refit in place: UpdateItem for each, then Refit. The tree is kept, so its quality
+// degrades with the moves: compare GetCost to GetBuildCost to decide a rebuild.
+//
+
+struct TBVHNode
+{
+	vec3f Min;
+	uint RightOrFirst;	// Internal node: index of the right child. Leaf: first item.
+	vec3f Max;
+	uint Count;			// Leaf: item count. Internal node: 0.
+};
+
+class LXBVH
+{
+
+public:
+
+	// Builds over the Items indices of Boxes, or all the boxes with an empty Items.
+	void Build(const TFrustumBoxes& Boxes, const vector<uint>& Items);
+	void Clear();
+
+	bool IsEmpty() const { return _Nodes.empty(); }
+	uint GetNodeCount() const { return (uint)_Nodes.size(); }
+	uint GetItemCount() const { return (uint)_Items.size(); }
+
+	// Root box, false when empty
+	bool GetBounds(vec3f& Min, vec3f& Max) const;
+
+	// Refit
+	void UpdateItem(uint Item, const vec3f& Min, const vec3f& Max);
+	void Refit();
+
+	// SAH cost relative to the root area
+	float GetCost() const;
+	float GetBuildCost() const { return _BuildCost; }
+
+	// Same visibility as LXFrustum::IsBoxIn per item. Whole subtrees inside the frustum are added without test.
+	void QueryFrustum(const LXFrustum& Frustum, vector<uint>& Items) const;
+
+	// Items whose box is crossed by the segment [Origin, Origin + Direction * MaxDistance].
+	void QueryRay(const vec3f& Origin, const vec3f& Direction, float MaxDistance, vector<uint>& Items) const;
+
+	void QueryBox(const vec3f& Min, const vec3f& Max, vector<uint>& Items) const;
+	void QuerySphere(const vec3f& Center, float Radius, vector<uint>& Items) const;
+
+private:
+
+	struct TItemBox
+	{
+		vec3f Min;
+		vec3f Max;
+	};
+
+	struct TBuildContext;
+	uint BuildNode(TBuildContext& Context, uint First, uint Count);
+
+	// Test(Min, Max) is called on the nodes and on the leaf items
+	template<typename T>
+	void Query(const T& Test, vector<uint>& Items) const;
+
+	void AddSubtree(uint NodeIndex, vector<uint>& Items) const;
+
+private:
+
+	vector<TBVHNode> _Nodes;
+	vector<uint> _Items;
+	vector<TItemBox> _ItemBoxes;
+	float _BuildCost = 0.f;
+
+	// Refit
+	vector<uint> _Parents;			// Per node
+	vector<uint> _ItemLeaves;		// Per position in _Items
+	vector<uint> _ItemPositions;	// Per item
+	vector<uint8> _RefitFlags;		// Per node
+	vector<uint> _RefitNodes;
+};
+
 class LXSpacePartitioning
 {
 
@@ -24,4 +111,3 @@ public:
 
 LXSpacePartitioning* GetSpacePartitioning();
 
-
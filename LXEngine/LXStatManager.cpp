@@ -8,10 +8,12 @@
 
 #include "stdafx.h"
 #include "LXStatManager.h"
+#include "LXThread.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
 LXStatManager::LXStatManager()
 {
+	_Mutex = make_unique<LXMutex>();
 }
 
 LXStatManager::~LXStatManager()
@@ -37,11 +39,22 @@ void LXStatManager::Reset()
 
 void LXStatManager::UpdateCounter(const wstring& Name, uint Value)
 {
+	_Mutex->Lock();
 	_Counters[Name] += Value;
+	_Mutex->Unlock();
+}
+
+void LXStatManager::SetFrameCounter(const wstring& Name, uint Value)
+{
+	_Mutex->Lock();
+	_FrameCounters[Name] = Value;
+	_Mutex->Unlock();
 }
 
 void LXStatManager::OpenStat(const wstring& Name)
 {
+	_Mutex->Lock();
+
 	LXStat& Stat = _Stats[Name];
 	Stat.Name = Name;
 	DWORD ThreadId = ::GetCurrentThreadId();
@@ -60,14 +73,17 @@ void LXStatManager::OpenStat(const wstring& Name)
 		StatCurrent->Children.insert(&Stat);
 	}
 	_StatCurrents[ThreadId] = &Stat;
-	
+
+	_Mutex->Unlock();
 }
 
 void LXStatManager::UpdateAndCloseStat(const wstring& Name, double Value)
 {
+	_Mutex->Lock();
 	LXStat& Stat = _Stats[Name];
 	Stat.Time+= Value;
 	Stat.Hits++;
 	DWORD ThreadId = ::GetCurrentThreadId();
 	_StatCurrents[ThreadId] = Stat.Parent;
+	_Mutex->Unlock();
 }
@@ -8,6 +8,8 @@
 
 #pragma once
 
+class LXMutex;
+
 struct LXStat
 {
 	wstring Name;
@@ -35,6 +37,15 @@ public:
 		return _Counters;
 	}
 
+	// Frame counters: value of the last frame, overwritten every frame
+
+	void SetFrameCounter(const wstring& Name, uint Value);
+
+	const map<wstring, uint>& GetFrameCounters() const
+	{
+		return _FrameCounters;
+	}
+
 	// Performances
 
 	void Reset();
@@ -63,4 +74,8 @@ private:
 	map<DWORD, LXStat*> _StatCurrents;
 
 	map<wstring, int> _Counters;
+	map<wstring, uint> _FrameCounters;
+
+	// Stats are updated from the render command recording threads
+	unique_ptr<LXMutex> _Mutex;
 };
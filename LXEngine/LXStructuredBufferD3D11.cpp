@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXStructuredBufferD3D11.h"
+#include "LXDirectX11.h"
+#include "LXRenderBackend.h"
+#include "LXThreadManager.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+LXStructuredBufferD3D11::LXStructuredBufferD3D11(uint ElementSize, uint ElementCount, const void* Data)
+{
+	if (LXRenderBackend::IsNullDevice())
+		return;
+
+	auto *D3D11Device = LXDirectX11::GetCurrentDevice();
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bd.ByteWidth = ElementSize * ElementCount;
+	bd.StructureByteStride = ElementSize;
+
+	D3D11_SUBRESOURCE_DATA subdata;
+	ZeroMemory(&subdata, sizeof(subdata));
+	subdata.pSysMem = Data;
+
+	HRESULT hr = D3D11Device->CreateBuffer(&bd, Data ? &subdata : nullptr, &D3D11Buffer);
+	if (FAILED(hr))
+	{
+		LXDirectX11::LogError(hr);
+		CHK(0);
+		return;
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
+	ZeroMemory(&srvd, sizeof(srvd));
+	srvd.Format = DXGI_FORMAT_UNKNOWN;
+	srvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvd.Buffer.FirstElement = 0;
+	srvd.Buffer.NumElements = ElementCount;
+
+	hr = D3D11Device->CreateShaderResourceView(D3D11Buffer, &srvd, &D3D11ShaderResourceView);
+	if (FAILED(hr))
+	{
+		LXDirectX11::LogError(hr);
+		CHK(0);
+	}
+}
+
+LXStructuredBufferD3D11::~LXStructuredBufferD3D11()
+{
+	CHK(IsRenderThread())
+	LX_SAFE_RELEASE(D3D11ShaderResourceView);
+	LX_SAFE_RELEASE(D3D11Buffer);
+}
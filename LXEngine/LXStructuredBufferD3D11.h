@@ -0,0 +1,28 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+struct ID3D11Buffer;
+struct ID3D11ShaderResourceView;
+
+//
+// Read-only StructuredBuffer for the shaders, updated with UpdateSubresource4 (the whole buffer).
+//
+
+class LXStructuredBufferD3D11
+{
+
+public:
+
+	LXStructuredBufferD3D11(uint ElementSize, uint ElementCount, const void* Data = nullptr);
+	~LXStructuredBufferD3D11();
+
+	ID3D11Buffer* D3D11Buffer = nullptr;
+	ID3D11ShaderResourceView* D3D11ShaderResourceView = nullptr;
+};
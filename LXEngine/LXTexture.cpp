@@ -15,6 +15,7 @@
 #include "LXMSXMLNode.h"
 #include "LXSettings.h"
 #include "LXProject.h"
+#include "LXThreadManager.h"
 #include "LXMemory.h" // --- Must be the last included ---
 
 LXTexture::LXTexture()
@@ -53,17 +54,50 @@ bool LXTexture::Load()
 		return true;
 
 	bool Result = false;
+
+	// Released by the memory budget: only the source is read again.
+	// On the Main thread, where the budget is updated, at the latest when the materials are synchronized.
+	if (_DataReleased)
+	{
+		CHK(IsMainThread());
+		if (LoadSource())
+		{
+			_DataReleased = false;
+			State = EResourceState::LXResourceState_Loaded;
+			MarkUsed();
+		}
+		return false;
+	}
+
 	Result = LoadWithMSXML(_filepath);
 
 	if (Result)
 	{
 		LoadSource();
 		State = EResourceState::LXResourceState_Loaded;
+		MarkUsed();
 	}
 
 	return false;
 }
 
+uint64 LXTexture::GetMemorySize() const
+{
+	return _Bitmap ? (uint64)_nWidth * _nHeight * _Bitmap->GetPixelSize() : 0;
+}
+
+bool LXTexture::ReleaseData()
+{
+	// The uploaded bitmaps, read again from their source file
+	if (State != EResourceState::LXResourceState_Loaded || !_Bitmap || TextureSource != ETextureSource::TextureSourceBitmap || _SourceFilepath.IsEmpty() || IsNeedSave())
+		return false;
+
+	LX_SAFE_DELETE_ARRAY(_Bitmap);
+	_DataReleased = true;
+	State = EResourceState::LXResourceState_Unloaded;
+	return true;
+}
+
 bool LXTexture::LoadSource()
 {
 	// The source file path is relative
@@ -139,6 +173,8 @@ void LXTexture::SetSource(const LXFilepath& Filepath)
 
 LXBitmap* LXTexture::GetBitmap( int index ) const 
 {
+	const_cast<LXTexture*>(this)->MarkUsed();
+
 	if (!_Bitmap)// && (State == LXResource::ResourceState_Unloaded))
 		const_cast<LXTexture*>(this)->Load();
 	
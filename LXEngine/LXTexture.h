@@ -64,6 +64,8 @@ public:
 	//
 
 	bool			Load() override;
+	uint64			GetMemorySize() const override;
+	bool			ReleaseData() override;
 	LXString		GetFileExtension() override { return LX_TEXTURE_EXT; }
 
 private:
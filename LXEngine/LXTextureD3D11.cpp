@@ -9,6 +9,7 @@
 #include "stdafx.h"
 #include "LXTextureD3D11.h"
 #include "LXDirectX11.h"
+#include "LXRenderBackend.h"
 #include "LXRenderCommandList.h"
 #include "LXTexture.h"
 #include "LXBitmap.h"
@@ -30,6 +31,11 @@ LXTextureD3D11::LXTextureD3D11(uint Width, uint Height, DXGI_FORMAT Format, void
 {
 	LX_COUNTSCOPEINC(LXTextureD3D11)
 
+	_Format = Format;
+
+	if (LXRenderBackend::IsNullDevice())
+		return;
+
 	ID3D11Device* D3D11Device = LXDirectX11::GetCurrentDevice();
 	ID3D11DeviceContext* D3D11DeviceContext = LXDirectX11::GetCurrentDeviceContext();
 		
@@ -132,6 +138,11 @@ LXTextureD3D11::~LXTextureD3D11()
 
 void LXTextureD3D11::Create(DXGI_FORMAT Format, uint Width, uint Height, bool bSupportAutoMipmap)
 {
+	_Format = Format;
+
+	if (LXRenderBackend::IsNullDevice())
+		return;
+
 	ID3D11Device* D3D11Device = LXDirectX11::GetCurrentDevice();
  
 	D3D11_TEXTURE2D_DESC desc = { 0 };
@@ -164,8 +175,6 @@ void LXTextureD3D11::Create(DXGI_FORMAT Format, uint Width, uint Height, bool bS
 	if (FAILED(hr))
 		CHK(0);
 
-	_Format = Format;
-
 	//
 	// Create the Shader Resource View
 	//
@@ -227,6 +236,9 @@ void LXTextureD3D11::Create(DXGI_FORMAT Format, uint Width, uint Height, bool bS
 
 void LXTextureD3D11::CreateForCapture2(ID3D11Texture2D*SrcResource)
 {
+	if (LXRenderBackend::IsNullDevice())
+		return;
+
 	ID3D11Device* D3D11Device = LXDirectX11::GetCurrentDevice();
 
 	D3D11_TEXTURE2D_DESC desc;
@@ -8,16 +8,346 @@
 
 #include "stdafx.h"
 #include "LXThreadManager.h"
+#include "LXCore.h"
+#include "LXLogger.h"
+#include "LXMemory.h" // --- Must be the last included ---
 
 DWORD MainThread = 0;
 DWORD RenderThread = 0;
 DWORD LoadingThread = 0;
 
-LXThreadManager::LXThreadManager()
+struct LXTask
 {
+	std::function<void()> Func;
+	LXTaskCounter* Counter = nullptr;
+	bool Background = false;
+};
+
+namespace
+{
+	// Worker identity of the current thread
+	thread_local const LXThreadManager* CurrentThreadManager = nullptr;
+	thread_local uint CurrentWorkerIndex = 0;
+
+	// Removes the first task of the Counter from the Tasks, from the back or the front
+	LXTask* Take(std::deque<LXTask*>& Tasks, const LXTaskCounter* Counter, bool FromBack)
+	{
+		for (size_t i = 0; i < Tasks.size(); i++)
+		{
+			const size_t Index = FromBack ? Tasks.size() - 1 - i : i;
+			LXTask* Task = Tasks[Index];
+			if (!Counter || Task->Counter == Counter)
+			{
+				Tasks.erase(Tasks.begin() + Index);
+				return Task;
+			}
+		}
+		return nullptr;
+	}
+};
+
+//------------------------------------------------------------------------------------------------------
+// LXTaskCounter
+//------------------------------------------------------------------------------------------------------
+
+LXTaskCounter::~LXTaskCounter()
+{
+	CHK(IsDone());
+}
+
+bool LXTaskCounter::IsDone() const
+{
+	std::lock_guard<std::mutex> Lock(_Mutex);
+	return _Count == 0;
 }
 
+//------------------------------------------------------------------------------------------------------
+// LXThreadManager
+//------------------------------------------------------------------------------------------------------
+
+LXThreadManager::LXThreadManager(uint WorkerCount)
+{
+	if (WorkerCount == 0)
+	{
+		// The Main thread helps when it waits
+		WorkerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	_Workers.resize(WorkerCount);
+
+	// All the deques exist before a worker can steal
+	for (unique_ptr<TWorker>& Worker : _Workers)
+	{
+		Worker = make_unique<TWorker>();
+	}
+
+	for (uint i = 0; i < WorkerCount; i++)
+	{
+		_Workers[i]->Thread = std::thread(&LXThreadManager::WorkerMain, this, i);
+	}
+
+	LogI(ThreadManager, L"%u worker threads", WorkerCount);
+}
 
 LXThreadManager::~LXThreadManager()
 {
+	{
+		std::lock_guard<std::mutex> Lock(_SleepMutex);
+		_Exit = true;
+	}
+	_WakeUp.notify_all();
+
+	for (unique_ptr<TWorker>& Worker : _Workers)
+	{
+		Worker->Thread.join();
+	}
+
+	// Tasks never executed
+	for (unique_ptr<TWorker>& Worker : _Workers)
+	{
+		for (LXTask* Task : Worker->Tasks)
+		{
+			delete Task;
+		}
+	}
+
+	for (LXTask* Task : _SharedTasks)
+	{
+		delete Task;
+	}
+
+	for (LXTask* Task : _BackgroundTasks)
+	{
+		delete Task;
+	}
+}
+
+void LXThreadManager::WorkerMain(uint WorkerIndex)
+{
+	CurrentThreadManager = this;
+	CurrentWorkerIndex = WorkerIndex;
+
+	while (!_Exit)
+	{
+		if (LXTask* Task = Pop())
+		{
+			Execute(Task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> Lock(_SleepMutex);
+		_WakeUp.wait(Lock, [this]() { return _Exit || _QueuedTasks > 0; });
+	}
+}
+
+bool LXThreadManager::IsWorkerThread() const
+{
+	return CurrentThreadManager == this;
+}
+
+void LXThreadManager::Run(std::function<void()> Func, LXTaskCounter* Counter, LXTaskCounter* Dependency)
+{
+	LXTask* Task = new LXTask();
+	Task->Func = std::move(Func);
+	Task->Counter = Counter;
+
+	if (Counter)
+	{
+		std::lock_guard<std::mutex> Lock(Counter->_Mutex);
+		Counter->_Count++;
+	}
+
+	if (Dependency)
+	{
+		std::lock_guard<std::mutex> Lock(Dependency->_Mutex);
+		if (Dependency->_Count > 0)
+		{
+			Dependency->_Dependents.push_back(Task);
+			return;
+		}
+	}
+
+	Push(Task);
+}
+
+void LXThreadManager::RunBackground(std::function<void()> Func, LXTaskCounter* Counter)
+{
+	LXTask* Task = new LXTask();
+	Task->Func = std::move(Func);
+	Task->Counter = Counter;
+	Task->Background = true;
+
+	if (Counter)
+	{
+		std::lock_guard<std::mutex> Lock(Counter->_Mutex);
+		Counter->_Count++;
+	}
+
+	Push(Task);
+}
+
+void LXThreadManager::Push(LXTask* Task)
+{
+	// Counted first: a popped task is always counted
+	_QueuedTasks++;
+
+	if (Task->Background)
+	{
+		std::lock_guard<std::mutex> Lock(_SharedMutex);
+		_BackgroundTasks.push_back(Task);
+	}
+	else if (IsWorkerThread())
+	{
+		TWorker* Worker = _Workers[CurrentWorkerIndex].get();
+		std::lock_guard<std::mutex> Lock(Worker->Mutex);
+		Worker->Tasks.push_back(Task);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> Lock(_SharedMutex);
+		_SharedTasks.push_back(Task);
+	}
+
+	// Taking the lock orders the notification after the predicate test of a worker going to sleep
+	{
+		std::lock_guard<std::mutex> Lock(_SleepMutex);
+	}
+	_WakeUp.notify_one();
+}
+
+LXTask* LXThreadManager::Pop(const LXTaskCounter* Counter)
+{
+	if (_QueuedTasks == 0)
+		return nullptr;
+
+	const bool IsWorker = IsWorkerThread();
+	const uint WorkerCount = GetWorkerCount();
+	LXTask* Task = nullptr;
+
+	// Own tasks, the most recent first
+	if (IsWorker)
+	{
+		TWorker* Worker = _Workers[CurrentWorkerIndex].get();
+		std::lock_guard<std::mutex> Lock(Worker->Mutex);
+		Task = Take(Worker->Tasks, Counter, true);
+	}
+
+	if (!Task)
+	{
+		std::lock_guard<std::mutex> Lock(_SharedMutex);
+		Task = Take(_SharedTasks, Counter, false);
+	}
+
+	// Steal the oldest task of the other workers
+	const uint First = IsWorker ? CurrentWorkerIndex + 1 : 0;
+	for (uint i = 0; i < WorkerCount && !Task; i++)
+	{
+		TWorker* Worker = _Workers[(First + i) % WorkerCount].get();
+		std::lock_guard<std::mutex> Lock(Worker->Mutex);
+		Task = Take(Worker->Tasks, Counter, false);
+	}
+
+	// Lowest priority, for the idle workers, or the thread waiting for this very task
+	if (!Task && (Counter || IsWorker))
+	{
+		std::lock_guard<std::mutex> Lock(_SharedMutex);
+		Task = Take(_BackgroundTasks, Counter, false);
+	}
+
+	if (Task)
+	{
+		_QueuedTasks--;
+	}
+
+	return Task;
+}
+
+void LXThreadManager::Execute(LXTask* Task)
+{
+	Task->Func();
+
+	if (LXTaskCounter* Counter = Task->Counter)
+	{
+		vector<LXTask*> Dependents;
+		{
+			std::lock_guard<std::mutex> Lock(Counter->_Mutex);
+			CHK(Counter->_Count > 0);
+			if (--Counter->_Count == 0)
+			{
+				Dependents.swap(Counter->_Dependents);
+			}
+		}
+
+		for (LXTask* Dependent : Dependents)
+		{
+			Push(Dependent);
+		}
+	}
+
+	delete Task;
+}
+
+void LXThreadManager::Wait(const LXTaskCounter& Counter)
+{
+	// Only the tasks of the batch: a task of another owner could be long, or wait itself
+	while (!Counter.IsDone())
+	{
+		if (LXTask* Task = Pop(&Counter))
+		{
+			Execute(Task);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void LXThreadManager::ParallelFor(uint Count, uint BatchSize, const std::function<void(uint)>& Func)
+{
+	if (Count == 0)
+		return;
+
+	BatchSize = std::max(1u, BatchSize);
+
+	LXTaskCounter Counter;
+
+	for (uint First = BatchSize; First < Count; First += BatchSize)
+	{
+		const uint Last = std::min(Count, First + BatchSize);
+		Run([&Func, First, Last]()
+		{
+			for (uint i = First; i < Last; i++)
+			{
+				Func(i);
+			}
+		}, &Counter);
+	}
+
+	// First batch on the calling thread
+	for (uint i = 0; i < std::min(Count, BatchSize); i++)
+	{
+		Func(i);
+	}
+
+	Wait(Counter);
+}
+
+//------------------------------------------------------------------------------------------------------
+// Global functions
+//------------------------------------------------------------------------------------------------------
+
+LXThreadManager* GetThreadManager()
+{
+	return GetCore().GetThreadManager();
+}
+
+void ParallelFor(uint Count, const std::function<void(uint)>& Func)
+{
+	GetThreadManager()->ParallelFor(Count, 1, Func);
+}
+
+void ParallelFor(uint Count, uint BatchSize, const std::function<void(uint)>& Func)
+{
+	GetThreadManager()->ParallelFor(Count, BatchSize, Func);
 }
@@ -9,15 +9,104 @@
 #pragma once
 
 #include "LXObject.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
 
-class LXThreadManager
+struct LXTask;
+
+//
+// Number of unfinished tasks of a group.
+// Tasks can depend on a counter: they are queued once it is done.
+// A counter must not be destroyed before being done.
+//
+
+class LXCORE_API LXTaskCounter
+{
+	friend class LXThreadManager;
+
+public:
+
+	LXTaskCounter() {}
+	~LXTaskCounter();
+
+	bool IsDone() const;
+
+private:
+
+	LXTaskCounter(const LXTaskCounter&) = delete;
+	LXTaskCounter& operator=(const LXTaskCounter&) = delete;
+
+	// The mutex is the last member touched by a finished task, so a waiter can release the counter once IsDone
+	mutable std::mutex _Mutex;
+	uint _Count = 0;
+	vector<LXTask*> _Dependents;
+};
+
+//
+// Task scheduler: a pool of worker threads, each with a deque of tasks.
+// A worker pushes and pops its tasks at the back, the idle workers steal at the front.
+// Tasks queued by the other threads (Main, Render...) go in a shared queue.
+// The background tasks are executed by the workers only, when nothing else is queued.
+//
+
+class LXCORE_API LXThreadManager
 {
 
 public:
 
-	LXThreadManager();
+	// WorkerCount 0: one worker per core, the calling threads helping while they wait.
+	LXThreadManager(uint WorkerCount = 0);
 	~LXThreadManager();
-	
+
+	// Queues Func. The Counter is incremented now and decremented when Func returns.
+	// With a Dependency, Func is queued once the Dependency is done.
+	void Run(std::function<void()> Func, LXTaskCounter* Counter = nullptr, LXTaskCounter* Dependency = nullptr);
+
+	// Queues a long task, to complete over several frames: never executed by a waiting thread.
+	void RunBackground(std::function<void()> Func, LXTaskCounter* Counter = nullptr);
+
+	// Executes the queued tasks of the Counter until it is done.
+	void Wait(const LXTaskCounter& Counter);
+
+	// Calls Func(Index) for each Index in [0, Count), by tasks of BatchSize indices.
+	// The calling thread takes part in the work and returns when all the calls are done.
+	void ParallelFor(uint Count, uint BatchSize, const std::function<void(uint)>& Func);
+
+	uint GetWorkerCount() const { return (uint)_Workers.size(); }
+	bool IsWorkerThread() const;
+
+private:
+
+	struct TWorker
+	{
+		std::thread Thread;
+		std::mutex Mutex;
+		std::deque<LXTask*> Tasks;
+	};
+
+	void WorkerMain(uint WorkerIndex);
+	void Push(LXTask* Task);
+	// With a Counter, only a task of this Counter
+	LXTask* Pop(const LXTaskCounter* Counter = nullptr);
+	void Execute(LXTask* Task);
+
+private:
+
+	vector<unique_ptr<TWorker>> _Workers;
+
+	std::mutex _SharedMutex;
+	std::deque<LXTask*> _SharedTasks;
+	std::deque<LXTask*> _BackgroundTasks;
+
+	// Idle workers
+	std::mutex _SleepMutex;
+	std::condition_variable _WakeUp;
+	std::atomic<uint> _QueuedTasks{ 0 };
+	std::atomic<bool> _Exit{ false };
 };
 
 LXCORE_API extern DWORD MainThread;
@@ -28,3 +117,9 @@ static bool IsMainThread()	{ return ::GetCurrentThreadId() == MainThread; }
 static bool IsRenderThread() { return ::GetCurrentThreadId() == RenderThread; }
 static bool IsLoadingThread() { return ::GetCurrentThreadId() == LoadingThread; }
 
+LXCORE_API LXThreadManager* GetThreadManager();
+
+// Calls Func(Index) for each Index in [0, Count) on worker threads.
+// The calling thread takes part in the work and returns when all the calls are done.
+LXCORE_API void ParallelFor(uint Count, const std::function<void(uint)>& Func);
+LXCORE_API void ParallelFor(uint Count, uint BatchSize, const std::function<void(uint)>& Func);
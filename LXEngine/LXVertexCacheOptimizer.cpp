@@ -0,0 +1,390 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "LXVertexCacheOptimizer.h"
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	// Forsyth scoring: the cache is modeled larger than the hardware one, the last triangle vertices
+	// get a fixed score to avoid the strips, the low valences are boosted to avoid the lone triangles.
+	const uint kScoreCacheSize = 32;
+	const uint kScoreMaxValence = 32;
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+	const float kValenceBoostScale = 2.f;
+	const float kValenceBoostPower = 0.5f;
+
+	// Overdraw clusters cut on the flushes of this cache
+	const uint kOverdrawCacheSize = 16;
+
+	struct TScoreTables
+	{
+		float Cache[kScoreCacheSize];
+		float Valence[kScoreMaxValence + 1];
+
+		TScoreTables()
+		{
+			for (uint i = 0; i < kScoreCacheSize; i++)
+				Cache[i] = i < 3 ? kLastTriangleScore : powf(1.f - (i - 3) / (float)(kScoreCacheSize - 3), kCacheDecayPower);
+
+			Valence[0] = 0.f;
+			for (uint i = 1; i <= kScoreMaxValence; i++)
+				Valence[i] = kValenceBoostScale * powf((float)i, -kValenceBoostPower);
+		}
+	};
+
+	const TScoreTables ScoreTables;
+
+	float GetVertexScore(int CachePosition, uint Valence)
+	{
+		// No triangle left
+		if (Valence == 0)
+			return -1.f;
+
+		const float CacheScore = CachePosition >= 0 ? ScoreTables.Cache[CachePosition] : 0.f;
+		return CacheScore + ScoreTables.Valence[min(Valence, kScoreMaxValence)];
+	}
+
+	// Per triangle transformed vertices, FIFO cache
+	void SimulateCache(const ArrayUint& Indices, uint VertexCount, uint CacheSize, vector<uint8>& OutMisses)
+	{
+		// Vertex in cache when it was pushed less than CacheSize misses ago
+		vector<uint> Timestamps(VertexCount, 0);
+		uint Time = CacheSize + 1;
+
+		const uint TriangleCount = (uint)Indices.size() / 3;
+		OutMisses.resize(TriangleCount);
+
+		for (uint t = 0; t < TriangleCount; t++)
+		{
+			uint8 Misses = 0;
+			for (uint k = 0; k < 3; k++)
+			{
+				const uint v = Indices[t * 3 + k];
+				if (Time - Timestamps[v] > CacheSize)
+				{
+					Timestamps[v] = Time++;
+					Misses++;
+				}
+			}
+			OutMisses[t] = Misses;
+		}
+	}
+};
+
+void LXVertexCacheOptimizer::OptimizeVertexCache(ArrayUint& Indices, uint VertexCount)
+{
+	const uint TriangleCount = (uint)Indices.size() / 3;
+	if (TriangleCount == 0)
+		return;
+
+	// Remaining triangles per vertex: the first Valences[v] of its adjacency
+	vector<uint> Offsets(VertexCount + 1, 0);
+	for (uint Index : Indices)
+		Offsets[Index + 1]++;
+	for (uint i = 0; i < VertexCount; i++)
+		Offsets[i + 1] += Offsets[i];
+
+	vector<uint> Valences(VertexCount);
+	for (uint i = 0; i < VertexCount; i++)
+		Valences[i] = Offsets[i + 1] - Offsets[i];
+
+	vector<uint> Adjacency(Indices.size());
+	{
+		vector<uint> Fill(Offsets.begin(), Offsets.end() - 1);
+		for (uint t = 0; t < TriangleCount; t++)
+			for (uint k = 0; k < 3; k++)
+				Adjacency[Fill[Indices[t * 3 + k]]++] = t;
+	}
+
+	vector<int> CachePositions(VertexCount, -1);
+	vector<float> VertexScores(VertexCount);
+	for (uint i = 0; i < VertexCount; i++)
+		VertexScores[i] = GetVertexScore(-1, Valences[i]);
+
+	uint BestTriangle = 0;
+	float BestScore = -FLT_MAX;
+
+	vector<float> TriangleScores(TriangleCount);
+	for (uint t = 0; t < TriangleCount; t++)
+	{
+		const uint* Triangle = &Indices[t * 3];
+		TriangleScores[t] = VertexScores[Triangle[0]] + VertexScores[Triangle[1]] + VertexScores[Triangle[2]];
+		if (TriangleScores[t] > BestScore)
+		{
+			BestScore = TriangleScores[t];
+			BestTriangle = t;
+		}
+	}
+
+	vector<bool> Emitted(TriangleCount, false);
+	uint Cursor = 0;
+
+	uint Cache[kScoreCacheSize + 3];
+	uint NewCache[kScoreCacheSize + 3];
+	uint CacheCount = 0;
+
+	ArrayUint Output;
+	Output.reserve(Indices.size());
+
+	for (uint i = 0; i < TriangleCount; i++)
+	{
+		// Dead end, none of the cached vertices has a triangle left: the next one in the input order
+		if (BestTriangle == UINT_MAX)
+		{
+			while (Emitted[Cursor])
+				Cursor++;
+			BestTriangle = Cursor;
+		}
+
+		const uint* Triangle = &Indices[BestTriangle * 3];
+		Output.insert(Output.end(), Triangle, Triangle + 3);
+		Emitted[BestTriangle] = true;
+
+		// Triangle vertices in front, then the previous cache
+		uint NewCount = 0;
+		for (uint k = 0; k < 3; k++)
+		{
+			if (find(NewCache, NewCache + NewCount, Triangle[k]) == NewCache + NewCount)
+				NewCache[NewCount++] = Triangle[k];
+		}
+
+		for (uint c = 0; c < CacheCount; c++)
+		{
+			const uint v = Cache[c];
+			if (v != Triangle[0] && v != Triangle[1] && v != Triangle[2])
+				NewCache[NewCount++] = v;
+		}
+
+		for (uint k = 0; k < 3; k++)
+		{
+			const uint v = Triangle[k];
+			uint* Begin = &Adjacency[Offsets[v]];
+			uint* End = Begin + Valences[v];
+			uint* It = find(Begin, End, BestTriangle);
+			CHK(It != End);
+			swap(*It, *(End - 1));
+			Valences[v]--;
+		}
+
+		for (uint c = kScoreCacheSize; c < NewCount; c++)
+			CachePositions[NewCache[c]] = -1;
+
+		CacheCount = min(NewCount, kScoreCacheSize);
+		copy(NewCache, NewCache + CacheCount, Cache);
+
+		// Score changes of the cached and evicted vertices, to their remaining triangles
+		for (uint c = 0; c < NewCount; c++)
+		{
+			const uint v = NewCache[c];
+			if (c < kScoreCacheSize)
+				CachePositions[v] = c;
+
+			const float Score = GetVertexScore(CachePositions[v], Valences[v]);
+			const float Delta = Score - VertexScores[v];
+			VertexScores[v] = Score;
+
+			for (uint a = Offsets[v], End = Offsets[v] + Valences[v]; a < End; a++)
+				TriangleScores[Adjacency[a]] += Delta;
+		}
+
+		// Next triangle among the ones of the cached vertices
+		BestTriangle = UINT_MAX;
+		BestScore = -FLT_MAX;
+
+		for (uint c = 0; c < CacheCount; c++)
+		{
+			const uint v = Cache[c];
+			for (uint a = Offsets[v], End = Offsets[v] + Valences[v]; a < End; a++)
+			{
+				const uint t = Adjacency[a];
+				if (TriangleScores[t] > BestScore)
+				{
+					BestScore = TriangleScores[t];
+					BestTriangle = t;
+				}
+			}
+		}
+	}
+
+	Indices.swap(Output);
+}
+
+void LXVertexCacheOptimizer::OptimizeOverdraw(ArrayUint& Indices, const ArrayVec3f& Positions, float Threshold)
+{
+	const uint TriangleCount = (uint)Indices.size() / 3;
+	if (TriangleCount == 0)
+		return;
+
+	vector<uint8> Misses;
+	SimulateCache(Indices, (uint)Positions.size(), kOverdrawCacheSize, Misses);
+
+	// Hard boundaries at the flushes, where the 3 vertices miss
+	vector<uint> HardStarts;
+	for (uint t = 0; t < TriangleCount; t++)
+	{
+		if (t == 0 || Misses[t] == 3)
+			HardStarts.push_back(t);
+	}
+	HardStarts.push_back(TriangleCount);
+
+	// Soft boundaries, where the running ACMR from a flushed cache is good enough: more clusters to sort
+	// for a small cache cost
+	vector<uint> Timestamps(Positions.size(), 0);
+	uint Time = kOverdrawCacheSize + 1;
+
+	vector<uint> Starts;
+	for (size_t h = 0; h + 1 < HardStarts.size(); h++)
+	{
+		const uint Begin = HardStarts[h];
+		const uint End = HardStarts[h + 1];
+
+		uint HardMisses = 0;
+		for (uint t = Begin; t < End; t++)
+			HardMisses += Misses[t];
+		const float HardACMR = HardMisses / (float)(End - Begin);
+
+		Starts.push_back(Begin);
+
+		uint Start = Begin;
+		uint RunningMisses = 0;
+		Time += kOverdrawCacheSize + 1;
+
+		for (uint t = Begin; t < End; t++)
+		{
+			for (uint k = 0; k < 3; k++)
+			{
+				const uint v = Indices[t * 3 + k];
+				if (Time - Timestamps[v] > kOverdrawCacheSize)
+				{
+					Timestamps[v] = Time++;
+					RunningMisses++;
+				}
+			}
+
+			if (t + 1 < End && RunningMisses <= Threshold * HardACMR * (t + 1 - Start))
+			{
+				Start = t + 1;
+				RunningMisses = 0;
+				Time += kOverdrawCacheSize + 1;
+				Starts.push_back(Start);
+			}
+		}
+	}
+
+	const uint ClusterCount = (uint)Starts.size();
+	Starts.push_back(TriangleCount);
+
+	// Area weighted centroids and normals
+	vector<vec3f> Centroids(ClusterCount, vec3f(0.f, 0.f, 0.f));
+	vector<vec3f> Normals(ClusterCount, vec3f(0.f, 0.f, 0.f));
+	vec3f MeshCentroid(0.f, 0.f, 0.f);
+	float MeshArea = 0.f;
+
+	for (uint c = 0; c < ClusterCount; c++)
+	{
+		float ClusterArea = 0.f;
+		for (uint t = Starts[c]; t < Starts[c + 1]; t++)
+		{
+			const vec3f& p0 = Positions[Indices[t * 3 + 0]];
+			const vec3f& p1 = Positions[Indices[t * 3 + 1]];
+			const vec3f& p2 = Positions[Indices[t * 3 + 2]];
+			const vec3f Normal = CrossProduct(p1 - p0, p2 - p0);
+			const float Area = Normal.Length();
+
+			Centroids[c] += (p0 + p1 + p2) * (Area / 3.f);
+			Normals[c] += Normal;
+			ClusterArea += Area;
+		}
+
+		MeshCentroid += Centroids[c];
+		MeshArea += ClusterArea;
+
+		if (ClusterArea > 0.f)
+			Centroids[c] = Centroids[c] * (1.f / ClusterArea);
+	}
+
+	if (MeshArea > 0.f)
+		MeshCentroid = MeshCentroid * (1.f / MeshArea);
+
+	// Outer facing first: they are likely to occlude the others
+	vector<float> Keys(ClusterCount);
+	for (uint c = 0; c < ClusterCount; c++)
+	{
+		const float Length = Normals[c].Length();
+		Keys[c] = Length > 0.f ? Dot(Centroids[c] - MeshCentroid, Normals[c]) / Length : 0.f;
+	}
+
+	vector<uint> Order(ClusterCount);
+	for (uint c = 0; c < ClusterCount; c++)
+		Order[c] = c;
+
+	stable_sort(Order.begin(), Order.end(), [&Keys](uint a, uint b) { return Keys[a] > Keys[b]; });
+
+	ArrayUint Output;
+	Output.reserve(Indices.size());
+	for (uint c : Order)
+		Output.insert(Output.end(), Indices.begin() + Starts[c] * 3, Indices.begin() + Starts[c + 1] * 3);
+
+	Indices.swap(Output);
+}
+
+uint LXVertexCacheOptimizer::OptimizeVertexFetch(const ArrayUint& Indices, uint VertexCount, ArrayUint& OutRemap)
+{
+	OutRemap.assign(VertexCount, UINT_MAX);
+
+	uint Next = 0;
+	for (uint Index : Indices)
+	{
+		if (OutRemap[Index] == UINT_MAX)
+			OutRemap[Index] = Next++;
+	}
+
+	const uint ReferencedCount = Next;
+
+	for (uint& Remap : OutRemap)
+	{
+		if (Remap == UINT_MAX)
+			Remap = Next++;
+	}
+
+	return ReferencedCount;
+}
+
+TVertexCacheStats LXVertexCacheOptimizer::AnalyzeVertexCache(const ArrayUint& Indices, uint VertexCount, uint CacheSize)
+{
+	TVertexCacheStats Stats;
+
+	const uint TriangleCount = (uint)Indices.size() / 3;
+	if (TriangleCount == 0)
+		return Stats;
+
+	vector<uint8> Misses;
+	SimulateCache(Indices, VertexCount, CacheSize, Misses);
+
+	uint TotalMisses = 0;
+	for (uint8 TriangleMisses : Misses)
+		TotalMisses += TriangleMisses;
+
+	vector<bool> Referenced(VertexCount, false);
+	uint ReferencedCount = 0;
+	for (uint Index : Indices)
+	{
+		if (!Referenced[Index])
+		{
+			Referenced[Index] = true;
+			ReferencedCount++;
+		}
+	}
+
+	Stats.ACMR = TotalMisses / (float)TriangleCount;
+	Stats.ATVR = TotalMisses / (float)ReferencedCount;
+	return Stats;
+}
@@ -0,0 +1,44 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "LXVec3.h"
+
+// Transformed vertices per triangle (ACMR) and per referenced vertex (ATVR), 1 being the ideal ATVR
+struct TVertexCacheStats
+{
+	float ACMR = 0.f;
+	float ATVR = 0.f;
+};
+
+//
+// Reordering of the indexed triangle lists for the GPU.
+// The triangles are ordered for the post-transform cache with the Forsyth linear-speed algorithm,
+// then optionally by clusters for the overdraw (Sander, Nehab, Barczak), the outer facing clusters first.
+// The vertices are finally ordered by first use for the fetch locality.
+//
+
+class LXVertexCacheOptimizer
+{
+
+public:
+
+	static void OptimizeVertexCache(ArrayUint& Indices, uint VertexCount);
+
+	// Indices must already be ordered for the cache: the clusters are cut at the cache flushes, or where
+	// their ACMR gets under Threshold x the one of their flush interval.
+	static void OptimizeOverdraw(ArrayUint& Indices, const ArrayVec3f& Positions, float Threshold);
+
+	// OutRemap gives the new vertex of each vertex: in the first use order, then the unreferenced ones.
+	// Returns the referenced vertex count.
+	static uint OptimizeVertexFetch(const ArrayUint& Indices, uint VertexCount, ArrayUint& OutRemap);
+
+	// Simulated FIFO cache
+	static TVertexCacheStats AnalyzeVertexCache(const ArrayUint& Indices, uint VertexCount, uint CacheSize);
+};
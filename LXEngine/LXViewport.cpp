@@ -10,6 +10,7 @@
 #include "LXActorMesh.h"
 #include "LXActorMeshGizmo.h"
 #include "LXAnchor.h"
+#include "LXAssetManager.h"
 #include "LXAssetMesh.h"
 #include "LXCommandManager.h"
 #include "LXConsoleManager.h"
@@ -654,6 +655,10 @@ bool LXViewport::DropMaterial( LXMaterial* pMaterial, LXPoint pntWnd )
 
 bool LXViewport::DropAssetMesh(LXAssetMesh* AssetMesh, LXPoint pntWnd)
 {
+	// The actor gets its mesh when the asset is loaded
+	if (AssetMesh->State == LXAsset::EResourceState::LXResourceState_Unloaded)
+		GetProject()->GetAssetManager().LoadAssetAsync(AssetMesh, EAssetPriority::Visible);
+
 	LXActorMesh* ActorMesh = new LXActorMesh();
 	ActorMesh->SetMesh(AssetMesh->GetMesh());
 	ActorMesh->SetAssetMesh(AssetMesh);
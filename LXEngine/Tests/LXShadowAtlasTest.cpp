@@ -0,0 +1,274 @@
+//------------------------------------------------------------------------------------------------------
+//
+// This is a part of Seetron Engine
+//
+// Copyright (c) 2018 Nicolas Arques. All rights reserved.
+//
+//------------------------------------------------------------------------------------------------------
+
+//
+// Standalone test of LXShadowAtlasPacker and LXShadowAtlas: a console program built with
+// LXShadowAtlas.cpp only, returning the number of failed checks.
+//
+
+#include "stdafx.h"
+#include "LXShadowAtlas.h"
+#include <cstdio>
+#include <random>
+#include "LXMemory.h" // --- Must be the last included ---
+
+namespace
+{
+	uint FailureCount = 0;
+
+	void Check(bool Condition, const char* Expression, int Line)
+	{
+		if (!Condition)
+		{
+			printf("LXShadowAtlasTest(%i): check failed: %s\n", Line, Expression);
+			FailureCount++;
+		}
+	}
+
+	#define TEST_CHECK(Condition) Check(Condition, #Condition, __LINE__)
+
+	const uint kAtlasSize = 2048;
+	const uint kMinSize = 128;
+	const uint kMaxSize = 1024;
+
+	// The tiles are in the atlas, aligned on their size and do not overlap, counted in MinSize cells
+	bool AreTilesValid(const vector<TShadowAtlasTile>& Tiles, uint AtlasSize, uint MinSize)
+	{
+		const uint CellCount = AtlasSize / MinSize;
+		vector<uint8> Cells(CellCount * CellCount, 0);
+
+		for (const TShadowAtlasTile& Tile : Tiles)
+		{
+			if (Tile.Size == 0)
+				continue;
+
+			if (Tile.X + Tile.Size > AtlasSize || Tile.Y + Tile.Size > AtlasSize || Tile.X % Tile.Size || Tile.Y % Tile.Size)
+				return false;
+
+			for (uint y = Tile.Y / MinSize; y < (Tile.Y + Tile.Size) / MinSize; y++)
+			{
+				for (uint x = Tile.X / MinSize; x < (Tile.X + Tile.Size) / MinSize; x++)
+				{
+					if (Cells[y * CellCount + x])
+						return false;
+					Cells[y * CellCount + x] = 1;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void TestRoundSize()
+	{
+		LXShadowAtlasPacker Packer(kAtlasSize, kMinSize);
+		TEST_CHECK(Packer.RoundSize(0) == kMinSize);
+		TEST_CHECK(Packer.RoundSize(kMinSize) == kMinSize);
+		TEST_CHECK(Packer.RoundSize(kMinSize + 1) == kMinSize * 2);
+		TEST_CHECK(Packer.RoundSize(1000) == 1024);
+		TEST_CHECK(Packer.RoundSize(kAtlasSize * 4) == kAtlasSize);
+	}
+
+	void TestFill()
+	{
+		// 16 tiles of 512 fill the atlas, a 17th does not fit
+		LXShadowAtlasPacker Packer(kAtlasSize, kMinSize);
+		vector<TShadowAtlasTile> Tiles(16);
+
+		for (TShadowAtlasTile& Tile : Tiles)
+			TEST_CHECK(Packer.Allocate(512, Tile) && Tile.Size == 512);
+
+		TShadowAtlasTile Tile;
+		TEST_CHECK(!Packer.Allocate(kMinSize, Tile));
+		TEST_CHECK(Packer.GetUsedArea() == (uint64)kAtlasSize * kAtlasSize);
+		TEST_CHECK(AreTilesValid(Tiles, kAtlasSize, kMinSize));
+
+		// A freed tile is reused
+		Packer.Free(Tiles[5]);
+		TEST_CHECK(Packer.Allocate(512, Tile) && Tile.X == Tiles[5].X && Tile.Y == Tiles[5].Y);
+	}
+
+	void TestMerge()
+	{
+		// The smallest free node is split: the small tiles share a large node
+		LXShadowAtlasPacker Packer(kAtlasSize, kMinSize);
+		TShadowAtlasTile Small[2];
+		TShadowAtlasTile Large;
+
+		TEST_CHECK(Packer.Allocate(kMinSize, Small[0]));
+		TEST_CHECK(Packer.Allocate(kMinSize, Small[1]));
+		TEST_CHECK(Small[0].X / 1024 == Small[1].X / 1024 && Small[0].Y / 1024 == Small[1].Y / 1024);
+		TEST_CHECK(Packer.Allocate(1024, Large));
+
+		// All freed, the siblings merge back up to the whole atlas
+		Packer.Free(Small[0]);
+		Packer.Free(Large);
+		Packer.Free(Small[1]);
+
+		TShadowAtlasTile Whole;
+		TEST_CHECK(Packer.GetUsedArea() == 0);
+		TEST_CHECK(Packer.Allocate(kAtlasSize, Whole) && Whole.Size == kAtlasSize && Whole.X == 0 && Whole.Y == 0);
+	}
+
+	void TestChurn()
+	{
+		LXShadowAtlasPacker Packer(kAtlasSize, kMinSize);
+		vector<TShadowAtlasTile> Tiles;
+		std::mt19937 Random(1234);
+		uint64 UsedArea = 0;
+
+		for (uint i = 0; i < 20000; i++)
+		{
+			if (Tiles.empty() || Random() % 2)
+			{
+				TShadowAtlasTile Tile;
+				if (Packer.Allocate(kMinSize << (Random() % 4), Tile))
+				{
+					Tiles.push_back(Tile);
+					UsedArea += (uint64)Tile.Size * Tile.Size;
+				}
+			}
+			else
+			{
+				const uint Index = Random() % Tiles.size();
+				Packer.Free(Tiles[Index]);
+				UsedArea -= (uint64)Tiles[Index].Size * Tiles[Index].Size;
+				Tiles[Index] = Tiles.back();
+				Tiles.pop_back();
+			}
+
+			if (i % 500 == 0)
+			{
+				TEST_CHECK(AreTilesValid(Tiles, kAtlasSize, kMinSize));
+				TEST_CHECK(Packer.GetUsedArea() == UsedArea);
+			}
+		}
+
+		for (const TShadowAtlasTile& Tile : Tiles)
+			Packer.Free(Tile);
+
+		TShadowAtlasTile Tile;
+		TEST_CHECK(Packer.Allocate(kAtlasSize, Tile));
+	}
+
+	void TestFixedTiles()
+	{
+		// Min and max sizes equal: every light gets the same tile size, whatever its coverage
+		LXShadowAtlas ShadowAtlas(kAtlasSize, 512, 512);
+		uint Keys[17] = {};
+
+		for (uint i = 0; i < 17; i++)
+			ShadowAtlas.Request(&Keys[i], i / 17.f, 1.f);
+		ShadowAtlas.Update();
+
+		uint TileCount = 0;
+		for (uint i = 0; i < 17; i++)
+		{
+			const TShadowAtlasTile& Tile = ShadowAtlas.GetTile(&Keys[i]);
+			TEST_CHECK(Tile.Size == 0 || Tile.Size == 512);
+			TileCount += Tile.Size > 0;
+		}
+
+		// The lowest coverage has no tile
+		TEST_CHECK(TileCount == 16);
+		TEST_CHECK(ShadowAtlas.GetTile(&Keys[0]).Size == 0);
+	}
+
+	void TestHysteresis()
+	{
+		LXShadowAtlas ShadowAtlas(kAtlasSize, kMinSize, kMaxSize);
+		const uint Key = 0;
+		uint ResizeCount = 0;
+
+		// A coverage alternating faster than the resize delay keeps the tile
+		for (uint Frame = 0; Frame < 100; Frame++)
+		{
+			ShadowAtlas.Request(&Key, (Frame / 5) % 2 ? 1.f : 0.25f, 1.f);
+			ShadowAtlas.Update();
+			ResizeCount += ShadowAtlas.GetResizeCount();
+		}
+
+		TEST_CHECK(ResizeCount == 0);
+
+		// A lasting change resizes it
+		for (uint Frame = 0; Frame < 30; Frame++)
+		{
+			ShadowAtlas.Request(&Key, 0.01f, 1.f);
+			ShadowAtlas.Update();
+			ResizeCount += ShadowAtlas.GetResizeCount();
+		}
+
+		TEST_CHECK(ResizeCount == 1);
+		TEST_CHECK(ShadowAtlas.GetTile(&Key).Size == ShadowAtlas.GetDesiredSize(0.01f));
+	}
+
+	void TestLRU()
+	{
+		// A light coming back gets its tile back
+		LXShadowAtlas ShadowAtlas(kAtlasSize, kMinSize, kMaxSize);
+		const uint Keys[2] = {};
+
+		ShadowAtlas.Request(&Keys[0], 1.f, 1.f);
+		ShadowAtlas.Update();
+		const TShadowAtlasTile Tile = ShadowAtlas.GetTile(&Keys[0]);
+		TEST_CHECK(Tile.Size == kMaxSize);
+
+		ShadowAtlas.Request(&Keys[1], 0.01f, 1.f);
+		ShadowAtlas.Update();
+		TEST_CHECK(ShadowAtlas.GetTile(&Keys[0]).Size == 0);
+
+		ShadowAtlas.Request(&Keys[0], 1.f, 1.f);
+		ShadowAtlas.Update();
+		TEST_CHECK(ShadowAtlas.GetTile(&Keys[0]).X == Tile.X && ShadowAtlas.GetTile(&Keys[0]).Y == Tile.Y);
+		TEST_CHECK(ShadowAtlas.GetEvictionCount() == 0);
+	}
+
+	void TestManyLights()
+	{
+		// Over budget: the tiles shrink and never overlap, the highest coverage is served first
+		LXShadowAtlas ShadowAtlas(kAtlasSize, kMinSize, kMaxSize);
+		vector<float> Coverages(1000);
+		vector<TShadowAtlasTile> Tiles(Coverages.size());
+		std::mt19937 Random(1234);
+		std::uniform_real_distribution<float> RandomUnit(0.f, 1.f);
+
+		for (float& Coverage : Coverages)
+			Coverage = RandomUnit(Random);
+		Coverages[0] = 1.f;
+
+		for (uint Frame = 0; Frame < 20; Frame++)
+		{
+			for (uint i = 0; i < (uint)Coverages.size(); i++)
+				ShadowAtlas.Request(&Coverages[i], Coverages[i], (float)i);
+			ShadowAtlas.Update();
+
+			for (uint i = 0; i < (uint)Coverages.size(); i++)
+				Tiles[i] = ShadowAtlas.GetTile(&Coverages[i]);
+
+			TEST_CHECK(AreTilesValid(Tiles, kAtlasSize, kMinSize));
+		}
+
+		TEST_CHECK(Tiles[0].Size > 0);
+		TEST_CHECK(ShadowAtlas.GetTileCount() == (kAtlasSize / kMinSize) * (kAtlasSize / kMinSize));
+	}
+};
+
+int main()
+{
+	TestRoundSize();
+	TestFill();
+	TestMerge();
+	TestChurn();
+	TestFixedTiles();
+	TestHysteresis();
+	TestLRU();
+	TestManyLights();
+
+	printf("LXShadowAtlasTest: %s (%u failed checks)\n", FailureCount ? "FAILED" : "passed", FailureCount);
+	return (int)FailureCount;
+}